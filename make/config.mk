@@ -31,6 +31,29 @@ ifndef INIT
   export INIT := sysvinit
 endif
 
+#
+# Payload compression. See $(ONL)/tools/onlcompress.py.
+#
+# ONL_SWI_COMPRESSION    : the SWI root squashfs
+# ONL_INITRD_COMPRESSION : the loader initrd and rootfs cpio
+# ONL_FIT_COMPRESSION    : the FIT kernel images
+#
+# Each defaults to ONL_<X>_COMPRESSION_<ARCH>, then gzip, so they
+# can be selected per architecture. The target kernel, U-Boot and
+# loader must support the chosen compressor.
+#
+ifndef ONL_SWI_COMPRESSION
+ONL_SWI_COMPRESSION = $(or $(ONL_SWI_COMPRESSION_$(ARCH)),gzip)
+endif
+
+ifndef ONL_INITRD_COMPRESSION
+ONL_INITRD_COMPRESSION = $(or $(ONL_INITRD_COMPRESSION_$(ARCH)),gzip)
+endif
+
+ifndef ONL_FIT_COMPRESSION
+ONL_FIT_COMPRESSION = $(or $(ONL_FIT_COMPRESSION_$(ARCH)),gzip)
+endif
+
 # Use the new module database tool to resolve dependencies dynamically.
 ifndef BUILDER_MODULE_DATABASE
 export BUILDER_MODULE_DATABASE := $(ONL)/make/modules/modules.json
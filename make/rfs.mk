@@ -40,6 +40,12 @@ ifdef RFS_SQUASH
 RFS_COMMAND += --squash $(RFS_SQUASH)
 endif
 
+RFS_COMMAND += --squash-compression $(ONL_SWI_COMPRESSION) --cpio-compression $(ONL_INITRD_COMPRESSION)
+
+ifdef RFS_LAYER_CACHE
+RFS_COMMAND += --layer-cache $(RFS_LAYER_CACHE)
+endif
+
 ifndef RFS_MANIFEST
 RFS_MANIFEST := etc/onl/rootfs/manifest.json
 endif
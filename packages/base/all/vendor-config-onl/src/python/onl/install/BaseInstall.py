@@ -15,8 +15,9 @@ import zipfile
 import shutil
 import imp
 import fnmatch, glob
+import threading
 
-from InstallUtils import SubprocessMixin
+from InstallUtils import SubprocessMixin, ImageWriter
 from InstallUtils import MountContext, BlkidParser, PartedParser, UbinfoParser
 from InstallUtils import ProcMountsParser
 from InstallUtils import GdiskParser
@@ -116,46 +117,111 @@ class Base:
         zf, self.zf = self.zf, None
         if zf: zf.close()
 
-    def installerCopy(self, basename, dst, optional=False):
-        """Copy the file as-is, or get it from the installer zip."""
+    def installerOpen(self, basename):
+        """Open an installer file, as-is or from the installer zip.
+
+        Returns a (file object, size) tuple, or (None, None).
+        ZipFile.open() re-opens the archive for each member,
+        so files may be read from concurrent install steps.
+        """
 
         src = os.path.join(self.im.installerConf.installer_dir, basename)
         if os.path.exists(src):
-            self.copy2(src, dst)
-            return True
+            return open(src, "rb"), os.path.getsize(src)
 
         if basename in self.zf.namelist():
+            return (self.zf.open(basename, "r"),
+                    self.zf.getinfo(basename).file_size,)
+
+        return None, None
+
+    def installerCopy(self, basename, dst, optional=False):
+        """Copy the file as-is, or get it from the installer zip."""
+
+        rfd, sz = self.installerOpen(basename)
+        if rfd is None:
+            if not optional:
+                raise ValueError("missing installer file %s" % basename)
+            return False
+
+        src = os.path.join(self.im.installerConf.installer_dir, basename)
+        if os.path.exists(src):
+            self.log.debug("+ /bin/cp -a %s %s", src, dst)
+        else:
             self.log.debug("+ unzip -p %s %s > %s",
                            self.im.installerConf.installer_zip, basename, dst)
-            with self.zf.open(basename, "r") as rfd:
-                with open(dst, "wb") as wfd:
-                    shutil.copyfileobj(rfd, wfd)
-            return True
+        with rfd:
+            ImageWriter(dst, log=self.log).write(rfd, sz)
 
-        if not optional:
-            raise ValueError("missing installer file %s" % basename)
+        if os.path.exists(src):
+            shutil.copystat(src, dst)
 
-        return False
+        return True
 
     def installerDd(self, basename, device):
 
-        p = os.path.join(self.im.installerConf.installer_dir, basename)
-        if os.path.exists(p):
-            cmd = ('dd',
-                   'if=' + basename,
-                   'of=' + device,)
-            self.check_call(cmd, vmode=self.V2)
-            return
+        rfd, sz = self.installerOpen(basename)
+        if rfd is None:
+            raise ValueError("cannot find file %s" % basename)
 
-        if basename in self.zf.namelist():
-            self.log.debug("+ unzip -p %s %s | dd of=%s",
-                           self.im.installerConf.installer_zip, basename, device)
-            with self.zf.open(basename, "r") as rfd:
-                with open(device, "rb+") as wfd:
-                    shutil.copyfileobj(rfd, wfd)
-            return
+        self.log.debug("+ unzip -p %s %s | dd of=%s",
+                       self.im.installerConf.installer_zip, basename, device)
+        with rfd:
+            ImageWriter(device, log=self.log).write(rfd, sz)
 
-        raise ValueError("cannot find file %s" % basename)
+    def installerDisk(self, label):
+        """Find the disk holding the partition with this label."""
+        try:
+            return self.blkidParts[label].splitDev()[0]
+        except (IndexError, TypeError):
+            return self.device
+
+    def installParallel(self, steps):
+        """Run install steps, concurrently if they are on separate disks.
+
+        'steps' is a list of (partition label, step) tuples.
+        Steps on the same disk are run in order, and stop at the first
+        failure. Returns the first non-zero step result, in step order.
+        """
+
+        groups = []
+        for label, step in steps:
+            disk = self.installerDisk(label)
+            for g in groups:
+                if g[0] == disk:
+                    g[1].append(step)
+                    break
+            else:
+                groups.append((disk, [step],))
+
+        results = {}
+
+        def _run(disk, steps):
+            try:
+                for step in steps:
+                    code = step()
+                    results[step] = code
+                    if code: return
+            except Exception:
+                results[disk] = sys.exc_info()
+
+        if len(groups) > 1:
+            self.log.info("installing to %s concurrently",
+                          ", ".join(str(g[0]) for g in groups))
+            threads = [threading.Thread(target=_run, args=g) for g in groups]
+            [t.start() for t in threads]
+            [t.join() for t in threads]
+        else:
+            [_run(*g) for g in groups]
+
+        for disk, _ in groups:
+            if disk in results:
+                ei = results[disk]
+                raise ei[0], ei[1], ei[2]
+        for label, step in steps:
+            code = results.get(step, None)
+            if code: return code
+        return 0
 
     def installerExists(self, basename):
         if basename in os.listdir(self.im.installerConf.installer_dir): return True
@@ -807,19 +873,11 @@ class GrubInstaller(SubprocessMixin, Base):
         self.im.grubEnv.__dict__['bootPart'] = dev.device
         self.im.grubEnv.__dict__['bootDir'] = None
 
-        code = self.installSwi()
-        if code: return code
-
-        code = self.installLoader()
-        if code: return code
-
-        code = self.installGrubCfg()
-        if code: return code
-
-        code = self.installBootConfig()
-        if code: return code
-
-        code = self.installOnlConfig()
+        code = self.installParallel([('ONL-IMAGES', self.installSwi,),
+                                     ('ONL-BOOT', self.installLoader,),
+                                     ('ONL-BOOT', self.installGrubCfg,),
+                                     ('ONL-BOOT', self.installBootConfig,),
+                                     ('ONL-CONFIG', self.installOnlConfig,),])
         if code: return code
 
         code = self.installGrub()
@@ -1289,21 +1347,16 @@ class UbootInstaller(SubprocessMixin, UBIfsCreater):
                 self.rawLoaderDevice = self.device + str(partIdx+1)
                 break
 
-        code = self.installSwi()
-        if code: return code
-
-        code = self.installLoader()
-        if code: return code
-
+        steps = [('ONL-IMAGES', self.installSwi,),
+                 ('ONL-BOOT', self.installLoader,),]
         if self.rawLoaderDevice is None:
-            code = self.installBootConfig()
-            if code: return code
+            steps.append(('ONL-BOOT', self.installBootConfig,))
         else:
             self.log.info("ONL-BOOT is a raw partition (%s), skipping boot-config",
                           self.rawLoaderDevice)
+        steps.append(('ONL-CONFIG', self.installOnlConfig,))
 
-
-        code = self.installOnlConfig()
+        code = self.installParallel(steps)
         if code: return code
 
         self.log.info("syncing block devices")
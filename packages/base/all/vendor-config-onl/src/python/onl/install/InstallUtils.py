@@ -10,6 +10,13 @@ import tempfile
 import string
 import shutil
 import re
+import errno
+import fcntl
+import struct
+import mmap
+import hashlib
+import time
+import ctypes, ctypes.util
 
 import Fit, Legacy
 
@@ -202,6 +209,191 @@ class SubprocessMixin:
                 dst = os.path.join(dstRoot, subdir)
                 self.copy2(src, dst)
 
+class ImageWriter(SubprocessMixin):
+    """Write an image stream to a block device or a regular file.
+
+    Data is written in large page-aligned blocks, with O_DIRECT if the
+    destination supports it.
+
+    All-zero blocks are not written if the destination already reads
+    back as zero. Block devices are discarded (BLKDISCARD) up front so
+    that flash devices usually do; regular files are left sparse.
+
+    A SHA-256 of the image is computed while writing, and the
+    destination is read back after it has been flushed and checked
+    against it.
+    """
+
+    BLOCKSIZE = 4 * 1024 * 1024
+
+    BLKDISCARD = 0x1277
+    # _IO(0x12,119)
+
+    POSIX_FADV_DONTNEED = 4
+
+    _libc = None
+
+    def __init__(self, dst, discard=True, verify=True, log=None):
+        self.dst = dst
+        self.discard = discard
+        self.verify = verify
+        self.log = log or logging.getLogger("imagewriter")
+
+        self.isBlock = False
+        self.fd = None
+        self.direct = False
+        self.discarded = False
+        self.skipped = 0
+
+    @classmethod
+    def libc(cls):
+        if cls._libc is None:
+            name = ctypes.util.find_library('c') or 'libc.so.6'
+            cls._libc = ctypes.CDLL(name, use_errno=True)
+        return cls._libc
+
+    def _open(self):
+        try:
+            st = os.stat(self.dst)
+            self.isBlock = stat.S_ISBLK(st.st_mode)
+        except OSError:
+            self.isBlock = False
+
+        flags = os.O_WRONLY
+        if not self.isBlock:
+            flags |= os.O_CREAT | os.O_TRUNC
+        try:
+            self.fd = os.open(self.dst, flags | getattr(os, 'O_DIRECT', 0), 0o644)
+            self.direct = hasattr(os, 'O_DIRECT')
+        except OSError as ex:
+            if ex.errno != errno.EINVAL: raise
+            self.fd = os.open(self.dst, flags, 0o644)
+            self.direct = False
+
+    def _setDirect(self, direct):
+        if self.direct == direct: return
+        fl = fcntl.fcntl(self.fd, fcntl.F_GETFL)
+        if direct:
+            fl |= os.O_DIRECT
+        else:
+            fl &= ~os.O_DIRECT
+        fcntl.fcntl(self.fd, fcntl.F_SETFL, fl)
+        self.direct = direct
+
+    def _discard(self, size):
+        if not self.isBlock or not self.discard or size is None: return
+        devSize = os.lseek(self.fd, 0, os.SEEK_END)
+        os.lseek(self.fd, 0, os.SEEK_SET)
+        # discard whole pages, never past the end of the device
+        sz = min((size + 4095) & ~4095, devSize)
+        try:
+            fcntl.ioctl(self.fd, self.BLKDISCARD, struct.pack('QQ', 0, sz))
+            self.discarded = True
+            self.log.debug("+ blkdiscard -l %d %s", sz, self.dst)
+        except IOError as ex:
+            self.log.debug("%s: discard not supported: %s", self.dst, str(ex))
+
+    def _readsZero(self, off, n):
+        """Test if the destination already reads back as zero."""
+        if not self.isBlock:
+            # holes in a truncated file
+            return True
+        if not self.discarded:
+            return False
+        with open(self.dst, "rb") as fd:
+            fd.seek(off)
+            return fd.read(n).count(b'\0') == n
+
+    def _write(self, buf, n):
+        if self.direct and n % 4096:
+            # unaligned tail
+            self._setDirect(False)
+        addr = ctypes.addressof(ctypes.c_char.from_buffer(buf))
+        done = 0
+        while done < n:
+            rv = self.libc().write(self.fd, ctypes.c_void_p(addr + done),
+                                   ctypes.c_size_t(n - done))
+            if rv < 0:
+                e = ctypes.get_errno()
+                if e == errno.EINVAL and self.direct:
+                    # O_DIRECT accepted by open() but not by write()
+                    self._setDirect(False)
+                    continue
+                raise OSError(e, "%s: %s" % (self.dst, os.strerror(e),))
+            done += rv
+
+    def _fill(self, rfd, buf):
+        """Fill buf from rfd, returning the number of bytes read."""
+        n = 0
+        while n < self.BLOCKSIZE:
+            data = rfd.read(self.BLOCKSIZE - n)
+            if not data: break
+            buf[n:n+len(data)] = data
+            n += len(data)
+        return n
+
+    def _check(self, size, digest):
+        """Flush, drop the cached pages and compare with the written image."""
+        os.fsync(self.fd)
+        self.libc().posix_fadvise(self.fd, 0, 0, self.POSIX_FADV_DONTNEED)
+        ck = hashlib.sha256()
+        with open(self.dst, "rb") as fd:
+            left = size
+            while left > 0:
+                data = fd.read(min(left, self.BLOCKSIZE))
+                if not data: break
+                ck.update(data)
+                left -= len(data)
+        if left > 0 or ck.hexdigest() != digest:
+            raise ValueError("%s: verify failed (sha256 %s, expected %s)"
+                             % (self.dst, ck.hexdigest(), digest,))
+
+    def write(self, rfd, size=None):
+        """Write the contents of rfd, returning the SHA-256 hex digest.
+
+        'size' is the size of the image, if known, used to limit the
+        discard range.
+        """
+
+        self._open()
+        buf = mmap.mmap(-1, self.BLOCKSIZE)
+        zero = b'\0' * self.BLOCKSIZE
+        ck = hashlib.sha256()
+        off = 0
+        t0 = time.time()
+        try:
+            self._discard(size)
+            while True:
+                n = self._fill(rfd, buf)
+                if not n: break
+                data = buf[:n]
+                ck.update(data)
+                if data == zero[:n] and self._readsZero(off, n):
+                    os.lseek(self.fd, n, os.SEEK_CUR)
+                    self.skipped += 1
+                else:
+                    self._write(buf, n)
+                off += n
+                if n < self.BLOCKSIZE: break
+
+            if not self.isBlock:
+                os.ftruncate(self.fd, off)
+
+            digest = ck.hexdigest()
+            if self.verify:
+                self._check(off, digest)
+            else:
+                os.fsync(self.fd)
+        finally:
+            os.close(self.fd)
+            self.fd = None
+            buf.close()
+
+        dt = max(time.time() - t0, 0.001)
+        self.log.debug("+ imagewrite %s (%d bytes, %d zero blocks skipped, %.1f MiB/s, sha256 %s)",
+                       self.dst, off, self.skipped, off / dt / 1048576, digest)
+        return digest
+
 class TempdirContext(SubprocessMixin):
 
     def __init__(self, prefix=None, suffix=None, chroot=None, log=None):
@@ -965,6 +1157,10 @@ class InitrdContext(SubprocessMixin):
             c1 = ('bzip2', '-dc', self.initrd,)
         elif mbuf[0:6] == "\xfd7zXZ\x00":
             c1 = ('xz', '-dc', self.initrd,)
+        elif mbuf[0:4] == "\x02\x21\x4c\x18":
+            c1 = ('lz4', '-dc', self.initrd,)
+        elif mbuf[0:4] == "\x28\xb5\x2f\xfd":
+            c1 = ('zstd', '-dc', self.initrd,)
         else:
             raise ValueError("cannot decode initrd")
         c2 = ('cpio', '-imd',)
@@ -85,6 +85,9 @@ typedef struct faultd_server_s faultd_server_t;
 
 typedef int faultd_sid_t; 
 
+/** The service id of the crash ring service. */
+#define FAULTD_SID_RING FAULTD_CONFIG_SERVICE_PIPES_MAX
+
 /**
  * @brief Create a faultd server object. 
  * @param rfso Receives the faultd_server object. 
@@ -117,11 +120,23 @@ faultd_sid_t faultd_server_add(faultd_server_t* fso, char* pipename);
 int faultd_server_remove(faultd_server_t* fso, char* pipename, 
                          faultd_sid_t sid); 
 
+/**
+ * @brief Add the crash ring service to the server. 
+ * @param fso The faultd server object. 
+ * @param sockname The registration socket name. 
+ * @returns FAULTD_SID_RING
+ * @note FAULTD_CONFIG_RING_SOCKET_DEFAULT will be used if sockname is NULL. 
+ * @note Processes register a shared memory crash ring through this socket.
+ * Fault records are written lock-free from the signal handler and
+ * symbolized here, offline, using the build-id of each module.
+ */
+faultd_sid_t faultd_server_ring_add(faultd_server_t* fso, const char* sockname); 
+
 /**
  * @brief Read a fault message from any service pipe. 
  * @param fso The faultd server object. 
  * @param info The fault information. 
-  * @note if sid == -1, all services will be polled. 
+ * @note if sid == -1, all services (including the crash ring) will be polled. 
  * @note else the given service will be polled. 
  * @returns The sid from which the message was received. 
  */
@@ -181,6 +196,15 @@ void faultd_client_destroy(faultd_client_t* fco);
  *
  *
  *****************************************************************************/
+/**
+ * @brief Register the fault handler. 
+ * @param localfd If >= 0, the signal and backtrace are also written here. 
+ * @param pipename The named pipe filename. 
+ * @param binaryname The binary name to report. 
+ * @note Faults are reported through the crash ring at 
+ * FAULTD_CONFIG_RING_SOCKET_DEFAULT if a server is listening there, 
+ * otherwise through the named pipe. 
+ */
 int faultd_handler_register(int localfd, 
                             const char* pipename, 
                             const char* binaryname); 
@@ -188,6 +188,46 @@
 #define FAULTD_CONFIG_MAIN_PIPENAME "/var/run/faultd.fifo"
 #endif
 
+/**
+ * FAULTD_CONFIG_RING_SOCKET_DEFAULT
+ *
+ * Default crash ring registration socket. */
+
+
+#ifndef FAULTD_CONFIG_RING_SOCKET_DEFAULT
+#define FAULTD_CONFIG_RING_SOCKET_DEFAULT "/var/run/faultd.sock"
+#endif
+
+/**
+ * FAULTD_CONFIG_RING_SIZE
+ *
+ * Number of fault records in each process crash ring. */
+
+
+#ifndef FAULTD_CONFIG_RING_SIZE
+#define FAULTD_CONFIG_RING_SIZE 8
+#endif
+
+/**
+ * FAULTD_CONFIG_RING_MAPS_SIZE
+ *
+ * Maximum size of the executable mappings captured with each fault record. */
+
+
+#ifndef FAULTD_CONFIG_RING_MAPS_SIZE
+#define FAULTD_CONFIG_RING_MAPS_SIZE 8192
+#endif
+
+/**
+ * FAULTD_CONFIG_RING_CLIENTS_MAX
+ *
+ * Maximum number of processes registered with a crash ring server. */
+
+
+#ifndef FAULTD_CONFIG_RING_CLIENTS_MAX
+#define FAULTD_CONFIG_RING_CLIENTS_MAX 256
+#endif
+
 
 
 /**
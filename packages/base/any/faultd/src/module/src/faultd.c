@@ -28,6 +28,9 @@
 #include <errno.h>
 
 #include <execinfo.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "faultd_int.h"
 #include "faultd_log.h"
 
 
@@ -50,7 +53,7 @@ typedef struct faultd_service_s {
      * There is not necessarily a writer for the pipe at all times, as
      * this depends on whether any clients are currently connected. 
      *
-     * The server wants to use select() on the named pipe to wait for
+     * The server wants to use epoll on the named pipe to wait for
      * any client connections, but this only works properly if
      * there is a writer connected to the pipe from which we are reading. 
      *
@@ -68,6 +71,24 @@ typedef struct faultd_service_s {
 
 
 
+/**
+ * A process registered with the crash ring service.
+ */
+typedef struct faultd_ring_client_s {
+    /** Registration socket. Closed by the client when it exits. */
+    int sock;
+    /** The shared crash ring */
+    faultd_ring_t* ring;
+} faultd_ring_client_t;
+
+/**
+ * epoll tags for the crash ring descriptors.
+ * Service pipes are tagged with their sid.
+ */
+#define FAULTD_EPOLL_RING_DOORBELL  FAULTD_SID_RING
+#define FAULTD_EPOLL_RING_LISTEN    (FAULTD_SID_RING + 1)
+#define FAULTD_EPOLL_RING_CLIENT    (FAULTD_SID_RING + 2)
+
 /**
  * faultd Server Object
  */
@@ -76,6 +97,21 @@ struct faultd_server_s {
     faultd_service_t services[FAULTD_CONFIG_SERVICE_PIPES_MAX]; 
     /** The last service from which we read a message */
     int sid_last;
+
+    /** All service descriptors */
+    int epollfd;
+
+    /** Crash ring service */
+    char* ring_sockname;
+    int ring_lfd;
+    int ring_doorbell;
+    faultd_ring_client_t ring_clients[FAULTD_CONFIG_RING_CLIENTS_MAX];
+
+    /** Crash ring records harvested but not yet read */
+    faultd_info_t ring_pending[FAULTD_CONFIG_RING_SIZE];
+    int ring_pending_count;
+    int ring_pending_next;
+
 }; /* faultd_server_t */
 
 
@@ -89,11 +125,43 @@ faultd_server_create(faultd_server_t** rfso)
     }
 
     fso = aim_zmalloc(sizeof(*fso)); 
+    fso->ring_lfd = -1;
+    fso->ring_doorbell = -1;
+
+    if((fso->epollfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        AIM_LOG_ERROR("epoll_create1(): %s", strerror(errno));
+        AIM_FREE(fso);
+        return -1;
+    }
 
     *rfso = fso; 
     return 0;
 }
 
+static int
+epoll_add__(faultd_server_t* fso, int fd, uint32_t tag)
+{
+    struct epoll_event ev;
+    FAULTD_MEMSET(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = tag;
+    if(epoll_ctl(fso->epollfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        AIM_LOG_ERROR("epoll_ctl(): %s", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static void
+ring_client_remove__(faultd_server_t* fso, int c)
+{
+    faultd_ring_client_t* rc = fso->ring_clients + c;
+    epoll_ctl(fso->epollfd, EPOLL_CTL_DEL, rc->sock, NULL);
+    close(rc->sock);
+    faultd_ring_release(rc->ring);
+    FAULTD_MEMSET(rc, 0, sizeof(*rc));
+}
+
 void
 faultd_server_destroy(faultd_server_t* fso)
 {
@@ -102,6 +170,11 @@ faultd_server_destroy(faultd_server_t* fso)
         for(i = 0; i < AIM_ARRAYSIZE(fso->services); i++) { 
             faultd_server_remove(fso, NULL, i); 
         }
+        faultd_server_remove(fso, NULL, FAULTD_SID_RING);
+        for(i = 0; i < fso->ring_pending_count; i++) {
+            AIM_FREE(fso->ring_pending[fso->ring_pending_next + i].backtrace_symbols);
+        }
+        close(fso->epollfd);
         AIM_FREE(fso); 
     }
 }
@@ -177,7 +250,7 @@ faultd_server_add(faultd_server_t* fso, char* pipename)
              * a client a client to open() it for writing. 
              *
              * We now want all reads on the pipe to be blocking so 
-             * we can use select() to pend on clients. 
+             * we can use epoll to pend on clients. 
              *
              * Reset the pipe to blocking here:
              */
@@ -189,6 +262,10 @@ faultd_server_add(faultd_server_t* fso, char* pipename)
                 goto server_add_failed;
             }
 
+            if(epoll_add__(fso, sp->pipefd, i) < 0) {
+                goto server_add_failed;
+            }
+
             /* Good to go. 'i' is the service id.  */
             return i;
         }
@@ -208,15 +285,70 @@ faultd_server_remove(faultd_server_t* fso, char* pipename,
     if(fso == NULL) {
         return -1; 
     }
+    else if(sid == FAULTD_SID_RING) {
+        int c;
+        for(c = 0; c < AIM_ARRAYSIZE(fso->ring_clients); c++) {
+            if(fso->ring_clients[c].ring) {
+                ring_client_remove__(fso, c);
+            }
+        }
+        if(fso->ring_lfd >= 0) {
+            close(fso->ring_lfd);
+            unlink(fso->ring_sockname);
+            fso->ring_lfd = -1;
+        }
+        if(fso->ring_doorbell >= 0) {
+            close(fso->ring_doorbell);
+            fso->ring_doorbell = -1;
+        }
+        if(fso->ring_sockname) {
+            AIM_FREE(fso->ring_sockname);
+            fso->ring_sockname = NULL;
+        }
+        return 0;
+    }
     else if(sid < 0 || sid >= AIM_ARRAYSIZE(fso->services)) {
         return -1; 
     }
     else {
+        if(fso->services[sid].pipefd) {
+            epoll_ctl(fso->epollfd, EPOLL_CTL_DEL, fso->services[sid].pipefd, NULL);
+        }
         faultd_service_destroy__(fso->services + sid); 
         return 0; 
     }
 }
 
+faultd_sid_t
+faultd_server_ring_add(faultd_server_t* fso, const char* sockname)
+{
+    if(fso == NULL || fso->ring_lfd >= 0) {
+        return -1;
+    }
+    if(sockname == NULL) {
+        sockname = FAULTD_CONFIG_RING_SOCKET_DEFAULT;
+    }
+
+    fso->ring_sockname = aim_strdup(sockname);
+
+    if((fso->ring_doorbell = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) {
+        AIM_LOG_ERROR("eventfd(): %s", strerror(errno));
+        goto ring_add_failed;
+    }
+    if((fso->ring_lfd = faultd_ring_listen(sockname)) < 0) {
+        goto ring_add_failed;
+    }
+    if(epoll_add__(fso, fso->ring_doorbell, FAULTD_EPOLL_RING_DOORBELL) < 0 ||
+       epoll_add__(fso, fso->ring_lfd, FAULTD_EPOLL_RING_LISTEN) < 0) {
+        goto ring_add_failed;
+    }
+    return FAULTD_SID_RING;
+
+ ring_add_failed:
+    faultd_server_remove(fso, NULL, FAULTD_SID_RING);
+    return -1;
+}
+
 int 
 faultd_server_process(faultd_server_t* fdo, faultd_sid_t sid,
                       int count, aim_pvs_t* pvs, int decode)
@@ -380,112 +512,174 @@ write_size__(int fd, char* src, int size)
     return size; 
 }
 
-int 
-faultd_wait_services__(faultd_server_t* fso, int sid, fd_set* rfds)
+/**
+ * Read a fault message from a service pipe.
+ */
+static int
+pipe_read__(faultd_server_t* fso, int s, faultd_info_t* info)
 {
-    int rv; 
-    int maxfd; 
+    int rv = read_size__(fso->services[s].pipefd, (char*)info, sizeof(*info));
 
-    FD_ZERO(rfds); 
+    if(rv < 0) {
+        /* Do something here, like restare the pipe */
+        AIM_LOG_ERROR("truncated read on pipe.");
+        return -1;
+    }
 
-    if(sid < 0 && sid >= AIM_ARRAYSIZE(fso->services) && sid != -1) { 
-        /* invalid sid */
-        return -1; 
+    /**
+     * Backtrace symbols information available?
+     */
+    if(info->backtrace_symbols) {
+        /*
+         * The backtrace symbol information is of variable length.
+         */
+        info->backtrace_symbols = aim_zmalloc(FAULTD_CONFIG_BACKTRACE_SYMBOLS_SIZE);
+        /* Backtrace symbols are terminated with a null character. */
+        read_until__(fso->services[s].pipefd, 0, info->backtrace_symbols,
+                     FAULTD_CONFIG_BACKTRACE_SYMBOLS_SIZE);
     }
-    
-    if(sid == -1) { 
-        /* All services */
-        int i; 
-        for(i = 0, maxfd = 0; i < AIM_ARRAYSIZE(fso->services); i++) { 
-            if(fso->services[i].pipefd) { 
-                FD_SET(fso->services[i].pipefd, rfds); 
-                if(fso->services[i].pipefd > maxfd) { 
-                    maxfd = fso->services[i].pipefd; 
-                }
-            }
+
+    info->pipename = fso->services[s].pipename;
+    fso->sid_last = s;
+    return s;
+}
+
+/**
+ * Collect completed records from all crash rings.
+ */
+static void
+ring_harvest__(faultd_server_t* fso)
+{
+    int c;
+
+    fso->ring_pending_next = 0;
+    for(c = 0; c < AIM_ARRAYSIZE(fso->ring_clients) &&
+            fso->ring_pending_count < FAULTD_CONFIG_RING_SIZE; c++) {
+        if(fso->ring_clients[c].ring) {
+            fso->ring_pending_count +=
+                faultd_ring_harvest(fso->ring_clients[c].ring,
+                                    fso->ring_pending + fso->ring_pending_count,
+                                    FAULTD_CONFIG_RING_SIZE - fso->ring_pending_count);
         }
     }
-    else { 
-        /* Single service */
-        if(fso->services[sid].pipefd == 0) { 
-            /* Invalid sid */
-            return -1;
-        }
-        else {
-            FD_SET(fso->services[sid].pipefd, rfds); 
-            maxfd = fso->services[sid].pipefd; 
-        }
+}
+
+static void
+ring_accept__(faultd_server_t* fso)
+{
+    faultd_ring_t* ring;
+    int c;
+    int sock = faultd_ring_accept(fso->ring_lfd, fso->ring_doorbell, &ring);
+
+    if(sock < 0) {
+        return;
     }
 
-    /* Wait on configured services */
-    do { 
-        rv = select(maxfd+1, rfds, NULL, NULL, NULL); 
-    } while(rv == -1 && errno == EINTR); 
+    for(c = 0; c < AIM_ARRAYSIZE(fso->ring_clients); c++) {
+        if(fso->ring_clients[c].ring == NULL) {
+            fso->ring_clients[c].sock = sock;
+            fso->ring_clients[c].ring = ring;
+            if(epoll_add__(fso, sock, FAULTD_EPOLL_RING_CLIENT + c) < 0) {
+                ring_client_remove__(fso, c);
+            }
+            return;
+        }
+    }
 
-    return rv; 
+    AIM_LOG_ERROR("Too many crash ring clients.");
+    close(sock);
+    faultd_ring_release(ring);
 }
 
-
-int 
+int
 faultd_server_read(faultd_server_t* fso, faultd_info_t* info, int sid)
 {
-    int i;      
-    int rv; 
-    fd_set rfds;
-    int count; 
+    struct epoll_event events[FAULTD_CONFIG_SERVICE_PIPES_MAX + 8];
+    int i, rv;
 
-    rv = faultd_wait_services__(fso, sid, &rfds); 
-    
-    if(rv < 0) { 
-        /* Error on select or sid */
-        return rv; 
+    if(sid >= 0 && sid < AIM_ARRAYSIZE(fso->services)) {
+        /* Single service. The pipe is in blocking mode. */
+        if(fso->services[sid].pipefd == 0) {
+            /* Invalid sid */
+            return -1;
+        }
+        return pipe_read__(fso, sid, info);
     }
 
-    /** 
-     * Read message on a ready descriptor.
-     *
-     * If we're polling all services, we start looking for the 
-     * next sid after the last sid we've received a message on. 
-     * This avoids starvation if multiple services are producing
-     * messages. This is unlikely to be a problem under normal
-     * circumstances and use cases, but can be avoided easily nonetheless. 
-     */
-    for(i = fso->sid_last+1, count = 0; 
-        count < AIM_ARRAYSIZE(fso->services); 
-        i++, count++) { 
-        int s = i % AIM_ARRAYSIZE(fso->services); 
-        if(FD_ISSET(fso->services[s].pipefd, &rfds)) { 
-            rv = read_size__(fso->services[s].pipefd, (char*)info, sizeof(*info)); 
-    
-            if(rv < 0) { 
-                /* Do something here, like restare the pipe */
-                AIM_LOG_ERROR("truncated read on pipe."); 
-                continue; 
+    for(;;) {
+        int ready = -1;
+
+        /* Crash ring records are returned first. */
+        if(fso->ring_pending_count == 0) {
+            ring_harvest__(fso);
+        }
+        if(fso->ring_pending_count) {
+            *info = fso->ring_pending[fso->ring_pending_next++];
+            fso->ring_pending_count--;
+            info->pipename = fso->ring_sockname;
+            return FAULTD_SID_RING;
+        }
+
+        rv = epoll_wait(fso->epollfd, events, AIM_ARRAYSIZE(events), -1);
+        if(rv < 0) {
+            if(errno == EINTR) {
+                continue;
             }
-            
-            /**
-             * Backtrace symbols information available? 
-             */
-            if(info->backtrace_symbols) { 
+            AIM_LOG_ERROR("epoll_wait(): %s", strerror(errno));
+            return -1;
+        }
+
+        for(i = 0; i < rv; i++) {
+            uint32_t tag = events[i].data.u32;
+
+            if(tag == FAULTD_EPOLL_RING_DOORBELL) {
+                uint64_t v;
+                if(read(fso->ring_doorbell, &v, sizeof(v)) < 0) {
+                    /* Nothing pending. */
+                }
+            }
+            else if(tag == FAULTD_EPOLL_RING_LISTEN) {
+                ring_accept__(fso);
+            }
+            else if(tag >= FAULTD_EPOLL_RING_CLIENT) {
                 /*
-                 * The backtrace symbol information is of variable length. 
+                 * The client process has exited. Its last records
+                 * are collected before the ring is released. If
+                 * records are still pending this is handled on the
+                 * next wakeup.
+                 */
+                int c = tag - FAULTD_EPOLL_RING_CLIENT;
+                if(fso->ring_pending_count == 0) {
+                    fso->ring_pending_next = 0;
+                    fso->ring_pending_count =
+                        faultd_ring_harvest(fso->ring_clients[c].ring,
+                                            fso->ring_pending,
+                                            FAULTD_CONFIG_RING_SIZE);
+                    ring_client_remove__(fso, c);
+                }
+            }
+            else if(tag < AIM_ARRAYSIZE(fso->services)) {
+                /**
+                 * Start looking for the next sid after the last sid
+                 * we've received a message on. This avoids starvation
+                 * if multiple services are producing messages.
                  */
-                info->backtrace_symbols = aim_zmalloc(FAULTD_CONFIG_BACKTRACE_SYMBOLS_SIZE); 
-                /* Backtrace symbols are terminated with a null character. */
-                read_until__(fso->services[s].pipefd, 0, info->backtrace_symbols, 
-                             FAULTD_CONFIG_BACKTRACE_SYMBOLS_SIZE); 
+                int n = AIM_ARRAYSIZE(fso->services);
+                if(ready < 0 ||
+                   (tag - fso->sid_last - 1 + n) % n <
+                   (ready - fso->sid_last - 1 + n) % n) {
+                    ready = tag;
+                }
             }
+        }
 
-            info->pipename = fso->services[s].pipename; 
-            fso->sid_last = s; 
-            return s; 
+        if(ready >= 0) {
+            return pipe_read__(fso, ready, info);
         }
     }
-    /* Error while reading on the only ready descriptor */
-    return -1; 
 }
-        
- 
+
+
 int
 faultd_client_write(faultd_client_t* fco, faultd_info_t* info)
 {
@@ -99,6 +99,26 @@ faultd_config_settings_t faultd_config_settings[] =
     { __faultd_config_STRINGIFY_NAME(FAULTD_CONFIG_MAIN_PIPENAME), __faultd_config_STRINGIFY_VALUE(FAULTD_CONFIG_MAIN_PIPENAME) },
 #else
 { FAULTD_CONFIG_MAIN_PIPENAME(__faultd_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef FAULTD_CONFIG_RING_SOCKET_DEFAULT
+    { __faultd_config_STRINGIFY_NAME(FAULTD_CONFIG_RING_SOCKET_DEFAULT), __faultd_config_STRINGIFY_VALUE(FAULTD_CONFIG_RING_SOCKET_DEFAULT) },
+#else
+{ FAULTD_CONFIG_RING_SOCKET_DEFAULT(__faultd_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef FAULTD_CONFIG_RING_SIZE
+    { __faultd_config_STRINGIFY_NAME(FAULTD_CONFIG_RING_SIZE), __faultd_config_STRINGIFY_VALUE(FAULTD_CONFIG_RING_SIZE) },
+#else
+{ FAULTD_CONFIG_RING_SIZE(__faultd_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef FAULTD_CONFIG_RING_MAPS_SIZE
+    { __faultd_config_STRINGIFY_NAME(FAULTD_CONFIG_RING_MAPS_SIZE), __faultd_config_STRINGIFY_VALUE(FAULTD_CONFIG_RING_MAPS_SIZE) },
+#else
+{ FAULTD_CONFIG_RING_MAPS_SIZE(__faultd_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef FAULTD_CONFIG_RING_CLIENTS_MAX
+    { __faultd_config_STRINGIFY_NAME(FAULTD_CONFIG_RING_CLIENTS_MAX), __faultd_config_STRINGIFY_VALUE(FAULTD_CONFIG_RING_CLIENTS_MAX) },
+#else
+{ FAULTD_CONFIG_RING_CLIENTS_MAX(__faultd_config_STRINGIFY_NAME), "__undefined__" },
 #endif
     { NULL, NULL }
 };
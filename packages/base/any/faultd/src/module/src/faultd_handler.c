@@ -43,6 +43,7 @@
 #include <pthread.h>
 #define _XOPEN_SOURCE 600
 #include <sys/select.h>
+#include "faultd_int.h"
 
 
 static pthread_spinlock_t thread_lock__;
@@ -50,6 +51,11 @@ static faultd_client_t* faultd_client__ = NULL;
 static faultd_info_t faultd_info__;
 static int localfd__ = -1;
 
+/** Crash ring shared with the server, if registered */
+static faultd_ring_t* faultd_ring__ = NULL;
+static int faultd_doorbell__ = -1;
+static int faultd_ring_sock__ = -1;
+
 int signal_backtrace__(void** buffer, int size, ucontext_t* context,
                               int distance)
 {
@@ -72,10 +78,63 @@ int signal_backtrace__(void** buffer, int size, ucontext_t* context,
     return rv;
 }
   #include <AIM/aim_pvs.h>
+
+/**
+ * strsignal() is not async-signal-safe.
+ */
+static const char*
+signame__(int signal)
+{
+    switch(signal)
+        {
+        case SIGSEGV: return "Segmentation fault";
+        case SIGILL: return "Illegal instruction";
+        case SIGFPE: return "Floating point exception";
+        case SIGBUS: return "Bus error";
+        case SIGQUIT: return "Quit";
+        case SIGALRM: return "Alarm clock";
+        case SIGUSR2: return "User defined signal 2";
+        default: return "Unknown signal";
+        }
+}
+
+static void
+fill_info__(faultd_info_t* info, int signal, siginfo_t* siginfo,
+            int last_errno)
+{
+    if(info != &faultd_info__) {
+        FAULTD_MEMCPY(info->binary, faultd_info__.binary, sizeof(info->binary));
+    }
+    info->pid = getpid();
+    info->tid = syscall(SYS_gettid);
+    info->signal = signal;
+    info->signal_code = siginfo->si_code;
+    info->fault_address = siginfo->si_addr;
+    info->last_errno = last_errno;
+}
+
 static void
 faultd_signal_handler__(int signal, siginfo_t* siginfo, void* context)
 {
     int rv;
+    int last_errno = errno;
+    faultd_ring_record_t* record;
+
+    /*
+     * The crash ring needs no lock. Each faulting thread
+     * claims its own record.
+     */
+    if(faultd_ring__ && (record = faultd_ring_claim(faultd_ring__))) {
+        fill_info__(&record->info, signal, siginfo, last_errno);
+        record->info.backtrace_size = signal_backtrace__(record->info.backtrace,
+                                                         AIM_ARRAYSIZE(record->info.backtrace),
+                                                         context, 0);
+        faultd_ring_commit(faultd_ring__, record, faultd_doorbell__);
+        if(localfd__ < 0) {
+            errno = last_errno;
+            return;
+        }
+    }
 
     /*
      * Make sure we syncronize properly with other threads that
@@ -92,12 +151,7 @@ faultd_signal_handler__(int signal, siginfo_t* siginfo, void* context)
     /*
      * Generate our fault information.
      */
-    faultd_info__.pid = getpid();
-    faultd_info__.tid = 0;
-    faultd_info__.signal = signal;
-    faultd_info__.signal_code = siginfo->si_code;
-    faultd_info__.fault_address = siginfo->si_addr;
-    faultd_info__.last_errno = errno;
+    fill_info__(&faultd_info__, signal, siginfo, last_errno);
 
     faultd_info__.backtrace_size = signal_backtrace__(faultd_info__.backtrace,
                                                       AIM_ARRAYSIZE(faultd_info__.backtrace),
@@ -107,10 +161,9 @@ faultd_signal_handler__(int signal, siginfo_t* siginfo, void* context)
         faultd_client_write(faultd_client__, &faultd_info__);
     }
     if(localfd__ >= 0) {
-        char* signame = strsignal(faultd_info__.signal);
-        char* nl = "\n";
-        write(localfd__, signame, strlen(signame)+1);
-        write(localfd__, nl, 2);
+        const char* signame = signame__(faultd_info__.signal);
+        write(localfd__, signame, FAULTD_STRLEN(signame));
+        write(localfd__, "\n", 1);
         backtrace_symbols_fd(faultd_info__.backtrace,
                              faultd_info__.backtrace_size,
                              localfd__);
@@ -120,9 +173,9 @@ faultd_signal_handler__(int signal, siginfo_t* siginfo, void* context)
      * Unlock spinlock, in case this signal wasn't fatal
      */
     pthread_spin_unlock(&thread_lock__);
+    errno = last_errno;
 }
 
-
 int
 faultd_handler_register(int localfd,
                         const char* pipename,
@@ -161,8 +214,16 @@ faultd_handler_register(int localfd,
     aim_strlcpy(faultd_info__.binary, binaryname, sizeof(faultd_info__.binary));
 
 
-    if(pipename) {
-        faultd_client_create(&faultd_client__, pipename);
+    /*
+     * Prefer the crash ring. The pipe is only used when no server
+     * is accepting ring registrations.
+     */
+    if(faultd_ring_register(FAULTD_CONFIG_RING_SOCKET_DEFAULT, &faultd_ring__,
+                            &faultd_doorbell__, &faultd_ring_sock__) < 0) {
+        faultd_ring__ = NULL;
+        if(pipename) {
+            faultd_client_create(&faultd_client__, pipename);
+        }
     }
 
     AIM_MEMSET(&saction, 0, sizeof(saction));
@@ -25,6 +25,98 @@
 #define __FAULTD_INT_H__
 
 #include <faultd/faultd_config.h>
+#include <faultd/faultd.h>
+#include <stdint.h>
+
+
+/**************************************************************************//**
+ *
+ * Crash Rings
+ *
+ * Each registered process shares a preallocated ring of fault records
+ * with the faultd server. The signal handler claims a record, fills it
+ * using only async-signal-safe operations and rings the server's
+ * eventfd doorbell. The server symbolizes the records offline.
+ *
+ *****************************************************************************/
+
+#define FAULTD_RING_MAGIC 0x46524E47
+
+/** Record is available. */
+#define FAULTD_RING_RECORD_FREE  0
+/** Record is being filled by a signal handler. */
+#define FAULTD_RING_RECORD_BUSY  1
+/** Record is complete and waiting for the server. */
+#define FAULTD_RING_RECORD_READY 2
+
+typedef struct faultd_ring_record_s {
+    /** FAULTD_RING_RECORD_* */
+    volatile uint32_t state;
+
+    /** Fault information. The pointer fields are not used. */
+    faultd_info_t info;
+
+    /** Executable mappings of the process at the time of the fault (/proc/pid/maps format) */
+    uint32_t maps_size;
+    char maps[FAULTD_CONFIG_RING_MAPS_SIZE];
+
+} faultd_ring_record_t;
+
+typedef struct faultd_ring_s {
+    uint32_t magic;
+    /** Number of records */
+    uint32_t size;
+    /** Next record to claim, modulo size */
+    volatile uint32_t head;
+    /** Faults dropped because the record was still in use */
+    volatile uint32_t dropped;
+
+    faultd_ring_record_t records[FAULTD_CONFIG_RING_SIZE];
+
+} faultd_ring_t;
+
+
+/**
+ * Client side. Create a crash ring and register it with the
+ * server listening on sockname.
+ */
+int faultd_ring_register(const char* sockname, faultd_ring_t** ring,
+                         int* doorbell, int* sock);
+
+/**
+ * Client side, async-signal-safe. Claim a free record.
+ * Returns NULL if the ring is full.
+ */
+faultd_ring_record_t* faultd_ring_claim(faultd_ring_t* ring);
+
+/**
+ * Client side, async-signal-safe. Capture the process mappings,
+ * publish the record and notify the server.
+ */
+void faultd_ring_commit(faultd_ring_t* ring, faultd_ring_record_t* record,
+                        int doorbell);
+
+/**
+ * Server side. Create the registration socket.
+ */
+int faultd_ring_listen(const char* sockname);
+
+/**
+ * Server side. Accept a registration, map its ring and
+ * send it the doorbell descriptor.
+ */
+int faultd_ring_accept(int lfd, int doorbell, faultd_ring_t** ring);
+
+/**
+ * Server side. Release a ring mapping.
+ */
+void faultd_ring_release(faultd_ring_t* ring);
+
+/**
+ * Server side. Copy out and symbolize up to max completed records.
+ * backtrace_symbols is allocated for each record returned.
+ */
+int faultd_ring_harvest(faultd_ring_t* ring, faultd_info_t* infos, int max);
 
 
 #endif /* __FAULTD_INT_H__ */
@@ -50,6 +50,7 @@ static int test__(const char* binaryname, const char* pipename);
  *
  * Hardcoded to :
  * - Listen on FAULTD_CONFIG_MAIN_PIPENAME
+ * - Accept crash ring registrations on FAULTD_CONFIG_RING_SOCKET_DEFAULT
  * - Output messages to syslog and stderr (if a tty)
  * - Daemonize and Restart on "-d", "-dr"
  */
@@ -60,13 +61,15 @@ static char help__[] =
 \n\
 SYNOPSIS\n\
 \n\
-        faultd [-dr|-d] [-pid file] [-t] [-h | --help]\n\
+        faultd [-dr|-d] [-pid file] [-p pipe] [-r socket] [-t] [-h | --help]\n\
 \n\
 OPTIONS\n\
         -d            Daemonize.\n\
 \n\
         -dr           Daemonize with automatic restart.\n\
         -p            Server pipe. Default is %s\n\
+\n\
+        -r            Crash ring registration socket. Default is %s\n\
 \n\
         -pid file     Write PID to the given filename.\n\
 \n\
@@ -88,6 +91,7 @@ faultd_main(int argc, char* argv[])
     int restart = 0;
     int test = 0;
     char* pipename = FAULTD_CONFIG_MAIN_PIPENAME;
+    char* sockname = FAULTD_CONFIG_RING_SOCKET_DEFAULT;
 
     aim_pvs_t* aim_pvs_syslog = NULL;
     faultd_server_t* faultd_server = NULL;
@@ -119,11 +123,20 @@ faultd_main(int argc, char* argv[])
                 exit(1);
             }
         }
+        else if(!strcmp(*arg, "-r")) {
+            arg++;
+            sockname = *arg;
+            if(!sockname) {
+                fprintf(stderr, "-r requires an argument.\n");
+                exit(1);
+            }
+        }
         else if(!strcmp(*arg, "-t")) {
             test = 1;
         }
         else if(!strcmp(*arg, "-h") || !strcmp(*arg, "--help")) {
-            printf(help__, FAULTD_CONFIG_MAIN_PIPENAME);
+            printf(help__, FAULTD_CONFIG_MAIN_PIPENAME,
+                   FAULTD_CONFIG_RING_SOCKET_DEFAULT);
             exit(0);
         }
     }
@@ -145,6 +158,12 @@ faultd_main(int argc, char* argv[])
         abort();
     }
 
+    if(faultd_server_ring_add(faultd_server, sockname) < 0) {
+        /* Clients fall back to the pipe. */
+        aim_printf(aim_pvs_syslog, "crash ring unavailable on %s", sockname);
+    }
+    sid = -1;
+
     if(daemonize) {
         aim_daemon_restart_config_t rconfig;
         aim_daemon_config_t config;
@@ -195,6 +214,9 @@ faultd_main(int argc, char* argv[])
             if(aim_pvs_isatty(&aim_pvs_stderr)) {
                 faultd_info_show(&faultd_info, &aim_pvs_stderr, 0);
             }
+            if(faultd_info.backtrace_symbols) {
+                aim_free(faultd_info.backtrace_symbols);
+            }
         }
     }
 }
@@ -0,0 +1,722 @@
+/**************************************************************************//**
+ * <bsn.cl fy=2013 v=onl>
+ *
+ *        Copyright 2013, 2014 BigSwitch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ *****************************************************************************/
+#include <faultd/faultd_config.h>
+#include <faultd/faultd.h>
+#include "faultd_int.h"
+#include "faultd_log.h"
+
+#include <AIM/aim.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <elf.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+
+/**************************************************************************//**
+ *
+ * Descriptor passing
+ *
+ *****************************************************************************/
+static int
+send_fd__(int sock, int fd)
+{
+    uint32_t magic = FAULTD_RING_MAGIC;
+    struct iovec iov = { &magic, sizeof(magic) };
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    struct cmsghdr* cmsg;
+
+    FAULTD_MEMSET(&msg, 0, sizeof(msg));
+    FAULTD_MEMSET(control, 0, sizeof(control));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    FAULTD_MEMCPY(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    return (sendmsg(sock, &msg, MSG_NOSIGNAL) == sizeof(magic)) ? 0 : -1;
+}
+
+static int
+recv_fd__(int sock)
+{
+    uint32_t magic = 0;
+    struct iovec iov = { &magic, sizeof(magic) };
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    struct cmsghdr* cmsg;
+    int fd;
+
+    FAULTD_MEMSET(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if(recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != sizeof(magic) ||
+       magic != FAULTD_RING_MAGIC) {
+        return -1;
+    }
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if(cmsg == NULL || cmsg->cmsg_type != SCM_RIGHTS) {
+        return -1;
+    }
+    FAULTD_MEMCPY(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
+
+
+/**************************************************************************//**
+ *
+ * Client side
+ *
+ *****************************************************************************/
+int
+faultd_ring_register(const char* sockname, faultd_ring_t** rring,
+                     int* rdoorbell, int* rsock)
+{
+    char shmname[] = "/dev/shm/faultd.XXXXXX";
+    struct sockaddr_un addr;
+    faultd_ring_t* ring = MAP_FAILED;
+    int fd, sock = -1, doorbell = -1;
+
+    if((fd = mkstemp(shmname)) < 0) {
+        return -1;
+    }
+    unlink(shmname);
+
+    if(ftruncate(fd, sizeof(*ring)) < 0) {
+        goto failed;
+    }
+    ring = mmap(NULL, sizeof(*ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(ring == MAP_FAILED) {
+        goto failed;
+    }
+    ring->size = FAULTD_CONFIG_RING_SIZE;
+    ring->magic = FAULTD_RING_MAGIC;
+
+    if((sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+        goto failed;
+    }
+    FAULTD_MEMSET(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    FAULTD_STRNCPY(addr.sun_path, sockname, sizeof(addr.sun_path)-1);
+    if(connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        goto failed;
+    }
+
+    if(send_fd__(sock, fd) < 0 || (doorbell = recv_fd__(sock)) < 0) {
+        goto failed;
+    }
+    close(fd);
+
+    /*
+     * The socket stays open for the life of the process.
+     * The server sees it close when the process exits.
+     */
+    *rring = ring;
+    *rdoorbell = doorbell;
+    *rsock = sock;
+    return 0;
+
+ failed:
+    if(sock >= 0) {
+        close(sock);
+    }
+    if(ring != MAP_FAILED) {
+        munmap(ring, sizeof(*ring));
+    }
+    close(fd);
+    return -1;
+}
+
+faultd_ring_record_t*
+faultd_ring_claim(faultd_ring_t* ring)
+{
+    uint32_t idx = __sync_fetch_and_add(&ring->head, 1) % ring->size;
+    faultd_ring_record_t* record = ring->records + idx;
+
+    if(!__sync_bool_compare_and_swap(&record->state,
+                                     FAULTD_RING_RECORD_FREE,
+                                     FAULTD_RING_RECORD_BUSY)) {
+        __sync_fetch_and_add(&ring->dropped, 1);
+        return NULL;
+    }
+    return record;
+}
+
+/**
+ * Returns true if the mapping line is executable.
+ */
+static int
+maps_line_exec__(const char* line, int len)
+{
+    int i;
+    for(i = 0; i < len; i++) {
+        if(line[i] == ' ') {
+            return (i + 3 < len) && line[i+3] == 'x';
+        }
+    }
+    return 0;
+}
+
+/**
+ * Copy the executable mappings from /proc/self/maps.
+ * Only async-signal-safe calls are used.
+ */
+static uint32_t
+maps_capture__(char* dst, uint32_t size)
+{
+    char buf[512];
+    char line[512];
+    int fd, n, i, len = 0;
+    uint32_t used = 0;
+
+    if((fd = open("/proc/self/maps", O_RDONLY)) < 0) {
+        return 0;
+    }
+
+    while((n = read(fd, buf, sizeof(buf))) > 0) {
+        for(i = 0; i < n; i++) {
+            if(len < sizeof(line)) {
+                line[len++] = buf[i];
+            }
+            if(buf[i] == '\n') {
+                if(line[len-1] == '\n' && maps_line_exec__(line, len) &&
+                   used + len <= size) {
+                    FAULTD_MEMCPY(dst + used, line, len);
+                    used += len;
+                }
+                len = 0;
+            }
+        }
+    }
+
+    close(fd);
+    return used;
+}
+
+void
+faultd_ring_commit(faultd_ring_t* ring, faultd_ring_record_t* record,
+                   int doorbell)
+{
+    uint64_t one = 1;
+
+    record->info.pipename = NULL;
+    record->info.backtrace_symbols = NULL;
+    record->maps_size = maps_capture__(record->maps, sizeof(record->maps));
+
+    __sync_synchronize();
+    record->state = FAULTD_RING_RECORD_READY;
+
+    if(write(doorbell, &one, sizeof(one)) < 0) {
+        /* The server will still find the record on its next scan. */
+    }
+}
+
+
+/**************************************************************************//**
+ *
+ * Server side
+ *
+ *****************************************************************************/
+int
+faultd_ring_listen(const char* sockname)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+        AIM_LOG_ERROR("socket(): %s", strerror(errno));
+        return -1;
+    }
+
+    FAULTD_MEMSET(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    FAULTD_STRNCPY(addr.sun_path, sockname, sizeof(addr.sun_path)-1);
+    unlink(sockname);
+
+    if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        AIM_LOG_ERROR("bind(%s): %s", sockname, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    /*
+     * Registered rings make faultd open and symbolize the client's
+     * executables, so only root (and the root group) may register.
+     */
+    chmod(sockname, 0660);
+
+    if(listen(fd, 16) < 0) {
+        AIM_LOG_ERROR("listen(%s): %s", sockname, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int
+faultd_ring_accept(int lfd, int doorbell, faultd_ring_t** rring)
+{
+    struct stat st;
+    faultd_ring_t* ring;
+    struct timeval tv = { 1, 0 };
+    struct ucred cred;
+    socklen_t credlen = sizeof(cred);
+    int sock, fd;
+
+    if((sock = accept4(lfd, NULL, NULL, SOCK_CLOEXEC)) < 0) {
+        return -1;
+    }
+    /* Don't let a misbehaving client block the server. */
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    /* The socket mode is the first check, the peer credentials the second. */
+    if(getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &credlen) < 0) {
+        AIM_LOG_ERROR("SO_PEERCRED: %s", strerror(errno));
+        close(sock);
+        return -1;
+    }
+    if(cred.uid != 0 && cred.uid != geteuid()) {
+        AIM_LOG_ERROR("crash ring registration from uid %d refused.", (int)cred.uid);
+        close(sock);
+        return -1;
+    }
+
+    if((fd = recv_fd__(sock)) < 0) {
+        AIM_LOG_ERROR("crash ring registration failed.");
+        close(sock);
+        return -1;
+    }
+
+    if(fstat(fd, &st) < 0 || st.st_size != sizeof(*ring)) {
+        AIM_LOG_ERROR("crash ring registration with the wrong ring size.");
+        goto failed;
+    }
+
+    ring = mmap(NULL, sizeof(*ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(ring == MAP_FAILED) {
+        AIM_LOG_ERROR("mmap(): %s", strerror(errno));
+        goto failed;
+    }
+    if(ring->magic != FAULTD_RING_MAGIC || ring->size != FAULTD_CONFIG_RING_SIZE) {
+        AIM_LOG_ERROR("crash ring registration with an invalid ring.");
+        munmap(ring, sizeof(*ring));
+        goto failed;
+    }
+
+    if(send_fd__(sock, doorbell) < 0) {
+        munmap(ring, sizeof(*ring));
+        goto failed;
+    }
+
+    close(fd);
+    *rring = ring;
+    return sock;
+
+ failed:
+    close(fd);
+    close(sock);
+    return -1;
+}
+
+void
+faultd_ring_release(faultd_ring_t* ring)
+{
+    if(ring) {
+        munmap(ring, sizeof(*ring));
+    }
+}
+
+
+/**
+ * An executable mapping from a fault record.
+ */
+typedef struct faultd_module_s {
+    uintptr_t start;
+    uintptr_t end;
+    uintptr_t offset;
+    char path[256];
+} faultd_module_t;
+
+#define FAULTD_MODULES_MAX 128
+
+static int
+maps_parse__(const char* maps, uint32_t size, faultd_module_t* modules, int max)
+{
+    int count = 0;
+    const char* p = maps;
+    const char* end = maps + size;
+
+    while(p < end && count < max) {
+        char line[512];
+        char perms[8];
+        unsigned long start, stop, offset;
+        const char* nl = memchr(p, '\n', end - p);
+        int len = nl ? nl - p : end - p;
+
+        if(len >= sizeof(line)) {
+            len = sizeof(line) - 1;
+        }
+        FAULTD_MEMCPY(line, p, len);
+        line[len] = 0;
+
+        modules[count].path[0] = 0;
+        if(sscanf(line, "%lx-%lx %7s %lx %*s %*s %255s",
+                  &start, &stop, perms, &offset, modules[count].path) == 5 &&
+           modules[count].path[0] == '/') {
+            modules[count].start = start;
+            modules[count].end = stop;
+            modules[count].offset = offset;
+            count++;
+        }
+        p = nl ? nl + 1 : end;
+    }
+    return count;
+}
+
+/**
+ * Read the ELF type and GNU build-id of a file.
+ */
+static int
+elf_info__(const char* path, int* type, char* build_id, int size)
+{
+    unsigned char ident[EI_NIDENT];
+    int fd, i, phnum, phentsize;
+    off_t phoff;
+
+    build_id[0] = 0;
+    *type = ET_NONE;
+
+    if((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+        return -1;
+    }
+    if(pread(fd, ident, sizeof(ident), 0) != sizeof(ident) ||
+       memcmp(ident, ELFMAG, SELFMAG)) {
+        close(fd);
+        return -1;
+    }
+
+    if(ident[EI_CLASS] == ELFCLASS64) {
+        Elf64_Ehdr eh;
+        if(pread(fd, &eh, sizeof(eh), 0) != sizeof(eh)) {
+            close(fd);
+            return -1;
+        }
+        *type = eh.e_type;
+        phoff = eh.e_phoff;
+        phnum = eh.e_phnum;
+        phentsize = eh.e_phentsize;
+    }
+    else {
+        Elf32_Ehdr eh;
+        if(pread(fd, &eh, sizeof(eh), 0) != sizeof(eh)) {
+            close(fd);
+            return -1;
+        }
+        *type = eh.e_type;
+        phoff = eh.e_phoff;
+        phnum = eh.e_phnum;
+        phentsize = eh.e_phentsize;
+    }
+
+    for(i = 0; i < phnum; i++) {
+        uint32_t p_type;
+        off_t n_off, n_end;
+
+        if(ident[EI_CLASS] == ELFCLASS64) {
+            Elf64_Phdr ph;
+            if(pread(fd, &ph, sizeof(ph), phoff + i*phentsize) != sizeof(ph)) {
+                break;
+            }
+            p_type = ph.p_type;
+            n_off = ph.p_offset;
+            n_end = ph.p_offset + ph.p_filesz;
+        }
+        else {
+            Elf32_Phdr ph;
+            if(pread(fd, &ph, sizeof(ph), phoff + i*phentsize) != sizeof(ph)) {
+                break;
+            }
+            p_type = ph.p_type;
+            n_off = ph.p_offset;
+            n_end = ph.p_offset + ph.p_filesz;
+        }
+
+        if(p_type != PT_NOTE) {
+            continue;
+        }
+
+        /* Elf32_Nhdr and Elf64_Nhdr are identical. */
+        while(n_off + (off_t)sizeof(Elf32_Nhdr) <= n_end) {
+            Elf32_Nhdr nh;
+            char name[4];
+            unsigned char desc[64];
+            if(pread(fd, &nh, sizeof(nh), n_off) != sizeof(nh)) {
+                break;
+            }
+            n_off += sizeof(nh);
+            if(nh.n_type == NT_GNU_BUILD_ID && nh.n_namesz == 4 &&
+               nh.n_descsz <= sizeof(desc) && 2*nh.n_descsz < size &&
+               pread(fd, name, 4, n_off) == 4 && !memcmp(name, "GNU", 4) &&
+               pread(fd, desc, nh.n_descsz, n_off + 4) == nh.n_descsz) {
+                int j;
+                for(j = 0; j < nh.n_descsz; j++) {
+                    sprintf(build_id + 2*j, "%02x", desc[j]);
+                }
+                close(fd);
+                return 0;
+            }
+            n_off += ((nh.n_namesz + 3) & ~3) + ((nh.n_descsz + 3) & ~3);
+        }
+    }
+
+    close(fd);
+    return 0;
+}
+
+/**
+ * Run addr2line for a batch of addresses in a single file.
+ * Each result is "function at file:line".
+ */
+static void
+addr2line__(const char* file, uintptr_t* addrs, int count, char** results)
+{
+    char* argv[FAULTD_CONFIG_BACKTRACE_SIZE_MAX + 6];
+    char args[FAULTD_CONFIG_BACKTRACE_SIZE_MAX][20];
+    int pfd[2], i, argc = 0;
+    pid_t pid;
+    FILE* fp;
+
+    argv[argc++] = "addr2line";
+    argv[argc++] = "-f";
+    argv[argc++] = "-C";
+    argv[argc++] = "-e";
+    argv[argc++] = (char*)file;
+    for(i = 0; i < count; i++) {
+        snprintf(args[i], sizeof(args[i]), "%p", (void*)addrs[i]);
+        argv[argc++] = args[i];
+    }
+    argv[argc] = NULL;
+
+    if(pipe(pfd) < 0) {
+        return;
+    }
+
+    /* No shell is involved, the file name comes from the faulting process. */
+    if((pid = fork()) == 0) {
+        int devnull = open("/dev/null", O_RDWR);
+        dup2(pfd[1], 1);
+        dup2(devnull, 2);
+        close(pfd[0]);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    close(pfd[1]);
+    if(pid < 0) {
+        close(pfd[0]);
+        return;
+    }
+
+    if((fp = fdopen(pfd[0], "r")) != NULL) {
+        for(i = 0; i < count; i++) {
+            char func[256], loc[256];
+            if(fgets(func, sizeof(func), fp) == NULL ||
+               fgets(loc, sizeof(loc), fp) == NULL) {
+                break;
+            }
+            func[strcspn(func, "\n")] = 0;
+            loc[strcspn(loc, "\n")] = 0;
+            if(strcmp(func, "??") || strncmp(loc, "??", 2)) {
+                results[i] = aim_fstrdup("%s at %s", func, loc);
+            }
+        }
+        fclose(fp);
+    }
+    else {
+        close(pfd[0]);
+    }
+    waitpid(pid, NULL, 0);
+}
+
+/**
+ * Symbolize a fault record.
+ *
+ * Frames are grouped by module and each module is decoded with
+ * a single addr2line call, using the separate debug file
+ * matching its build-id when it is installed.
+ */
+static char*
+symbolize__(faultd_info_t* info, const char* maps, uint32_t maps_size)
+{
+    faultd_module_t* modules = aim_zmalloc(sizeof(*modules) * FAULTD_MODULES_MAX);
+    int frame_module[FAULTD_CONFIG_BACKTRACE_SIZE_MAX];
+    uintptr_t frame_addr[FAULTD_CONFIG_BACKTRACE_SIZE_MAX];
+    char* frame_sym[FAULTD_CONFIG_BACKTRACE_SIZE_MAX] = { NULL };
+    char* out = aim_zmalloc(FAULTD_CONFIG_BACKTRACE_SYMBOLS_SIZE);
+    int len = 0;
+    int mcount, i, j, m;
+
+    mcount = maps_parse__(maps, maps_size, modules, FAULTD_MODULES_MAX);
+
+    for(i = 0; i < info->backtrace_size; i++) {
+        uintptr_t a = (uintptr_t)info->backtrace[i];
+        frame_module[i] = -1;
+        for(m = 0; m < mcount; m++) {
+            if(a >= modules[m].start && a < modules[m].end) {
+                frame_module[i] = m;
+                break;
+            }
+        }
+    }
+
+    for(i = 0; i < info->backtrace_size; i++) {
+        int type;
+        char build_id[129];
+        char debugfile[512];
+        const char* file;
+        uintptr_t batch[FAULTD_CONFIG_BACKTRACE_SIZE_MAX];
+        char* results[FAULTD_CONFIG_BACKTRACE_SIZE_MAX];
+        int index[FAULTD_CONFIG_BACKTRACE_SIZE_MAX];
+        int count = 0;
+
+        if((m = frame_module[i]) < 0 || frame_sym[i]) {
+            continue;
+        }
+
+        elf_info__(modules[m].path, &type, build_id, sizeof(build_id));
+        file = modules[m].path;
+        if(build_id[0]) {
+            snprintf(debugfile, sizeof(debugfile),
+                     "/usr/lib/debug/.build-id/%.2s/%s.debug",
+                     build_id, build_id + 2);
+            if(access(debugfile, R_OK) == 0) {
+                file = debugfile;
+            }
+        }
+
+        /* Collect all frames in this module. */
+        for(j = i; j < info->backtrace_size; j++) {
+            if(frame_module[j] >= 0 &&
+               !strcmp(modules[frame_module[j]].path, modules[m].path)) {
+                faultd_module_t* mp = modules + frame_module[j];
+                uintptr_t a = (uintptr_t)info->backtrace[j];
+                /* Shared objects and PIE are decoded relative to their load address. */
+                frame_addr[j] = (type == ET_DYN) ? a - (mp->start - mp->offset) : a;
+                batch[count] = frame_addr[j];
+                results[count] = NULL;
+                index[count++] = j;
+            }
+        }
+
+        addr2line__(file, batch, count, results);
+
+        for(j = 0; j < count; j++) {
+            int f = index[j];
+            const char* base = strrchr(modules[m].path, '/') + 1;
+            frame_sym[f] = aim_fstrdup("%s+%p %s%s%s%s",
+                                       base, (void*)frame_addr[f],
+                                       results[j] ? results[j] : "",
+                                       build_id[0] ? " [" : "",
+                                       build_id, build_id[0] ? "]" : "");
+            aim_free(results[j]);
+        }
+    }
+
+    for(i = 0; i < info->backtrace_size; i++) {
+        len += snprintf(out + len, FAULTD_CONFIG_BACKTRACE_SYMBOLS_SIZE - len,
+                        "#%-2d %p %s\n", i, info->backtrace[i],
+                        frame_sym[i] ? frame_sym[i] : "??");
+        aim_free(frame_sym[i]);
+        if(len >= FAULTD_CONFIG_BACKTRACE_SYMBOLS_SIZE) {
+            break;
+        }
+    }
+    for(; i < info->backtrace_size; i++) {
+        aim_free(frame_sym[i]);
+    }
+
+    aim_free(modules);
+    return out;
+}
+
+int
+faultd_ring_harvest(faultd_ring_t* ring, faultd_info_t* infos, int max)
+{
+    int i, count = 0;
+
+    for(i = 0; i < FAULTD_CONFIG_RING_SIZE && count < max; i++) {
+        faultd_ring_record_t* record = ring->records + i;
+        uint32_t maps_size;
+        char* maps;
+
+        if(record->state != FAULTD_RING_RECORD_READY) {
+            continue;
+        }
+        __sync_synchronize();
+
+        /*
+         * Copy the record out before it is released. The ring is
+         * writable by the client so nothing in it is trusted.
+         */
+        FAULTD_MEMCPY(infos + count, &record->info, sizeof(record->info));
+        maps_size = record->maps_size;
+        if(maps_size > sizeof(record->maps)) {
+            maps_size = sizeof(record->maps);
+        }
+        maps = aim_zmalloc(maps_size + 1);
+        FAULTD_MEMCPY(maps, record->maps, maps_size);
+
+        __sync_synchronize();
+        record->state = FAULTD_RING_RECORD_FREE;
+
+        infos[count].binary[sizeof(infos[count].binary)-1] = 0;
+        if(infos[count].backtrace_size < 0 ||
+           infos[count].backtrace_size > FAULTD_CONFIG_BACKTRACE_SIZE_MAX) {
+            infos[count].backtrace_size = 0;
+        }
+        infos[count].pipename = NULL;
+        infos[count].backtrace_symbols = symbolize__(infos + count, maps, maps_size);
+        aim_free(maps);
+        count++;
+    }
+
+    if(ring->dropped) {
+        AIM_LOG_ERROR("%d faults were dropped from a full crash ring.",
+                      __sync_fetch_and_and(&ring->dropped, 0));
+    }
+    return count;
+}
@@ -18,6 +18,7 @@
 #define DRIVER_DESCRIPTION_NAME "accton i2c psu driver"
 /* PMBus Protocol. */
 #define PMBUS_LITERAL_DATA_MULTIPLIER           1000
+#define PMBUS_REGISTER_CAPABILITY               0x19
 #define PMBUS_REGISTER_VOUT_MODE                0x20
 #define PMBUS_REGISTER_STATUS_BYTE              0x78
 #define PMBUS_REGISTER_STATUS_WORD              0x79
@@ -43,6 +44,8 @@
 #define PMBUS_REGISTER_MFR_SERIAL               0x9E
 
 
+#define PMBUS_CAPABILITY_PEC                    0x80
+
 #define MAX_FAN_DUTY_CYCLE      100
 #define I2C_RW_RETRY_COUNT		10
 #define I2C_RW_RETRY_INTERVAL	60 /* ms */
@@ -51,13 +54,29 @@
  */
 static const unsigned short normal_i2c[] = { I2C_CLIENT_END };
 
+
+/* Telemetry registers are sampled at most once per update_interval.
+ * VOUT_MODE and the MFR strings are read at probe and re-read only
+ * after the PSU stops responding (removed or hot-swapped).
+ */
+static unsigned int update_interval = 1500;
+module_param(update_interval, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(update_interval, "Minimum interval between PMBus telemetry samples (ms)");
+
+static bool pec = true;
+module_param(pec, bool, S_IRUGO);
+MODULE_PARM_DESC(pec, "Use PMBus packet error checking when the PSU and adapter support it");
+
 /* Each client has this additional data 
  */
 struct accton_i2c_psu_data {
     struct device      *hwmon_dev;
     struct mutex        update_lock;
     char                valid;           /* !=0 if registers are valid */
+    char                static_valid;    /* !=0 if static registers are valid */
+    char                sampled;         /* !=0 once telemetry was sampled */
     unsigned long       last_updated;    /* In jiffies */
+    u8   capability;    /* Register value */
     u8   vout_mode;     /* Register value */
     u16  v_in;          /* Register value */
     u16  v_out;         /* Register value */
@@ -87,6 +106,7 @@ static ssize_t show_byte(struct device *dev, struct device_attribute *da,
 			 			 
 static int accton_i2c_psu_write_word(struct i2c_client *client, u8 reg, u16 value);
 static struct accton_i2c_psu_data *accton_i2c_psu_update_device(struct device *dev);
+static int accton_i2c_psu_update_static(struct i2c_client *client, struct accton_i2c_psu_data *data);
 
 enum accton_i2c_psu_sysfs_attributes {
     PSU_V_IN,
@@ -326,6 +346,14 @@ static int accton_i2c_psu_probe(struct i2c_client *client,
 
     dev_info(&client->dev, "chip found\n");
 
+    /* The PSU may not be present yet, the static data is retried on access */
+    mutex_lock(&data->update_lock);
+    status = accton_i2c_psu_update_static(client, data);
+    mutex_unlock(&data->update_lock);
+    if (status < 0) {
+        dev_dbg(&client->dev, "static data not available, err %d\n", status);
+    }
+
     /* Register sysfs hooks */
     status = sysfs_create_group(&client->dev.kobj, &accton_i2c_psu_group);
     if (status) {
@@ -428,40 +456,61 @@ static int accton_i2c_psu_read_block_data(struct i2c_client *client, u8 command,
     int length;
     u8 buffer[128] = {0}, *ptr = buffer;
 
-    status = accton_i2c_psu_read_byte(client, command);
-    if (status < 0)
-    {
-        dev_dbg(&client->dev, "Unable to get data from offset 0x%02X\r\n", command);
-        status = -EIO;
-        goto EXIT_READ_BLOCK_DATA;
+    /* SMBus block reads depend on the adapter of each PSU. */
+    if (i2c_check_functionality(client->adapter, I2C_FUNC_SMBUS_READ_BLOCK_DATA)) {
+        /* A single SMBus block read, PEC protected when enabled.
+         * The count byte is not returned, put it back for the code below.
+         */
+        status = i2c_smbus_read_block_data(client, command, buffer + 1);
+        if (status < 0)
+        {
+            dev_dbg(&client->dev, "Unable to get data from offset 0x%02X\r\n", command);
+            goto EXIT_READ_BLOCK_DATA;
+        }
+
+        buffer[0] = status;
+        status = status + 1;
     }
-  
-    status = (status & 0xFF) + 1;
-    if ( status > 128)
-    {
-        dev_dbg(&client->dev, "Unable to get big data from offset 0x%02X\r\n", command);
-        status = -EINVAL;
-        goto EXIT_READ_BLOCK_DATA;
+    else {
+        status = accton_i2c_psu_read_byte(client, command);
+        if (status < 0)
+        {
+            dev_dbg(&client->dev, "Unable to get data from offset 0x%02X\r\n", command);
+            status = -EIO;
+            goto EXIT_READ_BLOCK_DATA;
+        }
+
+        status = (status & 0xFF) + 1;
+        if ( status > 128)
+        {
+            dev_dbg(&client->dev, "Unable to get big data from offset 0x%02X\r\n", command);
+            status = -EINVAL;
+            goto EXIT_READ_BLOCK_DATA;
+        }
+
+        length = status;
+        status = accton_i2c_psu_read_block(client, command, buffer, length);
+        if (unlikely(status < 0))
+            goto EXIT_READ_BLOCK_DATA;
+        if (unlikely(status != length)) {
+            status = -EIO;
+            goto EXIT_READ_BLOCK_DATA;
+        }
     }
-    
-    length = status;
-    status = accton_i2c_psu_read_block(client, command, buffer, length);
-    if (unlikely(status < 0))
-        goto EXIT_READ_BLOCK_DATA;
-    if (unlikely(status != length)) {
-        status = -EIO;
-        goto EXIT_READ_BLOCK_DATA;
-    } 
-    /* The first byte is the count byte of string. */   
+    /* The first byte is the count byte of string. */
     ptr++;
     status--;
 
     length=status>(data_length-1)?(data_length-1):status;
+    if (length <= 0) {
+        data[0] = 0;
+        goto EXIT_READ_BLOCK_DATA;
+    }
     memcpy(data, ptr, length);
     data[length-1] = 0;
 
 EXIT_READ_BLOCK_DATA:
-    
+
     return status;
 }
 
@@ -476,93 +525,153 @@ struct reg_data_word {
     u16 *value;
 };
 
+struct reg_data_string {
+    u8   reg;
+    u8  *value;
+    int  length;
+};
+
+static int accton_i2c_psu_update_static(struct i2c_client *client, struct accton_i2c_psu_data *data)
+{
+    int i, status;
+    struct reg_data_string regs_string[] = { {PMBUS_REGISTER_MFR_ID, data->mfr_id, ARRAY_SIZE(data->mfr_id)},
+                                             {PMBUS_REGISTER_MFR_MODEL, data->mfr_model, ARRAY_SIZE(data->mfr_model)},
+                                             {PMBUS_REGISTER_MFR_REVISION, data->mfr_revsion, ARRAY_SIZE(data->mfr_revsion)},
+                                             {PMBUS_REGISTER_MFR_SERIAL, data->mfr_serial, ARRAY_SIZE(data->mfr_serial)},
+                                             };
+
+    dev_dbg(&client->dev, "Starting accton_i2c_psu static update\n");
+    data->static_valid = 0;
+
+    /* The capability register tells whether PEC may be used, so it
+     * (and only it) is always read without PEC. Not every PSU
+     * implements it, those are used without PEC.
+     */
+    client->flags &= ~I2C_CLIENT_PEC;
+    status = accton_i2c_psu_read_byte(client, PMBUS_REGISTER_CAPABILITY);
+    if (status < 0) {
+        dev_dbg(&client->dev, "reg %d, err %d\n", PMBUS_REGISTER_CAPABILITY, status);
+        status = 0;
+    }
+    data->capability = status;
+
+    if (pec && (data->capability & PMBUS_CAPABILITY_PEC) &&
+        i2c_check_functionality(client->adapter, I2C_FUNC_SMBUS_PEC)) {
+        client->flags |= I2C_CLIENT_PEC;
+    }
+
+    status = accton_i2c_psu_read_byte(client, PMBUS_REGISTER_VOUT_MODE);
+    if (status < 0) {
+        dev_dbg(&client->dev, "reg %d, err %d\n", PMBUS_REGISTER_VOUT_MODE, status);
+        return status;
+    }
+    data->vout_mode = status;
+
+    /* Read mfr_id, mfr_model, mfr_revsion, mfr_serial. These are
+     * informational, a PSU which does not provide them is still sampled.
+     */
+    for (i = 0; i < ARRAY_SIZE(regs_string); i++) {
+        status = accton_i2c_psu_read_block_data(client, regs_string[i].reg,
+                                                regs_string[i].value,
+                                                regs_string[i].length);
+        if (status < 0) {
+            dev_dbg(&client->dev, "reg %d, err %d\n", regs_string[i].reg, status);
+            regs_string[i].value[0] = 0;
+        }
+    }
+
+    data->static_valid = 1;
+
+    return 0;
+}
+
+static int accton_i2c_psu_update_telemetry(struct i2c_client *client, struct accton_i2c_psu_data *data)
+{
+    int i, status, failed = 0;
+    struct reg_data_byte regs_byte[] = { {PMBUS_REGISTER_STATUS_FAN, &data->fan_fault}};
+    struct reg_data_word regs_word[] = { {PMBUS_REGISTER_READ_VIN, &data->v_in},
+                                         {PMBUS_REGISTER_READ_VOUT, &data->v_out},
+                                         {PMBUS_REGISTER_READ_IIN, &data->i_in},
+                                         {PMBUS_REGISTER_READ_IOUT, &data->i_out},
+                                         {PMBUS_REGISTER_READ_POUT, &data->p_out},
+                                         {PMBUS_REGISTER_READ_PIN, &data->p_in},
+                                         {PMBUS_REGISTER_READ_TEMPERATURE_1, &(data->temp_input[0])},
+                                         {PMBUS_REGISTER_READ_TEMPERATURE_2, &(data->temp_input[1])},
+                                         {PMBUS_REGISTER_FAN_COMMAND_1, &(data->fan_duty_cycle[0])},
+                                         {PMBUS_REGISTER_READ_FAN_SPEED_1, &(data->fan_speed[0])},
+                                         {PMBUS_REGISTER_READ_FAN_SPEED_2, &(data->fan_speed[1])},
+                                         };
+
+    dev_dbg(&client->dev, "Starting accton_i2c_psu update\n");
+
+    /* Read byte data */
+    for (i = 0; i < ARRAY_SIZE(regs_byte); i++) {
+        status = accton_i2c_psu_read_byte(client, regs_byte[i].reg);
+
+        if (status < 0) {
+            dev_dbg(&client->dev, "reg %d, err %d\n",
+                    regs_byte[i].reg, status);
+            failed++;
+        }
+        else {
+            *(regs_byte[i].value) = status;
+        }
+    }
+
+    /* Read word data */
+    for (i = 0; i < ARRAY_SIZE(regs_word); i++) {
+        status = accton_i2c_psu_read_word(client, regs_word[i].reg);
+
+        if (status < 0) {
+            dev_dbg(&client->dev, "reg %d, err %d\n",
+                    regs_word[i].reg, status);
+            failed++;
+        }
+        else {
+            *(regs_word[i].value) = status;
+        }
+    }
+
+    /* Individual registers may be unsupported, only a PSU that does
+     * not answer at all is treated as removed.
+     */
+    return (failed == ARRAY_SIZE(regs_byte) + ARRAY_SIZE(regs_word)) ? -EIO : 0;
+}
+
 static struct accton_i2c_psu_data *accton_i2c_psu_update_device(struct device *dev)
 {
     struct i2c_client *client = to_i2c_client(dev);
     struct accton_i2c_psu_data *data = i2c_get_clientdata(client);
-    
+
     mutex_lock(&data->update_lock);
 
-    if (time_after(jiffies, data->last_updated + HZ + HZ / 2)
-        || !data->valid) {
-        int i, status, length;
-        u8 command, buf;
-        struct reg_data_byte regs_byte[] = { {PMBUS_REGISTER_VOUT_MODE, &data->vout_mode},
-                                             {PMBUS_REGISTER_STATUS_FAN, &data->fan_fault}};
-        struct reg_data_word regs_word[] = { {PMBUS_REGISTER_READ_VIN, &data->v_in},
-                                             {PMBUS_REGISTER_READ_VOUT, &data->v_out},
-                                             {PMBUS_REGISTER_READ_IIN, &data->i_in},
-                                             {PMBUS_REGISTER_READ_IOUT, &data->i_out},
-                                             {PMBUS_REGISTER_READ_POUT, &data->p_out},
-                                             {PMBUS_REGISTER_READ_PIN, &data->p_in},
-                                             {PMBUS_REGISTER_READ_TEMPERATURE_1, &(data->temp_input[0])},
-                                             {PMBUS_REGISTER_READ_TEMPERATURE_2, &(data->temp_input[1])},
-                                             {PMBUS_REGISTER_FAN_COMMAND_1, &(data->fan_duty_cycle[0])},
-                                             {PMBUS_REGISTER_READ_FAN_SPEED_1, &(data->fan_speed[0])},
-                                             {PMBUS_REGISTER_READ_FAN_SPEED_2, &(data->fan_speed[1])},
-                                             };
+    /* Failed samples are rate limited too, so an absent PSU does not
+     * keep the bus busy.
+     */
+    if (data->sampled &&
+        !time_after(jiffies, data->last_updated + msecs_to_jiffies(update_interval))) {
+        goto exit;
+    }
 
-        dev_dbg(&client->dev, "Starting accton_i2c_psu update\n");
-
-        /* Read byte data */        
-        for (i = 0; i < ARRAY_SIZE(regs_byte); i++) {
-            status = accton_i2c_psu_read_byte(client, regs_byte[i].reg);
-            
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n",
-                        regs_byte[i].reg, status);
-            }
-            else {
-                *(regs_byte[i].value) = status;
-            }
-        }
-                    
-        /* Read word data */                    
-        for (i = 0; i < ARRAY_SIZE(regs_word); i++) {
-            status = accton_i2c_psu_read_word(client, regs_word[i].reg);
-            
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n",
-                        regs_word[i].reg, status);
-            }
-            else {
-                *(regs_word[i].value) = status;
-            }
-            
-        }
-        /* Read mfr_id */
-		status = accton_i2c_psu_read_block_data(client, PMBUS_REGISTER_MFR_ID, data->mfr_id,
-										 ARRAY_SIZE(data->mfr_id));
-		if (status < 0) {
-			dev_dbg(&client->dev, "reg %d, err %d\n", PMBUS_REGISTER_MFR_ID, status);
-			goto exit;
-		}		
-		/* Read mfr_model */		
-		status = accton_i2c_psu_read_block_data(client, PMBUS_REGISTER_MFR_MODEL, data->mfr_model,
-										 ARRAY_SIZE(data->mfr_model));
-		if (status < 0) {
-			dev_dbg(&client->dev, "reg %d, err %d\n", PMBUS_REGISTER_MFR_MODEL, status);
-			goto exit;
-		}
-        /* Read mfr_revsion */		
-		status = accton_i2c_psu_read_block_data(client, PMBUS_REGISTER_MFR_REVISION, data->mfr_revsion,
-										 ARRAY_SIZE(data->mfr_revsion));
-		if (status < 0) {
-			dev_dbg(&client->dev, "reg %d, err %d\n", PMBUS_REGISTER_MFR_REVISION, status);
-			goto exit;
-		}
-		/* Read mfr_serial */
-		status = accton_i2c_psu_read_block_data(client, PMBUS_REGISTER_MFR_SERIAL, data->mfr_serial,
-										 ARRAY_SIZE(data->mfr_serial));
-		if (status < 0) {
-			dev_dbg(&client->dev, "reg %d, err %d\n", PMBUS_REGISTER_MFR_SERIAL, status);
-			goto exit;
-		}
-        
-        data->last_updated = jiffies;
-        data->valid = 1;
+    data->sampled = 1;
+    data->last_updated = jiffies;
+
+    /* A failed static pass is retried on the next sample, the
+     * telemetry does not depend on it.
+     */
+    if (!data->static_valid) {
+        accton_i2c_psu_update_static(client, data);
     }
 
+    if (accton_i2c_psu_update_telemetry(client, data) < 0) {
+        /* The PSU may have been removed or replaced */
+        data->static_valid = 0;
+        data->valid = 0;
+        goto exit;
+    }
+
+    data->valid = 1;
+
 exit:
     mutex_unlock(&data->update_lock);
 
@@ -41,6 +41,20 @@
 
 static int support_i2c_block = 1; // 1: support I2C_FUNC_SMBUS_I2C_BLOCK 0: not support
 
+/* Telemetry registers are sampled at most once per update_interval.
+ * Capability, limits and MFR strings are read at probe and re-read only
+ * after the PSU stops responding (removed or hot-swapped).
+ */
+static unsigned int update_interval = 1500;
+module_param(update_interval, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(update_interval, "Minimum interval between PMBus telemetry samples (ms)");
+
+static bool pec = true;
+module_param(pec, bool, S_IRUGO);
+MODULE_PARM_DESC(pec, "Use PMBus packet error checking when the PSU and adapter support it");
+
+#define PMBUS_CAPABILITY_PEC    0x80
+
 /* Addresses scanned
  */
 static const unsigned short normal_i2c[] = { I2C_CLIENT_END };
@@ -59,6 +73,8 @@ struct ym2651y_data {
     struct device     *hwmon_dev;
     struct mutex        update_lock;
     char                valid;         /* !=0 if registers are valid */
+    char                static_valid;  /* !=0 if static registers are valid */
+    char                sampled;       /* !=0 once telemetry was sampled */
     unsigned long      last_updated;    /* In jiffies */
     u8   chip;          /* chip id */
     u8   capability;     /* Register value */
@@ -106,6 +122,7 @@ static ssize_t show_over_temp(struct device *dev, struct device_attribute *da,
 static ssize_t show_ascii(struct device *dev, struct device_attribute *da,
              char *buf);
 static struct ym2651y_data *ym2651y_update_device(struct device *dev);
+static int ym2651y_update_static(struct i2c_client *client, struct ym2651y_data *data);
 static ssize_t set_fan_duty_cycle(struct device *dev, struct device_attribute *da,
              const char *buf, size_t count);
 static int ym2651y_write_word(struct i2c_client *client, u8 reg, u16 value);
@@ -559,6 +576,14 @@ static int ym2651y_probe(struct i2c_client *client,
     data->chip = dev_id->driver_data;
     dev_info(&client->dev, "chip found\n");
 
+    /* The PSU may not be present yet, the static data is retried on access */
+    mutex_lock(&data->update_lock);
+    status = ym2651y_update_static(client, data);
+    mutex_unlock(&data->update_lock);
+    if (status < 0) {
+        dev_dbg(&client->dev, "static data not available, err %d\n", status);
+    }
+
     /* Register sysfs hooks */
     status = sysfs_create_group(&client->dev.kobj, &ym2651y_group);
     if (status) {
@@ -695,6 +720,66 @@ static int ym2651y_read_block(struct i2c_client *client, u8 command, u8 *data,
     return status;
 }
 
+static int ym2651y_read_block_data(struct i2c_client *client, u8 command, u8 *data)
+{
+    int status = 0, retry = I2C_RW_RETRY_COUNT;
+
+    while (retry) {
+        status = i2c_smbus_read_block_data(client, command, data);
+        if (unlikely(status < 0)) {
+            msleep(I2C_RW_RETRY_INTERVAL);
+            retry--;
+            continue;
+        }
+
+        break;
+    }
+
+    return status;
+}
+
+/* SMBus block reads depend on the adapter of each PSU. */
+static inline int ym2651y_smbus_block(struct i2c_client *client)
+{
+    return i2c_check_functionality(client->adapter,
+                                   I2C_FUNC_SMBUS_READ_BLOCK_DATA);
+}
+
+/* Read a PMBus string into data as <count><string><NUL>, truncated to
+ * data_len. SMBus block reads are used when the adapter supports them
+ * (and are PEC protected when enabled), otherwise a single I2C block
+ * read of the count byte and as much of the string as fits.
+ */
+static int ym2651y_read_string(struct i2c_client *client, u8 command, u8 *data,
+              int data_len)
+{
+    u8 block[I2C_SMBUS_BLOCK_MAX];
+    int status, length;
+
+    if (ym2651y_smbus_block(client)) {
+        status = ym2651y_read_block_data(client, command, block);
+        if (status < 0) {
+            return status;
+        }
+
+        length = min_t(int, status, data_len - 2);
+        memcpy(data + 1, block, length);
+    }
+    else {
+        status = ym2651y_read_block(client, command, data, data_len - 1);
+        if (status < 0) {
+            return status;
+        }
+
+        length = (status > 0) ? min_t(int, data[0], status - 1) : 0;
+    }
+
+    data[0] = length;
+    data[length + 1] = '\0';
+
+    return 0;
+}
+
 struct reg_data_byte {
     u8   reg;
     u8  *value;
@@ -705,192 +790,191 @@ struct reg_data_word {
     u16 *value;
 };
 
-static struct ym2651y_data *ym2651y_update_device(struct device *dev)
+struct reg_data_string {
+    u8   reg;
+    u8  *value;
+    int  length;
+};
+
+static int ym2651y_update_static(struct i2c_client *client, struct ym2651y_data *data)
 {
-    struct i2c_client *client = to_i2c_client(dev);
-    struct ym2651y_data *data = i2c_get_clientdata(client);
+    int i, status;
+    struct reg_data_byte regs_byte[] = { {0x20, &data->vout_mode},
+                                         {0x98, &data->pmbus_revision}};
+    struct reg_data_word regs_word[] = { {0xa0, &data->mfr_vin_min},
+                                         {0xa1, &data->mfr_vin_max},
+                                         {0xa2, &data->mfr_iin_max},
+                                         {0xa3, &data->mfr_pin_max},
+                                         {0xa4, &data->mfr_vout_min},
+                                         {0xa5, &data->mfr_vout_max},
+                                         {0xa6, &data->mfr_iout_max},
+                                         {0xa7, &data->mfr_pout_max}};
+    struct reg_data_string regs_string[] = { {0x99, data->mfr_id, ARRAY_SIZE(data->mfr_id)},
+                                             {0x9a, data->mfr_model, ARRAY_SIZE(data->mfr_model)},
+                                             {0xd0, data->mfr_model_opt, ARRAY_SIZE(data->mfr_model_opt)},
+                                             {0x9b, data->mfr_revsion, ARRAY_SIZE(data->mfr_revsion)},
+                                             {0x9e, data->mfr_serial, ARRAY_SIZE(data->mfr_serial)}};
+
+    dev_dbg(&client->dev, "Starting ym2651 static update\n");
+    data->static_valid = 0;
+
+    /* The capability register tells whether PEC may be used, so it
+     * (and only it) is always read without PEC.
+     */
+    client->flags &= ~I2C_CLIENT_PEC;
+    status = ym2651y_read_byte(client, 0x19);
+    if (status < 0) {
+        dev_dbg(&client->dev, "reg %d, err %d\n", 0x19, status);
+        return status;
+    }
+    data->capability = status;
 
-    mutex_lock(&data->update_lock);
+    if (pec && (data->capability & PMBUS_CAPABILITY_PEC) &&
+        i2c_check_functionality(client->adapter, I2C_FUNC_SMBUS_PEC)) {
+        client->flags |= I2C_CLIENT_PEC;
+    }
 
-    if (time_after(jiffies, data->last_updated + HZ + HZ / 2)
-        || !data->valid) {
-        int i, status, length;
-        u8 command, buf;
-        struct reg_data_byte regs_byte[] = { {0x19, &data->capability},
-                                             {0x20, &data->vout_mode},
-                                             {0x7d, &data->over_temp},
-                                             {0x81, &data->fan_fault},
-                                             {0x98, &data->pmbus_revision}};
-        struct reg_data_word regs_word[] = { {0x79, &data->status_word},
-                                             {0x88, &data->v_in},
-                                             {0x8b, &data->v_out},
-                                             {0x89, &data->i_in},
-                                             {0x8c, &data->i_out},
-                                             {0x97, &data->p_in},
-                                             {0x96, &data->p_out},
-                                             {0x8d, &(data->temp[0])},
-                                             {0x8e, &(data->temp[1])},
-                                             {0x8f, &(data->temp[2])},
-                                             {0x3b, &(data->fan_duty_cycle[0])},
-                                             {0x3c, &(data->fan_duty_cycle[1])},
-                                             {0x90, &data->fan_speed},
-                                             {0xa0, &data->mfr_vin_min},
-                                             {0xa1, &data->mfr_vin_max},
-                                             {0xa2, &data->mfr_iin_max},
-                                             {0xa3, &data->mfr_pin_max},
-                                             {0xa4, &data->mfr_vout_min},
-                                             {0xa5, &data->mfr_vout_max},
-                                             {0xa6, &data->mfr_iout_max},
-                                             {0xa7, &data->mfr_pout_max}};
-
-        dev_dbg(&client->dev, "Starting ym2651 update\n");
-        data->valid = 0;
-
-        /* Read byte data */
-        for (i = 0; i < ARRAY_SIZE(regs_byte); i++) {
-            status = ym2651y_read_byte(client, regs_byte[i].reg);
+    /* Read byte data */
+    for (i = 0; i < ARRAY_SIZE(regs_byte); i++) {
+        status = ym2651y_read_byte(client, regs_byte[i].reg);
 
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n",
-                        regs_byte[i].reg, status);
-                goto exit;
-            }
-            else {
-                *(regs_byte[i].value) = status;
-            }
+        if (status < 0) {
+            dev_dbg(&client->dev, "reg %d, err %d\n",
+                    regs_byte[i].reg, status);
+            return status;
         }
+        *(regs_byte[i].value) = status;
+    }
 
-        /* Read word data */
-        for (i = 0; i < ARRAY_SIZE(regs_word); i++) {
-            status = ym2651y_read_word(client, regs_word[i].reg);
+    /* Read word data */
+    for (i = 0; i < ARRAY_SIZE(regs_word); i++) {
+        status = ym2651y_read_word(client, regs_word[i].reg);
 
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n",
-                        regs_word[i].reg, status);
-                goto exit;
-            }
-            else {
-                *(regs_word[i].value) = status;
-            }
+        if (status < 0) {
+            dev_dbg(&client->dev, "reg %d, err %d\n",
+                    regs_word[i].reg, status);
+            return status;
         }
+        *(regs_word[i].value) = status;
+    }
 
-        if (support_i2c_block) {
-
-            /* Read fan_direction */
-            command = 0xC3;
-            status = ym2651y_read_block(client, command, data->fan_dir,
-                                         ARRAY_SIZE(data->fan_dir)-1);
-            if (data->fan_dir[0] < ARRAY_SIZE(data->fan_dir)-2) {
-                data->fan_dir[data->fan_dir[0]+1] = '\0';
-            }
-            else {
-                data->fan_dir[ARRAY_SIZE(data->fan_dir)-1] = '\0';
-            }
-
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n", command, status);
-                goto exit;
-            }
-
-            /* Read mfr_id */
-            command = 0x99;
-            status = ym2651y_read_block(client, command, data->mfr_id,
-                                            ARRAY_SIZE(data->mfr_id)-1);
-            if (data->mfr_id[0] < ARRAY_SIZE(data->mfr_id)-2) {
-                data->mfr_id[data->mfr_id[0]+1] = '\0';
-            }
-            else {
-                data->mfr_id[ARRAY_SIZE(data->mfr_id)-1] = '\0';
-            }
-
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n", command, status);
-                goto exit;
-            }
+    if (support_i2c_block) {
+        /* Read fan_direction. The raw register value is also decoded
+         * for some models, so this is always an I2C block read.
+         */
+        status = ym2651y_read_block(client, 0xC3, data->fan_dir,
+                                     ARRAY_SIZE(data->fan_dir)-1);
+        if (data->fan_dir[0] < ARRAY_SIZE(data->fan_dir)-2) {
+            data->fan_dir[data->fan_dir[0]+1] = '\0';
+        }
+        else {
+            data->fan_dir[ARRAY_SIZE(data->fan_dir)-1] = '\0';
+        }
 
-            /* Read mfr_model */
-            command = 0x9a;
-            length  = 1;
+        if (status < 0) {
+            dev_dbg(&client->dev, "reg %d, err %d\n", 0xC3, status);
+            return status;
+        }
+    }
 
-            /* Read first byte to determine the length of data */
-            status = ym2651y_read_block(client, command, &buf, length);
+    if (support_i2c_block || ym2651y_smbus_block(client)) {
+        /* Read mfr_id, mfr_model, mfr_model_opt, mfr_revsion, mfr_serial */
+        for (i = 0; i < ARRAY_SIZE(regs_string); i++) {
+            status = ym2651y_read_string(client, regs_string[i].reg,
+                                         regs_string[i].value,
+                                         regs_string[i].length);
             if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n", command, status);
-                goto exit;
+                dev_dbg(&client->dev, "reg %d, err %d\n",
+                        regs_string[i].reg, status);
+                return status;
             }
+        }
+    }
 
-            status = ym2651y_read_block(client, command, data->mfr_model, buf+1);
-            data->mfr_model[buf+1] = '\0';
+    data->static_valid = 1;
 
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n", command, status);
-                goto exit;
-            }
-
-            /* Read mfr_model_opt */
-            command = 0xd0;
-            length  = 1;
+    return 0;
+}
 
-            /* Read first byte to determine the length of data */
-            status = ym2651y_read_block(client, command, &buf, length);
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n", command, status);
-                goto exit;
-            }
+static int ym2651y_update_telemetry(struct i2c_client *client, struct ym2651y_data *data)
+{
+    int i, status;
+    struct reg_data_byte regs_byte[] = { {0x7d, &data->over_temp},
+                                         {0x81, &data->fan_fault}};
+    struct reg_data_word regs_word[] = { {0x79, &data->status_word},
+                                         {0x88, &data->v_in},
+                                         {0x8b, &data->v_out},
+                                         {0x89, &data->i_in},
+                                         {0x8c, &data->i_out},
+                                         {0x97, &data->p_in},
+                                         {0x96, &data->p_out},
+                                         {0x8d, &(data->temp[0])},
+                                         {0x8e, &(data->temp[1])},
+                                         {0x8f, &(data->temp[2])},
+                                         {0x3b, &(data->fan_duty_cycle[0])},
+                                         {0x3c, &(data->fan_duty_cycle[1])},
+                                         {0x90, &data->fan_speed}};
+
+    dev_dbg(&client->dev, "Starting ym2651 update\n");
+
+    /* Read byte data */
+    for (i = 0; i < ARRAY_SIZE(regs_byte); i++) {
+        status = ym2651y_read_byte(client, regs_byte[i].reg);
+
+        if (status < 0) {
+            dev_dbg(&client->dev, "reg %d, err %d\n",
+                    regs_byte[i].reg, status);
+            return status;
+        }
+        *(regs_byte[i].value) = status;
+    }
 
-            status = ym2651y_read_block(client, command, data->mfr_model_opt, buf+1);
-            data->mfr_model_opt[buf+1] = '\0';
+    /* Read word data */
+    for (i = 0; i < ARRAY_SIZE(regs_word); i++) {
+        status = ym2651y_read_word(client, regs_word[i].reg);
 
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n", command, status);
-                goto exit;
-            }
+        if (status < 0) {
+            dev_dbg(&client->dev, "reg %d, err %d\n",
+                    regs_word[i].reg, status);
+            return status;
+        }
+        *(regs_word[i].value) = status;
+    }
 
-            /* Read mfr_revsion */
-            command = 0x9b;
-            status = ym2651y_read_block(client, command, data->mfr_revsion,
-                                            ARRAY_SIZE(data->mfr_revsion)-1);
-            if (data->mfr_revsion[0] < ARRAY_SIZE(data->mfr_revsion)-2) {
-                data->mfr_revsion[data->mfr_revsion[0] + 1] = '\0';
-            }
-            else{
-                data->mfr_revsion[ARRAY_SIZE(data->mfr_revsion)-1] = '\0';
-            }
+    return 0;
+}
 
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n", command, status);
-                goto exit;
-            }
+static struct ym2651y_data *ym2651y_update_device(struct device *dev)
+{
+    struct i2c_client *client = to_i2c_client(dev);
+    struct ym2651y_data *data = i2c_get_clientdata(client);
 
-            /* Read mfr_serial */
-            command = 0x9e;
-            length  = 1;
+    mutex_lock(&data->update_lock);
 
-            /* Read first byte to determine the length of data */
-            status = ym2651y_read_block(client, command, &buf, length);
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n", command, status);
-                goto exit;
-            }
+    /* Failed samples are rate limited too, so an absent PSU does not
+     * keep the bus busy with retries.
+     */
+    if (data->sampled &&
+        !time_after(jiffies, data->last_updated + msecs_to_jiffies(update_interval))) {
+        goto exit;
+    }
 
-            status = ym2651y_read_block(client, command, data->mfr_serial, buf+1);
-            if (data->mfr_serial[0] < ARRAY_SIZE(data->mfr_serial)-2) {
-                data->mfr_serial[data->mfr_serial[0] + 1] = '\0';
-            }
-            else {
-                data->mfr_serial[ARRAY_SIZE(data->mfr_serial)-1] = '\0';
-            }
+    data->sampled = 1;
+    data->last_updated = jiffies;
+    data->valid = 0;
 
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n", command, status);
-                goto exit;
-            }
-        }
+    if (!data->static_valid && ym2651y_update_static(client, data) < 0) {
+        goto exit;
+    }
 
-        data->last_updated = jiffies;
-        data->valid = 1;
+    if (ym2651y_update_telemetry(client, data) < 0) {
+        /* The PSU may have been removed or replaced */
+        data->static_valid = 0;
+        goto exit;
     }
 
+    data->valid = 1;
+
 exit:
     mutex_unlock(&data->update_lock);
 
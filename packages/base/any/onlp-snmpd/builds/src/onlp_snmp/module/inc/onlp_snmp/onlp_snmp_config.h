@@ -201,6 +201,36 @@
 #define ONLP_SNMP_CONFIG_RESOURCE_UPDATE_SECONDS 5
 #endif
 
+/**
+ * ONLP_SNMP_CONFIG_INCLUDE_SFPS
+ *
+ * Include the transceiver tables. */
+
+
+#ifndef ONLP_SNMP_CONFIG_INCLUDE_SFPS
+#define ONLP_SNMP_CONFIG_INCLUDE_SFPS 1
+#endif
+
+/**
+ * ONLP_SNMP_CONFIG_SFP_UPDATE_PERIOD
+ *
+ * Transceiver presence update period in seconds. */
+
+
+#ifndef ONLP_SNMP_CONFIG_SFP_UPDATE_PERIOD
+#define ONLP_SNMP_CONFIG_SFP_UPDATE_PERIOD 2
+#endif
+
+/**
+ * ONLP_SNMP_CONFIG_SFP_DOM_UPDATE_PERIOD
+ *
+ * Transceiver DOM update period in seconds. */
+
+
+#ifndef ONLP_SNMP_CONFIG_SFP_DOM_UPDATE_PERIOD
+#define ONLP_SNMP_CONFIG_SFP_DOM_UPDATE_PERIOD 10
+#endif
+
 
 
 /**
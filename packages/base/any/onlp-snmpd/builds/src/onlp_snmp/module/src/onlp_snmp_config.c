@@ -99,6 +99,21 @@ onlp_snmp_config_settings_t onlp_snmp_config_settings[] =
     { __onlp_snmp_config_STRINGIFY_NAME(ONLP_SNMP_CONFIG_RESOURCE_UPDATE_SECONDS), __onlp_snmp_config_STRINGIFY_VALUE(ONLP_SNMP_CONFIG_RESOURCE_UPDATE_SECONDS) },
 #else
 { ONLP_SNMP_CONFIG_RESOURCE_UPDATE_SECONDS(__onlp_snmp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_SNMP_CONFIG_INCLUDE_SFPS
+    { __onlp_snmp_config_STRINGIFY_NAME(ONLP_SNMP_CONFIG_INCLUDE_SFPS), __onlp_snmp_config_STRINGIFY_VALUE(ONLP_SNMP_CONFIG_INCLUDE_SFPS) },
+#else
+{ ONLP_SNMP_CONFIG_INCLUDE_SFPS(__onlp_snmp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_SNMP_CONFIG_SFP_UPDATE_PERIOD
+    { __onlp_snmp_config_STRINGIFY_NAME(ONLP_SNMP_CONFIG_SFP_UPDATE_PERIOD), __onlp_snmp_config_STRINGIFY_VALUE(ONLP_SNMP_CONFIG_SFP_UPDATE_PERIOD) },
+#else
+{ ONLP_SNMP_CONFIG_SFP_UPDATE_PERIOD(__onlp_snmp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_SNMP_CONFIG_SFP_DOM_UPDATE_PERIOD
+    { __onlp_snmp_config_STRINGIFY_NAME(ONLP_SNMP_CONFIG_SFP_DOM_UPDATE_PERIOD), __onlp_snmp_config_STRINGIFY_VALUE(ONLP_SNMP_CONFIG_SFP_DOM_UPDATE_PERIOD) },
+#else
+{ ONLP_SNMP_CONFIG_SFP_DOM_UPDATE_PERIOD(__onlp_snmp_config_STRINGIFY_NAME), "__undefined__" },
 #endif
     { NULL, NULL }
 };
@@ -12,5 +12,7 @@ int onlp_snmp_sensors_init(void);
 int onlp_snmp_sensor_update_start(void);
 int onlp_snmp_platform_init(void);
 int onlp_snmp_platform_update_start(void);
+int onlp_snmp_sfps_init(void);
+int onlp_snmp_sfp_update_start(void);
 
 #endif /* __ONLP_SNMP_INT_H__ */
@@ -20,7 +20,7 @@ void __onlp_snmp_module_init__(void)
 {
     AIM_LOG_STRUCT_REGISTER();
     datatypes_init__();
-    onlp_init();
+    onlp_init_eager();
 }
 
 /**
@@ -40,9 +40,15 @@ onlp_snmp_client__(int enable, void* cookie)
 {
     onlp_snmp_sensors_init();
     onlp_snmp_platform_init();
+#if ONLP_SNMP_CONFIG_INCLUDE_SFPS == 1
+    onlp_snmp_sfps_init();
+#endif
 
     onlp_snmp_sensor_update_start();
     onlp_snmp_platform_update_start();
+#if ONLP_SNMP_CONFIG_INCLUDE_SFPS == 1
+    onlp_snmp_sfp_update_start();
+#endif
 
     return 0;
 }
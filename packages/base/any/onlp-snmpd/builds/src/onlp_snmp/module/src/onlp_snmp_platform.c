@@ -26,8 +26,6 @@
 #include "onlp_snmp_log.h"
 
 #include <AIM/aim_time.h>
-#include <cjson/cJSON.h>
-#include <cjson_util/cjson_util.h>
 #include <net-snmp/net-snmp-config.h>
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/agent/net-snmp-agent-includes.h>
@@ -35,6 +33,9 @@
 
 #include <pthread.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stddef.h>
 
 static void
 platform_string_register(int index, const char* desc, char* value)
@@ -75,29 +76,42 @@ platform_int_register(int index, char* desc, int value)
                                   v, NULL);
 }
 
-static void
-resource_int_register(int index, const char* desc,
-                      Netsnmp_Node_Handler *handler)
-{
-    oid tree[] = { 1, 3, 6, 1, 4, 1, 42623, 1, 3, 1, 1 };
-    tree[10] = index;
-
-    netsnmp_handler_registration *reg =
-        netsnmp_create_handler_registration(desc, handler,
-                                            tree, OID_LENGTH(tree),
-                                            HANDLER_CAN_RONLY);
-    if (netsnmp_register_instance(reg) != MIB_REGISTERED_OK) {
-        AIM_LOG_ERROR("registering handler for %s failed", desc);
-    }
-}
-
 /* updates happen in this pthread */
 static pthread_t update_thread_handle;
 
-/* resource objects */
+/* The most CPUs reported in the CPU table */
+#define RESOURCE_CPUS_MAX (256)
+
+/* resource objects. Percentages are multiplied by 100. */
 typedef struct {
     uint32_t utilization_percent;
     uint32_t idle_percent;
+    uint32_t user_percent;
+    uint32_t system_percent;
+    uint32_t iowait_percent;
+} cpu_resources_t;
+
+typedef struct {
+    /* All CPUs */
+    cpu_resources_t all;
+
+    /* Each CPU, by CPU number */
+    int cpu_count;
+    cpu_resources_t cpus[RESOURCE_CPUS_MAX];
+
+    /* kB */
+    uint32_t mem_total;
+    uint32_t mem_free;
+    uint32_t mem_available;
+    uint32_t mem_buffers;
+    uint32_t mem_cached;
+    uint32_t swap_total;
+    uint32_t swap_free;
+
+    /* Load averages multiplied by 100 */
+    uint32_t load_1;
+    uint32_t load_5;
+    uint32_t load_15;
 } resources_t;
 
 #define NUM_RESOURCE_BUFFERS (2)
@@ -125,53 +139,233 @@ swap_curr_next_resources(void)
     curr_resource = next_resource();
 }
 
+/*
+ * The /proc files stay open. Each sample rereads them from the start.
+ */
+typedef struct {
+    const char* path;
+    int fd;
+} proc_file_t;
+
+static proc_file_t proc_stat = { "/proc/stat", -1 };
+static proc_file_t proc_meminfo = { "/proc/meminfo", -1 };
+static proc_file_t proc_loadavg = { "/proc/loadavg", -1 };
+
+static char proc_buffer[64*1024];
+
+static char*
+proc_read(proc_file_t* pf)
+{
+    ssize_t len;
+
+    if (pf->fd < 0) {
+        pf->fd = open(pf->path, O_RDONLY);
+        if (pf->fd < 0) {
+            AIM_LOG_ERROR("failed to open %s: %{errno}", pf->path, errno);
+            return NULL;
+        }
+    }
+
+    len = pread(pf->fd, proc_buffer, sizeof(proc_buffer)-1, 0);
+    if (len < 0) {
+        AIM_LOG_ERROR("failed to read %s: %{errno}", pf->path, errno);
+        close(pf->fd);
+        pf->fd = -1;
+        return NULL;
+    }
+    proc_buffer[len] = 0;
+    return proc_buffer;
+}
+
+/* CPU time counters from the previous sample. [0] is all CPUs. */
+typedef struct {
+    uint64_t user;
+    uint64_t system;
+    uint64_t idle;
+    uint64_t iowait;
+    uint64_t total;
+} cpu_times_t;
+
+static cpu_times_t cpu_times[RESOURCE_CPUS_MAX+1];
+
+static uint32_t
+percent(uint64_t part, uint64_t total)
+{
+    if (part > total) {
+        part = total;
+    }
+    return total ? (part * 10000 + total / 2) / total : 0;
+}
+
+/*
+ * Counter delta clamped at 0. iowait is documented to go backwards
+ * and idle can too across CPU hotplug.
+ */
+static uint64_t
+delta(uint64_t now, uint64_t prev)
+{
+    return now > prev ? now - prev : 0;
+}
+
 static void
-resource_update(void)
+cpu_update(cpu_resources_t *cr, cpu_times_t *prev, cpu_times_t *now)
 {
-    uint64_t now = aim_time_monotonic();
-    if (now - last_resource_update_time >
-        (ONLP_SNMP_CONFIG_RESOURCE_UPDATE_SECONDS * 1000 * 1000)) {
-        last_resource_update_time = now;
+    uint64_t total = delta(now->total, prev->total);
 
-        /* invoke mpstat collection script for json output */
-        FILE *fp = popen("/usr/bin/onl-snmp-mpstat", "r");
-        if (fp == NULL) {
-            AIM_LOG_ERROR("failed invoking onl-snmp-mpstat");
-            return;
+    if (total == 0) {
+        /* No time passed or the counters were reset; keep the last values. */
+        *prev = *now;
+        return;
+    }
+
+    cr->idle_percent = percent(delta(now->idle, prev->idle), total);
+    cr->utilization_percent = 100*100 - cr->idle_percent;
+    cr->user_percent = percent(delta(now->user, prev->user), total);
+    cr->system_percent = percent(delta(now->system, prev->system), total);
+    cr->iowait_percent = percent(delta(now->iowait, prev->iowait), total);
+    *prev = *now;
+}
+
+static void
+cpu_sample(resources_t *r)
+{
+    char *line, *save;
+    char *data = proc_read(&proc_stat);
+
+    r->cpu_count = 0;
+    if (data == NULL) {
+        return;
+    }
+
+    for (line = strtok_r(data, "\n", &save); line;
+         line = strtok_r(NULL, "\n", &save)) {
+        unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
+        cpu_times_t now;
+        char *p = line+3;
+        int cpu = -1;
+
+        if (strncmp(line, "cpu", 3)) {
+            /* The cpu lines come first. */
+            break;
+        }
+        if (*p != ' ') {
+            cpu = strtol(p, &p, 10);
+            if (cpu < 0 || cpu >= RESOURCE_CPUS_MAX) {
+                continue;
+            }
+        }
+
+        /* steal is not reported by older kernels */
+        steal = 0;
+        if (sscanf(p, "%llu %llu %llu %llu %llu %llu %llu %llu",
+                   &user, &nice, &system, &idle, &iowait, &irq, &softirq,
+                   &steal) < 7) {
+            continue;
+        }
+
+        now.user = user + nice;
+        now.system = system + irq + softirq;
+        now.idle = idle;
+        now.iowait = iowait;
+        now.total = now.user + now.system + idle + iowait + steal;
+
+        if (cpu < 0) {
+            cpu_update(&r->all, &cpu_times[0], &now);
+        } else {
+            cpu_update(&r->cpus[cpu], &cpu_times[cpu+1], &now);
+            if (cpu >= r->cpu_count) {
+                r->cpu_count = cpu+1;
+            }
         }
+    }
+}
+
+static void
+memory_sample(resources_t *r)
+{
+    static const struct {
+        const char* name;
+        size_t offset;
+    } fields[] = {
+        { "MemTotal:", offsetof(resources_t, mem_total) },
+        { "MemFree:", offsetof(resources_t, mem_free) },
+        { "MemAvailable:", offsetof(resources_t, mem_available) },
+        { "Buffers:", offsetof(resources_t, mem_buffers) },
+        { "Cached:", offsetof(resources_t, mem_cached) },
+        { "SwapTotal:", offsetof(resources_t, swap_total) },
+        { "SwapFree:", offsetof(resources_t, swap_free) },
+    };
+    char *line, *save;
+    char *data = proc_read(&proc_meminfo);
+    int i;
+
+    if (data == NULL) {
+        return;
+    }
 
-        /* parse json output */
-        char line[1024];
-        while (fgets(line, sizeof(line), fp) != NULL) {
-            cJSON *root = cJSON_Parse(line);
-            int result;
-            int rv = cjson_util_lookup_int(root, &result, "all.%%idle");
-            if (rv == 0) {
-                resources_t *next = get_next_resources();
-                /* save it */
-                next->idle_percent = result;
-                next->utilization_percent = 100*100 - result;
-                /* swap buffers */
-                swap_curr_next_resources();
+    for (line = strtok_r(data, "\n", &save); line;
+         line = strtok_r(NULL, "\n", &save)) {
+        for (i = 0; i < AIM_ARRAYSIZE(fields); i++) {
+            int len = strlen(fields[i].name);
+            if (!strncmp(line, fields[i].name, len)) {
+                *(uint32_t*)((uint8_t*)r + fields[i].offset) =
+                    strtoul(line+len, NULL, 10);
+                break;
             }
-            cJSON_Delete(root);
         }
+    }
+}
+
+static void
+load_sample(resources_t *r)
+{
+    double l1, l5, l15;
+    char *data = proc_read(&proc_loadavg);
+
+    if (data && sscanf(data, "%lf %lf %lf", &l1, &l5, &l15) == 3) {
+        r->load_1 = l1 * 100 + 0.5;
+        r->load_5 = l5 * 100 + 0.5;
+        r->load_15 = l15 * 100 + 0.5;
+    }
+}
+
+static void
+resource_sample(void)
+{
+    resources_t *next = get_next_resources();
+
+    cpu_sample(next);
+    memory_sample(next);
+    load_sample(next);
+
+    /* swap buffers */
+    swap_curr_next_resources();
+}
 
-        pclose(fp);
+static void
+resource_update(void)
+{
+    uint64_t now = aim_time_monotonic();
+    if (now - last_resource_update_time >
+        (ONLP_SNMP_CONFIG_RESOURCE_UPDATE_SECONDS * 1000 * 1000)) {
+        last_resource_update_time = now;
+        /* CPU utilization is averaged since the last update */
+        resource_sample();
     }
 }
 
 static int
-utilization_handler(netsnmp_mib_handler *handler,
-             netsnmp_handler_registration *reginfo,
-             netsnmp_agent_request_info *reqinfo,
-             netsnmp_request_info *requests)
+resource_handler(netsnmp_mib_handler *handler,
+                 netsnmp_handler_registration *reginfo,
+                 netsnmp_agent_request_info *reqinfo,
+                 netsnmp_request_info *requests)
 {
     if (MODE_GET == reqinfo->mode) {
-        resources_t *curr = get_curr_resources();
+        /* myvoid is the offset of the object in resources_t */
+        uint32_t value = *(uint32_t*)((uint8_t*)get_curr_resources() +
+                                      (uintptr_t)handler->myvoid);
         snmp_set_var_typed_value(requests->requestvb, ASN_GAUGE,
-                                 (u_char *) &curr->utilization_percent,
-                                 sizeof(curr->utilization_percent));
+                                 (u_char *) &value, sizeof(value));
     } else {
         netsnmp_assert("bad mode in RO handler");
     }
@@ -183,19 +377,72 @@ utilization_handler(netsnmp_mib_handler *handler,
     return SNMP_ERR_NOERROR;
 }
 
+static void
+resource_register(int group, int index, const char* desc, size_t offset)
+{
+    oid tree[] = { 1, 3, 6, 1, 4, 1, 42623, 1, 3, 1, 1 };
+    tree[9] = group;
+    tree[10] = index;
+
+    netsnmp_handler_registration *reg =
+        netsnmp_create_handler_registration(desc, resource_handler,
+                                            tree, OID_LENGTH(tree),
+                                            HANDLER_CAN_RONLY);
+    reg->handler->myvoid = (void*)offset;
+    if (netsnmp_register_instance(reg) != MIB_REGISTERED_OK) {
+        AIM_LOG_ERROR("registering handler for %s failed", desc);
+    }
+}
+
+/* CPU table row indexes. Row n is CPU n-1. */
+static int cpu_index[RESOURCE_CPUS_MAX];
+
 static int
-idle_handler(netsnmp_mib_handler *handler,
-             netsnmp_handler_registration *reginfo,
-             netsnmp_agent_request_info *reqinfo,
-             netsnmp_request_info *requests)
+cpu_table_handler(netsnmp_mib_handler *handler,
+                  netsnmp_handler_registration *reginfo,
+                  netsnmp_agent_request_info *reqinfo,
+                  netsnmp_request_info *requests)
 {
-    if (MODE_GET == reqinfo->mode) {
-        resources_t *curr = get_curr_resources();
-        snmp_set_var_typed_value(requests->requestvb, ASN_GAUGE,
-                                 (u_char *) &curr->idle_percent,
-                                 sizeof(curr->idle_percent));
-    } else {
-        netsnmp_assert("bad mode in RO handler");
+    netsnmp_request_info *req;
+
+    if (reqinfo->mode != MODE_GET && reqinfo->mode != MODE_GETNEXT) {
+        return SNMP_ERR_NOERROR;
+    }
+
+    for (req = requests; req; req = req->next) {
+        int *index = (int *) netsnmp_tdata_extract_entry(req);
+        netsnmp_table_request_info *table_info =
+            netsnmp_extract_table_info(req);
+        cpu_resources_t *cr;
+        char name[16];
+        uint32_t value;
+
+        if (index == NULL) {
+            netsnmp_set_request_error(reqinfo, req, SNMP_NOSUCHINSTANCE);
+            continue;
+        }
+        cr = &get_curr_resources()->cpus[*index-1];
+
+        switch (table_info->colnum) {
+        case 1:
+            snmp_set_var_typed_integer(req->requestvb, ASN_INTEGER, *index);
+            continue;
+        case 2:
+            snprintf(name, sizeof(name), "cpu%d", *index-1);
+            snmp_set_var_typed_value(req->requestvb, ASN_OCTET_STR,
+                                     (u_char *) name, strlen(name));
+            continue;
+        case 3: value = cr->utilization_percent; break;
+        case 4: value = cr->idle_percent; break;
+        case 5: value = cr->user_percent; break;
+        case 6: value = cr->system_percent; break;
+        case 7: value = cr->iowait_percent; break;
+        default:
+            netsnmp_set_request_error(reqinfo, req, SNMP_NOSUCHINSTANCE);
+            continue;
+        }
+        snmp_set_var_typed_value(req->requestvb, ASN_GAUGE,
+                                 (u_char *) &value, sizeof(value));
     }
 
     if (handler->next && handler->next->access_method) {
@@ -205,6 +452,48 @@ idle_handler(netsnmp_mib_handler *handler,
     return SNMP_ERR_NOERROR;
 }
 
+static void
+cpu_table_register(int cpu_count)
+{
+    oid tree[] = { 1, 3, 6, 1, 4, 1, 42623, 1, 3, 2, 1 };
+    netsnmp_tdata *table;
+    netsnmp_table_registration_info *table_info;
+    netsnmp_handler_registration *reg;
+    int i;
+
+    table = netsnmp_tdata_create_table("onlCpuTable", 0);
+    table_info = SNMP_MALLOC_TYPEDEF(netsnmp_table_registration_info);
+    if (table == NULL || table_info == NULL) {
+        AIM_LOG_ERROR("failed to create onlCpuTable");
+        return;
+    }
+    netsnmp_table_helper_add_indexes(table_info, ASN_INTEGER, 0);
+    table_info->min_column = 1;
+    table_info->max_column = 7;
+
+    reg = netsnmp_create_handler_registration("onlCpuTable", cpu_table_handler,
+                                              tree, OID_LENGTH(tree),
+                                              HANDLER_CAN_RONLY);
+    if (reg == NULL ||
+        netsnmp_tdata_register(reg, table, table_info) != MIB_REGISTERED_OK) {
+        AIM_LOG_ERROR("failed to register onlCpuTable");
+        return;
+    }
+
+    for (i = 0; i < cpu_count; i++) {
+        netsnmp_tdata_row *row = netsnmp_tdata_create_row();
+        if (row == NULL) {
+            AIM_LOG_ERROR("failed to allocate table row");
+            return;
+        }
+        cpu_index[i] = i+1;
+        row->data = &cpu_index[i];
+        netsnmp_tdata_row_add_index(row, ASN_INTEGER, &cpu_index[i],
+                                    sizeof(cpu_index[i]));
+        netsnmp_tdata_add_row(table, row);
+    }
+}
+
 void
 onlp_snmp_platform_init(void)
 {
@@ -246,8 +535,31 @@ onlp_snmp_platform_init(void)
         REGISTER_STR(15, onie_version);
     }
 
-    resource_int_register(1, "CpuAllPercentUtilization", utilization_handler);
-    resource_int_register(2, "CpuAllPercentIdle", idle_handler);
+#define REGISTER_RESOURCE(_group, _index, _name, _field)                 \
+    resource_register(_group, _index, _name, offsetof(resources_t, _field))
+
+    REGISTER_RESOURCE(1, 1, "CpuAllPercentUtilization", all.utilization_percent);
+    REGISTER_RESOURCE(1, 2, "CpuAllPercentIdle", all.idle_percent);
+    REGISTER_RESOURCE(1, 3, "CpuAllPercentUser", all.user_percent);
+    REGISTER_RESOURCE(1, 4, "CpuAllPercentSystem", all.system_percent);
+    REGISTER_RESOURCE(1, 5, "CpuAllPercentIowait", all.iowait_percent);
+
+    REGISTER_RESOURCE(3, 1, "MemTotal", mem_total);
+    REGISTER_RESOURCE(3, 2, "MemFree", mem_free);
+    REGISTER_RESOURCE(3, 3, "MemAvailable", mem_available);
+    REGISTER_RESOURCE(3, 4, "MemBuffers", mem_buffers);
+    REGISTER_RESOURCE(3, 5, "MemCached", mem_cached);
+    REGISTER_RESOURCE(3, 6, "SwapTotal", swap_total);
+    REGISTER_RESOURCE(3, 7, "SwapFree", swap_free);
+
+    REGISTER_RESOURCE(4, 1, "LoadAverage1", load_1);
+    REGISTER_RESOURCE(4, 2, "LoadAverage5", load_5);
+    REGISTER_RESOURCE(4, 3, "LoadAverage15", load_15);
+
+    /* The first sample is the average since boot. It sizes the CPU table. */
+    resource_sample();
+    last_resource_update_time = aim_time_monotonic();
+    cpu_table_register(get_curr_resources()->cpu_count);
 }
 
 #define MIN(a,b) ((a)<(b)? (a): (b))
@@ -266,9 +578,8 @@ cpu_utilization_handler__(int fd, void* cookie)
 {
     char svalue[64];
     resources_t *curr = get_curr_resources();
-    sprintf(svalue, "%d", curr->utilization_percent);
+    sprintf(svalue, "%d", curr->all.utilization_percent);
     write(fd, svalue, strlen(svalue));
-    close(fd);
     return 0;
 }
 
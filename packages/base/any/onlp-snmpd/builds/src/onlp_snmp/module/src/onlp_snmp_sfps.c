@@ -0,0 +1,774 @@
+/************************************************************
+ * <bsn.cl fy=2015 v=onl>
+ *
+ *           Copyright 2015-2017 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+#include <onlp_snmp/onlp_snmp_config.h>
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+
+#include <AIM/aim_time.h>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <math.h>
+
+#include <onlp/sfp.h>
+#include <sff/sff.h>
+
+#include "onlp_snmp_log.h"
+#include "onlp_snmp_int.h"
+
+/**
+ * See:
+ *      OCP-ONL-TRANSCEIVER-MIB.txt
+ */
+#define ONLP_SNMP_TRANSCEIVER_OID 1,3,6,1,4,1,42623,1,4
+
+#define SFP_LANES_MAX (8)
+
+/* No light */
+#define SFP_POWER_DBM_MIN (-4000)
+
+typedef enum sfp_dom_type_e {
+    SFP_DOM_TYPE_NONE,
+    SFP_DOM_TYPE_SFF8472,
+    SFP_DOM_TYPE_SFF8636,
+    SFP_DOM_TYPE_CMIS,
+} sfp_dom_type_t;
+
+static const char* sfp_dom_type_names__[] = {
+    "none", "SFF-8472", "SFF-8636", "CMIS",
+};
+
+typedef struct sfp_lane_s {
+    /* uA */
+    int32_t bias;
+    /* dBm multiplied by 100 */
+    int32_t tx_power;
+    int32_t rx_power;
+} sfp_lane_t;
+
+typedef struct sfp_info_s {
+    bool present;
+
+    /* Identification. Read when the module is inserted. */
+    bool identified;
+    char type[32];
+    char media[32];
+    char vendor[17];
+    char model[17];
+    char serial[17];
+    sfp_dom_type_t dom_type;
+    int lanes;
+    /* SFF-8472 externally calibrated */
+    bool external_cal;
+    /* CMIS flat memory, no lane monitor pages */
+    bool flat_mem;
+
+    /* Monitors. Read every ONLP_SNMP_CONFIG_SFP_DOM_UPDATE_PERIOD. */
+    bool dom_valid;
+    /* The platform cannot read the monitors. Not retried until reinserted. */
+    bool dom_unsupported;
+    /* The lane monitors are valid. Not set for CMIS flat memory. */
+    bool lanes_valid;
+    /* milli-celsius */
+    int32_t temperature;
+    /* mV */
+    int32_t voltage;
+    sfp_lane_t lane[SFP_LANES_MAX];
+} sfp_info_t;
+
+/* for front-back buffers */
+#define NUM_SFP_INFO (2)
+
+struct onlp_snmp_sfp_s;
+
+/* Lane table row data */
+typedef struct sfp_lane_ref_s {
+    struct onlp_snmp_sfp_s *sfp;
+    uint32_t lane;
+} sfp_lane_ref_t;
+
+typedef struct onlp_snmp_sfp_s {
+    int port;
+    /* snmp table index */
+    uint32_t index;
+    sfp_info_t info[NUM_SFP_INFO];
+    uint64_t last_dom_update_time;
+
+    /* Rows currently in the tables. Only changed by restructure_tables__. */
+    bool row;
+    int lane_rows;
+    sfp_lane_ref_t lane_refs[SFP_LANES_MAX];
+} onlp_snmp_sfp_t;
+
+static onlp_snmp_sfp_t *sfps__[ONLP_SFP_BITMAP_PORTS];
+
+static int curr_info;
+static int
+next_info(void)
+{
+    return (curr_info+1) % NUM_SFP_INFO;
+}
+static sfp_info_t *
+get_curr_info(onlp_snmp_sfp_t *sfp)
+{
+    return &sfp->info[curr_info];
+}
+static sfp_info_t *
+get_next_info(onlp_snmp_sfp_t *sfp)
+{
+    return &sfp->info[next_info()];
+}
+static void
+swap_curr_next_info(void)
+{
+    curr_info = next_info();
+}
+
+/* timestamp used to trigger updates */
+static uint64_t last_sfp_update_time;
+
+/* set after an update, cleared after the tables are restructured */
+static bool restructure_trigger;
+
+/* updates happen in this pthread */
+static pthread_t update_thread_handle;
+
+static netsnmp_tdata *sfp_table__;
+static netsnmp_tdata *lane_table__;
+
+
+/**
+ * DOM decoding
+ */
+
+static uint16_t
+u16__(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static int16_t
+s16__(const uint8_t *p)
+{
+    return (int16_t) u16__(p);
+}
+
+static float
+f32__(const uint8_t *p)
+{
+    union { uint32_t u; float f; } v;
+    v.u = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    return v.f;
+}
+
+/* power in 0.1 uW to dBm multiplied by 100 */
+static int32_t
+power_dbm__(double uw10)
+{
+    if (uw10 <= 0) {
+        return SFP_POWER_DBM_MIN;
+    }
+    return (int32_t) lround(1000 * log10(uw10 / 10000));
+}
+
+/* temperature in 1/256 C to milli-celsius */
+static int32_t
+temperature_mc__(double t)
+{
+    return (int32_t) lround(t * 1000 / 256);
+}
+
+static int
+dom_sff8472__(int port, sfp_info_t *si)
+{
+    uint8_t *a2;
+    const uint8_t *d;
+    double t, v, bias, tx, rx;
+    int rv;
+
+    if ((rv = onlp_sfp_dom_read(port, &a2)) < 0) {
+        return rv;
+    }
+    d = a2 + 96;
+
+    t = s16__(d);
+    v = u16__(d + 2);
+    bias = u16__(d + 4);
+    tx = u16__(d + 6);
+    rx = u16__(d + 8);
+
+    if (si->external_cal) {
+        /* External calibration, SFF-8472 section 9.3 */
+        double raw = rx;
+        rx = f32__(a2 + 72) + f32__(a2 + 68) * raw +
+            f32__(a2 + 64) * raw * raw + f32__(a2 + 60) * raw * raw * raw +
+            f32__(a2 + 56) * raw * raw * raw * raw;
+        bias = bias * u16__(a2 + 76) / 256 + s16__(a2 + 78);
+        tx = tx * u16__(a2 + 80) / 256 + s16__(a2 + 82);
+        t = t * u16__(a2 + 84) / 256 + s16__(a2 + 86);
+        v = v * u16__(a2 + 88) / 256 + s16__(a2 + 90);
+    }
+
+    si->temperature = temperature_mc__(t);
+    si->voltage = lround(v / 10);
+    si->lane[0].bias = lround(bias * 2);
+    si->lane[0].tx_power = power_dbm__(tx);
+    si->lane[0].rx_power = power_dbm__(rx);
+    si->lanes_valid = true;
+
+    aim_free(a2);
+    return 0;
+}
+
+static int
+dom_sff8636__(int port, sfp_info_t *si)
+{
+    uint8_t d[36];
+    int i, rv;
+
+    /* Lower page, bytes 22-57 */
+    if ((rv = onlp_sfp_dev_read_page(port, 0x50, -1, 22, d, sizeof(d))) < 0) {
+        return rv;
+    }
+
+    si->temperature = temperature_mc__(s16__(d));
+    si->voltage = u16__(d + 4) / 10;
+    for (i = 0; i < 4; i++) {
+        si->lane[i].rx_power = power_dbm__(u16__(d + 12 + i*2));
+        si->lane[i].bias = u16__(d + 20 + i*2) * 2;
+        si->lane[i].tx_power = power_dbm__(u16__(d + 28 + i*2));
+    }
+    si->lanes_valid = true;
+    return 0;
+}
+
+static int
+dom_cmis__(int port, sfp_info_t *si)
+{
+    uint8_t d[48];
+    int i, rv;
+
+    /* Lower page, bytes 14-17 */
+    if ((rv = onlp_sfp_dev_read_page(port, 0x50, -1, 14, d, 4)) < 0) {
+        return rv;
+    }
+    si->temperature = temperature_mc__(s16__(d));
+    si->voltage = u16__(d + 2) / 10;
+
+    if (si->flat_mem) {
+        /* Flat memory. There are no lane monitors. */
+        return 0;
+    }
+
+    /* Page 11h, bytes 154-201. The module monitors stay valid without it. */
+    if ((rv = onlp_sfp_dev_read_page(port, 0x50, 0x11, 154, d, sizeof(d))) < 0) {
+        AIM_LOG_VERBOSE("port %d: failed to read the lane monitors: %{onlp_status}",
+                        port, rv);
+        return 0;
+    }
+
+    for (i = 0; i < si->lanes; i++) {
+        si->lane[i].tx_power = power_dbm__(u16__(d + i*2));
+        si->lane[i].bias = u16__(d + 16 + i*2) * 2;
+        si->lane[i].rx_power = power_dbm__(u16__(d + 32 + i*2));
+    }
+    si->lanes_valid = true;
+    return 0;
+}
+
+
+/**
+ * Identification. Only done when a module is inserted.
+ */
+static void
+sfp_identify__(onlp_snmp_sfp_t *sfp, sfp_info_t *si, const uint8_t *a0)
+{
+    sff_eeprom_t se;
+
+    sff_eeprom_parse(&se, (uint8_t *) a0);
+    if (!se.identified) {
+        aim_strlcpy(si->type, "unknown", sizeof(si->type));
+    } else {
+        aim_strlcpy(si->type, se.info.module_type_name, sizeof(si->type));
+        aim_strlcpy(si->media, se.info.media_type_name, sizeof(si->media));
+        aim_strlcpy(si->vendor, se.info.vendor, sizeof(si->vendor));
+        aim_strlcpy(si->model, se.info.model, sizeof(si->model));
+        aim_strlcpy(si->serial, se.info.serial, sizeof(si->serial));
+    }
+
+    /* The SFF-8024 identifier selects the DOM layout. */
+    si->dom_type = SFP_DOM_TYPE_NONE;
+    si->lanes = 0;
+    switch (a0[0])
+        {
+        case 0x03:
+            /* SFP. Diagnostic monitoring implemented. */
+            if (a0[92] & 0x40) {
+                si->dom_type = SFP_DOM_TYPE_SFF8472;
+                si->lanes = 1;
+                si->external_cal = (a0[92] & 0x10) != 0;
+            }
+            break;
+        case 0x0C:
+        case 0x0D:
+        case 0x11:
+            /* QSFP, QSFP+, QSFP28 */
+            si->dom_type = SFP_DOM_TYPE_SFF8636;
+            si->lanes = 4;
+            break;
+        case 0x18:
+        case 0x19:
+            /* QSFP-DD, OSFP */
+            si->dom_type = SFP_DOM_TYPE_CMIS;
+            si->lanes = 8;
+            si->flat_mem = (a0[2] & 0x80) != 0;
+            break;
+        case 0x1E:
+            /* QSFP+ with CMIS */
+            si->dom_type = SFP_DOM_TYPE_CMIS;
+            si->lanes = 4;
+            si->flat_mem = (a0[2] & 0x80) != 0;
+            break;
+        }
+
+    si->identified = true;
+    AIM_LOG_INFO("port %d: %s %s %s %s, DOM %s", sfp->port,
+                 si->type, si->vendor, si->model, si->serial,
+                 sfp_dom_type_names__[si->dom_type]);
+}
+
+static void
+sfp_update__(onlp_snmp_sfp_t *sfp, int present, uint64_t now)
+{
+    sfp_info_t *si = get_next_info(sfp);
+    uint8_t *a0;
+    int rv;
+
+    /* Start from the current state. Only what has changed is read. */
+    AIM_MEMCPY(si, get_curr_info(sfp), sizeof(*si));
+
+    if (!present) {
+        AIM_MEMSET(si, 0, sizeof(*si));
+        return;
+    }
+
+    if (!si->present || !si->identified) {
+        /* Inserted, or the last identification failed */
+        AIM_MEMSET(si, 0, sizeof(*si));
+        si->present = true;
+        if ((rv = onlp_sfp_eeprom_read(sfp->port, &a0)) < 0) {
+            AIM_LOG_ERROR("port %d: failed to read eeprom: %{onlp_status}",
+                          sfp->port, rv);
+            return;
+        }
+        sfp_identify__(sfp, si, a0);
+        aim_free(a0);
+        sfp->last_dom_update_time = 0;
+    }
+
+    if (si->dom_type == SFP_DOM_TYPE_NONE || si->dom_unsupported ||
+        now - sfp->last_dom_update_time <
+        ONLP_SNMP_CONFIG_SFP_DOM_UPDATE_PERIOD * 1000 * 1000) {
+        return;
+    }
+
+    si->lanes_valid = false;
+    switch (si->dom_type)
+        {
+        case SFP_DOM_TYPE_SFF8472: rv = dom_sff8472__(sfp->port, si); break;
+        case SFP_DOM_TYPE_SFF8636: rv = dom_sff8636__(sfp->port, si); break;
+        case SFP_DOM_TYPE_CMIS: rv = dom_cmis__(sfp->port, si); break;
+        default: rv = ONLP_STATUS_E_UNSUPPORTED; break;
+        }
+    si->dom_valid = (rv >= 0);
+    if (rv == ONLP_STATUS_E_UNSUPPORTED) {
+        AIM_LOG_INFO("port %d: DOM is not supported by the platform",
+                     sfp->port);
+        si->dom_unsupported = true;
+    } else if (rv < 0) {
+        AIM_LOG_ERROR("port %d: failed to read DOM: %{onlp_status}",
+                      sfp->port, rv);
+    }
+    sfp->last_dom_update_time = now;
+}
+
+static void
+update_tables__(void)
+{
+    onlp_sfp_bitmap_t presence;
+    int port;
+
+    uint64_t now = aim_time_monotonic();
+    if (now - last_sfp_update_time <
+        (ONLP_SNMP_CONFIG_SFP_UPDATE_PERIOD * 1000 * 1000)) {
+        return;
+    }
+
+    if (restructure_trigger) {
+        AIM_LOG_INFO("restructure has not happened, skip transceiver update");
+        return;
+    }
+
+    last_sfp_update_time = now;
+
+    onlp_sfp_bitmap_t_init(&presence);
+    if (onlp_sfp_presence_bitmap_get(&presence) < 0) {
+        AIM_LOG_ERROR("failed to get the transceiver presence bitmap");
+        return;
+    }
+
+    for (port = 0; port < ONLP_SFP_BITMAP_PORTS; port++) {
+        if (sfps__[port]) {
+            sfp_update__(sfps__[port], AIM_BITMAP_GET(&presence, port), now);
+        }
+    }
+
+    /* swap front and back buffers */
+    swap_curr_next_info();
+
+    restructure_trigger = true;
+}
+
+
+/**
+ * Tables
+ */
+
+static void
+table_row_add__(netsnmp_tdata *table, void *data, uint32_t *index,
+                uint32_t *index2)
+{
+    netsnmp_tdata_row *row = netsnmp_tdata_create_row();
+    if (row == NULL) {
+        AIM_LOG_ERROR("failed to allocate table row");
+        return;
+    }
+    row->data = data;
+    netsnmp_tdata_row_add_index(row, ASN_INTEGER, index, sizeof(*index));
+    if (index2) {
+        netsnmp_tdata_row_add_index(row, ASN_INTEGER, index2, sizeof(*index2));
+    }
+    netsnmp_tdata_add_row(table, row);
+}
+
+static void
+table_row_delete__(netsnmp_tdata *table, uint32_t index, uint32_t index2)
+{
+    oid o[] = { index, index2 };
+    netsnmp_tdata_row *row =
+        netsnmp_tdata_row_get_byoid(table, o, index2 ? 2 : 1);
+    if (row) {
+        netsnmp_tdata_remove_and_delete_row(table, row);
+    }
+}
+
+/*
+ * adds or removes rows from the tables.
+ * registered with snmp_alarm_register so the tables are not
+ * changed while snmp requests are handled.
+ */
+static void
+restructure_tables__(unsigned int reg, void *clientarg)
+{
+    int port;
+
+    if (!restructure_trigger) {
+        return;
+    }
+
+    for (port = 0; port < ONLP_SFP_BITMAP_PORTS; port++) {
+        onlp_snmp_sfp_t *sfp = sfps__[port];
+        sfp_info_t *si;
+        int lanes;
+
+        if (sfp == NULL) {
+            continue;
+        }
+        si = get_curr_info(sfp);
+
+        if (si->present && !sfp->row) {
+            snmp_log(LOG_INFO, "Adding transceiver %d", sfp->port);
+            table_row_add__(sfp_table__, sfp, &sfp->index, NULL);
+            sfp->row = true;
+        } else if (!si->present && sfp->row) {
+            snmp_log(LOG_INFO, "Deleting transceiver %d", sfp->port);
+            table_row_delete__(sfp_table__, sfp->index, 0);
+            sfp->row = false;
+        }
+
+        lanes = si->present ? si->lanes : 0;
+        while (sfp->lane_rows < lanes) {
+            sfp_lane_ref_t *ref = &sfp->lane_refs[sfp->lane_rows++];
+            table_row_add__(lane_table__, ref, &sfp->index, &ref->lane);
+        }
+        while (sfp->lane_rows > lanes) {
+            table_row_delete__(lane_table__, sfp->index, sfp->lane_rows--);
+        }
+    }
+
+    restructure_trigger = false;
+}
+
+static void
+set_string__(netsnmp_request_info *req, const char *s)
+{
+    snmp_set_var_typed_value(req->requestvb, ASN_OCTET_STR,
+                             (u_char *) s, strlen(s));
+}
+
+static int
+sfp_table_handler__(netsnmp_mib_handler *handler,
+                    netsnmp_handler_registration *reg_info,
+                    netsnmp_agent_request_info *req_info,
+                    netsnmp_request_info *requests)
+{
+    netsnmp_request_info *req;
+
+    if (req_info->mode != MODE_GET && req_info->mode != MODE_GETNEXT) {
+        return SNMP_ERR_NOERROR;
+    }
+
+    for (req = requests; req; req = req->next) {
+        onlp_snmp_sfp_t *sfp =
+            (onlp_snmp_sfp_t *) netsnmp_tdata_extract_entry(req);
+        netsnmp_table_request_info *table_info =
+            netsnmp_extract_table_info(req);
+        sfp_info_t *si;
+
+        if (sfp == NULL) {
+            netsnmp_set_request_error(req_info, req, SNMP_NOSUCHINSTANCE);
+            continue;
+        }
+        si = get_curr_info(sfp);
+
+        switch (table_info->colnum) {
+        case 1:
+            snmp_set_var_typed_integer(req->requestvb, ASN_INTEGER, sfp->index);
+            break;
+        case 2:
+            snmp_set_var_typed_integer(req->requestvb, ASN_INTEGER, sfp->port);
+            break;
+        case 3: set_string__(req, si->type); break;
+        case 4: set_string__(req, si->media); break;
+        case 5: set_string__(req, si->vendor); break;
+        case 6: set_string__(req, si->model); break;
+        case 7: set_string__(req, si->serial); break;
+        case 8: set_string__(req, sfp_dom_type_names__[si->dom_type]); break;
+        case 9:
+        case 10:
+            if (!si->dom_valid) {
+                netsnmp_set_request_error(req_info, req, SNMP_NOSUCHINSTANCE);
+                break;
+            }
+            snmp_set_var_typed_integer(req->requestvb, ASN_INTEGER,
+                                       table_info->colnum == 9 ?
+                                       si->temperature : si->voltage);
+            break;
+        case 11:
+            snmp_set_var_typed_integer(req->requestvb, ASN_INTEGER, si->lanes);
+            break;
+        default:
+            netsnmp_set_request_error(req_info, req, SNMP_NOSUCHINSTANCE);
+            break;
+        }
+    }
+
+    if (handler->next && handler->next->access_method) {
+        return netsnmp_call_next_handler(handler, reg_info, req_info, requests);
+    }
+
+    return SNMP_ERR_NOERROR;
+}
+
+static int
+lane_table_handler__(netsnmp_mib_handler *handler,
+                     netsnmp_handler_registration *reg_info,
+                     netsnmp_agent_request_info *req_info,
+                     netsnmp_request_info *requests)
+{
+    netsnmp_request_info *req;
+
+    if (req_info->mode != MODE_GET && req_info->mode != MODE_GETNEXT) {
+        return SNMP_ERR_NOERROR;
+    }
+
+    for (req = requests; req; req = req->next) {
+        sfp_lane_ref_t *ref = (sfp_lane_ref_t *) netsnmp_tdata_extract_entry(req);
+        netsnmp_table_request_info *table_info =
+            netsnmp_extract_table_info(req);
+        sfp_info_t *si;
+        sfp_lane_t *lane;
+
+        if (ref == NULL) {
+            netsnmp_set_request_error(req_info, req, SNMP_NOSUCHINSTANCE);
+            continue;
+        }
+        si = get_curr_info(ref->sfp);
+        lane = &si->lane[ref->lane-1];
+
+        if (table_info->colnum > 1 && !(si->dom_valid && si->lanes_valid)) {
+            netsnmp_set_request_error(req_info, req, SNMP_NOSUCHINSTANCE);
+            continue;
+        }
+
+        switch (table_info->colnum) {
+        case 1:
+            snmp_set_var_typed_integer(req->requestvb, ASN_INTEGER, ref->lane);
+            break;
+        case 2:
+            snmp_set_var_typed_integer(req->requestvb, ASN_INTEGER, lane->bias);
+            break;
+        case 3:
+            snmp_set_var_typed_integer(req->requestvb, ASN_INTEGER, lane->tx_power);
+            break;
+        case 4:
+            snmp_set_var_typed_integer(req->requestvb, ASN_INTEGER, lane->rx_power);
+            break;
+        default:
+            netsnmp_set_request_error(req_info, req, SNMP_NOSUCHINSTANCE);
+            break;
+        }
+    }
+
+    if (handler->next && handler->next->access_method) {
+        return netsnmp_call_next_handler(handler, reg_info, req_info, requests);
+    }
+
+    return SNMP_ERR_NOERROR;
+}
+
+static netsnmp_tdata *
+register_table__(char table_name[], oid table_oid[], size_t table_oid_len,
+                 unsigned int max_col, int indexes,
+                 Netsnmp_Node_Handler *handler_fn)
+{
+    netsnmp_tdata *table = netsnmp_tdata_create_table(table_name, 0);
+    netsnmp_table_registration_info *table_info =
+        SNMP_MALLOC_TYPEDEF(netsnmp_table_registration_info);
+    netsnmp_handler_registration *reg;
+
+    if (table == NULL || table_info == NULL) {
+        AIM_LOG_ERROR("failed to create table %s", table_name);
+        return NULL;
+    }
+
+    if (indexes == 2) {
+        netsnmp_table_helper_add_indexes(table_info, ASN_INTEGER, ASN_INTEGER, 0);
+    } else {
+        netsnmp_table_helper_add_indexes(table_info, ASN_INTEGER, 0);
+    }
+    table_info->min_column = 1;
+    table_info->max_column = max_col;
+
+    reg = netsnmp_create_handler_registration(table_name, handler_fn,
+                                              table_oid, table_oid_len,
+                                              HANDLER_CAN_RONLY);
+    if (reg == NULL ||
+        netsnmp_tdata_register(reg, table, table_info) != MIB_REGISTERED_OK) {
+        AIM_LOG_ERROR("failed to register table %s", table_name);
+        return NULL;
+    }
+
+    return table;
+}
+
+int
+onlp_snmp_sfps_init(void)
+{
+    onlp_sfp_bitmap_t bitmap;
+    int port, i;
+    oid sfp_oid[] = { ONLP_SNMP_TRANSCEIVER_OID, 1 };
+    oid lane_oid[] = { ONLP_SNMP_TRANSCEIVER_OID, 2 };
+
+    onlp_sfp_bitmap_t_init(&bitmap);
+    if (onlp_sfp_bitmap_get(&bitmap) < 0 || AIM_BITMAP_COUNT(&bitmap) == 0) {
+        AIM_LOG_INFO("no transceiver ports");
+        return 0;
+    }
+
+    AIM_BITMAP_ITER(&bitmap, port) {
+        onlp_snmp_sfp_t *sfp = aim_zmalloc(sizeof(*sfp));
+        sfp->port = port;
+        sfp->index = port + ONLP_SNMP_CONFIG_DEV_BASE_INDEX;
+        for (i = 0; i < SFP_LANES_MAX; i++) {
+            sfp->lane_refs[i].sfp = sfp;
+            sfp->lane_refs[i].lane = i+1;
+        }
+        sfps__[port] = sfp;
+    }
+
+    sfp_table__ = register_table__("onlTransceiverTable", sfp_oid,
+                                   OID_LENGTH(sfp_oid), 11, 1,
+                                   sfp_table_handler__);
+    lane_table__ = register_table__("onlTransceiverLaneTable", lane_oid,
+                                    OID_LENGTH(lane_oid), 4, 2,
+                                    lane_table_handler__);
+    if (sfp_table__ == NULL || lane_table__ == NULL) {
+        sfp_table__ = NULL;
+        return -1;
+    }
+
+    /* initial population and periodic table restructuring */
+    update_tables__();
+    restructure_tables__(0, NULL);
+    snmp_alarm_register(1, SA_REPEAT, restructure_tables__, NULL);
+    return 0;
+}
+
+#define MIN(a,b) ((a)<(b)? (a): (b))
+static unsigned int
+us_to_next_update(void)
+{
+    uint64_t deltat = aim_time_monotonic() - last_sfp_update_time;
+    uint64_t period = ONLP_SNMP_CONFIG_SFP_UPDATE_PERIOD * 1000 * 1000;
+    return MIN(period - deltat, period);
+}
+
+static void *
+do_update(void *arg)
+{
+    for (;;) {
+        update_tables__();
+        usleep(us_to_next_update());
+    }
+
+    return NULL;
+}
+
+int
+onlp_snmp_sfp_update_start(void)
+{
+    if (sfp_table__ == NULL) {
+        /* No transceiver ports */
+        return 0;
+    }
+    if (pthread_create(&update_thread_handle, NULL, do_update, NULL) < 0) {
+        AIM_LOG_ERROR("update thread creation failed");
+        return -1;
+    }
+    return 0;
+}
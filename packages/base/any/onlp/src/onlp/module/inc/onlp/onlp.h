@@ -55,10 +55,24 @@ typedef enum onlp_status_e {
     ((_rv) == ONLP_STATUS_E_UNSUPPORTED)
 
 /**
- * @brief Initialize all subsystems.
+ * @brief Initialize ONLP.
+ * @note Unless ONLP_CONFIG_INIT_EAGER_ENV is set, each subsystem
+ * (sys, sfp, led, psu, fan, thermal) is initialized when it is first used.
  */
 int onlp_init(void);
 
+/**
+ * @brief Initialize ONLP and all subsystems immediately.
+ * @note Intended for long running daemons.
+ */
+int onlp_init_eager(void);
+
+/**
+ * @brief Show the initialization status and time of each subsystem.
+ * @param pvs The output pvs.
+ */
+void onlp_init_show(aim_pvs_t* pvs);
+
 int onlp_denit(void);
 
 /**
@@ -254,6 +254,136 @@
 #define ONLP_CONFIG_INCLUDE_API_PROFILING 0
 #endif
 
+/**
+ * ONLP_CONFIG_ONIE_CACHE_DIR
+ *
+ * Directory in which the decoded ONIE system EEPROM is cached for all processes. NULL disables the cache. */
+
+
+#ifndef ONLP_CONFIG_ONIE_CACHE_DIR
+#define ONLP_CONFIG_ONIE_CACHE_DIR "/run/onlp"
+#endif
+
+/**
+ * ONLP_CONFIG_SFP_CACHE_DIR
+ *
+ * Directory in which decoded SFP EEPROMs are cached for all processes. NULL disables the cache. */
+
+
+#ifndef ONLP_CONFIG_SFP_CACHE_DIR
+#define ONLP_CONFIG_SFP_CACHE_DIR "/run/onlp"
+#endif
+
+/**
+ * ONLP_CONFIG_INCLUDE_LAZY_INIT
+ *
+ * Initialize each subsystem on first use instead of in onlp_init(). */
+
+
+#ifndef ONLP_CONFIG_INCLUDE_LAZY_INIT
+#define ONLP_CONFIG_INCLUDE_LAZY_INIT 1
+#endif
+
+/**
+ * ONLP_CONFIG_INIT_EAGER_ENV
+ *
+ * If this environment variable is set to a non-zero value onlp_init() initializes all subsystems immediately. */
+
+
+#ifndef ONLP_CONFIG_INIT_EAGER_ENV
+#define ONLP_CONFIG_INIT_EAGER_ENV "ONLP_INIT_EAGER"
+#endif
+
+/**
+ * ONLP_CONFIG_QUERY_SOCKET
+ *
+ * The onlpd query socket. */
+
+
+#ifndef ONLP_CONFIG_QUERY_SOCKET
+#define ONLP_CONFIG_QUERY_SOCKET "/var/run/onlpd.sock"
+#endif
+
+/**
+ * ONLP_CONFIG_QUERY_SOCKET_ENV
+ *
+ * Overrides the onlpd query socket. An empty value disables the query client. */
+
+
+#ifndef ONLP_CONFIG_QUERY_SOCKET_ENV
+#define ONLP_CONFIG_QUERY_SOCKET_ENV "ONLP_QUERY_SOCKET"
+#endif
+
+/**
+ * ONLP_CONFIG_QUERY_CACHE_MS
+ *
+ * How long (in milliseconds) onlpd reuses a query response. Zero disables the cache. */
+
+
+#ifndef ONLP_CONFIG_QUERY_CACHE_MS
+#define ONLP_CONFIG_QUERY_CACHE_MS 1000
+#endif
+
+/**
+ * ONLP_CONFIG_QUERY_TIMEOUT_MS
+ *
+ * The query client timeout in milliseconds. */
+
+
+#ifndef ONLP_CONFIG_QUERY_TIMEOUT_MS
+#define ONLP_CONFIG_QUERY_TIMEOUT_MS 5000
+#endif
+
+/**
+ * ONLP_CONFIG_INCLUDE_THERMAL_WATCHDOG
+ *
+ * Include the thermal threshold watchdog in the platform manager. It runs on platforms which implement onlp_thermali_alarm_arm(), or when ONLP_CONFIG_THERMAL_WATCHDOG_ENV is set. */
+
+
+#ifndef ONLP_CONFIG_INCLUDE_THERMAL_WATCHDOG
+#define ONLP_CONFIG_INCLUDE_THERMAL_WATCHDOG 1
+#endif
+
+/**
+ * ONLP_CONFIG_THERMAL_WATCHDOG_ENV
+ *
+ * If this environment variable is set to a non-zero value the thermal watchdog runs even if the platform does not implement onlp_thermali_alarm_arm(). */
+
+
+#ifndef ONLP_CONFIG_THERMAL_WATCHDOG_ENV
+#define ONLP_CONFIG_THERMAL_WATCHDOG_ENV "ONLP_THERMAL_WATCHDOG"
+#endif
+
+/**
+ * ONLP_CONFIG_THERMAL_WATCHDOG_INTERVAL_MS
+ *
+ * How often (in milliseconds) the platform manager checks thermal thresholds. */
+
+
+#ifndef ONLP_CONFIG_THERMAL_WATCHDOG_INTERVAL_MS
+#define ONLP_CONFIG_THERMAL_WATCHDOG_INTERVAL_MS 500
+#endif
+
+/**
+ * ONLP_CONFIG_THERMAL_WATCHDOG_HYSTERESIS
+ *
+ * A thermal must fall this far (in milli-celsius) below a threshold before the threshold is cleared. */
+
+
+#ifndef ONLP_CONFIG_THERMAL_WATCHDOG_HYSTERESIS
+#define ONLP_CONFIG_THERMAL_WATCHDOG_HYSTERESIS 2000
+#endif
+
+/**
+ * ONLP_CONFIG_THERMAL_SHUTDOWN_COMMAND
+ *
+ * The command run when a thermal reaches its shutdown threshold and the platform does not handle it. NULL disables it. */
+
+
+#ifndef ONLP_CONFIG_THERMAL_SHUTDOWN_COMMAND
+#define ONLP_CONFIG_THERMAL_SHUTDOWN_COMMAND NULL
+#endif
+
 
 
 /**
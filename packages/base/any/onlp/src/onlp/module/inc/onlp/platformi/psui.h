@@ -53,6 +53,17 @@ int onlp_psui_status_get(onlp_oid_t id, uint32_t* rv);
  */
 int onlp_psui_hdr_get(onlp_oid_t id, onlp_oid_hdr_t* rv);
 
+/**
+ * @brief Get the i2c location of the given PSU.
+ * @param id The PSU OID.
+ * @param [out] bus Receives the i2c bus number.
+ * @param [out] addr Receives the slave address, or -1 if every
+ * device on the bus belongs to the PSU.
+ * @notes Optional. The i2c health of these devices is forgotten
+ * when the PSU is inserted. See onlp_i2c_health_clear().
+ */
+int onlp_psui_i2c_get(onlp_oid_t id, int* bus, int* addr);
+
 /**
  * @brief Generic PSU ioctl
  * @param id The PSU OID
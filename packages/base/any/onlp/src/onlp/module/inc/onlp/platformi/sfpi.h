@@ -127,6 +127,17 @@ int onlp_sfpi_dom_read(int port, uint8_t data[256]);
  */
 int onlp_sfpi_post_insert(int port, sff_info_t* info);
 
+/**
+ * @brief Get the i2c location of the module in the given port.
+ * @param port The port number.
+ * @param [out] bus Receives the i2c bus number.
+ * @param [out] addr Receives the slave address, or -1 if every
+ * device on the bus belongs to the port.
+ * @notes Optional. The i2c health of these devices is forgotten
+ * when a module is inserted. See onlp_i2c_health_clear().
+ */
+int onlp_sfpi_i2c_get(int port, int* bus, int* addr);
+
 /**
  * @brief Returns whether or not the given control is suppport on the given port.
  * @param port The port number.
@@ -154,6 +165,29 @@ int onlp_sfpi_control_set(int port, onlp_sfp_control_t control, int value);
  */
 int onlp_sfpi_control_get(int port, onlp_sfp_control_t control, int* value);
 
+/**
+ * @brief Get an SFP control for all SFP ports.
+ * @param control The control.
+ * @param [out] dst Receives the bitmap of ports on which the control is set.
+ * @note Ports which do not support the control must be reported as clear.
+ * @note This is optional. It allows platforms which keep a control
+ * for all ports in a few CPLD registers to report it with a single read.
+ * If it is not supported the per-port control interface is used.
+ */
+int onlp_sfpi_control_bitmap_get(onlp_sfp_control_t control, onlp_sfp_bitmap_t* dst);
+
+/**
+ * @brief Set an SFP control on several SFP ports.
+ * @param control The control.
+ * @param ports The ports to change.
+ * @param values The new value for each port in ports.
+ * @note This is optional. If it is not supported the per-port control
+ * interface is used.
+ */
+int onlp_sfpi_control_bitmap_set(onlp_sfp_control_t control,
+                                 onlp_sfp_bitmap_t* ports,
+                                 onlp_sfp_bitmap_t* values);
+
 /**
  * @brief Remap SFP user SFP port numbers before calling the SFPI interface.
  * @param port The user SFP port number.
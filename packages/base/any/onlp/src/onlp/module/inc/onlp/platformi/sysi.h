@@ -26,6 +26,7 @@
 #define __ONLP_SYSI_H__
 
 #include <onlp/sys.h>
+#include <onlp/thermal.h>
 
 
 /**
@@ -149,6 +150,21 @@ int onlp_sysi_platform_manage_fans(void);
  */
 int onlp_sysi_platform_manage_leds(void);
 
+/**
+ * @brief Respond to a thermal threshold crossing.
+ * @param id The thermal oid.
+ * @param level The new threshold level of the thermal.
+ * @param mcelsius The current temperature in milli-celsius.
+ * @note This is called by the platform manager as soon as it sees
+ * the crossing, in either direction.
+ * @note Optional. If it is not supported the platform manager calls
+ * onlp_sysi_platform_manage_fans() immediately when a thermal rises to
+ * a new level, and runs ONLP_CONFIG_THERMAL_SHUTDOWN_COMMAND at the
+ * shutdown level.
+ */
+int onlp_sysi_platform_manage_thermal(onlp_oid_t id, onlp_thermal_level_t level,
+                                      int mcelsius);
+
 /**
  * @brief Return custom platform information.
  */
@@ -54,6 +54,20 @@ int onlp_thermali_status_get(onlp_oid_t id, uint32_t* rv);
  */
 int onlp_thermali_hdr_get(onlp_oid_t id, onlp_oid_hdr_t* rv);
 
+/**
+ * @brief Arm a hardware alarm for the given thermal.
+ * @param id The thermal oid.
+ * @param mcelsius The alarm temperature in milli-celsius.
+ * @param [out] fd Receives a descriptor which signals an exceptional
+ * condition (POLLPRI) when the alarm is raised, or -1 if the platform
+ * reports the alarm some other way.
+ * @note This is optional. Platforms which implement it enable the
+ * platform manager's thermal watchdog. A mcelsius of 0 disarms the
+ * alarm, and the platform must then restore whatever setting it
+ * replaced. onlp_file_hwmon_alarm_arm() does this for hwmon sensors.
+ */
+int onlp_thermali_alarm_arm(onlp_oid_t id, int mcelsius, int* fd);
+
 /**
  * @brief Generic ioctl.
  */
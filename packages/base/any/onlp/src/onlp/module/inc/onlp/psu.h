@@ -110,6 +110,13 @@ int onlp_psu_status_get(onlp_oid_t id, uint32_t* rv);
  */
 int onlp_psu_hdr_get(onlp_oid_t id, onlp_oid_hdr_t* rv);
 
+/**
+ * @brief Perform any actions required after a PSU is inserted.
+ * @param id The PSU OID.
+ * @notes Forgets the i2c health of the PSU's devices.
+ */
+int onlp_psu_post_insert(onlp_oid_t id);
+
 /**
  * @brief Issue a PSU ioctl.
  * @param id The PSU OID
@@ -0,0 +1,84 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * ONLP Query Service.
+ *
+ * The platform manager daemon (onlpd) answers queries from other
+ * processes on a local socket using its already initialized
+ * platform, so those processes do not need to initialize the
+ * platform themselves or compete with the daemon for the platform.
+ *
+ * A query is a single line of text:
+ *
+ *     dump                     onlp_platform_dump()
+ *     show <flags>             onlp_platform_show()
+ *     oid-dump <oid> <flags>   onlp_oid_dump()
+ *     oid-show <oid> <flags>   onlp_oid_show()
+ *     onie [json]              ONIE system information
+ *     platform-info [json]     Platform information
+ *     sfp-presence             SFP presence bitmap
+ *     sfp-eeprom <port>        SFP EEPROM data (hex)
+ *     thermal-watchdog         Thermal watchdog state and latencies
+ *     i2c-health               Health of the i2c devices which have failed
+ *
+ * The response is a status line containing the ONLP status
+ * code, followed by the output of the query.
+ *
+ ***********************************************************/
+#ifndef __ONLP_QUERY_H__
+#define __ONLP_QUERY_H__
+
+#include <onlp/onlp_config.h>
+#include <onlp/onlp.h>
+#include <AIM/aim_pvs.h>
+
+/**
+ * @brief Start answering queries.
+ * @param path The socket path. NULL selects the default.
+ * @note Each client is served on its own thread. Callers should
+ * ignore SIGPIPE, although replies are sent with MSG_NOSIGNAL.
+ */
+int onlp_query_server_start(const char* path);
+
+/**
+ * @brief Stop answering queries.
+ */
+void onlp_query_server_stop(void);
+
+/**
+ * @brief Process a query locally.
+ * @param request The query.
+ * @param pvs Receives the output.
+ * @returns The ONLP status of the query.
+ */
+int onlp_query_process(const char* request, aim_pvs_t* pvs);
+
+/**
+ * @brief Send a query to the query server.
+ * @param path The socket path. NULL selects the default.
+ * @param request The query.
+ * @param pvs Receives the output.
+ * @returns The ONLP status of the query.
+ * @returns ONLP_STATUS_E_MISSING if the query server is not available.
+ */
+int onlp_query(const char* path, const char* request, aim_pvs_t* pvs);
+
+#endif /* __ONLP_QUERY_H__ */
@@ -74,6 +74,9 @@ int onlp_sfp_init(void);
  */
 typedef aim_bitmap256_t onlp_sfp_bitmap_t;
 
+/** The number of ports an onlp_sfp_bitmap_t can hold. */
+#define ONLP_SFP_BITMAP_PORTS 256
+
 /**
  * Convenience function for initializing SFP bitmaps.
  * @param bmap The address of the bitmap to initialize.
@@ -120,6 +123,20 @@ int onlp_sfp_presence_bitmap_get(onlp_sfp_bitmap_t* dst);
  */
 int onlp_sfp_eeprom_read(int port, uint8_t** rv);
 
+/**
+ * @brief Read and decode the EEPROM of the module in the given port.
+ * @param port The SFP Port
+ * @param se Receives the decoded EEPROM.
+ * @notes Identified modules are cached in ONLP_CONFIG_SFP_CACHE_DIR,
+ * keyed by the port, the vendor serial number and the EEPROM
+ * checksums. Only those fields are read from a module which is
+ * already cached. Modules are not cached on platforms which support
+ * neither onlp_sfpi_dev_read() nor onlp_sfpi_dev_readb().
+ * @returns 0 if successful
+ * @returns -1 on error.
+ */
+int onlp_sfp_eeprom_decode(int port, sff_eeprom_t* se);
+
 
 /**
  * @brief Read the DOM data from the given port.
@@ -174,6 +191,43 @@ int onlp_sfp_dev_readw(int port, uint8_t devaddr, uint8_t addr);
  */
 int onlp_sfp_dev_writew(int port, uint8_t devaddr, uint8_t addr, uint16_t value);
 
+/**
+ * @brief Read from an address on the given SFP port's bus.
+ * @param port The port number.
+ * @param devaddr The device address.
+ * @param addr The address.
+ * @param rdata Receives the data.
+ * @param size The number of bytes to read.
+ */
+int onlp_sfp_dev_read(int port, uint8_t devaddr, uint8_t addr, uint8_t* rdata, int size);
+
+/**
+ * @brief Read from a page of the given SFP port's bus.
+ * @param port The port number.
+ * @param devaddr The device address.
+ * @param page The page selected through byte 127 for the read, or -1
+ * to read without selecting a page.
+ * @param addr The address.
+ * @param rdata Receives the data.
+ * @param size The number of bytes to read.
+ * @notes The page select, the read and the return to page 0 are done
+ * under a single API lock. Platforms without onlp_sfpi_dev_read() are
+ * read a byte at a time, and with no page selected a read from 0x50
+ * falls back to the platform's eeprom read.
+ */
+int onlp_sfp_dev_read_page(int port, uint8_t devaddr, int page,
+                           uint8_t addr, uint8_t* rdata, int size);
+
+/**
+ * @brief Write to an address on the given SFP port's bus.
+ * @param port The port number.
+ * @param devaddr The device address.
+ * @param addr The address.
+ * @param data The data.
+ * @param size The number of bytes to write.
+ */
+int onlp_sfp_dev_write(int port, uint8_t devaddr, uint8_t addr, uint8_t* data, int size);
+
 
 
 
@@ -226,6 +280,37 @@ int onlp_sfp_control_get(int port, onlp_sfp_control_t control, int* value);
  */
 int onlp_sfp_control_flags_get(int port, uint32_t* flags);
 
+/**
+ * @brief Get an SFP control for all ports.
+ * @param control The control.
+ * @param [out] dst Receives the bitmap of ports on which the control is set.
+ * @note Ports which do not support the control are reported as clear.
+ * This is emulated with the per-port control interface if the
+ * platform does not support it directly.
+ */
+int onlp_sfp_control_bitmap_get(onlp_sfp_control_t control, onlp_sfp_bitmap_t* dst);
+
+/**
+ * @brief Set an SFP control on several ports.
+ * @param control The control.
+ * @param ports The ports to change.
+ * @param values The new value for each port in ports.
+ */
+int onlp_sfp_control_bitmap_set(onlp_sfp_control_t control,
+                                onlp_sfp_bitmap_t* ports,
+                                onlp_sfp_bitmap_t* values);
+
+/**
+ * @brief Get the value of all SFP controls for all ports.
+ * @param [out] flags Receives the control flag values for each port,
+ * indexed by port number. See onlp_sfp_control_flags_t
+ * @param count The number of entries in flags.
+ * @note This reads each control once for all ports instead of once per port.
+ * Controls the platform cannot read in bulk are read from populated ports
+ * only. The flags of empty ports are zero.
+ */
+int onlp_sfp_control_flags_get_all(uint32_t* flags, int count);
+
 /******************************************************************************
  *
  * Enumeration Support Definitions.
@@ -0,0 +1,131 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * Platform Snapshots.
+ *
+ * A snapshot is a single packed buffer containing the state of
+ * every OID and every SFP port. It allows bindings and collectors
+ * to sample the whole platform with a single call.
+ *
+ * The buffer starts with an onlp_snapshot_hdr_t followed by
+ * oid_count onlp_snapshot_oid_t records at oid_offset and
+ * sfp_count onlp_snapshot_sfp_t records at sfp_offset. All fields
+ * are in host byte order. Readers must use the offsets and record
+ * sizes in the header so that fields can be appended in later versions.
+ *
+ ***********************************************************/
+#ifndef __ONLP_SNAPSHOT_H__
+#define __ONLP_SNAPSHOT_H__
+
+#include <onlp/onlp_config.h>
+#include <onlp/onlp.h>
+#include <onlp/oids.h>
+
+/** "ONLS" */
+#define ONLP_SNAPSHOT_MAGIC   0x534C4E4F
+#define ONLP_SNAPSHOT_VERSION 1
+
+/** Include all OIDs. */
+#define ONLP_SNAPSHOT_F_OIDS        0x1
+/** Include SFP presence and control state. */
+#define ONLP_SNAPSHOT_F_SFPS        0x2
+/** Include the SFP EEPROM of present ports. */
+#define ONLP_SNAPSHOT_F_SFP_EEPROM  0x4
+/** Include the SFP DOM data of present ports. */
+#define ONLP_SNAPSHOT_F_SFP_DOM     0x8
+
+/**
+ * Snapshot header.
+ */
+typedef struct __attribute__((__packed__)) onlp_snapshot_hdr_s {
+    /** ONLP_SNAPSHOT_MAGIC */
+    uint32_t magic;
+    /** ONLP_SNAPSHOT_VERSION */
+    uint16_t version;
+    /** sizeof(onlp_snapshot_hdr_t) */
+    uint16_t hdr_size;
+    /** Total size of the snapshot. */
+    uint32_t size;
+    /** ONLP_SNAPSHOT_F_* */
+    uint32_t flags;
+    /** Time the snapshot was started (aim_time_monotonic()). */
+    uint64_t timestamp;
+    /** Time taken to collect the snapshot, in usecs. */
+    uint32_t usecs;
+
+    uint32_t oid_offset;
+    uint32_t oid_count;
+    uint32_t oid_size;
+
+    uint32_t sfp_offset;
+    uint32_t sfp_count;
+    uint32_t sfp_size;
+} onlp_snapshot_hdr_t;
+
+/**
+ * OID record.
+ *
+ * The meaning of values[] depends on the OID type:
+ *     THERMAL: mcelsius, warning, error, shutdown
+ *     FAN:     rpm, percentage, mode
+ *     PSU:     mvin, mvout, miin, miout, mpin, mpout
+ *     LED:     mode, character
+ */
+typedef struct __attribute__((__packed__)) onlp_snapshot_oid_s {
+    uint32_t oid;
+    uint32_t poid;
+    /** The result of the information request. */
+    int32_t rv;
+    uint32_t status;
+    uint32_t caps;
+    int32_t values[6];
+    char description[ONLP_OID_DESC_SIZE];
+} onlp_snapshot_oid_t;
+
+/**
+ * SFP record.
+ */
+typedef struct __attribute__((__packed__)) onlp_snapshot_sfp_s {
+    int32_t port;
+    /** 1 if a module is present. */
+    uint32_t present;
+    /** onlp_sfp_control_flag_t values. */
+    uint32_t controls;
+    /** The result of the EEPROM read, if requested. */
+    int32_t eeprom_rv;
+    /** The result of the DOM read, if requested. */
+    int32_t dom_rv;
+    uint8_t eeprom[256];
+    uint8_t dom[256];
+} onlp_snapshot_sfp_t;
+
+/**
+ * @brief Take a snapshot of the platform.
+ * @param buf Receives the snapshot. May be NULL.
+ * @param size The size of buf.
+ * @param flags ONLP_SNAPSHOT_F_*
+ * @returns The size of the snapshot. The buffer is only written
+ * if it is large enough.
+ * @returns A negative ONLP_STATUS_E_* code on error.
+ */
+int onlp_snapshot_get(uint8_t* buf, int size, uint32_t flags);
+
+#endif /* __ONLP_SNAPSHOT_H__ */
@@ -122,6 +122,13 @@ int onlp_sys_platform_manage_join(void);
 
 void onlp_sys_platform_manage_now(void);
 
+/**
+ * @brief Show the state of the platform manager's thermal watchdog.
+ * @param pvs The output pvs.
+ * @note This includes the worst observed detection and response latencies.
+ */
+void onlp_sys_platform_manage_thermal_show(aim_pvs_t* pvs);
+
 int onlp_sys_debug(aim_pvs_t* pvs, int argc, char** argv);
 
 #endif /* __ONLP_SYS_H_ */
@@ -73,6 +73,16 @@ typedef enum onlp_thermal_threshold_e {
       ONLP_THERMAL_THRESHOLD_ERROR_DEFAULT,             \
       ONLP_THERMAL_THRESHOLD_SHUTDOWN_DEFAULT }
 
+/**
+ * Thermal threshold levels.
+ */
+typedef enum onlp_thermal_level_e {
+    ONLP_THERMAL_LEVEL_NORMAL,
+    ONLP_THERMAL_LEVEL_WARNING,
+    ONLP_THERMAL_LEVEL_ERROR,
+    ONLP_THERMAL_LEVEL_SHUTDOWN,
+} onlp_thermal_level_t;
+
 /**
  * Thermal sensor information structure.
  */
@@ -129,6 +139,16 @@ int onlp_thermal_status_get(onlp_oid_t id, uint32_t* rv);
  */
 int onlp_thermal_hdr_get(onlp_oid_t id, onlp_oid_hdr_t* rv);
 
+/**
+ * @brief Arm a hardware alarm for the given thermal.
+ * @param id The thermal oid.
+ * @param mcelsius The alarm temperature in milli-celsius.
+ * @param [out] fd Receives a descriptor which signals an exceptional
+ * condition (POLLPRI) when the alarm is raised, or -1.
+ * @returns ONLP_STATUS_E_UNSUPPORTED if the thermal has no hardware alarm.
+ */
+int onlp_thermal_alarm_arm(onlp_oid_t id, int mcelsius, int* fd);
+
 /**
  * @brief Thermal driver ioctl.
  * @param code Thermal ioctl code.
@@ -636,6 +636,114 @@ def onlp_sfp_init_prototypes():
     libonlp.onlp_sfp_control_flags_get.restype = ctypes.c_int
     libonlp.onlp_sfp_control_flags_get.argtyeps = (ctypes.c_int, ctypes.POINTER(ctypes.c_uint32),)
 
+    libonlp.onlp_sfp_control_bitmap_get.restype = ctypes.c_int
+    libonlp.onlp_sfp_control_bitmap_get.argtypes = (onlp_sfp_control, ctypes.POINTER(onlp_sfp_bitmap),)
+
+    libonlp.onlp_sfp_control_bitmap_set.restype = ctypes.c_int
+    libonlp.onlp_sfp_control_bitmap_set.argtypes = (onlp_sfp_control, ctypes.POINTER(onlp_sfp_bitmap), ctypes.POINTER(onlp_sfp_bitmap),)
+
+    libonlp.onlp_sfp_control_flags_get_all.restype = ctypes.c_int
+    libonlp.onlp_sfp_control_flags_get_all.argtypes = (ctypes.POINTER(ctypes.c_uint32), ctypes.c_int,)
+
+# onlp/snapshot.h
+
+ONLP_SNAPSHOT_MAGIC = 0x534C4E4F
+ONLP_SNAPSHOT_VERSION = 1
+
+ONLP_SNAPSHOT_F_OIDS = 0x1
+ONLP_SNAPSHOT_F_SFPS = 0x2
+ONLP_SNAPSHOT_F_SFP_EEPROM = 0x4
+ONLP_SNAPSHOT_F_SFP_DOM = 0x8
+
+class onlp_snapshot_hdr(ctypes.Structure):
+    _pack_ = 1
+    _fields_ = [("magic", ctypes.c_uint32,),
+                ("version", ctypes.c_uint16,),
+                ("hdr_size", ctypes.c_uint16,),
+                ("size", ctypes.c_uint32,),
+                ("flags", ctypes.c_uint32,),
+                ("timestamp", ctypes.c_uint64,),
+                ("usecs", ctypes.c_uint32,),
+                ("oid_offset", ctypes.c_uint32,),
+                ("oid_count", ctypes.c_uint32,),
+                ("oid_size", ctypes.c_uint32,),
+                ("sfp_offset", ctypes.c_uint32,),
+                ("sfp_count", ctypes.c_uint32,),
+                ("sfp_size", ctypes.c_uint32,),]
+
+class onlp_snapshot_oid(ctypes.Structure):
+    _pack_ = 1
+    _fields_ = [("oid", ctypes.c_uint32,),
+                ("poid", ctypes.c_uint32,),
+                ("rv", ctypes.c_int32,),
+                ("status", ctypes.c_uint32,),
+                ("caps", ctypes.c_uint32,),
+                ("values", ctypes.c_int32 * 6,),
+                ("description", ctypes.c_char * ONLP_OID_DESC_SIZE,),]
+
+    def getType(self):
+        return self.oid >> 24
+
+class onlp_snapshot_sfp(ctypes.Structure):
+    _pack_ = 1
+    _fields_ = [("port", ctypes.c_int32,),
+                ("present", ctypes.c_uint32,),
+                ("controls", ctypes.c_uint32,),
+                ("eeprom_rv", ctypes.c_int32,),
+                ("dom_rv", ctypes.c_int32,),
+                ("eeprom", ctypes.c_uint8 * 256,),
+                ("dom", ctypes.c_uint8 * 256,),]
+
+class OnlpSnapshot(object):
+    """A platform snapshot.
+
+    'hdr', 'oids' and 'sfps' are ctypes views into 'buffer';
+    nothing is copied. memoryview(snapshot.oids) is a structured
+    view of all OID records.
+    """
+
+    def __init__(self, buf):
+        self.buffer = buf
+        self.hdr = onlp_snapshot_hdr.from_buffer(buf)
+        if (self.hdr.magic != ONLP_SNAPSHOT_MAGIC
+            or self.hdr.version < ONLP_SNAPSHOT_VERSION):
+            raise ValueError("invalid snapshot (magic 0x%x version %d)"
+                             % (self.hdr.magic, self.hdr.version,))
+        self.oids = self._records(onlp_snapshot_oid, self.hdr.oid_offset,
+                                  self.hdr.oid_count, self.hdr.oid_size)
+        self.sfps = self._records(onlp_snapshot_sfp, self.hdr.sfp_offset,
+                                  self.hdr.sfp_count, self.hdr.sfp_size)
+
+    def _records(self, cls, offset, count, size):
+        if size == ctypes.sizeof(cls):
+            return (cls * count).from_buffer(self.buffer, offset)
+        # Records from a newer version have additional fields.
+        return [cls.from_buffer(self.buffer, offset + i * size)
+                for i in range(count)]
+
+    def memoryview(self):
+        return memoryview(self.buffer)[:self.hdr.size]
+
+_snapshot_size = 64 * 1024
+
+def onlp_snapshot(flags=ONLP_SNAPSHOT_F_OIDS | ONLP_SNAPSHOT_F_SFPS):
+    """Take a platform snapshot with a single libonlp call."""
+    global _snapshot_size
+    while True:
+        buf = bytearray(_snapshot_size)
+        cbuf = (ctypes.c_uint8 * len(buf)).from_buffer(buf)
+        size = libonlp.onlp_snapshot_get(cbuf, len(buf), flags)
+        if size < 0:
+            raise RuntimeError("onlp_snapshot_get() failed: %d" % size)
+        if size <= len(buf):
+            return OnlpSnapshot(buf)
+        _snapshot_size = size
+
+def onlp_snapshot_init_prototypes():
+
+    libonlp.onlp_snapshot_get.restype = ctypes.c_int
+    libonlp.onlp_snapshot_get.argtypes = (ctypes.POINTER(ctypes.c_uint8), ctypes.c_int, ctypes.c_uint32,)
+
 # onlp/onlp.h
 
 def init_prototypes():
@@ -658,5 +766,6 @@ def init_prototypes():
     onlp_psu_init_prototypes()
     sff_init_prototypes()
     onlp_sfp_init_prototypes()
+    onlp_snapshot_init_prototypes()
 
 init_prototypes()
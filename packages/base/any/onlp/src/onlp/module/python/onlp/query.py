@@ -0,0 +1,133 @@
+"""query.py
+
+Client for the onlpd query service.
+
+The ONLP platform manager daemon (onlpd) answers queries on a local
+socket from its already initialized platform. Use these functions
+instead of the onlp.onlp bindings when you only need information, so
+that this process does not initialize the platform itself.
+
+If onlpd is not running the query is answered directly through the
+onlp.onlp bindings.
+
+Set ONLP_QUERY_SOCKET to use a different socket, or to an empty
+string to always access the platform directly.
+"""
+
+import os
+import re
+import socket
+
+SOCKET = "/var/run/onlpd.sock"
+TIMEOUT = 5.0
+
+class QueryUnavailable(Exception):
+    """The query service is not available."""
+    pass
+
+class QueryError(Exception):
+    """The query failed with an ONLP status code."""
+
+    def __init__(self, request, status):
+        Exception.__init__(self, "%s: ONLP status %d" % (request, status,))
+        self.request = request
+        self.status = status
+
+def socketPath():
+    return os.environ.get("ONLP_QUERY_SOCKET", SOCKET)
+
+def query(request, path=None, timeout=TIMEOUT):
+    """Send a query to onlpd.
+
+    Returns (status, output).
+    Raises QueryUnavailable if onlpd does not answer.
+    """
+    path = path if path is not None else socketPath()
+    if not path:
+        raise QueryUnavailable("query client disabled")
+
+    s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    s.settimeout(timeout)
+    try:
+        try:
+            s.connect(path)
+            s.sendall((request + "\n").encode())
+            chunks = []
+            while True:
+                buf = s.recv(65536)
+                if not buf:
+                    break
+                chunks.append(buf)
+        except socket.error as e:
+            raise QueryUnavailable(str(e))
+    finally:
+        s.close()
+
+    data = b"".join(chunks)
+    if b"\n" not in data:
+        raise QueryUnavailable("no response")
+    status, output = data.split(b"\n", 1)
+    return int(status), output.decode("utf-8", "replace")
+
+def direct(request):
+    """Answer a query in this process.
+
+    Returns (status, output).
+    """
+    import ctypes
+    import onlp.onlp
+    libonlp = onlp.onlp.libonlp
+
+    libonlp.onlp_query_process.restype = ctypes.c_int
+    libonlp.onlp_query_process.argtypes = (ctypes.c_char_p, ctypes.POINTER(onlp.onlp.aim_pvs),)
+
+    pvs = libonlp.aim_pvs_buffer_create()
+    try:
+        status = libonlp.onlp_query_process(request.encode(), pvs)
+        output = libonlp.aim_pvs_buffer_get(pvs).string_at() or b""
+    finally:
+        libonlp.aim_pvs_destroy(pvs)
+    return status, output.decode("utf-8", "replace")
+
+def request(request):
+    """Answer a query from onlpd, or directly if onlpd is not available.
+
+    Returns the output.
+    Raises QueryError if the query fails.
+    """
+    try:
+        status, output = query(request)
+    except QueryUnavailable:
+        status, output = direct(request)
+    if status < 0:
+        raise QueryError(request, status)
+    return output
+
+def dump(flags=None):
+    return request("dump" if flags is None else "dump %d" % flags)
+
+def show(flags=0):
+    return request("show %d" % flags)
+
+def oidDump(oid, flags=None):
+    return request("oid-dump 0x%x" % oid if flags is None else "oid-dump 0x%x %d" % (oid, flags,))
+
+def oidShow(oid, flags=0):
+    return request("oid-show 0x%x %d" % (oid, flags,))
+
+def onie(json=False):
+    return request("onie json" if json else "onie")
+
+def platformInfo(json=False):
+    return request("platform-info json" if json else "platform-info")
+
+def sfpPresence():
+    """Returns the list of ports with an SFP present."""
+    ports = []
+    for lo, hi in re.findall(r"(\d+)(?:-(\d+))?", request("sfp-presence")):
+        ports.extend(range(int(lo), int(hi or lo) + 1))
+    return ports
+
+def sfpEeprom(port):
+    """Returns the SFP EEPROM data as a bytearray."""
+    return bytearray.fromhex(request("sfp-eeprom %d" % port).strip())
@@ -26,6 +26,8 @@
 #include <onlp/platformi/fani.h>
 #include <onlp/oids.h>
 #include "onlp_int.h"
+#define ONLP_API_SUBSYSTEM ONLP_SUBSYSTEM_FAN
+#define ONLP_API_SUBSYSTEM_INIT onlp_fan_init_locked__
 #include "onlp_locks.h"
 #include "onlp_log.h"
 #include "onlp_json.h"
@@ -50,7 +52,12 @@ onlp_fan_init_locked__(void)
 {
     return onlp_fani_init();
 }
-ONLP_LOCKED_API0(onlp_fan_init)
+
+int
+onlp_fan_init(void)
+{
+    return onlp_subsystem_init(ONLP_SUBSYSTEM_FAN, onlp_fan_init_locked__);
+}
 
 
 #if ONLP_CONFIG_INCLUDE_PLATFORM_OVERRIDES == 1
@@ -27,6 +27,8 @@
 #include <onlp/led.h>
 #include <onlp/platformi/ledi.h>
 #include "onlp_int.h"
+#define ONLP_API_SUBSYSTEM ONLP_SUBSYSTEM_LED
+#define ONLP_API_SUBSYSTEM_INIT onlp_led_init_locked__
 #include "onlp_locks.h"
 
 #define VALIDATE(_id)                           \
@@ -74,7 +76,12 @@ onlp_led_init_locked__(void)
 {
     return onlp_ledi_init();
 }
-ONLP_LOCKED_API0(onlp_led_init);
+
+int
+onlp_led_init(void)
+{
+    return onlp_subsystem_init(ONLP_SUBSYSTEM_LED, onlp_led_init_locked__);
+}
 
 static int
 onlp_led_info_get_locked__(onlp_oid_t id, onlp_led_info_t* info)
@@ -32,9 +32,115 @@
 #include <onlp/fan.h>
 #include <onlp/thermal.h>
 
+#include <AIM/aim_time.h>
+#include <inttypes.h>
+#include <pthread.h>
+
 #include "onlp_int.h"
 #include "onlp_json.h"
 #include "onlp_locks.h"
+#include "onlp_log.h"
+
+/**
+ * Subsystem initialization state.
+ */
+typedef struct onlp_subsystem_state_s {
+    /** Subsystem name. */
+    const char* name;
+    /** The public init function. */
+    int (*init)(void);
+    /** Set once initialization has completed. */
+    int done;
+    /** Initialization result. */
+    int rv;
+    /** Initialization start time, relative to onlp_init(). */
+    uint64_t start;
+    /** Initialization duration. */
+    uint64_t usecs;
+} onlp_subsystem_state_t;
+
+static onlp_subsystem_state_t subsystems__[ONLP_SUBSYSTEM_COUNT] = {
+    [ONLP_SUBSYSTEM_SYS] = { "sys", onlp_sys_init },
+    [ONLP_SUBSYSTEM_SFP] = { "sfp", onlp_sfp_init },
+    [ONLP_SUBSYSTEM_LED] = { "led", onlp_led_init },
+    [ONLP_SUBSYSTEM_PSU] = { "psu", onlp_psu_init },
+    [ONLP_SUBSYSTEM_FAN] = { "fan", onlp_fan_init },
+    [ONLP_SUBSYSTEM_THERMAL] = { "thermal", onlp_thermal_init },
+};
+
+static pthread_mutex_t subsystems_lock__ = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t init_start__;
+static uint64_t init_usecs__;
+
+int
+onlp_subsystem_init(onlp_subsystem_t s, int (*init)(void))
+{
+    onlp_subsystem_state_t* ss = subsystems__ + s;
+
+    if(__atomic_load_n(&ss->done, __ATOMIC_ACQUIRE)) {
+        return ss->rv;
+    }
+
+    /* The platform must be selected before any other subsystem is initialized. */
+    if(s != ONLP_SUBSYSTEM_SYS) {
+        onlp_sys_init();
+    }
+
+    pthread_mutex_lock(&subsystems_lock__);
+    if(!ss->done) {
+        uint64_t now = aim_time_monotonic();
+        ss->start = now - init_start__;
+        ONLP_API_LOCK(ss->name);
+        ss->rv = init();
+        ONLP_API_UNLOCK();
+        ss->usecs = aim_time_monotonic() - now;
+        AIM_LOG_VERBOSE("%s subsystem initialized in %"PRIu64" usecs: %{onlp_status}",
+                        ss->name, ss->usecs, ss->rv);
+        __atomic_store_n(&ss->done, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&subsystems_lock__);
+    return ss->rv;
+}
+
+int
+onlp_subsystem_denit(onlp_subsystem_t s, int (*denit)(void))
+{
+    onlp_subsystem_state_t* ss = subsystems__ + s;
+    int rv = ONLP_STATUS_OK;
+
+    pthread_mutex_lock(&subsystems_lock__);
+    if(ss->done) {
+        if(denit) {
+            ONLP_API_LOCK(ss->name);
+            rv = denit();
+            ONLP_API_UNLOCK();
+        }
+        __atomic_store_n(&ss->done, 0, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&subsystems_lock__);
+    return rv;
+}
+
+int
+onlp_subsystem_init_all(void)
+{
+    int s;
+    for(s = 0; s < ONLP_SUBSYSTEM_COUNT; s++) {
+        subsystems__[s].init();
+    }
+    return 0;
+}
+
+static int
+init_eager__(void)
+{
+#if ONLP_CONFIG_INCLUDE_LAZY_INIT == 1
+    char* v = getenv(ONLP_CONFIG_INIT_EAGER_ENV);
+    return v && atoi(v);
+#else
+    return 1;
+#endif
+}
 
 int
 onlp_init(void)
@@ -44,6 +150,8 @@ onlp_init(void)
 
     char* cfile;
 
+    init_start__ = aim_time_monotonic();
+
     if( (cfile=getenv(ONLP_CONFIG_CONFIGURATION_ENV)) == NULL) {
         cfile = ONLP_CONFIG_CONFIGURATION_FILENAME;
     }
@@ -54,23 +162,57 @@ onlp_init(void)
 
 
     onlp_json_init(cfile);
-    onlp_sys_init();
-    onlp_sfp_init();
-    onlp_led_init();
-    onlp_psu_init();
-    onlp_fan_init();
-    onlp_thermal_init();
+
+    if(init_eager__()) {
+        onlp_subsystem_init_all();
+    }
+
+    init_usecs__ = aim_time_monotonic() - init_start__;
     return 0;
 }
 
+int
+onlp_init_eager(void)
+{
+    onlp_init();
+    return onlp_subsystem_init_all();
+}
+
+void
+onlp_init_show(aim_pvs_t* pvs)
+{
+    int s;
+
+    aim_printf(pvs, "onlp_init: %"PRIu64" usecs (%s)\n", init_usecs__,
+               init_eager__() ? "eager" : "lazy");
+    aim_printf(pvs, "%-10s %-12s %12s %12s\n", "Subsystem", "Status", "Start", "Usecs");
+    for(s = 0; s < ONLP_SUBSYSTEM_COUNT; s++) {
+        onlp_subsystem_state_t* ss = subsystems__ + s;
+        if(ss->done) {
+            aim_printf(pvs, "%-10s %-12s %12"PRIu64" %12"PRIu64"\n", ss->name,
+                       ss->rv < 0 ? onlp_status_name(ss->rv) : "OK",
+                       ss->start, ss->usecs);
+        }
+        else {
+            aim_printf(pvs, "%-10s %-12s %12s %12s\n", ss->name, "-", "-", "-");
+        }
+    }
+}
+
 int
 onlp_denit(void)
 {
+    int s;
+
 #if ONLP_CONFIG_INCLUDE_API_LOCK == 1
     onlp_api_lock_denit();
 #endif
 
     onlp_json_denit();
 
+    for(s = 0; s < ONLP_SUBSYSTEM_COUNT; s++) {
+        onlp_subsystem_denit(s, NULL);
+    }
+
     return 0;
 }
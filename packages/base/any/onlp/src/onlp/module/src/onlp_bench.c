@@ -0,0 +1,515 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+#include <onlp/onlp.h>
+#include <onlp/oids.h>
+#include <onlp/sys.h>
+#include <onlp/sfp.h>
+#include <onlp/fan.h>
+#include <onlp/psu.h>
+#include <onlp/thermal.h>
+#include <onlp/led.h>
+#include <AIM/aim.h>
+#include <AIM/aim_time.h>
+#include <cjson/cJSON.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "onlp_log.h"
+
+/**
+ * ONLP benchmark.
+ *
+ * Each test drives the public ONLP APIs the way an application would
+ * (a presence sweep, a bulk read, an inventory pass, a platform manager
+ * pass) from one or more threads for a fixed time. The latency of every
+ * pass is recorded and the throughput and latency percentiles are
+ * reported.
+ *
+ * Together with the simulated platform (onlpsim) this allows ONLP
+ * performance changes to be measured without the target hardware.
+ */
+
+#define BENCH_OIDS_MAX 256
+
+typedef struct bench_ctx_s {
+    int ports[ONLP_SFP_BITMAP_PORTS];
+    int port_count;
+    int present[ONLP_SFP_BITMAP_PORTS];
+    int present_count;
+
+    onlp_oid_t fans[BENCH_OIDS_MAX];
+    int fan_count;
+    onlp_oid_t thermals[BENCH_OIDS_MAX];
+    int thermal_count;
+    onlp_oid_t psus[BENCH_OIDS_MAX];
+    int psu_count;
+    onlp_oid_t leds[BENCH_OIDS_MAX];
+    int led_count;
+    onlp_oid_t all[BENCH_OIDS_MAX];
+    int all_count;
+} bench_ctx_t;
+
+static bench_ctx_t ctx__;
+
+typedef struct bench_test_s {
+    const char* name;
+    const char* desc;
+    /** Run one pass. Returns the number of failed calls. */
+    int (*run)(void);
+} bench_test_t;
+
+
+/**
+ * Tests
+ */
+static int
+sfp_presence__(void)
+{
+    int i, errors = 0;
+    for(i = 0; i < ctx__.port_count; i++) {
+        if(onlp_sfp_is_present(ctx__.ports[i]) < 0) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+static int
+sfp_presence_bitmap__(void)
+{
+    onlp_sfp_bitmap_t bmap;
+    onlp_sfp_bitmap_t_init(&bmap);
+    return (onlp_sfp_presence_bitmap_get(&bmap) < 0) ? 1 : 0;
+}
+
+static int
+sfp_eeprom__(void)
+{
+    int i, errors = 0;
+    uint8_t* data;
+
+    for(i = 0; i < ctx__.present_count; i++) {
+        data = NULL;
+        if(onlp_sfp_eeprom_read(ctx__.present[i], &data) < 0) {
+            errors++;
+        }
+        aim_free(data);
+    }
+    return errors;
+}
+
+static int
+sfp_decode__(void)
+{
+    int i, errors = 0;
+    sff_eeprom_t se;
+
+    for(i = 0; i < ctx__.present_count; i++) {
+        if(onlp_sfp_eeprom_decode(ctx__.present[i], &se) < 0) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+static int
+sfp_flags__(void)
+{
+    int i, errors = 0;
+    uint32_t flags;
+
+    for(i = 0; i < ctx__.port_count; i++) {
+        if(onlp_sfp_control_flags_get(ctx__.ports[i], &flags) < 0) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+static int
+sfp_flags_all__(void)
+{
+    uint32_t flags[ONLP_SFP_BITMAP_PORTS];
+    return (onlp_sfp_control_flags_get_all(flags, AIM_ARRAYSIZE(flags)) < 0) ? 1 : 0;
+}
+
+static int
+fans__(void)
+{
+    int i, errors = 0;
+    onlp_fan_info_t info;
+
+    for(i = 0; i < ctx__.fan_count; i++) {
+        if(onlp_fan_info_get(ctx__.fans[i], &info) < 0) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+static int
+thermals__(void)
+{
+    int i, errors = 0;
+    onlp_thermal_info_t info;
+
+    for(i = 0; i < ctx__.thermal_count; i++) {
+        if(onlp_thermal_info_get(ctx__.thermals[i], &info) < 0) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+static int
+psus__(void)
+{
+    int i, errors = 0;
+    onlp_psu_info_t info;
+
+    for(i = 0; i < ctx__.psu_count; i++) {
+        if(onlp_psu_info_get(ctx__.psus[i], &info) < 0) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+static int
+leds__(void)
+{
+    int i, errors = 0;
+    onlp_led_info_t info;
+
+    for(i = 0; i < ctx__.led_count; i++) {
+        if(onlp_led_info_get(ctx__.leds[i], &info) < 0) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+static int
+oid_hdrs__(void)
+{
+    int i, errors = 0;
+    onlp_oid_hdr_t hdr;
+
+    for(i = 0; i < ctx__.all_count; i++) {
+        if(onlp_oid_hdr_get(ctx__.all[i], &hdr) < 0) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+static int
+inventory__(void)
+{
+    return fans__() + thermals__() + psus__() + leds__() +
+        sfp_presence_bitmap__() + sfp_flags_all__();
+}
+
+static int
+manage__(void)
+{
+    onlp_sys_platform_manage_now();
+    return 0;
+}
+
+static bench_test_t tests__[] = {
+    { "sfp-presence", "onlp_sfp_is_present() on every port", sfp_presence__ },
+    { "sfp-presence-bitmap", "onlp_sfp_presence_bitmap_get()", sfp_presence_bitmap__ },
+    { "sfp-eeprom", "onlp_sfp_eeprom_read() on every populated port", sfp_eeprom__ },
+    { "sfp-decode", "onlp_sfp_eeprom_decode() on every populated port", sfp_decode__ },
+    { "sfp-flags", "onlp_sfp_control_flags_get() on every port", sfp_flags__ },
+    { "sfp-flags-all", "onlp_sfp_control_flags_get_all()", sfp_flags_all__ },
+    { "fan", "onlp_fan_info_get() on every fan", fans__ },
+    { "thermal", "onlp_thermal_info_get() on every thermal", thermals__ },
+    { "psu", "onlp_psu_info_get() on every psu", psus__ },
+    { "led", "onlp_led_info_get() on every led", leds__ },
+    { "oid-hdr", "onlp_oid_hdr_get() on every oid", oid_hdrs__ },
+    { "inventory", "fans, thermals, psus, leds, sfp presence and flags", inventory__ },
+    { "manage", "onlp_sys_platform_manage_now()", manage__ },
+};
+
+
+/**
+ * Setup
+ */
+static void
+oid_add__(onlp_oid_t* table, int* count, onlp_oid_t oid)
+{
+    if(*count < BENCH_OIDS_MAX) {
+        table[(*count)++] = oid;
+    }
+}
+
+static int
+oid_collect__(onlp_oid_t oid, void* cookie)
+{
+    oid_add__(ctx__.all, &ctx__.all_count, oid);
+    switch(ONLP_OID_TYPE_GET(oid))
+        {
+        case ONLP_OID_TYPE_FAN: oid_add__(ctx__.fans, &ctx__.fan_count, oid); break;
+        case ONLP_OID_TYPE_THERMAL: oid_add__(ctx__.thermals, &ctx__.thermal_count, oid); break;
+        case ONLP_OID_TYPE_PSU: oid_add__(ctx__.psus, &ctx__.psu_count, oid); break;
+        case ONLP_OID_TYPE_LED: oid_add__(ctx__.leds, &ctx__.led_count, oid); break;
+        default: break;
+        }
+    return 0;
+}
+
+static void
+ctx_init__(void)
+{
+    onlp_sfp_bitmap_t bmap;
+    int p;
+
+    memset(&ctx__, 0, sizeof(ctx__));
+
+    onlp_sfp_bitmap_t_init(&bmap);
+    if(onlp_sfp_bitmap_get(&bmap) >= 0) {
+        AIM_BITMAP_ITER(&bmap, p) {
+            ctx__.ports[ctx__.port_count++] = p;
+            if(onlp_sfp_is_present(p) == 1) {
+                ctx__.present[ctx__.present_count++] = p;
+            }
+        }
+    }
+    onlp_oid_iterate(ONLP_OID_SYS, 0, oid_collect__, NULL);
+}
+
+
+/**
+ * Runner
+ */
+typedef struct bench_thread_s {
+    pthread_t thread;
+    bench_test_t* test;
+    uint64_t deadline;
+    int max;
+
+    uint32_t* us;
+    int count;
+    int size;
+    int errors;
+} bench_thread_t;
+
+static void*
+bench_thread__(void* arg)
+{
+    bench_thread_t* bt = (bench_thread_t*)arg;
+    uint64_t start, end;
+
+    for(;;) {
+        start = aim_time_monotonic();
+        if(start >= bt->deadline || (bt->max && bt->count >= bt->max)) {
+            break;
+        }
+        bt->errors += bt->test->run();
+        end = aim_time_monotonic();
+
+        if(bt->count == bt->size) {
+            bt->size = bt->size ? bt->size * 2 : 1024;
+            bt->us = aim_realloc(bt->us, bt->size * sizeof(bt->us[0]));
+        }
+        bt->us[bt->count++] = end - start;
+    }
+    return NULL;
+}
+
+static int
+us_compare__(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t
+percentile__(uint32_t* us, int count, int permille)
+{
+    if(count == 0) {
+        return 0;
+    }
+    return us[(int)(((uint64_t)(count - 1) * permille) / 1000)];
+}
+
+static int
+bench_run__(bench_test_t* test, int threads, int seconds, int max, int json)
+{
+    bench_thread_t* bt = aim_zmalloc(sizeof(*bt) * threads);
+    uint32_t* us;
+    uint64_t start, elapsed;
+    int t, count = 0, errors = 0;
+    double rate;
+
+    start = aim_time_monotonic();
+    for(t = 0; t < threads; t++) {
+        bt[t].test = test;
+        bt[t].deadline = start + (uint64_t)seconds * 1000000;
+        bt[t].max = max;
+        if(pthread_create(&bt[t].thread, NULL, bench_thread__, bt + t) != 0) {
+            AIM_DIE("pthread_create() failed.");
+        }
+    }
+    for(t = 0; t < threads; t++) {
+        pthread_join(bt[t].thread, NULL);
+        count += bt[t].count;
+        errors += bt[t].errors;
+    }
+    elapsed = aim_time_monotonic() - start;
+
+    us = aim_zmalloc(sizeof(*us) * (count ? count : 1));
+    count = 0;
+    for(t = 0; t < threads; t++) {
+        memcpy(us + count, bt[t].us, bt[t].count * sizeof(*us));
+        count += bt[t].count;
+        aim_free(bt[t].us);
+    }
+    aim_free(bt);
+    qsort(us, count, sizeof(*us), us_compare__);
+
+    rate = elapsed ? (double)count * 1000000 / elapsed : 0;
+
+    if(json) {
+        cJSON* cj = cJSON_CreateObject();
+        char* out;
+        cJSON_AddStringToObject(cj, "test", test->name);
+        cJSON_AddNumberToObject(cj, "threads", threads);
+        cJSON_AddNumberToObject(cj, "passes", count);
+        cJSON_AddNumberToObject(cj, "errors", errors);
+        cJSON_AddNumberToObject(cj, "passes_per_sec", rate);
+        cJSON_AddNumberToObject(cj, "p50_us", percentile__(us, count, 500));
+        cJSON_AddNumberToObject(cj, "p90_us", percentile__(us, count, 900));
+        cJSON_AddNumberToObject(cj, "p99_us", percentile__(us, count, 990));
+        cJSON_AddNumberToObject(cj, "p999_us", percentile__(us, count, 999));
+        cJSON_AddNumberToObject(cj, "max_us", count ? us[count-1] : 0);
+        out = cJSON_PrintUnformatted(cj);
+        printf("%s\n", out);
+        free(out);
+        cJSON_Delete(cj);
+    }
+    else {
+        printf("%-20s %3d %9d %7d %12.1f %9u %9u %9u %9u %9u\n",
+               test->name, threads, count, errors, rate,
+               percentile__(us, count, 500), percentile__(us, count, 900),
+               percentile__(us, count, 990), percentile__(us, count, 999),
+               count ? us[count-1] : 0);
+    }
+    fflush(stdout);
+    aim_free(us);
+    return errors;
+}
+
+static bench_test_t*
+test_find__(const char* name)
+{
+    int i;
+    for(i = 0; i < AIM_ARRAYSIZE(tests__); i++) {
+        if(!strcmp(tests__[i].name, name)) {
+            return tests__ + i;
+        }
+    }
+    return NULL;
+}
+
+int
+onlp_bench_main(int argc, char* argv[])
+{
+    int threads = 1;
+    int seconds = 3;
+    int max = 0;
+    int json = 0;
+    int list = 0;
+    int help = 0;
+    int rv = 0;
+    int c, i;
+
+    while( (c = getopt(argc, argv, "t:d:n:jlh")) != -1) {
+        switch(c)
+            {
+            case 't': threads = atoi(optarg); break;
+            case 'd': seconds = atoi(optarg); break;
+            case 'n': max = atoi(optarg); break;
+            case 'j': json = 1; break;
+            case 'l': list = 1; break;
+            case 'h': help = 1; break;
+            default: help = 1; rv = 1; break;
+            }
+    }
+
+    if(help || threads < 1 || seconds < 1 || max < 0) {
+        printf("Usage: %s [OPTIONS] [TEST...]\n", argv[0]);
+        printf("  -t   <threads> Concurrent readers. Default is 1.\n");
+        printf("  -d   <seconds> Duration of each test. Default is 3.\n");
+        printf("  -n   <passes> Stop each thread after this many passes.\n");
+        printf("  -j   Report one JSON object per test.\n");
+        printf("  -l   List the tests.\n");
+        printf("All tests are run if none are given. Latencies are per pass, in microseconds.\n");
+        return help ? rv : 1;
+    }
+
+    if(list) {
+        for(i = 0; i < AIM_ARRAYSIZE(tests__); i++) {
+            printf("%-20s %s\n", tests__[i].name, tests__[i].desc);
+        }
+        return 0;
+    }
+
+    for(i = optind; i < argc; i++) {
+        if(test_find__(argv[i]) == NULL) {
+            fprintf(stderr, "Unknown test '%s'. Use -l to list the tests.\n", argv[i]);
+            return 1;
+        }
+    }
+
+    onlp_init();
+    ctx_init__();
+
+    if(!json) {
+        printf("ports: %d populated: %d fans: %d thermals: %d psus: %d leds: %d\n",
+               ctx__.port_count, ctx__.present_count, ctx__.fan_count,
+               ctx__.thermal_count, ctx__.psu_count, ctx__.led_count);
+        printf("%-20s %3s %9s %7s %12s %9s %9s %9s %9s %9s\n",
+               "test", "thr", "passes", "errors", "passes/s",
+               "p50", "p90", "p99", "p99.9", "max");
+    }
+
+    if(optind == argc) {
+        for(i = 0; i < AIM_ARRAYSIZE(tests__); i++) {
+            bench_run__(tests__ + i, threads, seconds, max, json);
+        }
+    }
+    else {
+        for(i = optind; i < argc; i++) {
+            bench_run__(test_find__(argv[i]), threads, seconds, max, json);
+        }
+    }
+    return 0;
+}
@@ -134,6 +134,71 @@ onlp_config_settings_t onlp_config_settings[] =
     { __onlp_config_STRINGIFY_NAME(ONLP_CONFIG_INCLUDE_API_PROFILING), __onlp_config_STRINGIFY_VALUE(ONLP_CONFIG_INCLUDE_API_PROFILING) },
 #else
 { ONLP_CONFIG_INCLUDE_API_PROFILING(__onlp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_CONFIG_ONIE_CACHE_DIR
+    { __onlp_config_STRINGIFY_NAME(ONLP_CONFIG_ONIE_CACHE_DIR), __onlp_config_STRINGIFY_VALUE(ONLP_CONFIG_ONIE_CACHE_DIR) },
+#else
+{ ONLP_CONFIG_ONIE_CACHE_DIR(__onlp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_CONFIG_SFP_CACHE_DIR
+    { __onlp_config_STRINGIFY_NAME(ONLP_CONFIG_SFP_CACHE_DIR), __onlp_config_STRINGIFY_VALUE(ONLP_CONFIG_SFP_CACHE_DIR) },
+#else
+{ ONLP_CONFIG_SFP_CACHE_DIR(__onlp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_CONFIG_INCLUDE_LAZY_INIT
+    { __onlp_config_STRINGIFY_NAME(ONLP_CONFIG_INCLUDE_LAZY_INIT), __onlp_config_STRINGIFY_VALUE(ONLP_CONFIG_INCLUDE_LAZY_INIT) },
+#else
+{ ONLP_CONFIG_INCLUDE_LAZY_INIT(__onlp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_CONFIG_INIT_EAGER_ENV
+    { __onlp_config_STRINGIFY_NAME(ONLP_CONFIG_INIT_EAGER_ENV), __onlp_config_STRINGIFY_VALUE(ONLP_CONFIG_INIT_EAGER_ENV) },
+#else
+{ ONLP_CONFIG_INIT_EAGER_ENV(__onlp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_CONFIG_QUERY_SOCKET
+    { __onlp_config_STRINGIFY_NAME(ONLP_CONFIG_QUERY_SOCKET), __onlp_config_STRINGIFY_VALUE(ONLP_CONFIG_QUERY_SOCKET) },
+#else
+{ ONLP_CONFIG_QUERY_SOCKET(__onlp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_CONFIG_QUERY_SOCKET_ENV
+    { __onlp_config_STRINGIFY_NAME(ONLP_CONFIG_QUERY_SOCKET_ENV), __onlp_config_STRINGIFY_VALUE(ONLP_CONFIG_QUERY_SOCKET_ENV) },
+#else
+{ ONLP_CONFIG_QUERY_SOCKET_ENV(__onlp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_CONFIG_QUERY_CACHE_MS
+    { __onlp_config_STRINGIFY_NAME(ONLP_CONFIG_QUERY_CACHE_MS), __onlp_config_STRINGIFY_VALUE(ONLP_CONFIG_QUERY_CACHE_MS) },
+#else
+{ ONLP_CONFIG_QUERY_CACHE_MS(__onlp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_CONFIG_QUERY_TIMEOUT_MS
+    { __onlp_config_STRINGIFY_NAME(ONLP_CONFIG_QUERY_TIMEOUT_MS), __onlp_config_STRINGIFY_VALUE(ONLP_CONFIG_QUERY_TIMEOUT_MS) },
+#else
+{ ONLP_CONFIG_QUERY_TIMEOUT_MS(__onlp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_CONFIG_INCLUDE_THERMAL_WATCHDOG
+    { __onlp_config_STRINGIFY_NAME(ONLP_CONFIG_INCLUDE_THERMAL_WATCHDOG), __onlp_config_STRINGIFY_VALUE(ONLP_CONFIG_INCLUDE_THERMAL_WATCHDOG) },
+#else
+{ ONLP_CONFIG_INCLUDE_THERMAL_WATCHDOG(__onlp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_CONFIG_THERMAL_WATCHDOG_ENV
+    { __onlp_config_STRINGIFY_NAME(ONLP_CONFIG_THERMAL_WATCHDOG_ENV), __onlp_config_STRINGIFY_VALUE(ONLP_CONFIG_THERMAL_WATCHDOG_ENV) },
+#else
+{ ONLP_CONFIG_THERMAL_WATCHDOG_ENV(__onlp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_CONFIG_THERMAL_WATCHDOG_INTERVAL_MS
+    { __onlp_config_STRINGIFY_NAME(ONLP_CONFIG_THERMAL_WATCHDOG_INTERVAL_MS), __onlp_config_STRINGIFY_VALUE(ONLP_CONFIG_THERMAL_WATCHDOG_INTERVAL_MS) },
+#else
+{ ONLP_CONFIG_THERMAL_WATCHDOG_INTERVAL_MS(__onlp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_CONFIG_THERMAL_WATCHDOG_HYSTERESIS
+    { __onlp_config_STRINGIFY_NAME(ONLP_CONFIG_THERMAL_WATCHDOG_HYSTERESIS), __onlp_config_STRINGIFY_VALUE(ONLP_CONFIG_THERMAL_WATCHDOG_HYSTERESIS) },
+#else
+{ ONLP_CONFIG_THERMAL_WATCHDOG_HYSTERESIS(__onlp_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLP_CONFIG_THERMAL_SHUTDOWN_COMMAND
+    { __onlp_config_STRINGIFY_NAME(ONLP_CONFIG_THERMAL_SHUTDOWN_COMMAND), __onlp_config_STRINGIFY_VALUE(ONLP_CONFIG_THERMAL_SHUTDOWN_COMMAND) },
+#else
+{ ONLP_CONFIG_THERMAL_SHUTDOWN_COMMAND(__onlp_config_STRINGIFY_NAME), "__undefined__" },
 #endif
     { NULL, NULL }
 };
@@ -44,4 +44,31 @@ void onlp_oid_show_description(iof_t* iof, onlp_oid_hdr_t* hdr);
 /** Standard message when an OID is missing. */
 void onlp_oid_show_state_missing(iof_t* iof);
 
+/** onlpdump --watch output formats */
+typedef enum onlp_watch_format_e {
+    ONLP_WATCH_FORMAT_JSON,
+    ONLP_WATCH_FORMAT_TLV,
+} onlp_watch_format_t;
+
+/** onlpdump --watch configuration */
+typedef struct onlp_watch_config_s {
+    /** Sample interval (ms). */
+    uint32_t interval_ms;
+    /** Minimum time between reports of analog changes for one object (ms). */
+    uint32_t holdoff_ms;
+    /** Maximum number of records per second. 0 is unlimited. */
+    uint32_t rate;
+    /** Number of samples. 0 is unlimited. */
+    uint32_t count;
+    /** Output format. */
+    onlp_watch_format_t format;
+} onlp_watch_config_t;
+
+/**
+ * @brief Sample the platform and report changes on stdout.
+ * @param config The watch configuration.
+ * @note Returns on SIGINT or SIGTERM or after config->count samples.
+ */
+int onlp_watch(const onlp_watch_config_t* config);
+
 #endif /* __ONLP_INT_H__ */
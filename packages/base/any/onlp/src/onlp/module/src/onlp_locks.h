@@ -71,6 +71,55 @@ void onlp_api_unlock(void);
 
 #define ONLP_LOCKED_API_NAME(_name) _name##_locked__
 
+/****************************************************************************
+ *
+ * Subsystem initialization.
+ *
+ * Each subsystem is initialized once, either by onlp_init_eager() or
+ * by the first call to one of its APIs. Source files which implement
+ * a subsystem's APIs define ONLP_API_SUBSYSTEM and ONLP_API_SUBSYSTEM_INIT
+ * (the subsystem's locked init function) before including this file.
+ *
+ ***************************************************************************/
+typedef enum onlp_subsystem_e {
+    ONLP_SUBSYSTEM_SYS,
+    ONLP_SUBSYSTEM_SFP,
+    ONLP_SUBSYSTEM_LED,
+    ONLP_SUBSYSTEM_PSU,
+    ONLP_SUBSYSTEM_FAN,
+    ONLP_SUBSYSTEM_THERMAL,
+    ONLP_SUBSYSTEM_COUNT,
+} onlp_subsystem_t;
+
+/**
+ * @brief Initialize a subsystem if it has not been initialized.
+ * @param s The subsystem.
+ * @param init The subsystem's init function. It is called with the API lock held.
+ * @returns The result of the subsystem's initialization.
+ */
+int onlp_subsystem_init(onlp_subsystem_t s, int (*init)(void));
+
+/**
+ * @brief Initialize all subsystems which have not been initialized.
+ */
+int onlp_subsystem_init_all(void);
+
+/**
+ * @brief Deinitialize a subsystem if it has been initialized.
+ * @param s The subsystem.
+ * @param denit The subsystem's denit function, or NULL. It is called with the API lock held.
+ * @returns The result of denit, or ONLP_STATUS_OK if the subsystem was not initialized.
+ */
+int onlp_subsystem_denit(onlp_subsystem_t s, int (*denit)(void));
+
+#if ONLP_CONFIG_INCLUDE_LAZY_INIT == 1 && defined(ONLP_API_SUBSYSTEM)
+static int ONLP_API_SUBSYSTEM_INIT(void);
+#define ONLP_API_INIT(_name)                                            \
+    onlp_subsystem_init(ONLP_API_SUBSYSTEM, ONLP_API_SUBSYSTEM_INIT)
+#else
+#define ONLP_API_INIT(_name)
+#endif
+
 #if ONLP_CONFIG_INCLUDE_API_PROFILING == 1
 
 #define ONLP_API_T0(_name)                              \
@@ -96,6 +145,7 @@ void onlp_api_unlock(void);
 #define ONLP_LOCKED_API0(_name)                            \
     int _name (void)                                       \
     {                                                      \
+        ONLP_API_INIT(_name);                              \
         ONLP_API_T0(_name);                                \
         ONLP_API_LOCK(#_name);                             \
         ONLP_API_T1(_name);                                \
@@ -108,6 +158,7 @@ void onlp_api_unlock(void);
 #define ONLP_LOCKED_API1(_name, _t, _v)                         \
     int _name (_t _v)                                           \
     {                                                           \
+        ONLP_API_INIT(_name);                                   \
         ONLP_API_T0(_name);                                     \
         ONLP_API_LOCK(#_name);                                  \
         ONLP_API_T1(_name);                                     \
@@ -120,6 +171,7 @@ void onlp_api_unlock(void);
 #define ONLP_LOCKED_API2(_name, _t1, _v1, _t2, _v2)                     \
     int _name (_t1 _v1, _t2 _v2)                                        \
     {                                                                   \
+        ONLP_API_INIT(_name);                                           \
         ONLP_API_T0(_name);                                             \
         ONLP_API_LOCK(#_name);                                          \
         ONLP_API_T1(_name);                                             \
@@ -132,6 +184,7 @@ void onlp_api_unlock(void);
 #define ONLP_LOCKED_API3(_name, _t1, _v1, _t2, _v2, _t3, _v3)           \
     int _name (_t1 _v1, _t2 _v2, _t3 _v3)                               \
     {                                                                   \
+        ONLP_API_INIT(_name);                                           \
         ONLP_API_T0(_name);                                             \
         ONLP_API_LOCK(#_name);                                          \
         ONLP_API_T1(_name);                                             \
@@ -144,6 +197,7 @@ void onlp_api_unlock(void);
 #define ONLP_LOCKED_API4(_name, _t1, _v1, _t2, _v2, _t3, _v3, _t4, _v4) \
     int _name (_t1 _v1, _t2 _v2, _t3 _v3, _t4 _v4)                      \
     {                                                                   \
+        ONLP_API_INIT(_name);                                           \
         ONLP_API_T0(_name);                                             \
         ONLP_API_LOCK(#_name);                                          \
         ONLP_API_T1(_name);                                             \
@@ -156,6 +210,7 @@ void onlp_api_unlock(void);
 #define ONLP_LOCKED_API5(_name, _t1, _v1, _t2, _v2, _t3, _v3, _t4, _v4, _t5, _v5) \
     int _name (_t1 _v1, _t2 _v2, _t3 _v3, _t4 _v4, _t5 _v5)             \
     {                                                                   \
+        ONLP_API_INIT(_name);                                           \
         ONLP_API_T0(_name);                                             \
         ONLP_API_LOCK(#_name);                                          \
         ONLP_API_T1(_name);                                             \
@@ -165,9 +220,23 @@ void onlp_api_unlock(void);
         return _rv;                                                     \
     }
 
+#define ONLP_LOCKED_API6(_name, _t1, _v1, _t2, _v2, _t3, _v3, _t4, _v4, _t5, _v5, _t6, _v6) \
+    int _name (_t1 _v1, _t2 _v2, _t3 _v3, _t4 _v4, _t5 _v5, _t6 _v6)   \
+    {                                                                   \
+        ONLP_API_INIT(_name);                                           \
+        ONLP_API_T0(_name);                                             \
+        ONLP_API_LOCK(#_name);                                          \
+        ONLP_API_T1(_name);                                             \
+        int _rv = ONLP_LOCKED_API_NAME(_name) (_v1, _v2, _v3, _v4, _v5, _v6); \
+        ONLP_API_UNLOCK();                                              \
+        ONLP_API_T2(_name);                                             \
+        return _rv;                                                     \
+    }
+
 #define ONLP_LOCKED_VAPI0(_name)                                 \
     void _name (void)                                            \
     {                                                            \
+        ONLP_API_INIT(_name);                                    \
         ONLP_API_T0(_name);                                      \
         ONLP_API_LOCK(#_name);                                   \
         ONLP_API_T1(_name);                                      \
@@ -179,6 +248,7 @@ void onlp_api_unlock(void);
 #define ONLP_LOCKED_VAPI1(_name, _t, _v)                  \
     void _name (_t _v)                                    \
     {                                                     \
+        ONLP_API_INIT(_name);                             \
         ONLP_API_T0(_name);                               \
         ONLP_API_LOCK(#_name);                            \
         ONLP_API_T1(_name);                               \
@@ -190,6 +260,7 @@ void onlp_api_unlock(void);
 #define ONLP_LOCKED_VAPI2(_name, _t1, _v1, _t2, _v2)              \
     void _name (_t1 _v1, _t2 _v2)                                 \
     {                                                             \
+        ONLP_API_INIT(_name);                                     \
         ONLP_API_T0(_name);                                       \
         ONLP_API_LOCK(#_name);                                    \
         ONLP_API_T1(_name);                                       \
@@ -201,6 +272,7 @@ void onlp_api_unlock(void);
 #define ONLP_LOCKED_VAPI3(_name, _t1, _v1, _t2, _v2, _t3, _v3)          \
     void _name (_t1 _v1, _t2 _v2, _t3 _v3)                              \
     {                                                                   \
+        ONLP_API_INIT(_name);                                           \
         ONLP_API_T0(_name);                                             \
         ONLP_API_LOCK(#_name);                                          \
         ONLP_API_T1(_name);                                             \
@@ -212,6 +284,7 @@ void onlp_api_unlock(void);
 #define ONLP_LOCKED_VAPI4(_name, _t1, _v1, _t2, _v2, _t3, _v3, _t4, _v4) \
     void _name (_t1 _v1, _t2 _v2, _t3 _v3, _t4 _v4)                     \
     {                                                                   \
+        ONLP_API_INIT(_name);                                           \
         ONLP_API_T0(_name);                                             \
         ONLP_API_LOCK(#_name);                                          \
         ONLP_API_T1(_name);                                             \
@@ -223,6 +296,7 @@ void onlp_api_unlock(void);
 #define ONLP_LOCKED_VAPI5(_name, _t1, _v1, _t2, _v2, _t3, _v3, _t4, _v4, _t5, _v5) \
     void _name (_t1 _v1, _t2 _v2, _t3 _v3, _t4 _v4, _t5 _v5)            \
     {                                                                   \
+        ONLP_API_INIT(_name);                                           \
         ONLP_API_T0(_name);                                             \
         ONLP_API_LOCK(#_name);                                          \
         ONLP_API_T1(_name);                                             \
@@ -25,6 +25,7 @@
 #include <onlp/onlp.h>
 #include <onlp/oids.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <onlp/sys.h>
 #include <onlp/sfp.h>
 #include <sff/sff.h>
@@ -32,6 +33,10 @@
 #include <AIM/aim_log_handler.h>
 #include <syslog.h>
 #include <onlp/platformi/sysi.h>
+#include <onlp/query.h>
+#include <AIM/aim_pvs_buffer.h>
+#include "onlp_locks.h"
+#include "onlp_int.h"
 
 static void platform_manager_daemon__(const char* pidfile, char** argv);
 
@@ -42,12 +47,22 @@ static void platform_manager_daemon__(const char* pidfile, char** argv);
 static void
 show_inventory__(aim_pvs_t* pvs, int database)
 {
-    int port;
+    int port, rv, bulk;
     onlp_sfp_bitmap_t bitmap;
+    onlp_sfp_bitmap_t present;
+    uint32_t flags[ONLP_SFP_BITMAP_PORTS];
 
     onlp_sfp_bitmap_t_init(&bitmap);
     onlp_sfp_bitmap_get(&bitmap);
 
+    /* Collect the presence and control status of all ports at once. */
+    onlp_sfp_bitmap_t_init(&present);
+    bulk = (onlp_sfp_presence_bitmap_get(&present) >= 0);
+
+    if(onlp_sfp_control_flags_get_all(flags, AIM_ARRAYSIZE(flags)) < 0) {
+        memset(flags, 0, sizeof(flags));
+    }
+
     if(AIM_BITMAP_COUNT(&bitmap) == 0) {
         aim_printf(pvs, "No SFPs on this platform.\n");
     }
@@ -58,35 +73,36 @@ show_inventory__(aim_pvs_t* pvs, int database)
         }
 
         AIM_BITMAP_ITER(&bitmap, port) {
-            int rv;
-            uint8_t* data;
-
-            rv = onlp_sfp_is_present(port);
+            if(bulk) {
+                rv = AIM_BITMAP_GET(&present, port);
+            }
+            else {
+                /* Fall back to checking each port. */
+                rv = onlp_sfp_is_present(port);
+                if(rv < 0) {
+                    aim_printf(pvs, "%4d  Error %{onlp_status}\n", port, rv);
+                    continue;
+                }
+            }
 
-            if(rv == 0) {
+            if(!rv) {
                 if(!database) {
                     aim_printf(pvs, "%4d  NONE\n", port);
                 }
                 continue;
             }
 
-            if(rv < 0) {
-                aim_printf(pvs, "%4d  Error %{onlp_status}\n", port, rv);
-                continue;
-            }
+            sff_eeprom_t sff;
+            char status_str[32] = {0};
 
-            rv = onlp_sfp_eeprom_read(port, &data);
+            /* Unchanged modules are served from the SFP cache. */
+            rv = onlp_sfp_eeprom_decode(port, &sff);
 
             if(rv < 0) {
                 aim_printf(pvs, "%4d  Error %{onlp_status}\n", port, rv);
                 continue;
             }
 
-            sff_eeprom_t sff;
-            char status_str[32] = {0};
-
-            sff_eeprom_parse(&sff, data);
-
             if(!sff.identified) {
                 /* Present but unidentified. */
                 aim_printf(pvs, "%13d  UNK\n", port);
@@ -98,9 +114,8 @@ show_inventory__(aim_pvs_t* pvs, int database)
                 continue;
             }
 
-            uint32_t status = 0;
+            uint32_t status = flags[port];
             char* cp = status_str;
-            onlp_sfp_control_flags_get(port, &status);
             if(status & ONLP_SFP_CONTROL_FLAG_RX_LOS) {
                 *cp++ = 'R';
             }
@@ -166,6 +181,92 @@ iterate_oids__(void)
 
 
 
+/**
+ * Send a query to onlpd.
+ * Returns -1 if onlpd is not available, 1 if it answered with an
+ * error and 0 on success.
+ */
+static int
+query__(const char* request, aim_pvs_t* pvs)
+{
+    int rv = onlp_query(NULL, request, pvs);
+    if(rv == ONLP_STATUS_E_MISSING) {
+        return -1;
+    }
+    if(rv < 0) {
+        aim_printf(&aim_pvs_stderr, "%s: %{onlp_status}\n", request, rv);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Answer the request from onlpd if it is running.
+ * Returns the exit code, or -1 if the platform must be accessed directly.
+ * Requests which were answered before onlpd became unavailable are
+ * cleared so they are not repeated.
+ */
+static int
+client_main__(const char* O, int* o, int* x, int j, int* show, uint32_t showflags, int p)
+{
+    char request[64];
+    int rv = 0;
+    int qrv;
+
+    if(O) {
+        snprintf(request, sizeof(request), "oid-dump %s", O);
+        return query__(request, &aim_pvs_stdout);
+    }
+
+    if(*o || *x) {
+        if(*o) {
+            snprintf(request, sizeof(request), "onie%s", j ? " json" : "");
+            if((qrv = query__(request, &aim_pvs_stdout)) < 0) {
+                return -1;
+            }
+            *o = 0;
+            rv |= qrv;
+        }
+        if(*x) {
+            snprintf(request, sizeof(request), "platform-info%s", j ? " json" : "");
+            if((qrv = query__(request, &aim_pvs_stdout)) < 0) {
+                return -1;
+            }
+            *x = 0;
+            rv |= qrv;
+        }
+        return rv;
+    }
+
+    if(*show >= 0) {
+        if(*show == 0) {
+            snprintf(request, sizeof(request), "dump");
+        }
+        else {
+            snprintf(request, sizeof(request), "show %u", showflags);
+        }
+        if((qrv = query__(request, &aim_pvs_stdout)) < 0) {
+            return -1;
+        }
+        *show = -1;
+        rv |= qrv;
+    }
+
+    if(p) {
+        aim_pvs_t* pvs = aim_pvs_buffer_create();
+        qrv = query__("sfp-presence", pvs);
+        if(qrv == 0) {
+            char* presence = aim_pvs_buffer_get(pvs);
+            aim_printf(&aim_pvs_stdout, "Presence: %s", presence);
+            aim_free(presence);
+        }
+        aim_pvs_destroy(pvs);
+        return (qrv < 0) ? -1 : (rv | qrv);
+    }
+
+    return rv;
+}
+
 int
 onlpdump_main(int argc, char* argv[])
 {
@@ -184,10 +285,30 @@ onlpdump_main(int argc, char* argv[])
     int l = 0;
     int M = 0;
     int b = 0;
+    int D = 0;
     char* pidfile = NULL;
     const char* O = NULL;
     const char* t = NULL;
     const char* J = NULL;
+    int W = 0;
+    onlp_watch_config_t watch = { 1000, 10000, 0, 0, ONLP_WATCH_FORMAT_JSON };
+
+    enum {
+        OPT_WATCH = 256,
+        OPT_WATCH_HOLDOFF,
+        OPT_WATCH_RATE,
+        OPT_WATCH_COUNT,
+        OPT_WATCH_FORMAT,
+    };
+
+    static struct option long_options[] = {
+        { "watch",         optional_argument, NULL, OPT_WATCH },
+        { "watch-holdoff", required_argument, NULL, OPT_WATCH_HOLDOFF },
+        { "watch-rate",    required_argument, NULL, OPT_WATCH_RATE },
+        { "watch-count",   required_argument, NULL, OPT_WATCH_COUNT },
+        { "watch-format",  required_argument, NULL, OPT_WATCH_FORMAT },
+        { NULL, 0, NULL, 0 },
+    };
 
     /**
      * debug trap
@@ -195,6 +316,12 @@ onlpdump_main(int argc, char* argv[])
     if(argc > 1 && (!strcmp(argv[1], "debug") || !strcmp(argv[1], "debugi"))) {
         if(!strcmp(argv[1], "debug")) {
             onlp_init();
+            if(argc > 2 && !strcmp(argv[2], "init")) {
+                /* Startup time breakdown */
+                onlp_subsystem_init_all();
+                onlp_init_show(&aim_pvs_stdout);
+                return 0;
+            }
             return onlp_sys_debug(&aim_pvs_stdout, argc-2, argv+2);
         }
         else {
@@ -202,7 +329,8 @@ onlpdump_main(int argc, char* argv[])
         }
     }
 
-    while( (c = getopt(argc, argv, "srehdojmyM:ipxlSt:O:bJ:")) != -1) {
+    while( (c = getopt_long(argc, argv, "srehdojmyM:ipxlSt:O:bJ:D",
+                            long_options, NULL)) != -1) {
         switch(c)
             {
             case 's': show=1; break;
@@ -223,7 +351,28 @@ onlpdump_main(int argc, char* argv[])
             case 'l': l=1; break;
             case 'b': b=1; break;
             case 'J': J = optarg; break;
+            case 'D': D=1; break;
             case 'y': show=1; showflags |= ONLP_OID_SHOW_YAML; break;
+            case OPT_WATCH:
+                W=1;
+                if(optarg) {
+                    watch.interval_ms = strtoul(optarg, NULL, 0);
+                }
+                break;
+            case OPT_WATCH_HOLDOFF: watch.holdoff_ms = strtoul(optarg, NULL, 0); break;
+            case OPT_WATCH_RATE: watch.rate = strtoul(optarg, NULL, 0); break;
+            case OPT_WATCH_COUNT: watch.count = strtoul(optarg, NULL, 0); break;
+            case OPT_WATCH_FORMAT:
+                if(!strcmp(optarg, "json")) {
+                    watch.format = ONLP_WATCH_FORMAT_JSON;
+                }
+                else if(!strcmp(optarg, "tlv")) {
+                    watch.format = ONLP_WATCH_FORMAT_TLV;
+                }
+                else {
+                    help=1; rv = 1;
+                }
+                break;
             default: help=1; rv = 1; break;
             }
     }
@@ -248,6 +397,12 @@ onlpdump_main(int argc, char* argv[])
         printf("  -b   Decode SFP Inventory into SFF database entries.\n");
         printf("  -l   API Lock test.\n");
         printf("  -J   Decode ONIE JSON data.\n");
+        printf("  -D   Access the platform directly instead of querying onlpd.\n");
+        printf("  --watch[=<ms>]         Report changes as they happen. Samples every <ms> (default 1000).\n");
+        printf("  --watch-holdoff <ms>   Report analog changes at most once per <ms> per object (default 10000).\n");
+        printf("  --watch-rate <n>       Report at most <n> records per second (default unlimited).\n");
+        printf("  --watch-count <n>      Stop after <n> samples (default unlimited).\n");
+        printf("  --watch-format <fmt>   json (newline-delimited, default) or tlv (binary).\n");
         return rv;
     }
 
@@ -281,13 +436,30 @@ onlpdump_main(int argc, char* argv[])
         }
     }
 
-    onlp_init();
-
     if(M) {
+        onlp_init_eager();
         platform_manager_daemon__(pidfile, argv);
         exit(0);
     }
 
+    if(W) {
+        if(watch.interval_ms == 0) {
+            fprintf(stderr, "The watch interval must be nonzero.\n");
+            return 1;
+        }
+        onlp_init();
+        return onlp_watch(&watch) < 0 ? 1 : 0;
+    }
+
+    if(!D && !l && !S && !i && !m) {
+        int crv = client_main__(O, &o, &x, j, &show, showflags, p);
+        if(crv >= 0) {
+            return crv;
+        }
+    }
+
+    onlp_init();
+
     if(l) {
         extern int onlp_api_lock_test(void);
         int i;
@@ -437,11 +609,18 @@ platform_manager_daemon__(const char* pidfile, char** argv)
     /** Signal handler for terminating the platform manager */
     signal(SIGTERM, sighandler__);
 
+    /** Query clients may disconnect before their reply is written. */
+    signal(SIGPIPE, SIG_IGN);
+
+    /** Answer queries from other processes. */
+    onlp_query_server_start(NULL);
+
     /** Start and block in platform manager. */
     onlp_sys_platform_manage_start(1);
 
     /** Terminated via signal. Cleanup and exit. */
     onlp_sys_platform_manage_stop(1);
+    onlp_query_server_stop();
 
     aim_log_handler_basic_denit_all();
     exit(0);
@@ -0,0 +1,635 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+#include <onlp/query.h>
+#include <onlp/oids.h>
+#include <onlp/sys.h>
+#include <onlp/sfp.h>
+#include <onlplib/pi.h>
+#include <onlplib/i2c.h>
+#include <AIM/aim.h>
+#include <AIM/aim_pvs_buffer.h>
+#include <AIM/aim_time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include "onlp_log.h"
+
+#define QUERY_REQUEST_MAX 256
+#define QUERY_ARGS_MAX    8
+#define QUERY_CACHE_SIZE  16
+#define QUERY_CLIENTS_MAX 16
+
+static const char*
+socket_path__(const char* path)
+{
+    if(path == NULL) {
+        path = getenv(ONLP_CONFIG_QUERY_SOCKET_ENV);
+    }
+    if(path == NULL) {
+        path = ONLP_CONFIG_QUERY_SOCKET;
+    }
+    return path;
+}
+
+static int
+socket_addr__(const char* path, struct sockaddr_un* addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if(path[0] == 0 || strlen(path) >= sizeof(addr->sun_path)) {
+        return ONLP_STATUS_E_PARAM;
+    }
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+static int
+write_all__(int fd, const char* data, int size)
+{
+    while(size > 0) {
+        /* The client may have gone away, don't raise SIGPIPE. */
+        int rv = send(fd, data, size, MSG_NOSIGNAL);
+        if(rv < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += rv;
+        size -= rv;
+    }
+    return 0;
+}
+
+
+/**************************************************************************//**
+ *
+ * Queries
+ *
+ *****************************************************************************/
+
+static uint32_t
+flags_arg__(int argc, char* argv[], int i, uint32_t def)
+{
+    return (argc > i) ? strtoul(argv[i], NULL, 0) : def;
+}
+
+static int
+query_dump__(aim_pvs_t* pvs, int argc, char* argv[])
+{
+    onlp_platform_dump(pvs, flags_arg__(argc, argv, 1,
+                                        ONLP_OID_DUMP_RECURSE |
+                                        ONLP_OID_DUMP_EVEN_IF_ABSENT));
+    return 0;
+}
+
+static int
+query_show__(aim_pvs_t* pvs, int argc, char* argv[])
+{
+    onlp_platform_show(pvs, flags_arg__(argc, argv, 1, 0));
+    return 0;
+}
+
+static int
+query_oid_dump__(aim_pvs_t* pvs, int argc, char* argv[])
+{
+    if(argc < 2) {
+        return ONLP_STATUS_E_PARAM;
+    }
+    onlp_oid_dump(strtoul(argv[1], NULL, 0), pvs,
+                  flags_arg__(argc, argv, 2,
+                              ONLP_OID_DUMP_RECURSE |
+                              ONLP_OID_DUMP_EVEN_IF_ABSENT));
+    return 0;
+}
+
+static int
+query_oid_show__(aim_pvs_t* pvs, int argc, char* argv[])
+{
+    if(argc < 2) {
+        return ONLP_STATUS_E_PARAM;
+    }
+    onlp_oid_show(strtoul(argv[1], NULL, 0), pvs, flags_arg__(argc, argv, 2, 0));
+    return 0;
+}
+
+static int
+query_sys_info__(aim_pvs_t* pvs, int argc, char* argv[])
+{
+    onlp_sys_info_t si;
+    int json = (argc > 1 && !strcmp(argv[1], "json"));
+
+    ONLP_IF_ERROR_RETURN(onlp_sys_info_get(&si));
+
+    if(!strcmp(argv[0], "onie")) {
+        if(json) {
+            onlp_onie_show_json(&si.onie_info, pvs);
+        }
+        else {
+            onlp_onie_show(&si.onie_info, pvs);
+        }
+    }
+    else {
+        if(json) {
+            onlp_platform_info_show_json(&si.platform_info, pvs);
+        }
+        else {
+            onlp_platform_info_show(&si.platform_info, pvs);
+        }
+    }
+    onlp_sys_info_free(&si);
+    return 0;
+}
+
+static int
+query_sfp_presence__(aim_pvs_t* pvs, int argc, char* argv[])
+{
+    onlp_sfp_bitmap_t presence;
+    onlp_sfp_bitmap_t_init(&presence);
+    ONLP_IF_ERROR_RETURN(onlp_sfp_presence_bitmap_get(&presence));
+    aim_printf(pvs, "%{aim_bitmap}\n", &presence);
+    return 0;
+}
+
+static int
+query_sfp_eeprom__(aim_pvs_t* pvs, int argc, char* argv[])
+{
+    uint8_t* data;
+    int i, rv;
+
+    if(argc < 2) {
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    rv = onlp_sfp_eeprom_read(atoi(argv[1]), &data);
+    if(rv < 0) {
+        return rv;
+    }
+    for(i = 0; i < rv; i++) {
+        aim_printf(pvs, "%.2x", data[i]);
+    }
+    aim_printf(pvs, "\n");
+    aim_free(data);
+    return 0;
+}
+
+static int
+query_thermal_watchdog__(aim_pvs_t* pvs, int argc, char* argv[])
+{
+    onlp_sys_platform_manage_thermal_show(pvs);
+    return 0;
+}
+
+#if ONLPLIB_CONFIG_INCLUDE_I2C == 1
+static int
+query_i2c_health__(aim_pvs_t* pvs, int argc, char* argv[])
+{
+    onlp_i2c_health_show(pvs);
+    return 0;
+}
+#endif
+
+typedef struct query_handler_s {
+    const char* name;
+    int (*handler)(aim_pvs_t* pvs, int argc, char* argv[]);
+} query_handler_t;
+
+static query_handler_t handlers__[] = {
+    { "dump", query_dump__ },
+    { "show", query_show__ },
+    { "oid-dump", query_oid_dump__ },
+    { "oid-show", query_oid_show__ },
+    { "onie", query_sys_info__ },
+    { "platform-info", query_sys_info__ },
+    { "sfp-presence", query_sfp_presence__ },
+    { "sfp-eeprom", query_sfp_eeprom__ },
+    { "thermal-watchdog", query_thermal_watchdog__ },
+#if ONLPLIB_CONFIG_INCLUDE_I2C == 1
+    { "i2c-health", query_i2c_health__ },
+#endif
+};
+
+int
+onlp_query_process(const char* request, aim_pvs_t* pvs)
+{
+    char buf[QUERY_REQUEST_MAX];
+    char* argv[QUERY_ARGS_MAX];
+    char* saveptr = NULL;
+    char* tok;
+    int argc = 0;
+    int i;
+
+    aim_strlcpy(buf, request, sizeof(buf));
+    for(tok = strtok_r(buf, " \t\r\n", &saveptr);
+        tok && argc < QUERY_ARGS_MAX;
+        tok = strtok_r(NULL, " \t\r\n", &saveptr)) {
+        argv[argc++] = tok;
+    }
+
+    if(argc == 0) {
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    for(i = 0; i < AIM_ARRAYSIZE(handlers__); i++) {
+        if(!strcmp(argv[0], handlers__[i].name)) {
+            return handlers__[i].handler(pvs, argc, argv);
+        }
+    }
+    return ONLP_STATUS_E_UNSUPPORTED;
+}
+
+
+/**************************************************************************//**
+ *
+ * Server
+ *
+ *****************************************************************************/
+
+typedef struct query_cache_entry_s {
+    char request[QUERY_REQUEST_MAX];
+    int rv;
+    char* output;
+    uint64_t expires;
+} query_cache_entry_t;
+
+static struct {
+    int lfd;
+    int efd;
+    char* path;
+    pthread_t thread;
+
+    /** Recent responses, shared by the client threads. */
+    pthread_mutex_t lock;
+    query_cache_entry_t cache[QUERY_CACHE_SIZE];
+    int cache_next;
+
+    /** Clients being served. */
+    int clients;
+} server__ = { -1, -1, NULL, 0, PTHREAD_MUTEX_INITIALIZER };
+
+static query_cache_entry_t*
+cache_lookup__(const char* request)
+{
+    int i;
+    uint64_t now = aim_time_monotonic();
+
+    for(i = 0; i < QUERY_CACHE_SIZE; i++) {
+        query_cache_entry_t* e = server__.cache + i;
+        if(e->output && now < e->expires && !strcmp(e->request, request)) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static query_cache_entry_t*
+cache_add__(const char* request, int rv, char* output)
+{
+    query_cache_entry_t* e = server__.cache + server__.cache_next;
+    server__.cache_next = (server__.cache_next + 1) % QUERY_CACHE_SIZE;
+
+    aim_free(e->output);
+    aim_strlcpy(e->request, request, sizeof(e->request));
+    e->rv = rv;
+    e->output = output;
+    e->expires = aim_time_monotonic() + ONLP_CONFIG_QUERY_CACHE_MS * 1000ULL;
+    return e;
+}
+
+static void
+client_process__(int fd)
+{
+    char request[QUERY_REQUEST_MAX];
+    char status[32];
+    char* output = NULL;
+    int len = 0, rv = 0;
+    struct timeval tv = { 1, 0 };
+    query_cache_entry_t* e;
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    /* Read the request line. */
+    while(len < sizeof(request) - 1) {
+        int rv = read(fd, request + len, sizeof(request) - 1 - len);
+        if(rv < 0 && errno == EINTR) {
+            continue;
+        }
+        if(rv <= 0) {
+            break;
+        }
+        len += rv;
+        if(memchr(request, '\n', len)) {
+            break;
+        }
+    }
+    request[len] = 0;
+    request[strcspn(request, "\r\n")] = 0;
+
+    if(len == 0) {
+        return;
+    }
+
+    /* Take a copy, the entry may be replaced while the reply is written. */
+    pthread_mutex_lock(&server__.lock);
+    e = cache_lookup__(request);
+    if(e) {
+        rv = e->rv;
+        output = aim_strdup(e->output);
+    }
+    pthread_mutex_unlock(&server__.lock);
+
+    if(e == NULL) {
+        aim_pvs_t* pvs = aim_pvs_buffer_create();
+        rv = onlp_query_process(request, pvs);
+        output = aim_pvs_buffer_get(pvs);
+        aim_pvs_destroy(pvs);
+        if(ONLP_CONFIG_QUERY_CACHE_MS > 0 && output) {
+            pthread_mutex_lock(&server__.lock);
+            cache_add__(request, rv, aim_strdup(output));
+            pthread_mutex_unlock(&server__.lock);
+        }
+    }
+
+    snprintf(status, sizeof(status), "%d\n", rv);
+    if(write_all__(fd, status, strlen(status)) == 0 && output) {
+        write_all__(fd, output, strlen(output));
+    }
+    aim_free(output);
+}
+
+static void*
+client_thread__(void* arg)
+{
+    int fd = (int)(intptr_t)arg;
+
+    client_process__(fd);
+    close(fd);
+
+    pthread_mutex_lock(&server__.lock);
+    server__.clients--;
+    pthread_mutex_unlock(&server__.lock);
+    return NULL;
+}
+
+/**
+ * Serve a client on its own thread so a slow or stalled client
+ * does not hold up the others.
+ */
+static void
+client_start__(int fd)
+{
+    pthread_t thread;
+    pthread_attr_t attr;
+    int busy;
+
+    pthread_mutex_lock(&server__.lock);
+    busy = (server__.clients >= QUERY_CLIENTS_MAX);
+    if(!busy) {
+        server__.clients++;
+    }
+    pthread_mutex_unlock(&server__.lock);
+
+    if(busy) {
+        AIM_LOG_VERBOSE("query server: too many clients.");
+        close(fd);
+        return;
+    }
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if(pthread_create(&thread, &attr, client_thread__, (void*)(intptr_t)fd) != 0) {
+        AIM_LOG_ERROR("query server pthread_create() failed.");
+        close(fd);
+        pthread_mutex_lock(&server__.lock);
+        server__.clients--;
+        pthread_mutex_unlock(&server__.lock);
+    }
+    pthread_attr_destroy(&attr);
+}
+
+static void*
+server_thread__(void* arg)
+{
+    struct pollfd fds[2];
+
+    fds[0].fd = server__.lfd;
+    fds[0].events = POLLIN;
+    fds[1].fd = server__.efd;
+    fds[1].events = POLLIN;
+
+    for(;;) {
+        if(poll(fds, 2, -1) < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            AIM_LOG_ERROR("query server poll(): %{errno}", errno);
+            break;
+        }
+        if(fds[1].revents) {
+            /* Stop requested. */
+            break;
+        }
+        if(fds[0].revents & POLLIN) {
+            int fd = accept(server__.lfd, NULL, NULL);
+            if(fd >= 0) {
+                client_start__(fd);
+            }
+        }
+    }
+    return NULL;
+}
+
+int
+onlp_query_server_start(const char* path)
+{
+    struct sockaddr_un addr;
+
+    if(server__.lfd >= 0) {
+        return 0;
+    }
+
+    path = socket_path__(path);
+    if(socket_addr__(path, &addr) < 0) {
+        AIM_LOG_ERROR("Invalid query socket path '%s'", path);
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    if((server__.lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+        AIM_LOG_ERROR("query server socket(): %{errno}", errno);
+        return ONLP_STATUS_E_INTERNAL;
+    }
+
+    unlink(path);
+    if(bind(server__.lfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+       chmod(path, 0660) < 0 ||
+       listen(server__.lfd, 16) < 0) {
+        AIM_LOG_ERROR("query server %s: %{errno}", path, errno);
+        goto error;
+    }
+
+    if((server__.efd = eventfd(0, EFD_CLOEXEC)) < 0) {
+        AIM_LOG_ERROR("query server eventfd(): %{errno}", errno);
+        goto error;
+    }
+
+    server__.path = aim_strdup(path);
+    if(pthread_create(&server__.thread, NULL, server_thread__, NULL) != 0) {
+        AIM_LOG_ERROR("query server pthread_create() failed.");
+        goto error;
+    }
+
+    AIM_LOG_INFO("Serving queries on %s", path);
+    return 0;
+
+ error:
+    close(server__.lfd);
+    server__.lfd = -1;
+    if(server__.efd >= 0) {
+        close(server__.efd);
+        server__.efd = -1;
+    }
+    aim_free(server__.path);
+    server__.path = NULL;
+    return ONLP_STATUS_E_INTERNAL;
+}
+
+void
+onlp_query_server_stop(void)
+{
+    int i;
+    uint64_t v = 1;
+
+    if(server__.lfd < 0) {
+        return;
+    }
+
+    if(write(server__.efd, &v, sizeof(v)) == sizeof(v)) {
+        pthread_join(server__.thread, NULL);
+    }
+
+    close(server__.lfd);
+    close(server__.efd);
+    server__.lfd = server__.efd = -1;
+    unlink(server__.path);
+    aim_free(server__.path);
+    server__.path = NULL;
+
+    pthread_mutex_lock(&server__.lock);
+    for(i = 0; i < QUERY_CACHE_SIZE; i++) {
+        aim_free(server__.cache[i].output);
+        server__.cache[i].output = NULL;
+    }
+    pthread_mutex_unlock(&server__.lock);
+}
+
+
+/**************************************************************************//**
+ *
+ * Client
+ *
+ *****************************************************************************/
+
+int
+onlp_query(const char* path, const char* request, aim_pvs_t* pvs)
+{
+    struct sockaddr_un addr;
+    struct timeval tv;
+    char buf[4096];
+    int fd, rv, len;
+    int status = ONLP_STATUS_E_INTERNAL;
+    int have_status = 0;
+    char* nl;
+
+    path = socket_path__(path);
+    if(socket_addr__(path, &addr) < 0) {
+        return ONLP_STATUS_E_MISSING;
+    }
+
+    if((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+        return ONLP_STATUS_E_MISSING;
+    }
+
+    if(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        /* No server. */
+        close(fd);
+        return ONLP_STATUS_E_MISSING;
+    }
+
+    tv.tv_sec = ONLP_CONFIG_QUERY_TIMEOUT_MS / 1000;
+    tv.tv_usec = (ONLP_CONFIG_QUERY_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    if(write_all__(fd, request, strlen(request)) < 0 ||
+       write_all__(fd, "\n", 1) < 0) {
+        close(fd);
+        return ONLP_STATUS_E_MISSING;
+    }
+
+    len = 0;
+    for(;;) {
+        rv = read(fd, buf + len, sizeof(buf) - 1 - len);
+        if(rv < 0 && errno == EINTR) {
+            continue;
+        }
+        if(rv <= 0) {
+            break;
+        }
+        len += rv;
+        buf[len] = 0;
+
+        if(!have_status) {
+            /* The first line is the status. */
+            if((nl = strchr(buf, '\n')) == NULL) {
+                if(len < sizeof(buf) - 1) {
+                    continue;
+                }
+                break;
+            }
+            status = atoi(buf);
+            have_status = 1;
+            len -= (nl + 1 - buf);
+            memmove(buf, nl + 1, len + 1);
+        }
+
+        if(len) {
+            aim_printf(pvs, "%s", buf);
+            len = 0;
+        }
+    }
+    close(fd);
+
+    if(!have_status) {
+        /* The server did not answer. */
+        return ONLP_STATUS_E_MISSING;
+    }
+    return status;
+}
@@ -0,0 +1,265 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+#include <onlp/snapshot.h>
+#include <onlp/sys.h>
+#include <onlp/thermal.h>
+#include <onlp/fan.h>
+#include <onlp/psu.h>
+#include <onlp/led.h>
+#include <onlp/sfp.h>
+#include <AIM/aim.h>
+#include <AIM/aim_time.h>
+#include "onlp_log.h"
+
+typedef struct snapshot_oids_s {
+    onlp_snapshot_oid_t* records;
+    int count;
+    int allocated;
+} snapshot_oids_t;
+
+static int
+snapshot_oid_seen__(snapshot_oids_t* oids, onlp_oid_t oid)
+{
+    int i;
+    for(i = 0; i < oids->count; i++) {
+        if(oids->records[i].oid == oid) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void
+snapshot_oid_hdr__(onlp_snapshot_oid_t* r, onlp_oid_hdr_t* hdr)
+{
+    r->poid = hdr->poid;
+    aim_strlcpy(r->description, hdr->description, sizeof(r->description));
+}
+
+/**
+ * Record an OID and its children. Each information request
+ * also returns the children, so the OID tree is only read once.
+ */
+static void
+snapshot_oid__(snapshot_oids_t* oids, onlp_oid_t oid)
+{
+    onlp_snapshot_oid_t* r;
+    onlp_oid_hdr_t* hdr = NULL;
+    onlp_oid_t* oidp;
+    union {
+        onlp_sys_info_t sys;
+        onlp_thermal_info_t thermal;
+        onlp_fan_info_t fan;
+        onlp_psu_info_t psu;
+        onlp_led_info_t led;
+        onlp_oid_hdr_t hdr;
+    } info;
+
+    if(oid == 0 || snapshot_oid_seen__(oids, oid)) {
+        return;
+    }
+
+    if(oids->count == oids->allocated) {
+        oids->allocated = oids->allocated ? oids->allocated * 2 : 64;
+        oids->records = aim_realloc(oids->records,
+                                    oids->allocated * sizeof(*oids->records));
+    }
+    r = oids->records + oids->count++;
+    memset(r, 0, sizeof(*r));
+    r->oid = oid;
+
+    switch(ONLP_OID_TYPE_GET(oid))
+        {
+        case ONLP_OID_TYPE_SYS:
+            /* The ONIE data is not needed. */
+            r->rv = onlp_sys_hdr_get(&info.hdr);
+            hdr = &info.hdr;
+            break;
+
+        case ONLP_OID_TYPE_THERMAL:
+            r->rv = onlp_thermal_info_get(oid, &info.thermal);
+            if(r->rv >= 0) {
+                hdr = &info.thermal.hdr;
+                r->status = info.thermal.status;
+                r->caps = info.thermal.caps;
+                r->values[0] = info.thermal.mcelsius;
+                r->values[1] = info.thermal.thresholds.warning;
+                r->values[2] = info.thermal.thresholds.error;
+                r->values[3] = info.thermal.thresholds.shutdown;
+            }
+            break;
+
+        case ONLP_OID_TYPE_FAN:
+            r->rv = onlp_fan_info_get(oid, &info.fan);
+            if(r->rv >= 0) {
+                hdr = &info.fan.hdr;
+                r->status = info.fan.status;
+                r->caps = info.fan.caps;
+                r->values[0] = info.fan.rpm;
+                r->values[1] = info.fan.percentage;
+                r->values[2] = info.fan.mode;
+            }
+            break;
+
+        case ONLP_OID_TYPE_PSU:
+            r->rv = onlp_psu_info_get(oid, &info.psu);
+            if(r->rv >= 0) {
+                hdr = &info.psu.hdr;
+                r->status = info.psu.status;
+                r->caps = info.psu.caps;
+                r->values[0] = info.psu.mvin;
+                r->values[1] = info.psu.mvout;
+                r->values[2] = info.psu.miin;
+                r->values[3] = info.psu.miout;
+                r->values[4] = info.psu.mpin;
+                r->values[5] = info.psu.mpout;
+            }
+            break;
+
+        case ONLP_OID_TYPE_LED:
+            r->rv = onlp_led_info_get(oid, &info.led);
+            if(r->rv >= 0) {
+                hdr = &info.led.hdr;
+                r->status = info.led.status;
+                r->caps = info.led.caps;
+                r->values[0] = info.led.mode;
+                r->values[1] = info.led.character;
+            }
+            break;
+
+        default:
+            r->rv = onlp_oid_hdr_get(oid, &info.hdr);
+            hdr = &info.hdr;
+            break;
+        }
+
+    if(r->rv < 0 || hdr == NULL) {
+        return;
+    }
+
+    snapshot_oid_hdr__(r, hdr);
+
+    /* r is not valid once children have been added. */
+    ONLP_OID_TABLE_ITER(hdr->coids, oidp) {
+        snapshot_oid__(oids, *oidp);
+    }
+}
+
+static void
+snapshot_sfps__(onlp_snapshot_sfp_t* records, int count,
+                onlp_sfp_bitmap_t* ports, uint32_t flags)
+{
+    onlp_sfp_bitmap_t presence;
+    uint32_t controls[ONLP_SFP_BITMAP_PORTS];
+    int presence_rv, controls_rv;
+    int i = 0, p;
+
+    onlp_sfp_bitmap_t_init(&presence);
+    presence_rv = onlp_sfp_presence_bitmap_get(&presence);
+    controls_rv = onlp_sfp_control_flags_get_all(controls, AIM_ARRAYSIZE(controls));
+
+    AIM_BITMAP_ITER(ports, p) {
+        onlp_snapshot_sfp_t* r = records + i++;
+        uint8_t* data;
+
+        memset(r, 0, sizeof(*r));
+        r->port = p;
+        r->present = (presence_rv >= 0) ?
+            AIM_BITMAP_GET(&presence, p) : (onlp_sfp_is_present(p) > 0);
+        r->controls = (controls_rv >= 0) ? controls[p] : 0;
+
+        if(r->present && (flags & ONLP_SNAPSHOT_F_SFP_EEPROM)) {
+            r->eeprom_rv = onlp_sfp_eeprom_read(p, &data);
+            if(r->eeprom_rv >= 0) {
+                memcpy(r->eeprom, data, sizeof(r->eeprom));
+                aim_free(data);
+            }
+        }
+        if(r->present && (flags & ONLP_SNAPSHOT_F_SFP_DOM)) {
+            r->dom_rv = onlp_sfp_dom_read(p, &data);
+            if(r->dom_rv >= 0) {
+                memcpy(r->dom, data, sizeof(r->dom));
+                aim_free(data);
+            }
+        }
+        if(i == count) {
+            break;
+        }
+    }
+}
+
+int
+onlp_snapshot_get(uint8_t* buf, int size, uint32_t flags)
+{
+    onlp_snapshot_hdr_t hdr;
+    snapshot_oids_t oids;
+    onlp_sfp_bitmap_t ports;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memset(&oids, 0, sizeof(oids));
+    hdr.magic = ONLP_SNAPSHOT_MAGIC;
+    hdr.version = ONLP_SNAPSHOT_VERSION;
+    hdr.hdr_size = sizeof(hdr);
+    hdr.flags = flags;
+    hdr.timestamp = aim_time_monotonic();
+    hdr.oid_size = sizeof(onlp_snapshot_oid_t);
+    hdr.sfp_size = sizeof(onlp_snapshot_sfp_t);
+
+    if(size < 0) {
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    if(flags & ONLP_SNAPSHOT_F_OIDS) {
+        snapshot_oid__(&oids, ONLP_OID_SYS);
+        hdr.oid_count = oids.count;
+    }
+
+    onlp_sfp_bitmap_t_init(&ports);
+    if(flags & ONLP_SNAPSHOT_F_SFPS) {
+        if(onlp_sfp_bitmap_get(&ports) >= 0) {
+            hdr.sfp_count = AIM_BITMAP_COUNT(&ports);
+        }
+    }
+
+    hdr.oid_offset = hdr.hdr_size;
+    hdr.sfp_offset = hdr.oid_offset + hdr.oid_count * hdr.oid_size;
+    hdr.size = hdr.sfp_offset + hdr.sfp_count * hdr.sfp_size;
+
+    if(buf && size >= hdr.size) {
+        if(hdr.oid_count) {
+            memcpy(buf + hdr.oid_offset, oids.records,
+                   hdr.oid_count * hdr.oid_size);
+        }
+        if(hdr.sfp_count) {
+            snapshot_sfps__((onlp_snapshot_sfp_t*)(buf + hdr.sfp_offset),
+                            hdr.sfp_count, &ports, flags);
+        }
+        hdr.usecs = aim_time_monotonic() - hdr.timestamp;
+        memcpy(buf, &hdr, sizeof(hdr));
+    }
+
+    aim_free(oids.records);
+    return hdr.size;
+}
@@ -0,0 +1,403 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+#include <onlp/onlp.h>
+#include <onlp/oids.h>
+#include <onlp/snapshot.h>
+#include <AIM/aim.h>
+#include <AIM/aim_time.h>
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <sys/time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdio.h>
+#include "onlp_int.h"
+#include "onlp_log.h"
+
+/**
+ * onlpdump --watch
+ *
+ * The platform is sampled with onlp_snapshot_get() every interval.
+ * Only the fields which have changed are reported.
+ *
+ * Changes to discrete fields (status, presence, modes, thresholds)
+ * are reported when they are seen. Changes to analog fields
+ * (temperatures, fan speeds, PSU readings) are reported at most once
+ * per holdoff period for each object, and intermediate values are
+ * coalesced. The total number of records per second can also be
+ * limited. Pending changes are reported on a later sample.
+ *
+ * JSON output is one object per line:
+ *
+ *     {"ts":1500000000000,"oid":"0x2000001","desc":"Thermal 1","mcelsius":41000}
+ *     {"ts":1500000000000,"port":3,"present":0}
+ *     {"ts":1500000000000,"oid":"0x3000004","removed":true}
+ *
+ * The first sample reports every field. "desc" is reported the
+ * first time an OID is reported.
+ *
+ * TLV output is a sequence of records in network byte order:
+ *
+ *     uint8  type     1 = OID, 2 = SFP port, 3 = OID removed
+ *     uint8  count    Number of fields
+ *     uint32 id       OID or port number
+ *     uint64 ts       Milliseconds since the epoch
+ *     count * { uint8 field; int32 value; }
+ *
+ * The field numbers are the indexes of the field names below.
+ */
+
+#define WATCH_FIELDS 8
+
+#define WATCH_TLV_OID         1
+#define WATCH_TLV_SFP         2
+#define WATCH_TLV_OID_REMOVED 3
+
+/* SFP ports use the type slot after the last OID type. */
+#define WATCH_KIND_SFP (ONLP_OID_TYPE_RTC + 1)
+
+static const char* fields__[WATCH_KIND_SFP + 1][WATCH_FIELDS] = {
+    [ONLP_OID_TYPE_SYS] = { "rv", "status" },
+    [ONLP_OID_TYPE_THERMAL] = { "rv", "status", "mcelsius", "warning", "error", "shutdown" },
+    [ONLP_OID_TYPE_FAN] = { "rv", "status", "rpm", "percentage", "mode" },
+    [ONLP_OID_TYPE_PSU] = { "rv", "status", "mvin", "mvout", "miin", "miout", "mpin", "mpout" },
+    [ONLP_OID_TYPE_LED] = { "rv", "status", "mode", "character" },
+    [ONLP_OID_TYPE_MODULE] = { "rv", "status" },
+    [ONLP_OID_TYPE_RTC] = { "rv", "status" },
+    [WATCH_KIND_SFP] = { NULL, "present", "controls" },
+};
+
+/** Analog fields, by kind. */
+static const uint32_t analog__[WATCH_KIND_SFP + 1] = {
+    [ONLP_OID_TYPE_THERMAL] = (1 << 2),
+    [ONLP_OID_TYPE_FAN] = (1 << 2) | (1 << 3),
+    [ONLP_OID_TYPE_PSU] = 0xFC,
+};
+
+typedef struct watch_obj_s {
+    uint32_t id;
+    int kind;
+    const char* desc;
+    int32_t current[WATCH_FIELDS];
+    int32_t reported[WATCH_FIELDS];
+    /** Fields whose current value has not been reported. */
+    uint32_t pending;
+    uint64_t last_report;
+    /** Sample in which the object was last seen. */
+    uint32_t seen;
+    /** Set once the object has been reported. */
+    int reported_once;
+} watch_obj_t;
+
+typedef struct watch_s {
+    const onlp_watch_config_t* config;
+    watch_obj_t* objs;
+    int count;
+    int allocated;
+    int hint;
+    uint32_t sample;
+
+    /** Rate limit tokens. */
+    double tokens;
+    uint64_t tokens_time;
+} watch_t;
+
+static volatile sig_atomic_t stop__ = 0;
+
+static void
+watch_signal__(int sig)
+{
+    stop__ = 1;
+}
+
+static uint64_t
+now_ms__(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+static watch_obj_t*
+watch_obj__(watch_t* w, int kind, uint32_t id)
+{
+    int i;
+    watch_obj_t* o;
+
+    /* Objects are usually seen in the same order in every sample. */
+    for(i = 0; i < w->count; i++) {
+        o = w->objs + (w->hint + i) % w->count;
+        if(o->id == id && o->kind == kind) {
+            w->hint = (o - w->objs) + 1;
+            return o;
+        }
+    }
+
+    if(w->count == w->allocated) {
+        w->allocated = w->allocated ? w->allocated * 2 : 128;
+        w->objs = aim_realloc(w->objs, w->allocated * sizeof(*w->objs));
+    }
+    o = w->objs + w->count++;
+    memset(o, 0, sizeof(*o));
+    o->id = id;
+    o->kind = kind;
+    return o;
+}
+
+static void
+json_string__(const char* s)
+{
+    aim_printf(&aim_pvs_stdout, "\"");
+    for(; *s; s++) {
+        if(*s == '"' || *s == '\\') {
+            aim_printf(&aim_pvs_stdout, "\\%c", *s);
+        }
+        else if((unsigned char)*s < 0x20) {
+            aim_printf(&aim_pvs_stdout, "\\u%.4x", *s);
+        }
+        else {
+            aim_printf(&aim_pvs_stdout, "%c", *s);
+        }
+    }
+    aim_printf(&aim_pvs_stdout, "\"");
+}
+
+static void
+watch_report__(watch_t* w, watch_obj_t* o, uint32_t fields, int removed, uint64_t ts)
+{
+    int f;
+    const char** names = fields__[o->kind];
+
+    if(w->config->format == ONLP_WATCH_FORMAT_TLV) {
+        uint8_t rec[14 + WATCH_FIELDS * 5];
+        uint32_t v32;
+        uint64_t v64 = htobe64(ts);
+        int len = 14;
+
+        rec[0] = removed ? WATCH_TLV_OID_REMOVED :
+            (o->kind == WATCH_KIND_SFP ? WATCH_TLV_SFP : WATCH_TLV_OID);
+        rec[1] = 0;
+        v32 = htonl(o->id);
+        memcpy(rec + 2, &v32, 4);
+        memcpy(rec + 6, &v64, 8);
+        for(f = 0; f < WATCH_FIELDS && !removed; f++) {
+            if((fields & (1 << f)) && names[f]) {
+                rec[len] = f;
+                v32 = htonl(o->current[f]);
+                memcpy(rec + len + 1, &v32, 4);
+                len += 5;
+                rec[1]++;
+            }
+        }
+        fwrite(rec, 1, len, stdout);
+        return;
+    }
+
+    if(o->kind == WATCH_KIND_SFP) {
+        aim_printf(&aim_pvs_stdout, "{\"ts\":%"PRIu64",\"port\":%u", ts, o->id);
+    }
+    else {
+        aim_printf(&aim_pvs_stdout, "{\"ts\":%"PRIu64",\"oid\":\"0x%x\"", ts, o->id);
+    }
+    if(removed) {
+        aim_printf(&aim_pvs_stdout, ",\"removed\":true");
+    }
+    else {
+        if(!o->reported_once && o->desc && o->desc[0]) {
+            aim_printf(&aim_pvs_stdout, ",\"desc\":");
+            json_string__(o->desc);
+        }
+        for(f = 0; f < WATCH_FIELDS; f++) {
+            if((fields & (1 << f)) && names[f]) {
+                aim_printf(&aim_pvs_stdout, ",\"%s\":%d", names[f], o->current[f]);
+            }
+        }
+    }
+    aim_printf(&aim_pvs_stdout, "}\n");
+}
+
+/**
+ * Take a rate limit token.
+ */
+static int
+watch_token__(watch_t* w)
+{
+    uint64_t now;
+
+    if(w->config->rate == 0) {
+        return 1;
+    }
+
+    now = aim_time_monotonic();
+    w->tokens += (now - w->tokens_time) * w->config->rate / 1000000.0;
+    if(w->tokens > w->config->rate) {
+        w->tokens = w->config->rate;
+    }
+    w->tokens_time = now;
+
+    if(w->tokens >= 1) {
+        w->tokens -= 1;
+        return 1;
+    }
+    return 0;
+}
+
+static void
+watch_update__(watch_t* w, int kind, uint32_t id, const char* desc,
+               const int32_t* values, int count)
+{
+    int f;
+    watch_obj_t* o = watch_obj__(w, kind, id);
+
+    o->seen = w->sample;
+    o->desc = desc;
+    for(f = 0; f < count; f++) {
+        o->current[f] = values[f];
+        if(!o->reported_once || o->current[f] != o->reported[f]) {
+            o->pending |= (1 << f);
+        }
+        else {
+            /* Changed back before it was reported. */
+            o->pending &= ~(1 << f);
+        }
+    }
+}
+
+static void
+watch_flush__(watch_t* w)
+{
+    int i, f;
+    uint64_t now = aim_time_monotonic();
+    uint64_t ts = now_ms__();
+
+    for(i = 0; i < w->count; i++) {
+        watch_obj_t* o = w->objs + i;
+
+        if(o->seen != w->sample) {
+            /* No longer present. */
+            if(o->reported_once) {
+                watch_report__(w, o, 0, 1, ts);
+            }
+            w->objs[i--] = w->objs[--w->count];
+            continue;
+        }
+
+        if(o->pending == 0) {
+            continue;
+        }
+
+        if(o->reported_once && (o->pending & ~analog__[o->kind]) == 0 &&
+           now - o->last_report < w->config->holdoff_ms * 1000ULL) {
+            /* Analog changes are coalesced until the holdoff expires. */
+            continue;
+        }
+
+        if(!watch_token__(w)) {
+            /* Rate limited. Report on a later sample. */
+            continue;
+        }
+
+        watch_report__(w, o, o->pending, 0, ts);
+        for(f = 0; f < WATCH_FIELDS; f++) {
+            o->reported[f] = o->current[f];
+        }
+        o->pending = 0;
+        o->last_report = now;
+        o->reported_once = 1;
+    }
+    fflush(stdout);
+}
+
+int
+onlp_watch(const onlp_watch_config_t* config)
+{
+    watch_t w;
+    uint8_t* buf = NULL;
+    int size = 0;
+    int rv = 0;
+
+    memset(&w, 0, sizeof(w));
+    w.config = config;
+    w.tokens = config->rate;
+    w.tokens_time = aim_time_monotonic();
+
+    signal(SIGINT, watch_signal__);
+    signal(SIGTERM, watch_signal__);
+
+    while(!stop__ && (config->count == 0 || w.sample < config->count)) {
+        uint64_t start = aim_time_monotonic();
+        onlp_snapshot_hdr_t* hdr;
+        uint64_t elapsed;
+        int i;
+
+        rv = onlp_snapshot_get(buf, size, ONLP_SNAPSHOT_F_OIDS | ONLP_SNAPSHOT_F_SFPS);
+        if(rv < 0) {
+            AIM_LOG_ERROR("onlp_snapshot_get(): %{onlp_status}", rv);
+            break;
+        }
+        if(rv > size) {
+            size = rv;
+            buf = aim_realloc(buf, size);
+            continue;
+        }
+        rv = 0;
+
+        w.sample++;
+        hdr = (onlp_snapshot_hdr_t*)buf;
+
+        for(i = 0; i < hdr->oid_count; i++) {
+            onlp_snapshot_oid_t* r = (onlp_snapshot_oid_t*)
+                (buf + hdr->oid_offset + i * hdr->oid_size);
+            int32_t values[WATCH_FIELDS];
+            int kind = ONLP_OID_TYPE_GET(r->oid);
+
+            if(kind <= 0 || kind > ONLP_OID_TYPE_RTC) {
+                continue;
+            }
+            values[0] = r->rv;
+            values[1] = r->status;
+            memcpy(values + 2, r->values, sizeof(r->values));
+            watch_update__(&w, kind, r->oid, r->description, values, WATCH_FIELDS);
+        }
+
+        for(i = 0; i < hdr->sfp_count; i++) {
+            onlp_snapshot_sfp_t* r = (onlp_snapshot_sfp_t*)
+                (buf + hdr->sfp_offset + i * hdr->sfp_size);
+            int32_t values[3] = { 0, r->present, r->controls };
+            watch_update__(&w, WATCH_KIND_SFP, r->port, NULL, values, 3);
+        }
+
+        watch_flush__(&w);
+
+        elapsed = aim_time_monotonic() - start;
+        if(!stop__ && elapsed < config->interval_ms * 1000ULL) {
+            usleep(config->interval_ms * 1000ULL - elapsed);
+        }
+    }
+
+    aim_free(w.objs);
+    aim_free(buf);
+    return rv;
+}
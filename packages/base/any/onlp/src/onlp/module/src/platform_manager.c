@@ -25,6 +25,7 @@
 #include <onlp/sys.h>
 #include <onlp/psu.h>
 #include <onlp/fan.h>
+#include <onlp/thermal.h>
 #include <onlp/platformi/sysi.h>
 #include <onlplib/mmap.h>
 #include <timer_wheel/timer_wheel.h>
@@ -33,9 +34,11 @@
 #include <AIM/aim.h>
 #include "onlp_log.h"
 #include "onlp_int.h"
+#include "onlp_locks.h"
 #include <sys/eventfd.h>
 #include <errno.h>
 #include <pthread.h>
+#include <inttypes.h>
 
 /**
  * Timer wheel callback entry.
@@ -86,6 +89,15 @@ static int platform_psus_notify__(void);
  */
 static int platform_fans_notify__(void);
 
+#if ONLP_CONFIG_INCLUDE_THERMAL_WATCHDOG == 1
+/*
+ * Internal thermal threshold watchdog (all platforms)
+ */
+static int platform_thermals_watchdog__(void);
+static int platform_thermals_alarm_fds__(fd_set* fds, int maxfd);
+static void platform_thermals_alarm__(fd_set* fds, uint64_t now);
+static void platform_thermals_release__(void);
+#endif
 
 
 /*
@@ -123,7 +135,15 @@ static management_entry_t management_entries[] =
             /* Every second */
             1*1000*1000,
             "Fans",
-        }
+        },
+#if ONLP_CONFIG_INCLUDE_THERMAL_WATCHDOG == 1
+        {
+            { },
+            platform_thermals_watchdog__,
+            ONLP_CONFIG_THERMAL_WATCHDOG_INTERVAL_MS*1000,
+            "Thermals",
+        },
+#endif
     };
 
 
@@ -132,8 +152,12 @@ onlp_sys_platform_manage_init(void)
 {
     if(control__.tw == NULL) {
         int i;
-        uint64_t now = os_time_monotonic();
+        uint64_t now;
 
+        /* The platform management hooks may use any subsystem. */
+        onlp_subsystem_init_all();
+
+        now = os_time_monotonic();
         onlp_sysi_platform_manage_init();
         control__.tw = timer_wheel_create(4, 512, now);
 
@@ -175,12 +199,20 @@ onlp_sys_platform_manage_thread__(void* vctrl)
     for(;;) {
 
         fd_set fds;
+        fd_set efds;
+        int maxfd;
         uint64_t now;
         struct timeval tv;
         timer_wheel_entry_t* twe;
 
         FD_ZERO(&fds);
         FD_SET(ctrl->eventfd, &fds);
+        FD_ZERO(&efds);
+        maxfd = ctrl->eventfd;
+#if ONLP_CONFIG_INCLUDE_THERMAL_WATCHDOG == 1
+        /* Hardware thermal alarms wake us immediately. */
+        maxfd = platform_thermals_alarm_fds__(&efds, maxfd);
+#endif
 
         /*
          * Ask the timer wheel if there is an expiration in the next 2 seconds.
@@ -206,10 +238,14 @@ onlp_sys_platform_manage_thread__(void* vctrl)
             }
         }
 
-        int rv = select(ctrl->eventfd+1, &fds, NULL, NULL, &tv);
-        if(rv == 1 && FD_ISSET(ctrl->eventfd, &fds)) {
+        int rv = select(maxfd+1, &fds, NULL, &efds, &tv);
+        /* A stop may arrive together with a thermal alarm. */
+        if(rv > 0 && FD_ISSET(ctrl->eventfd, &fds)) {
             /* We've been asked to terminate. */
             AIM_LOG_MSG("Terminating.");
+#if ONLP_CONFIG_INCLUDE_THERMAL_WATCHDOG == 1
+            platform_thermals_release__();
+#endif
             /* Also signifies that we have exit */
             close(ctrl->eventfd);
             ctrl->eventfd = -1;
@@ -221,6 +257,12 @@ onlp_sys_platform_manage_thread__(void* vctrl)
             sleep(1);
         }
 
+#if ONLP_CONFIG_INCLUDE_THERMAL_WATCHDOG == 1
+        if(rv > 0) {
+            platform_thermals_alarm__(&efds, os_time_monotonic());
+        }
+#endif
+
         /*
          * We don't bother to check the result of select() here.
          */
@@ -356,6 +398,7 @@ platform_psus_notify__(void)
                 AIM_SYSLOG_INFO("PSU <id> has been inserted.",
                                 "A PSU has been inserted in the given slot.",
                                 "PSU %d has been inserted.", pid);
+                onlp_psu_post_insert(psu_oid_table[i]);
             }
             if( (old & 0x1) && !(new & 0x1) ) {
                 /* PSU Removed */
@@ -491,3 +534,331 @@ platform_fans_notify__(void)
 }
 
 
+
+#if ONLP_CONFIG_INCLUDE_THERMAL_WATCHDOG == 1
+
+/**
+ * Thermal watchdog state for one thermal.
+ */
+typedef struct thermal_watch_s {
+    onlp_oid_t oid;
+
+    /** Current threshold level */
+    onlp_thermal_level_t level;
+
+    /** The threshold for each level. Zero if not supported. */
+    int thresholds[ONLP_THERMAL_LEVEL_SHUTDOWN+1];
+
+    /** Armed hardware alarm temperature, and its descriptor */
+    int alarm;
+    int alarm_fd;
+
+    /** Time of the last sample */
+    uint64_t sampled;
+
+} thermal_watch_t;
+
+static struct {
+    pthread_mutex_t lock;
+
+    int loaded;
+    int enabled;
+    thermal_watch_t thermals[ONLP_OID_TABLE_SIZE];
+    int count;
+
+    uint64_t samples;
+    uint64_t alarms;
+    uint64_t events;
+
+    /** Worst time (us) between a crossing and its detection. */
+    uint64_t detect_max;
+    /** Worst time (us) between detection and the end of the response. */
+    uint64_t respond_max;
+
+} thermal_watchdog__ = { PTHREAD_MUTEX_INITIALIZER };
+
+static const char* thermal_levels__[] = {
+    "normal", "warning", "error", "shutdown",
+};
+
+static int
+platform_thermals_load__(onlp_oid_t oid, void* cookie)
+{
+    thermal_watch_t* t;
+
+    if(thermal_watchdog__.count == AIM_ARRAYSIZE(thermal_watchdog__.thermals)) {
+        return 0;
+    }
+    t = thermal_watchdog__.thermals + thermal_watchdog__.count++;
+    memset(t, 0, sizeof(*t));
+    t->oid = oid;
+    t->alarm_fd = -1;
+    return 0;
+}
+
+static void
+platform_thermal_respond__(thermal_watch_t* t, onlp_thermal_level_t level, int mcelsius)
+{
+    int rv;
+    int tid = ONLP_OID_ID_GET(t->oid);
+
+    if(level > t->level) {
+        if(level >= ONLP_THERMAL_LEVEL_ERROR) {
+            AIM_SYSLOG_CRIT("Thermal <id> has reached its <level> threshold.",
+                            "The given thermal has reached the given threshold.",
+                            "Thermal %d has reached its %s threshold (%d mC).",
+                            tid, thermal_levels__[level], mcelsius);
+        }
+        else {
+            AIM_SYSLOG_WARN("Thermal <id> has reached its <level> threshold.",
+                            "The given thermal has reached the given threshold.",
+                            "Thermal %d has reached its %s threshold (%d mC).",
+                            tid, thermal_levels__[level], mcelsius);
+        }
+    }
+    else {
+        AIM_SYSLOG_INFO("Thermal <id> has returned to <level>.",
+                        "The given thermal has fallen below its threshold.",
+                        "Thermal %d has returned to %s (%d mC).",
+                        tid, thermal_levels__[level], mcelsius);
+    }
+
+    rv = onlp_sysi_platform_manage_thermal(t->oid, level, mcelsius);
+    if(ONLP_UNSUPPORTED(rv) && level > t->level) {
+        /* Let the platform fan policy respond now instead of at its next run. */
+        onlp_sysi_platform_manage_fans();
+
+        if(level == ONLP_THERMAL_LEVEL_SHUTDOWN &&
+           ONLP_CONFIG_THERMAL_SHUTDOWN_COMMAND) {
+            AIM_LOG_MSG("Running %s", ONLP_CONFIG_THERMAL_SHUTDOWN_COMMAND);
+            if(system(ONLP_CONFIG_THERMAL_SHUTDOWN_COMMAND) != 0) {
+                AIM_LOG_ERROR("%s failed.", ONLP_CONFIG_THERMAL_SHUTDOWN_COMMAND);
+            }
+        }
+    }
+}
+
+/**
+ * Check one thermal.
+ * 'since' is the earliest time at which a crossing could have occurred
+ * without being seen.
+ */
+static void
+platform_thermal_check__(thermal_watch_t* t, uint64_t since)
+{
+    onlp_thermal_info_t ti;
+    onlp_thermal_level_t level, l;
+    uint64_t now;
+
+    if(onlp_thermal_info_get(t->oid, &ti) < 0 ||
+       !(ti.status & ONLP_THERMAL_STATUS_PRESENT) ||
+       (ti.status & ONLP_THERMAL_STATUS_FAILED)) {
+        return;
+    }
+    now = os_time_monotonic();
+    t->sampled = now;
+
+    t->thresholds[ONLP_THERMAL_LEVEL_WARNING] =
+        (ti.caps & ONLP_THERMAL_CAPS_GET_WARNING_THRESHOLD) ? ti.thresholds.warning : 0;
+    t->thresholds[ONLP_THERMAL_LEVEL_ERROR] =
+        (ti.caps & ONLP_THERMAL_CAPS_GET_ERROR_THRESHOLD) ? ti.thresholds.error : 0;
+    t->thresholds[ONLP_THERMAL_LEVEL_SHUTDOWN] =
+        (ti.caps & ONLP_THERMAL_CAPS_GET_SHUTDOWN_THRESHOLD) ? ti.thresholds.shutdown : 0;
+
+    level = ONLP_THERMAL_LEVEL_NORMAL;
+    for(l = ONLP_THERMAL_LEVEL_WARNING; l <= ONLP_THERMAL_LEVEL_SHUTDOWN; l++) {
+        if(t->thresholds[l] && ti.mcelsius >= t->thresholds[l]) {
+            level = l;
+        }
+    }
+    if(level < t->level && t->thresholds[t->level] &&
+       ti.mcelsius >= t->thresholds[t->level] - ONLP_CONFIG_THERMAL_WATCHDOG_HYSTERESIS) {
+        /* Not far enough below the current threshold. */
+        level = t->level;
+    }
+
+    if(level != t->level) {
+        uint64_t done;
+
+        platform_thermal_respond__(t, level, ti.mcelsius);
+        done = os_time_monotonic();
+
+        thermal_watchdog__.events++;
+        if(now - since > thermal_watchdog__.detect_max) {
+            thermal_watchdog__.detect_max = now - since;
+        }
+        if(done - now > thermal_watchdog__.respond_max) {
+            thermal_watchdog__.respond_max = done - now;
+        }
+        AIM_LOG_INFO("Thermal %d: %s -> %s: detected within %"PRIu64" us, handled in %"PRIu64" us",
+                     ONLP_OID_ID_GET(t->oid), thermal_levels__[t->level],
+                     thermal_levels__[level], now - since, done - now);
+        t->level = level;
+    }
+
+    /* Arm the hardware alarm at the next threshold. */
+    for(l = level + 1; l <= ONLP_THERMAL_LEVEL_SHUTDOWN && t->thresholds[l] == 0; l++);
+    if(l <= ONLP_THERMAL_LEVEL_SHUTDOWN && t->thresholds[l] != t->alarm) {
+        int fd;
+        if(t->alarm_fd >= 0) {
+            close(t->alarm_fd);
+            t->alarm_fd = -1;
+        }
+        t->alarm = t->thresholds[l];
+        if(ONLP_FAILURE(onlp_thermal_alarm_arm(t->oid, t->alarm, &fd))) {
+            /* Polling only. Don't retry. */
+            fd = -1;
+        }
+        t->alarm_fd = fd;
+    }
+}
+
+static int
+platform_thermals_watchdog__(void)
+{
+    int i;
+
+    pthread_mutex_lock(&thermal_watchdog__.lock);
+    if(!thermal_watchdog__.loaded) {
+        char* v = getenv(ONLP_CONFIG_THERMAL_WATCHDOG_ENV);
+
+        onlp_oid_iterate(ONLP_OID_SYS, ONLP_OID_TYPE_THERMAL,
+                         platform_thermals_load__, NULL);
+        thermal_watchdog__.loaded = 1;
+
+        /*
+         * The platform opts in by supporting hardware alarms.
+         * Disarming an alarm which is not armed tells us if it does.
+         */
+        thermal_watchdog__.enabled = (v && atoi(v));
+        for(i = 0; i < thermal_watchdog__.count && !thermal_watchdog__.enabled; i++) {
+            int fd = -1;
+            if(ONLP_SUCCESS(onlp_thermal_alarm_arm(thermal_watchdog__.thermals[i].oid, 0, &fd))) {
+                thermal_watchdog__.enabled = 1;
+            }
+            if(fd >= 0) {
+                close(fd);
+            }
+        }
+        AIM_LOG_VERBOSE("The thermal watchdog is %s.",
+                        thermal_watchdog__.enabled ? "enabled" : "disabled");
+    }
+
+    if(!thermal_watchdog__.enabled) {
+        pthread_mutex_unlock(&thermal_watchdog__.lock);
+        return 0;
+    }
+
+    for(i = 0; i < thermal_watchdog__.count; i++) {
+        thermal_watch_t* t = thermal_watchdog__.thermals + i;
+        /* A crossing may have happened any time since the last sample. */
+        platform_thermal_check__(t, t->sampled ? t->sampled : os_time_monotonic());
+    }
+    thermal_watchdog__.samples++;
+    pthread_mutex_unlock(&thermal_watchdog__.lock);
+    return 0;
+}
+
+static int
+platform_thermals_alarm_fds__(fd_set* fds, int maxfd)
+{
+    int i;
+    pthread_mutex_lock(&thermal_watchdog__.lock);
+    for(i = 0; i < thermal_watchdog__.count; i++) {
+        int fd = thermal_watchdog__.thermals[i].alarm_fd;
+        if(fd >= 0 && fd < FD_SETSIZE) {
+            FD_SET(fd, fds);
+            if(fd > maxfd) {
+                maxfd = fd;
+            }
+        }
+    }
+    pthread_mutex_unlock(&thermal_watchdog__.lock);
+    return maxfd;
+}
+
+static void
+platform_thermals_alarm__(fd_set* fds, uint64_t now)
+{
+    int i;
+    char buf[16];
+
+    pthread_mutex_lock(&thermal_watchdog__.lock);
+    for(i = 0; i < thermal_watchdog__.count; i++) {
+        thermal_watch_t* t = thermal_watchdog__.thermals + i;
+        if(t->alarm_fd >= 0 && FD_ISSET(t->alarm_fd, fds)) {
+            /* Consume the notification so the next one can be seen. */
+            if(lseek(t->alarm_fd, 0, SEEK_SET) < 0 ||
+               read(t->alarm_fd, buf, sizeof(buf)) < 0) {
+                close(t->alarm_fd);
+                t->alarm_fd = -1;
+            }
+            thermal_watchdog__.alarms++;
+            platform_thermal_check__(t, now);
+        }
+    }
+    pthread_mutex_unlock(&thermal_watchdog__.lock);
+}
+
+/**
+ * Disarm all hardware alarms when the manager stops.
+ */
+static void
+platform_thermals_release__(void)
+{
+    int i;
+
+    pthread_mutex_lock(&thermal_watchdog__.lock);
+    for(i = 0; i < thermal_watchdog__.count; i++) {
+        thermal_watch_t* t = thermal_watchdog__.thermals + i;
+        if(t->alarm_fd >= 0) {
+            close(t->alarm_fd);
+            t->alarm_fd = -1;
+        }
+        if(t->alarm) {
+            int fd = -1;
+            /* Let the platform restore its original alarm setting. */
+            if(ONLP_SUCCESS(onlp_thermal_alarm_arm(t->oid, 0, &fd)) && fd >= 0) {
+                close(fd);
+            }
+            t->alarm = 0;
+        }
+    }
+    pthread_mutex_unlock(&thermal_watchdog__.lock);
+}
+
+void
+onlp_sys_platform_manage_thermal_show(aim_pvs_t* pvs)
+{
+    int i;
+
+    pthread_mutex_lock(&thermal_watchdog__.lock);
+    aim_printf(pvs, "Enabled: %s\n", thermal_watchdog__.enabled ? "yes" : "no");
+    aim_printf(pvs, "Interval: %d ms\n", ONLP_CONFIG_THERMAL_WATCHDOG_INTERVAL_MS);
+    aim_printf(pvs, "Hysteresis: %d mC\n", ONLP_CONFIG_THERMAL_WATCHDOG_HYSTERESIS);
+    aim_printf(pvs, "Samples: %"PRIu64"\n", thermal_watchdog__.samples);
+    aim_printf(pvs, "Alarms: %"PRIu64"\n", thermal_watchdog__.alarms);
+    aim_printf(pvs, "Events: %"PRIu64"\n", thermal_watchdog__.events);
+    aim_printf(pvs, "Max detection latency: %"PRIu64" us\n", thermal_watchdog__.detect_max);
+    aim_printf(pvs, "Max response latency: %"PRIu64" us\n", thermal_watchdog__.respond_max);
+    for(i = 0; i < thermal_watchdog__.count; i++) {
+        thermal_watch_t* t = thermal_watchdog__.thermals + i;
+        aim_printf(pvs, "Thermal %d: %s warning=%d error=%d shutdown=%d alarm=%d%s\n",
+                   ONLP_OID_ID_GET(t->oid), thermal_levels__[t->level],
+                   t->thresholds[ONLP_THERMAL_LEVEL_WARNING],
+                   t->thresholds[ONLP_THERMAL_LEVEL_ERROR],
+                   t->thresholds[ONLP_THERMAL_LEVEL_SHUTDOWN],
+                   t->alarm, (t->alarm_fd >= 0) ? " (interrupt)" : "");
+    }
+    pthread_mutex_unlock(&thermal_watchdog__.lock);
+}
+
+#else
+
+void
+onlp_sys_platform_manage_thermal_show(aim_pvs_t* pvs)
+{
+    aim_printf(pvs, "The thermal watchdog is not included.\n");
+}
+
+#endif /* ONLP_CONFIG_INCLUDE_THERMAL_WATCHDOG */
@@ -27,7 +27,10 @@
 #include <onlp/oids.h>
 #include <onlp/psu.h>
 #include <onlp/platformi/psui.h>
+#include <onlplib/i2c.h>
 #include "onlp_int.h"
+#define ONLP_API_SUBSYSTEM ONLP_SUBSYSTEM_PSU
+#define ONLP_API_SUBSYSTEM_INIT onlp_psu_init_locked__
 #include "onlp_locks.h"
 
 #define VALIDATE(_id)                           \
@@ -50,7 +53,12 @@ onlp_psu_init_locked__(void)
 {
     return onlp_psui_init();
 }
-ONLP_LOCKED_API0(onlp_psu_init);
+
+int
+onlp_psu_init(void)
+{
+    return onlp_subsystem_init(ONLP_SUBSYSTEM_PSU, onlp_psu_init_locked__);
+}
 
 static int
 onlp_psu_info_get_locked__(onlp_oid_t id,  onlp_psu_info_t* info)
@@ -91,6 +99,19 @@ onlp_psu_hdr_get_locked__(onlp_oid_t id, onlp_oid_hdr_t* hdr)
     return rv;
 }
 ONLP_LOCKED_API2(onlp_psu_hdr_get, onlp_oid_t, id, onlp_oid_hdr_t*, hdr);
+
+static int
+onlp_psu_post_insert_locked__(onlp_oid_t id)
+{
+    int bus, addr;
+    VALIDATE(id);
+    /* The new PSU must not inherit the backoff of the old one. */
+    if(onlp_psui_i2c_get(id, &bus, &addr) >= 0) {
+        onlp_i2c_health_clear(bus, addr);
+    }
+    return ONLP_STATUS_OK;
+}
+ONLP_LOCKED_API1(onlp_psu_post_insert, onlp_oid_t, id);
 int
 onlp_psu_vioctl_locked__(onlp_oid_t id, va_list vargs)
 {
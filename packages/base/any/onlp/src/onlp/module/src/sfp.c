@@ -24,7 +24,14 @@
  ***********************************************************/
 #include <onlp/sfp.h>
 #include <onlp/platformi/sfpi.h>
+#include <onlplib/i2c.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
 #include "onlp_log.h"
+#define ONLP_API_SUBSYSTEM ONLP_SUBSYSTEM_SFP
+#define ONLP_API_SUBSYSTEM_INIT onlp_sfp_init_locked__
 #include "onlp_locks.h"
 
 /**
@@ -67,7 +74,12 @@ onlp_sfp_init_locked__(void)
         return ONLP_STATUS_OK;
     }
 }
-ONLP_LOCKED_API0(onlp_sfp_init)
+
+int
+onlp_sfp_init(void)
+{
+    return onlp_subsystem_init(ONLP_SUBSYSTEM_SFP, onlp_sfp_init_locked__);
+}
 
 
 
@@ -85,7 +97,13 @@ onlp_sfp_denit_locked__(void)
 {
     return onlp_sfpi_denit();
 }
-ONLP_LOCKED_API0(onlp_sfp_denit);
+
+int
+onlp_sfp_denit(void)
+{
+    /* Nothing to tear down if the subsystem was never initialized. */
+    return onlp_subsystem_denit(ONLP_SUBSYSTEM_SFP, onlp_sfp_denit_locked__);
+}
 
 
 #define ONLP_SFP_PORT_VALIDATE_AND_MAP(_port)            \
@@ -136,6 +154,8 @@ ONLP_LOCKED_API1(onlp_sfp_presence_bitmap_get, onlp_sfp_bitmap_t*, dst);
 int
 onlp_sfp_port_valid(int port)
 {
+    /* Not a locked API, but the port bitmap is set up by the subsystem init. */
+    ONLP_API_INIT(onlp_sfp_port_valid);
     return AIM_BITMAP_GET(&sfpi_bitmap__, port);
 }
 
@@ -156,6 +176,214 @@ onlp_sfp_eeprom_read_locked__(int port, uint8_t** datap)
 }
 ONLP_LOCKED_API2(onlp_sfp_eeprom_read, int, port, uint8_t**, rv);
 
+/**
+ * Block read from a (mapped) port. Platforms which do not implement
+ * onlp_sfpi_dev_read() are read a byte at a time.
+ */
+static int
+sfp_dev_read__(int rport, uint8_t devaddr, uint8_t addr, uint8_t* rdata, int size)
+{
+    int i, rv;
+
+    if(size < 0 || addr + size > 256) {
+        return ONLP_STATUS_E_PARAM;
+    }
+    rv = onlp_sfpi_dev_read(rport, devaddr, addr, rdata, size);
+    if(rv != ONLP_STATUS_E_UNSUPPORTED) {
+        return (rv < 0) ? rv : ONLP_STATUS_OK;
+    }
+    for(i = 0; i < size; i++) {
+        if((rv = onlp_sfpi_dev_readb(rport, devaddr, addr + i)) < 0) {
+            return rv;
+        }
+        rdata[i] = rv;
+    }
+    return ONLP_STATUS_OK;
+}
+
+/**
+ * The decoded SFP EEPROM cache.
+ *
+ * Each identified module is stored in ONLP_CONFIG_SFP_CACHE_DIR
+ * (normally a tmpfs) along with its raw EEPROM. A cache entry is
+ * reused when the module's identifier and the EEPROM window which
+ * holds the base checksum, the vendor serial number and the extended
+ * checksum still match. Only those bytes are read from the module,
+ * so an unchanged module costs two short reads instead of a full
+ * EEPROM read and decode. Modules whose window can not be read are
+ * not cached.
+ */
+#define SFP_CACHE_MAGIC 0x53464643
+#define SFP_CACHE_DEVADDR 0x50
+#define SFP_CACHE_WINDOW 33
+
+typedef struct sfp_cache_entry_s {
+    uint32_t magic;
+    uint32_t size;
+    uint8_t eeprom[256];
+    int32_t module_type;
+    int32_t length;
+    char vendor[17];
+    char model[17];
+    char serial[17];
+} sfp_cache_entry_t;
+
+/**
+ * Returns the offset of the checksum and serial number window
+ * for the given identifier, or -1 if it is not known.
+ */
+static int
+sfp_cache_window__(uint8_t id)
+{
+    switch(id)
+        {
+        case 0x03:
+            /* SFP: CC_BASE (63), serial (68-83), CC_EXT (95) */
+            return 63;
+        case 0x0C:
+        case 0x0D:
+        case 0x11:
+            /* QSFP: CC_BASE (191), serial (196-211), CC_EXT (223) */
+            return 191;
+        default:
+            return -1;
+        }
+}
+
+static char*
+sfp_cache_file__(int port)
+{
+    if(ONLP_CONFIG_SFP_CACHE_DIR == NULL) {
+        return NULL;
+    }
+    return aim_fstrdup("%s/sfp-%d.bin", ONLP_CONFIG_SFP_CACHE_DIR, port);
+}
+
+static int
+sfp_cache_load__(int port, sfp_cache_entry_t* entry)
+{
+    int rv = -1;
+    int fd;
+    char* fname = sfp_cache_file__(port);
+
+    if(fname && (fd = open(fname, O_RDONLY)) >= 0) {
+        if(read(fd, entry, sizeof(*entry)) == sizeof(*entry) &&
+           entry->magic == SFP_CACHE_MAGIC && entry->size == sizeof(*entry)) {
+            rv = 0;
+        }
+        close(fd);
+    }
+    aim_free(fname);
+    return rv;
+}
+
+static void
+sfp_cache_store__(int port, sff_eeprom_t* se)
+{
+    sfp_cache_entry_t entry;
+    char* fname = sfp_cache_file__(port);
+    char* tname = NULL;
+    int fd, rv;
+
+    if(fname == NULL) {
+        return;
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    entry.magic = SFP_CACHE_MAGIC;
+    entry.size = sizeof(entry);
+    memcpy(entry.eeprom, se->eeprom, sizeof(entry.eeprom));
+    entry.module_type = se->info.module_type;
+    entry.length = se->info.length;
+    aim_strlcpy(entry.vendor, se->info.vendor, sizeof(entry.vendor));
+    aim_strlcpy(entry.model, se->info.model, sizeof(entry.model));
+    aim_strlcpy(entry.serial, se->info.serial, sizeof(entry.serial));
+
+    if(mkdir(ONLP_CONFIG_SFP_CACHE_DIR, 0755) < 0 && errno != EEXIST) {
+        AIM_LOG_VERBOSE("mkdir(%s): %{errno}", ONLP_CONFIG_SFP_CACHE_DIR, errno);
+        goto done;
+    }
+
+    /* Write and rename so readers never see a partial entry. */
+    tname = aim_fstrdup("%s.XXXXXX", fname);
+    if((fd = mkstemp(tname)) < 0) {
+        AIM_LOG_VERBOSE("mkstemp(%s): %{errno}", tname, errno);
+        goto done;
+    }
+    rv = (write(fd, &entry, sizeof(entry)) == sizeof(entry) && fchmod(fd, 0444) == 0);
+    if(close(fd) < 0 || !rv || rename(tname, fname) < 0) {
+        AIM_LOG_VERBOSE("Could not store the SFP cache file %s: %{errno}",
+                        fname, errno);
+        unlink(tname);
+    }
+
+ done:
+    aim_free(tname);
+    aim_free(fname);
+}
+
+/**
+ * Returns 0 if the module in the (mapped) port, whose identifier
+ * is id, still matches the entry.
+ */
+static int
+sfp_cache_match__(int rport, uint8_t id, sfp_cache_entry_t* entry)
+{
+    uint8_t window[SFP_CACHE_WINDOW];
+    int offset = sfp_cache_window__(entry->eeprom[0]);
+
+    if(offset < 0 || id != entry->eeprom[0]) {
+        return -1;
+    }
+    if(sfp_dev_read__(rport, SFP_CACHE_DEVADDR, offset,
+                      window, sizeof(window)) < 0) {
+        return -1;
+    }
+    return memcmp(window, entry->eeprom + offset, sizeof(window)) ? -1 : 0;
+}
+
+static int
+onlp_sfp_eeprom_decode_locked__(int port, sff_eeprom_t* se)
+{
+    int rv;
+    int rport = port;
+    uint8_t id;
+    uint8_t data[256];
+    sfp_cache_entry_t entry;
+    int cacheable;
+
+    if(se == NULL) {
+        return ONLP_STATUS_E_PARAM;
+    }
+    ONLP_SFP_PORT_VALIDATE_AND_MAP(rport);
+
+    /* Without register reads a cached entry could never be matched. */
+    cacheable = (sfp_dev_read__(rport, SFP_CACHE_DEVADDR, 0, &id, 1) >= 0);
+
+    if(cacheable && sfp_cache_load__(port, &entry) == 0 &&
+       sfp_cache_match__(rport, id, &entry) == 0) {
+        memset(se, 0, sizeof(*se));
+        memcpy(se->eeprom, entry.eeprom, sizeof(se->eeprom));
+        rv = sff_info_init(&se->info, entry.module_type,
+                           entry.vendor, entry.model, entry.serial,
+                           entry.length);
+        if(rv >= 0) {
+            se->identified = 1;
+            return 0;
+        }
+    }
+
+    if((rv = onlp_sfpi_eeprom_read(rport, data)) < 0) {
+        return rv;
+    }
+    sff_eeprom_parse(se, data);
+    if(se->identified && cacheable && sfp_cache_window__(data[0]) >= 0) {
+        sfp_cache_store__(port, se);
+    }
+    return 0;
+}
+ONLP_LOCKED_API2(onlp_sfp_eeprom_decode, int, port, sff_eeprom_t*, se);
+
 static int
 onlp_sfp_dom_read_locked__(int port, uint8_t** datap)
 {
@@ -179,6 +407,8 @@ onlp_sfp_dump(aim_pvs_t* pvs)
     int p;
     int rv;
 
+    ONLP_API_INIT(onlp_sfp_dump);
+
     if(AIM_BITMAP_COUNT(&sfpi_bitmap__) == 0) {
         aim_printf(pvs, "There are no SFP capable ports.\n");
         return;
@@ -204,6 +434,9 @@ onlp_sfp_dump(aim_pvs_t* pvs)
     }
     aim_printf(pvs, "\n");
 
+    uint32_t flags[ONLP_SFP_BITMAP_PORTS];
+    int frv = onlp_sfp_control_flags_get_all(flags, AIM_ARRAYSIZE(flags));
+
     AIM_BITMAP_ITER(&sfpi_bitmap__, p) {
         rv = onlp_sfp_is_present(p);
         aim_printf(pvs, "Port %.2d: ", p);
@@ -213,14 +446,11 @@ onlp_sfp_dump(aim_pvs_t* pvs)
         }
         else if(rv == 1) {
             /* Present, OK */
-            int srv;
-            uint32_t flags = 0;
-            srv = onlp_sfp_control_flags_get(p, &flags);
-            if(srv >= 0) {
-                aim_printf(pvs, "Present, Status = %{onlp_sfp_control_flags}\n", flags);
+            if(frv >= 0) {
+                aim_printf(pvs, "Present, Status = %{onlp_sfp_control_flags}\n", flags[p]);
             }
             else {
-                aim_printf(pvs, "Present, Status Unavailable [ %{onlp_status} ]\n", srv);
+                aim_printf(pvs, "Present, Status Unavailable [ %{onlp_status} ]\n", frv);
             }
         }
         else {
@@ -245,7 +475,12 @@ onlp_sfp_dump(aim_pvs_t* pvs)
 static int
 onlp_sfp_post_insert_locked__(int port, sff_info_t* info)
 {
+    int bus, addr;
     ONLP_SFP_PORT_VALIDATE_AND_MAP(port);
+    /* The new module must not inherit the backoff of the old one. */
+    if(onlp_sfpi_i2c_get(port, &bus, &addr) >= 0) {
+        onlp_i2c_health_clear(bus, addr);
+    }
     return onlp_sfpi_post_insert(port, info);
 }
 ONLP_LOCKED_API2(onlp_sfp_post_insert, int, port, sff_info_t*, info);
@@ -342,21 +577,22 @@ onlp_sfp_rx_los_bitmap_get_locked__(onlp_sfp_bitmap_t* dst)
 ONLP_LOCKED_API1(onlp_sfp_rx_los_bitmap_get, onlp_sfp_bitmap_t*, dst);
 
 
+/**
+ * These are the control bits queried and returned by the control flags APIs.
+ */
+static onlp_sfp_control_t control_flags__[] =
+    {
+        ONLP_SFP_CONTROL_RESET_STATE,
+        ONLP_SFP_CONTROL_RX_LOS,
+        ONLP_SFP_CONTROL_TX_FAULT,
+        ONLP_SFP_CONTROL_TX_DISABLE,
+        ONLP_SFP_CONTROL_LP_MODE,
+        ONLP_SFP_CONTROL_SOFT_RATE_SELECT
+    };
+
 int
 onlp_sfp_control_flags_get(int port, uint32_t* flags)
 {
-    /**
-     * These are the control bits queried and returned.
-     */
-    onlp_sfp_control_t controls[] =
-        {
-            ONLP_SFP_CONTROL_RESET_STATE,
-            ONLP_SFP_CONTROL_RX_LOS,
-            ONLP_SFP_CONTROL_TX_DISABLE,
-            ONLP_SFP_CONTROL_LP_MODE,
-            ONLP_SFP_CONTROL_SOFT_RATE_SELECT
-        };
-
     if(flags) {
         *flags = 0;
     }
@@ -366,11 +602,11 @@ onlp_sfp_control_flags_get(int port, uint32_t* flags)
 
     int rv, i, v;
 
-    for(i = 0; i < AIM_ARRAYSIZE(controls); i++) {
-        rv = onlp_sfp_control_get(port, controls[i], &v);
+    for(i = 0; i < AIM_ARRAYSIZE(control_flags__); i++) {
+        rv = onlp_sfp_control_get(port, control_flags__[i], &v);
         if(rv >= 0) {
             if(v) {
-                *flags |= (1 << controls[i]);
+                *flags |= (1 << control_flags__[i]);
             }
         }
         else {
@@ -382,6 +618,147 @@ onlp_sfp_control_flags_get(int port, uint32_t* flags)
     return 0;
 }
 
+/**
+ * Get a control bitmap. If the platform has no bulk hook, the control
+ * is read from each of the given ports.
+ */
+static int
+control_bitmap_get__(onlp_sfp_control_t control, onlp_sfp_bitmap_t* dst,
+                     onlp_sfp_bitmap_t* ports)
+{
+    int p, rv;
+    int supported = 0;
+
+    if(!ONLP_SFP_CONTROL_VALID(control) || dst == NULL) {
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    if(control == ONLP_SFP_CONTROL_RESET) {
+        /* This is a write-only control. */
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+
+    onlp_sfp_bitmap_t_init(dst);
+    rv = onlp_sfpi_control_bitmap_get(control, dst);
+    if(rv == ONLP_STATUS_E_UNSUPPORTED && control == ONLP_SFP_CONTROL_RX_LOS) {
+        rv = onlp_sfpi_rx_los_bitmap_get(dst);
+    }
+    if(rv != ONLP_STATUS_E_UNSUPPORTED) {
+        return rv;
+    }
+
+    /*
+     * Generate from the per-port control API. Ports which do not
+     * support the control, or fail to report it, are left clear.
+     */
+    AIM_BITMAP_CLR_ALL(dst);
+    AIM_BITMAP_ITER(ports, p) {
+        int v = 0;
+        int prv = onlp_sfp_control_get_locked__(p, control, &v);
+        if(prv >= 0) {
+            supported = 1;
+            if(v) {
+                AIM_BITMAP_SET(dst, p);
+            }
+        }
+        else if(prv != ONLP_STATUS_E_UNSUPPORTED && rv == ONLP_STATUS_E_UNSUPPORTED) {
+            rv = prv;
+        }
+    }
+
+    return (supported) ? ONLP_STATUS_OK : rv;
+}
+
+static int
+onlp_sfp_control_bitmap_get_locked__(onlp_sfp_control_t control,
+                                     onlp_sfp_bitmap_t* dst)
+{
+    return control_bitmap_get__(control, dst, &sfpi_bitmap__);
+}
+ONLP_LOCKED_API2(onlp_sfp_control_bitmap_get, onlp_sfp_control_t, control,
+                 onlp_sfp_bitmap_t*, dst);
+
+static int
+onlp_sfp_control_bitmap_set_locked__(onlp_sfp_control_t control,
+                                     onlp_sfp_bitmap_t* ports,
+                                     onlp_sfp_bitmap_t* values)
+{
+    int p, rv;
+
+    if(!ONLP_SFP_CONTROL_VALID(control) || ports == NULL || values == NULL) {
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    switch(control)
+        {
+        case ONLP_SFP_CONTROL_RX_LOS:
+        case ONLP_SFP_CONTROL_TX_FAULT:
+            /** These are read-only. */
+            return ONLP_STATUS_E_PARAM;
+
+        default:
+            break;
+        }
+
+    rv = onlp_sfpi_control_bitmap_set(control, ports, values);
+    if(rv != ONLP_STATUS_E_UNSUPPORTED) {
+        return rv;
+    }
+
+    /* Apply with the per-port control API. The first error is returned. */
+    rv = ONLP_STATUS_OK;
+    AIM_BITMAP_ITER(ports, p) {
+        if(AIM_BITMAP_GET(&sfpi_bitmap__, p)) {
+            int prv = onlp_sfp_control_set_locked__(p, control,
+                                                    AIM_BITMAP_GET(values, p) ? 1 : 0);
+            if(prv < 0 && rv >= 0) {
+                rv = prv;
+            }
+        }
+    }
+    return rv;
+}
+ONLP_LOCKED_API3(onlp_sfp_control_bitmap_set, onlp_sfp_control_t, control,
+                 onlp_sfp_bitmap_t*, ports, onlp_sfp_bitmap_t*, values);
+
+static int
+onlp_sfp_control_flags_get_all_locked__(uint32_t* flags, int count)
+{
+    int i, p, rv;
+    onlp_sfp_bitmap_t bmap;
+    onlp_sfp_bitmap_t present;
+
+    if(flags == NULL || count < 0) {
+        return ONLP_STATUS_E_PARAM;
+    }
+    memset(flags, 0, sizeof(*flags) * count);
+
+    /*
+     * Controls the platform cannot report in bulk are read from the
+     * populated ports only, as onlp_sfp_control_flags_get() callers do.
+     */
+    if(onlp_sfp_presence_bitmap_get_locked__(&present) < 0) {
+        AIM_BITMAP_ASSIGN(&present, &sfpi_bitmap__);
+    }
+
+    for(i = 0; i < AIM_ARRAYSIZE(control_flags__); i++) {
+        rv = control_bitmap_get__(control_flags__[i], &bmap, &present);
+        if(rv == ONLP_STATUS_E_UNSUPPORTED) {
+            continue;
+        }
+        if(rv < 0) {
+            return rv;
+        }
+        AIM_BITMAP_ITER(&bmap, p) {
+            if(p < count) {
+                flags[p] |= (1 << control_flags__[i]);
+            }
+        }
+    }
+    return 0;
+}
+ONLP_LOCKED_API2(onlp_sfp_control_flags_get_all, uint32_t*, flags, int, count);
+
 int
 onlp_sfp_ioctl(int port, ...)
 {
@@ -441,6 +818,38 @@ onlp_sfp_dev_read_locked__(int port, uint8_t devaddr, uint8_t addr, uint8_t* rda
 }
 ONLP_LOCKED_API5(onlp_sfp_dev_read, int, port, uint8_t, devaddr, uint8_t, addr, uint8_t*, rdata, int, size);
 
+static int
+onlp_sfp_dev_read_page_locked__(int port, uint8_t devaddr, int page,
+                                uint8_t addr, uint8_t* rdata, int size)
+{
+    int rv;
+    uint8_t data[256];
+    ONLP_SFP_PORT_VALIDATE_AND_MAP(port);
+
+    if(page < 0) {
+        rv = sfp_dev_read__(port, devaddr, addr, rdata, size);
+        if(rv == ONLP_STATUS_E_UNSUPPORTED && devaddr == 0x50) {
+            /* Page 0 is also what the platform's eeprom read returns. */
+            if((rv = onlp_sfpi_eeprom_read(port, data)) >= 0) {
+                memcpy(rdata, data + addr, size);
+                rv = ONLP_STATUS_OK;
+            }
+        }
+        return rv;
+    }
+
+    if((rv = onlp_sfpi_dev_writeb(port, devaddr, 127, page)) < 0) {
+        return rv;
+    }
+    rv = sfp_dev_read__(port, devaddr, addr, rdata, size);
+    if(onlp_sfpi_dev_writeb(port, devaddr, 127, 0) < 0) {
+        AIM_LOG_ERROR("port %d: failed to restore page 0", port);
+    }
+    return rv;
+}
+ONLP_LOCKED_API6(onlp_sfp_dev_read_page, int, port, uint8_t, devaddr, int, page,
+                 uint8_t, addr, uint8_t*, rdata, int, size);
+
 int
 onlp_sfp_dev_write_locked__(int port, uint8_t devaddr, uint8_t addr, uint8_t* data, int size)
 {
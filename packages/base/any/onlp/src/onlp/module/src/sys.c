@@ -26,10 +26,21 @@
 #include <onlp/platformi/sysi.h>
 #include <onlplib/mmap.h>
 #include <AIM/aim.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
 #include "onlp_log.h"
 #include "onlp_int.h"
+#define ONLP_API_SUBSYSTEM ONLP_SUBSYSTEM_SYS
+#define ONLP_API_SUBSYSTEM_INIT onlp_sys_init_locked__
 #include "onlp_locks.h"
 
+/**
+ * The current platform name. This keys the ONIE cache file.
+ */
+static char* platform__ = NULL;
+
 static char*
 platform_detect_fs__(int warn)
 {
@@ -94,11 +105,17 @@ onlp_sys_init_locked__(void)
     }
 
     /* If we get here, its all good */
-    aim_free((char*)current_platform);
+    aim_free(platform__);
+    platform__ = (char*)current_platform;
     rv = onlp_sysi_init();
     return rv;
 }
-ONLP_LOCKED_API0(onlp_sys_init);
+
+int
+onlp_sys_init(void)
+{
+    return onlp_subsystem_init(ONLP_SUBSYSTEM_SYS, onlp_sys_init_locked__);
+}
 
 static uint8_t*
 onie_data_get__(int* free)
@@ -108,7 +125,7 @@ onie_data_get__(int* free)
     int size;
     if(onlp_sysi_onie_data_phys_addr_get(&pa) == 0) {
         ma = onlp_mmap((off_t)pa, 64*1024, "onie_data_get__");
-        *free = 0;
+        *free = 2;
     }
     else if(onlp_sysi_onie_data_get(&ma, &size) == 0) {
         *free = 1;
@@ -120,6 +137,144 @@ onie_data_get__(int* free)
     return ma;
 }
 
+static void
+onie_data_free__(uint8_t* data, int free)
+{
+    if(free == 1) {
+        onlp_sysi_onie_data_free(data);
+    }
+    else if(free == 2) {
+        onlp_munmap(data, 64*1024);
+    }
+}
+
+/**
+ * The decoded ONIE system EEPROM.
+ *
+ * The EEPROM does not change at runtime, so it is read and decoded
+ * once per process. The first process to read it after boot also
+ * stores it in ONLP_CONFIG_ONIE_CACHE_DIR (normally a tmpfs) in
+ * TlvInfo format. Other processes decode that file instead of
+ * touching the EEPROM. The file name is keyed by the platform and
+ * the contents are validated by their CRC when loaded. Remove the
+ * file if the EEPROM is reprogrammed.
+ */
+static onlp_onie_info_t onie_info__;
+static int onie_info_valid__ = 0;
+
+static char*
+onie_cache_file__(void)
+{
+    if(ONLP_CONFIG_ONIE_CACHE_DIR == NULL || platform__ == NULL) {
+        return NULL;
+    }
+    return aim_fstrdup("%s/onie-%s.bin", ONLP_CONFIG_ONIE_CACHE_DIR, platform__);
+}
+
+static int
+onie_cache_load__(onlp_onie_info_t* info)
+{
+    int rv = -1;
+    char* fname = onie_cache_file__();
+
+    if(fname && access(fname, R_OK) == 0) {
+        /* A short file fails before the decoder initializes info. */
+        memset(info, 0, sizeof(*info));
+        list_init(&info->vx_list);
+        rv = onlp_onie_decode_file(info, fname);
+        if(rv < 0) {
+            AIM_LOG_WARN("Ignoring invalid ONIE cache file %s", fname);
+            onlp_onie_info_free(info);
+            unlink(fname);
+        }
+    }
+    aim_free(fname);
+    return rv;
+}
+
+static void
+onie_cache_store__(onlp_onie_info_t* info, const uint8_t* data)
+{
+    uint8_t buf[2048];
+    char* fname = onie_cache_file__();
+    char* tname = NULL;
+    int size, fd, rv;
+
+    if(fname == NULL) {
+        return;
+    }
+
+    if(data) {
+        /* Store the original TlvInfo data. The header has already been validated. */
+        size = 11 + ((data[9] << 8) | data[10]);
+    }
+    else {
+        /* Serialize the information provided by the platform. */
+        size = onlp_onie_encode(info, buf, sizeof(buf));
+        data = buf;
+    }
+
+    if(size <= 0) {
+        goto done;
+    }
+
+    if(mkdir(ONLP_CONFIG_ONIE_CACHE_DIR, 0755) < 0 && errno != EEXIST) {
+        AIM_LOG_VERBOSE("mkdir(%s): %{errno}", ONLP_CONFIG_ONIE_CACHE_DIR, errno);
+        goto done;
+    }
+
+    /* Write and rename so readers never see a partial file. */
+    tname = aim_fstrdup("%s.XXXXXX", fname);
+    if((fd = mkstemp(tname)) < 0) {
+        AIM_LOG_VERBOSE("mkstemp(%s): %{errno}", tname, errno);
+        goto done;
+    }
+    rv = (write(fd, data, size) == size && fchmod(fd, 0444) == 0);
+    if(close(fd) < 0 || !rv || rename(tname, fname) < 0) {
+        AIM_LOG_VERBOSE("Could not store the ONIE cache file %s: %{errno}",
+                        fname, errno);
+        unlink(tname);
+    }
+
+ done:
+    aim_free(tname);
+    aim_free(fname);
+}
+
+static int
+onie_info_load__(onlp_onie_info_t* info)
+{
+    int free;
+    uint8_t* onie_data;
+    int rv;
+
+    if(onie_cache_load__(info) == 0) {
+        return 0;
+    }
+
+    onie_data = onie_data_get__(&free);
+    if(onie_data) {
+        rv = onlp_onie_decode(info, onie_data, -1);
+        if(rv == 0) {
+            onie_cache_store__(info, onie_data);
+        }
+        onie_data_free__(onie_data, free);
+    }
+    else {
+        rv = onlp_sysi_onie_info_get(info);
+        if(rv == 0) {
+            onie_cache_store__(info, NULL);
+        }
+    }
+
+    if(rv != 0) {
+        onlp_onie_info_free(info);
+        memset(info, 0, sizeof(*info));
+        list_init(&info->vx_list);
+    }
+    return rv;
+}
+
 static int
 onlp_sys_info_get_locked__(onlp_sys_info_t* rv)
 {
@@ -131,21 +286,17 @@ onlp_sys_info_get_locked__(onlp_sys_info_t* rv)
 
     /**
      * Get the system ONIE information.
+     * Failures are not cached and will be retried on the next call.
      */
-    int free;
-    uint8_t* onie_data = onie_data_get__(&free);
+    if(!onie_info_valid__) {
+        onie_info_valid__ = (onie_info_load__(&onie_info__) == 0);
+    }
 
-    if(onie_data) {
-        onlp_onie_decode(&rv->onie_info, onie_data, -1);
-        if(free) {
-            onlp_sysi_onie_data_free(onie_data);
-        }
+    if(onie_info_valid__) {
+        onlp_onie_info_copy(&rv->onie_info, &onie_info__);
     }
     else {
-        if(onlp_sysi_onie_info_get(&rv->onie_info) != 0) {
-            memset(&rv->onie_info, 0, sizeof(rv->onie_info));
-            list_init(&rv->onie_info.vx_list);
-        }
+        list_init(&rv->onie_info.vx_list);
     }
 
     /*
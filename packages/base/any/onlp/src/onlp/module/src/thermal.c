@@ -26,6 +26,8 @@
 #include <onlp/platformi/thermali.h>
 #include <onlp/oids.h>
 #include "onlp_int.h"
+#define ONLP_API_SUBSYSTEM ONLP_SUBSYSTEM_THERMAL
+#define ONLP_API_SUBSYSTEM_INIT onlp_thermal_init_locked__
 #include "onlp_locks.h"
 
 #define VALIDATE(_id)                           \
@@ -48,7 +50,12 @@ onlp_thermal_init_locked__(void)
 {
     return onlp_thermali_init();
 }
-ONLP_LOCKED_API0(onlp_thermal_init);
+
+int
+onlp_thermal_init(void)
+{
+    return onlp_subsystem_init(ONLP_SUBSYSTEM_THERMAL, onlp_thermal_init_locked__);
+}
 
 #if ONLP_CONFIG_INCLUDE_PLATFORM_OVERRIDES == 1
 
@@ -127,6 +134,16 @@ onlp_thermal_hdr_get_locked__(onlp_oid_t id, onlp_oid_hdr_t* hdr)
     return rv;
 }
 ONLP_LOCKED_API2(onlp_thermal_hdr_get, onlp_oid_t, id, onlp_oid_hdr_t*, hdr);
+
+static int
+onlp_thermal_alarm_arm_locked__(onlp_oid_t id, int mcelsius, int* fd)
+{
+    VALIDATE(id);
+    *fd = -1;
+    return onlp_thermali_alarm_arm(id, mcelsius, fd);
+}
+ONLP_LOCKED_API3(onlp_thermal_alarm_arm, onlp_oid_t, id, int, mcelsius, int*, fd);
+
 int
 onlp_thermal_ioctl(int code, ...)
 {
@@ -68,4 +68,5 @@ __ONLP_DEFAULTI_IMPLEMENTATION(onlp_sysi_ioctl(int id, va_list vargs));
 __ONLP_DEFAULTI_IMPLEMENTATION(onlp_sysi_platform_manage_init(void));
 __ONLP_DEFAULTI_IMPLEMENTATION(onlp_sysi_platform_manage_fans(void));
 __ONLP_DEFAULTI_IMPLEMENTATION(onlp_sysi_platform_manage_leds(void));
+__ONLP_DEFAULTI_IMPLEMENTATION(onlp_sysi_platform_manage_thermal(onlp_oid_t id, onlp_thermal_level_t level, int mcelsius));
 
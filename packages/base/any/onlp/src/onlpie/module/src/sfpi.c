@@ -96,6 +96,27 @@ onlp_sfpi_rx_los_bitmap_get(onlp_sfp_bitmap_t* dst)
     return ONLP_STATUS_OK;
 }
 
+/*
+ * This function returns the state of a control for all ports.
+ *
+ * Platforms which keep a control for many ports in a block of
+ * CPLD registers should read the whole block here instead of
+ * one port at a time. Controls which are not reported this way
+ * should return ONLP_STATUS_E_UNSUPPORTED and the per-port
+ * control interface will be used.
+ */
+int
+onlp_sfpi_control_bitmap_get(onlp_sfp_control_t control, onlp_sfp_bitmap_t* dst)
+{
+    switch(control)
+        {
+        case ONLP_SFP_CONTROL_RX_LOS:
+            return onlp_sfpi_rx_los_bitmap_get(dst);
+        default:
+            return ONLP_STATUS_E_UNSUPPORTED;
+        }
+}
+
 /*
  * This function reads the SFPs idrom and returns in
  * in the data buffer provided.
@@ -0,0 +1,161 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *           Copyright 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * BMC serial console transport.
+ *
+ * Some platforms can only reach their fans, PSUs and thermal
+ * sensors by running shell commands on the BMC over a serial
+ * console (usually /dev/ttyACM0).
+ *
+ * The console session is logged in once and kept open. Each
+ * command's output is delimited by begin and end markers which
+ * also carry the exit status, and the response is read with
+ * poll() until the markers and the shell prompt arrive, so no
+ * fixed delays are needed. Several commands can be sent on a
+ * single command line and are answered in one round trip.
+ *
+ * Results of read-only commands may be cached for a short time.
+ * Any command which is not marked cacheable invalidates the cache,
+ * since it may change what the cached commands return (e.g. an
+ * i2c mux selection).
+ *
+ * The console device can be redirected with the
+ * ONLPLIB_CONFIG_BMC_CONSOLE_DEVICE_ENV environment variable,
+ * e.g. to a pty connected to a BMC simulator.
+ *
+ ***********************************************************/
+#ifndef __ONLPLIB_BMC_H__
+#define __ONLPLIB_BMC_H__
+
+#include <onlplib/onlplib_config.h>
+#include <stdint.h>
+
+/**
+ * BMC console configuration.
+ */
+typedef struct onlp_bmc_console_config_s {
+    /** Console device, e.g. "/dev/ttyACM0" */
+    const char* device;
+
+    /** Shell prompt substring, e.g. "@bmc:" */
+    const char* prompt;
+
+    /** Login user and password. */
+    const char* user;
+    const char* password;
+
+    /**
+     * Optional login action, used instead of user and password
+     * when the console is at the login prompt. The prompt is
+     * expected once it returns.
+     */
+    int (*login)(void);
+
+    /** Command timeout in milliseconds. 0 selects the default. */
+    uint32_t timeout_ms;
+
+    /** Result cache lifetime in milliseconds. 0 selects the default. */
+    uint32_t cache_ttl_ms;
+
+} onlp_bmc_console_config_t;
+
+
+/** The command result may be served from, and stored in, the cache. */
+#define ONLP_BMC_CMD_F_CACHE 0x1
+
+/**
+ * A BMC console command.
+ */
+typedef struct onlp_bmc_cmd_s {
+    /** Shell command. Trailing line endings are ignored. */
+    const char* cmd;
+    /** ONLP_BMC_CMD_F_* */
+    uint32_t flags;
+
+    /** Receives the command output (NULL terminated). May be NULL. */
+    char* out;
+    /** Size of out. */
+    int size;
+
+    /** Receives the output length or a negative ONLP_STATUS_E_* code. */
+    int rv;
+    /** Receives the command's exit status. */
+    int status;
+
+} onlp_bmc_cmd_t;
+
+
+/**
+ * @brief Open and log in to the BMC console.
+ * @param config The console configuration. It must remain valid
+ * until onlp_bmc_console_deinit().
+ * @note Calling this again once the console is open has no effect.
+ */
+int onlp_bmc_console_init(const onlp_bmc_console_config_t* config);
+
+/**
+ * @brief Close the BMC console.
+ */
+int onlp_bmc_console_deinit(void);
+
+/**
+ * @brief Run a batch of commands in as few round trips as possible.
+ * @param cmds The commands.
+ * @param count The number of commands.
+ * @returns ONLP_STATUS_OK if the console answered. The result of each
+ * command is reported in its rv and status fields.
+ */
+int onlp_bmc_console_exec_batch(onlp_bmc_cmd_t* cmds, int count);
+
+/**
+ * @brief Run a single command.
+ * @param cmd The shell command.
+ * @param flags ONLP_BMC_CMD_F_*
+ * @param out Receives the command output. May be NULL.
+ * @param size The size of out.
+ * @returns The output length, or ONLP_STATUS_E_INTERNAL if the command
+ * failed or exited with a non-zero status.
+ */
+int onlp_bmc_console_exec(const char* cmd, uint32_t flags, char* out, int size);
+
+/**
+ * @brief Run a command which prints a single integer.
+ * @param cmd The shell command.
+ * @param base The integer base (see strtol()).
+ * @param value Receives the value.
+ * @note The result is cacheable.
+ */
+int onlp_bmc_console_read_int(const char* cmd, int base, int* value);
+
+/**
+ * @brief Parse the output of a command which prints a single integer.
+ * @param out The command output.
+ * @param base The integer base (see strtol()).
+ * @param value Receives the value.
+ */
+int onlp_bmc_console_parse_int(const char* out, int base, int* value);
+
+/**
+ * @brief Drop all cached command results.
+ */
+void onlp_bmc_console_cache_flush(void);
+
+#endif /* __ONLPLIB_BMC_H__ */
@@ -197,4 +197,33 @@ int onlp_file_vopen(int flags, int log, const char* fmt, va_list vargs);
  */
 int onlp_file_find(char* root, char* fname, char** rpath);
 
+/**
+ * The original limits of an hwmon temperature sensor,
+ * saved by onlp_file_hwmon_alarm_arm().
+ */
+typedef struct onlp_file_hwmon_alarm_s {
+    /** Non-zero if the limits below have been saved. */
+    int saved;
+    /** Original tempN_max */
+    int max;
+    /** Original tempN_max_hyst, if has_hyst is set. */
+    int max_hyst;
+    int has_hyst;
+} onlp_file_hwmon_alarm_t;
+
+/**
+ * @brief Program the alarm of an hwmon temperature sensor.
+ * @param alarm The sensor's saved limits. Zero it before the first call.
+ * @param input The sensor's tempN_input attribute. Wildcards are allowed.
+ * @param mcelsius The alarm temperature (tempN_max) in milli-celsius,
+ * or 0 to restore the original limits.
+ * @param hysteresis tempN_max_hyst is set to mcelsius - hysteresis.
+ * @param [out] fd Receives an open descriptor for tempN_max_alarm,
+ * or -1 if the sensor does not have one.
+ * @note The original limits are saved on the first call and restored
+ * when disarmed. On the LM75 tempN_max also drives the OS# output.
+ */
+int onlp_file_hwmon_alarm_arm(onlp_file_hwmon_alarm_t* alarm, const char* input,
+                              int mcelsius, int hysteresis, int* fd);
+
 #endif /* __ONLPLIB_FILE_H__ */
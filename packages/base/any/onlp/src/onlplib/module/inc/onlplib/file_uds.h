@@ -54,6 +54,10 @@
  * Standardizing on this method allows all system ONLP clients to access
  * all data, even if that data is present only in seperate processes.
  *
+ * Connections are accepted by a single service thread and handled
+ * by a pool of ONLPLIB_CONFIG_FILE_UDS_WORKER_COUNT worker threads,
+ * so a slow handler does not delay the other services.
+ *
  *
  ***********************************************************/
 #ifndef __ONLPLIB_FILE_UDS_H__
@@ -77,7 +81,12 @@ int onlp_file_uds_create(onlp_file_uds_t** fuds);
  * @brief This is the prototype for your service handler function.
  * @param fd The client file descriptor. This is the descriptor accepted
  * on your behalf by the service manager when someone attempts to open your domain socket.
+ * It is closed by the service manager when the handler returns.
  * @param cookie Private callback pointer.
+ * @note Handlers run on the worker threads and may be called concurrently,
+ * including for several connections to the same service. A handler must
+ * be reentrant or serialize access to any state it shares. Handlers of
+ * cached services (onlp_file_uds_add_cached()) are serialized per service.
  */
 typedef int (*onlp_file_uds_handler_t)(int fd, void* cookie);
 
@@ -92,6 +101,22 @@ int onlp_file_uds_add(onlp_file_uds_t* fuds,
                       const char* path,
                       onlp_file_uds_handler_t handler, void* cookie);
 
+/**
+ * @brief Add a domain socket service path whose responses are cached.
+ * @param fuds The service manager
+ * @param path The domain socket filesystem path you would like to register.
+ * @param handler The connection handler for the domain socket.
+ * @param cookie Cookie for you connection handler.
+ * @param ttl_ms The handler's response is served to all clients
+ * for this many milliseconds before the handler is called again.
+ * @note The handler is not connected to the client and must only
+ * write its response. Use this for read-only status sockets.
+ */
+int onlp_file_uds_add_cached(onlp_file_uds_t* fuds,
+                             const char* path,
+                             onlp_file_uds_handler_t handler, void* cookie,
+                             uint32_t ttl_ms);
+
 /**
  * @brief Remove a domain socket service path from an existing service manager.
  * @param fuds The service manager.
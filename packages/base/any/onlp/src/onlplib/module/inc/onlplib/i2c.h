@@ -26,6 +26,7 @@
 #define __ONLP_I2C_H__
 
 #include <onlplib/onlplib_config.h>
+#include <AIM/aim_pvs.h>
 
 #if ONLPLIB_CONFIG_INCLUDE_I2C == 1
 
@@ -77,6 +78,14 @@
  */
 #define ONLP_I2C_F_DISABLE_READ_RETRIES 0x80
 
+/**
+ * Bypass device health tracking. The operation is performed even
+ * if the device is backing off or quarantined and its result is
+ * not recorded. Recovery handlers should use this when they access
+ * the muxes in front of a failing device.
+ */
+#define ONLP_I2C_F_NO_HEALTH 0x100
+
 /**
  * @brief Open and prepare for reading or writing.
  * @param bus The i2c bus number.
@@ -183,6 +192,122 @@ int onlp_i2c_writew(int bus, uint8_t addr, uint8_t offset, uint16_t word,
 
 
 
+/****************************************************************************
+ *
+ * I2C Device Health.
+ *
+ * The outcome of every operation is recorded per (bus, address).
+ * A device which fails an operation (after all retries) is not
+ * accessed again for ONLPLIB_CONFIG_I2C_BACKOFF_MS, doubling with each
+ * consecutive failure up to ONLPLIB_CONFIG_I2C_BACKOFF_MAX_MS. Operations
+ * on a backing off device fail immediately with ONLP_STATUS_E_I2C.
+ * After a failure the next operation is attempted once instead of
+ * spending the full retry budget. After
+ * ONLPLIB_CONFIG_I2C_QUARANTINE_THRESHOLD consecutive failures the
+ * device is quarantined and only probed once per maximum backoff.
+ * One successful operation restores the device.
+ *
+ * Tracking is enabled at runtime when the platform registers its
+ * recovery handlers with onlp_i2c_recovery_register(). Setting
+ * ONLPLIB_CONFIG_I2C_HEALTH_ENV enables (non-zero) or disables (0)
+ * it regardless of the platform. When an SFP or PSU is inserted the
+ * core forgets the health of the devices which the platform reports
+ * for the slot through onlp_sfpi_i2c_get() or onlp_psui_i2c_get().
+ *
+ ***************************************************************************/
+
+/**
+ * The health of a single i2c device.
+ */
+typedef struct onlp_i2c_health_s {
+    /** i2c bus number */
+    int bus;
+    /** Slave address */
+    uint8_t addr;
+    /** Operations attempted on the device. */
+    uint32_t operations;
+    /** Operations which failed after all retries. */
+    uint32_t failures;
+    /** Retries spent by all operations. */
+    uint32_t retries;
+    /** Operations refused while the device was backing off. */
+    uint32_t skipped;
+    /** Recovery handler invocations. */
+    uint32_t recoveries;
+    /** Consecutive failed operations. */
+    uint32_t consecutive;
+    /** Remaining backoff in milliseconds. */
+    uint32_t backoff_ms;
+    /** Non-zero if the device is quarantined. */
+    int quarantined;
+    /** Moving average of the operation success rate (0-100). */
+    int score;
+} onlp_i2c_health_t;
+
+/**
+ * @brief Get the health of an i2c device.
+ * @param bus The i2c bus number.
+ * @param addr The slave address.
+ * @param health [out] Receives the health.
+ * @returns ONLP_STATUS_E_MISSING if the device has not been accessed.
+ */
+int onlp_i2c_health_get(int bus, uint8_t addr, onlp_i2c_health_t* health);
+
+/**
+ * @brief Iterate over the health of all accessed i2c devices.
+ * @param cb Called for each device. A negative return stops the iteration.
+ * @param cookie Passed to the callback.
+ */
+int onlp_i2c_health_iterate(int (*cb)(onlp_i2c_health_t* health, void* cookie),
+                            void* cookie);
+
+/**
+ * @brief Forget the health of an i2c device.
+ * @param bus The i2c bus number, or -1 for all devices.
+ * @param addr The slave address, or -1 for all devices on the bus.
+ * @note Platforms should call this when a device is replaced, so that
+ * a new device does not inherit the quarantine of the old one.
+ */
+void onlp_i2c_health_clear(int bus, int addr);
+
+/**
+ * @brief Show the health of all i2c devices which have failed.
+ * @param pvs The output stream.
+ */
+void onlp_i2c_health_show(aim_pvs_t* pvs);
+
+
+/**
+ * Platform i2c recovery handlers.
+ *
+ * When a device fails an operation the handlers are escalated:
+ * the first consecutive failure calls mux_reset(), the second calls
+ * bus_recover(). If the handler succeeds the operation is attempted
+ * once more. Quarantined devices do not trigger recovery, so a dead
+ * device does not repeatedly disturb its neighbours. Handlers must
+ * pass ONLP_I2C_F_NO_HEALTH to their own i2c operations.
+ *
+ * Registering the handlers enables health tracking. A platform which
+ * wants tracking without recovery registers a structure with no
+ * handlers.
+ */
+typedef struct onlp_i2c_recovery_s {
+    /** Reset the muxes in front of the device. Optional. */
+    int (*mux_reset)(int bus, uint8_t addr, void* cookie);
+    /** Recover the bus, e.g. by clocking out a stuck slave. Optional. */
+    int (*bus_recover)(int bus, void* cookie);
+    /** Passed to the handlers. */
+    void* cookie;
+} onlp_i2c_recovery_t;
+
+/**
+ * @brief Register the platform i2c recovery handlers.
+ * @param recovery The handlers, or NULL to remove them and disable
+ * health tracking. The structure is copied.
+ */
+void onlp_i2c_recovery_register(onlp_i2c_recovery_t* recovery);
+
+
 /****************************************************************************
  *
  * I2C Mux/Device Management.
@@ -37,6 +37,13 @@
  */
 void* onlp_mmap(off_t pa, uint32_t size, const char* name);
 
+/**
+ * @brief Unmap a region mapped with onlp_mmap().
+ * @param va The address returned by onlp_mmap().
+ * @param size The size passed to onlp_mmap().
+ */
+int onlp_munmap(void* va, uint32_t size);
+
 
 
 
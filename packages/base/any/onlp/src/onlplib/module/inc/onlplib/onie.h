@@ -85,6 +85,24 @@ typedef struct onlp_onie_vx_s {
 int onlp_onie_decode(onlp_onie_info_t* rv, const uint8_t* data, int size);
 int onlp_onie_decode_file(onlp_onie_info_t* rv, const char* file);
 
+/**
+ * @brief Encode an ONIE info structure in TlvInfo format.
+ * @param info The ONIE information.
+ * @param data Receives the TlvInfo data, including the CRC TLV.
+ * @param size The size of data.
+ * @returns The length of the TlvInfo data or -1 if it does not fit.
+ * @note Unset fields are not encoded. The result can be decoded
+ * with onlp_onie_decode().
+ */
+int onlp_onie_encode(onlp_onie_info_t* info, uint8_t* data, int size);
+
+/**
+ * @brief Copy an ONIE info structure.
+ * @param dst Receives the copy. It must be freed with onlp_onie_info_free().
+ * @param src The source.
+ */
+int onlp_onie_info_copy(onlp_onie_info_t* dst, const onlp_onie_info_t* src);
+
 /**
  * Free an ONIE info structure.
  */
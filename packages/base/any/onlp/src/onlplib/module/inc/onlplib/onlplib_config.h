@@ -145,6 +145,86 @@
 #define ONLPLIB_CONFIG_I2C_READ_RETRY_COUNT 16
 #endif
 
+/**
+ * ONLPLIB_CONFIG_I2C_RETRY_DELAY_US
+ *
+ * The delay (in microseconds) before the first I2C read retry. It doubles with each retry. */
+
+
+#ifndef ONLPLIB_CONFIG_I2C_RETRY_DELAY_US
+#define ONLPLIB_CONFIG_I2C_RETRY_DELAY_US 100
+#endif
+
+/**
+ * ONLPLIB_CONFIG_I2C_RETRY_DELAY_MAX_US
+ *
+ * The maximum delay (in microseconds) between I2C read retries. */
+
+
+#ifndef ONLPLIB_CONFIG_I2C_RETRY_DELAY_MAX_US
+#define ONLPLIB_CONFIG_I2C_RETRY_DELAY_MAX_US 5000
+#endif
+
+/**
+ * ONLPLIB_CONFIG_INCLUDE_I2C_HEALTH
+ *
+ * Include I2C device health tracking. It runs on platforms which register recovery handlers, or when ONLPLIB_CONFIG_I2C_HEALTH_ENV is set. */
+
+
+#ifndef ONLPLIB_CONFIG_INCLUDE_I2C_HEALTH
+#define ONLPLIB_CONFIG_INCLUDE_I2C_HEALTH 1
+#endif
+
+/**
+ * ONLPLIB_CONFIG_I2C_HEALTH_ENV
+ *
+ * Environment variable which enables (non-zero) or disables (0) I2C device health tracking regardless of the platform. */
+
+
+#ifndef ONLPLIB_CONFIG_I2C_HEALTH_ENV
+#define ONLPLIB_CONFIG_I2C_HEALTH_ENV "ONLP_I2C_HEALTH"
+#endif
+
+/**
+ * ONLPLIB_CONFIG_I2C_HEALTH_TABLE_SIZE
+ *
+ * The number of I2C devices whose health is tracked. */
+
+
+#ifndef ONLPLIB_CONFIG_I2C_HEALTH_TABLE_SIZE
+#define ONLPLIB_CONFIG_I2C_HEALTH_TABLE_SIZE 256
+#endif
+
+/**
+ * ONLPLIB_CONFIG_I2C_BACKOFF_MS
+ *
+ * How long (in milliseconds) a failed I2C device is not accessed. It doubles with each consecutive failure. */
+
+
+#ifndef ONLPLIB_CONFIG_I2C_BACKOFF_MS
+#define ONLPLIB_CONFIG_I2C_BACKOFF_MS 100
+#endif
+
+/**
+ * ONLPLIB_CONFIG_I2C_BACKOFF_MAX_MS
+ *
+ * The maximum I2C device backoff in milliseconds. Quarantined devices are retried at this interval. */
+
+
+#ifndef ONLPLIB_CONFIG_I2C_BACKOFF_MAX_MS
+#define ONLPLIB_CONFIG_I2C_BACKOFF_MAX_MS 30000
+#endif
+
+/**
+ * ONLPLIB_CONFIG_I2C_QUARANTINE_THRESHOLD
+ *
+ * The number of consecutive failed operations after which an I2C device is quarantined. */
+
+
+#ifndef ONLPLIB_CONFIG_I2C_QUARANTINE_THRESHOLD
+#define ONLPLIB_CONFIG_I2C_QUARANTINE_THRESHOLD 4
+#endif
+
 /**
  * ONLPLIB_CONFIG_I2C_USE_CUSTOM_HEADER
  *
@@ -165,6 +245,76 @@
 #define ONLPLIB_CONFIG_INCLUDE_I2C_SMBUS 0
 #endif
 
+/**
+ * ONLPLIB_CONFIG_REGMAP_SNAPSHOT_SIZE
+ *
+ * Maximum number of registers captured by a single register map snapshot. */
+
+
+#ifndef ONLPLIB_CONFIG_REGMAP_SNAPSHOT_SIZE
+#define ONLPLIB_CONFIG_REGMAP_SNAPSHOT_SIZE 256
+#endif
+
+/**
+ * ONLPLIB_CONFIG_FILE_UDS_WORKER_COUNT
+ *
+ * Number of worker threads handling domain socket service requests. Zero handles requests in the service thread. */
+
+
+#ifndef ONLPLIB_CONFIG_FILE_UDS_WORKER_COUNT
+#define ONLPLIB_CONFIG_FILE_UDS_WORKER_COUNT 4
+#endif
+
+/**
+ * ONLPLIB_CONFIG_BMC_CONSOLE_DEVICE_ENV
+ *
+ * Environment variable which overrides the BMC console device (e.g. a pty connected to a BMC simulator). */
+
+
+#ifndef ONLPLIB_CONFIG_BMC_CONSOLE_DEVICE_ENV
+#define ONLPLIB_CONFIG_BMC_CONSOLE_DEVICE_ENV "ONLP_BMC_CONSOLE_DEVICE"
+#endif
+
+/**
+ * ONLPLIB_CONFIG_BMC_CONSOLE_TIMEOUT_MS
+ *
+ * Default BMC console command timeout in milliseconds. */
+
+
+#ifndef ONLPLIB_CONFIG_BMC_CONSOLE_TIMEOUT_MS
+#define ONLPLIB_CONFIG_BMC_CONSOLE_TIMEOUT_MS 3000
+#endif
+
+/**
+ * ONLPLIB_CONFIG_BMC_CONSOLE_BUFFER_SIZE
+ *
+ * Maximum BMC console response size for a single round trip. */
+
+
+#ifndef ONLPLIB_CONFIG_BMC_CONSOLE_BUFFER_SIZE
+#define ONLPLIB_CONFIG_BMC_CONSOLE_BUFFER_SIZE 8192
+#endif
+
+/**
+ * ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_SIZE
+ *
+ * Number of BMC console command results cached. */
+
+
+#ifndef ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_SIZE
+#define ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_SIZE 64
+#endif
+
+/**
+ * ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_TTL_MS
+ *
+ * Default lifetime of cached BMC console command results in milliseconds. */
+
+
+#ifndef ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_TTL_MS
+#define ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_TTL_MS 1000
+#endif
+
 
 
 /**
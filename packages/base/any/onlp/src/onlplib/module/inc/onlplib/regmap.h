@@ -0,0 +1,269 @@
+/************************************************************
+ * <bsn.cl v=2014 v=onl>
+ *
+ *           Copyright 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ * CPLD/FPGA register map support.
+ *
+ * A register map describes a block of 8-bit device registers
+ * and how to reach them (mmap, i2c, or sysfs). Fields and
+ * per-port bitmaps are described in static tables and can be
+ * decoded either directly from the device or from a snapshot
+ * of the register block taken with a single access.
+ *
+ ***********************************************************/
+#ifndef __ONLPLIB_REGMAP_H__
+#define __ONLPLIB_REGMAP_H__
+
+#include <onlplib/onlplib_config.h>
+#include <onlp/sfp.h>
+#include <sys/types.h>
+
+/**
+ * Register block access methods.
+ */
+typedef enum onlp_regmap_access_e {
+    /** Registers are memory mapped at a physical address. */
+    ONLP_REGMAP_ACCESS_MMAP,
+    /** Registers are accessed over i2c (block reads where possible). */
+    ONLP_REGMAP_ACCESS_I2C,
+    /**
+     * Registers are accessed through a sysfs file.
+     *
+     * If the path contains a format specifier it is expanded with
+     * the register offset and each register is a text attribute.
+     * Otherwise the path is a binary attribute exposing the whole
+     * register block, accessed at the register offset.
+     */
+    ONLP_REGMAP_ACCESS_SYSFS,
+} onlp_regmap_access_t;
+
+/**
+ * A register map.
+ */
+typedef struct onlp_regmap_s {
+    /** Name (for logging purposes) */
+    const char* name;
+
+    /** Access method */
+    onlp_regmap_access_t access;
+
+    /** Number of registers in the block. */
+    uint32_t size;
+
+    /** ONLP_REGMAP_ACCESS_MMAP: physical base address */
+    off_t pa;
+
+    /** ONLP_REGMAP_ACCESS_I2C: bus, address, and ONLP_I2C_F_* flags */
+    int bus;
+    uint8_t addr;
+    uint32_t flags;
+
+    /** ONLP_REGMAP_ACCESS_SYSFS: attribute path */
+    const char* path;
+
+    /** Runtime mapping. Set by onlp_regmap_open(). */
+    volatile uint8_t* base;
+
+} onlp_regmap_t;
+
+
+/**
+ * The field value is active low.
+ * Only meaningful for single-bit fields.
+ */
+#define ONLP_REGMAP_F_ACTIVE_LOW 0x1
+
+/**
+ * Bitmaps are packed from the most significant bit
+ * of each register. The default is least significant first.
+ */
+#define ONLP_REGMAP_F_MSB_FIRST 0x2
+
+/**
+ * A register field.
+ */
+typedef struct onlp_regmap_field_s {
+    /** Field name */
+    const char* name;
+    /** Register offset */
+    uint16_t reg;
+    /** Field mask within the register */
+    uint8_t mask;
+    /** ONLP_REGMAP_F_* */
+    uint32_t flags;
+} onlp_regmap_field_t;
+
+/**
+ * A per-port bitmap spread across consecutive registers.
+ *
+ * Port (first + n) is described by bit (n % 8) of
+ * register (reg + n / 8).
+ */
+typedef struct onlp_regmap_bitmap_s {
+    /** Bitmap name */
+    const char* name;
+    /** First register offset */
+    uint16_t reg;
+    /** Port number of the first bit */
+    int first;
+    /** Number of ports */
+    int count;
+    /** ONLP_REGMAP_F_* */
+    uint32_t flags;
+} onlp_regmap_bitmap_t;
+
+/**
+ * A snapshot of a range of registers.
+ */
+typedef struct onlp_regmap_snapshot_s {
+    /** First register captured */
+    uint16_t start;
+    /** Number of registers captured */
+    uint16_t count;
+    /** Register contents */
+    uint8_t data[ONLPLIB_CONFIG_REGMAP_SNAPSHOT_SIZE];
+} onlp_regmap_snapshot_t;
+
+
+/**
+ * @brief Prepare a register map for access.
+ * @param map The register map.
+ * @note This is called implicitly on first access.
+ */
+int onlp_regmap_open(onlp_regmap_t* map);
+
+/**
+ * @brief Read a range of registers.
+ * @param map The register map.
+ * @param reg The first register.
+ * @param count The number of registers.
+ * @param [out] data Receives the register contents.
+ */
+int onlp_regmap_read(onlp_regmap_t* map, uint16_t reg, int count,
+                     uint8_t* data);
+
+/**
+ * @brief Read a single register.
+ * @param map The register map.
+ * @param reg The register.
+ * @returns The register value or a negative error code.
+ */
+int onlp_regmap_readb(onlp_regmap_t* map, uint16_t reg);
+
+/**
+ * @brief Write a single register.
+ * @param map The register map.
+ * @param reg The register.
+ * @param value The value.
+ */
+int onlp_regmap_writeb(onlp_regmap_t* map, uint16_t reg, uint8_t value);
+
+/**
+ * @brief Modify a single register.
+ * @param map The register map.
+ * @param reg The register.
+ * @param andmask The and mask.
+ * @param ormask The or mask.
+ */
+int onlp_regmap_modifyb(onlp_regmap_t* map, uint16_t reg,
+                        uint8_t andmask, uint8_t ormask);
+
+/**
+ * @brief Get a field value from the device.
+ * @param map The register map.
+ * @param field The field.
+ * @param [out] value Receives the field value.
+ */
+int onlp_regmap_field_get(onlp_regmap_t* map,
+                          const onlp_regmap_field_t* field, int* value);
+
+/**
+ * @brief Set a field value on the device.
+ * @param map The register map.
+ * @param field The field.
+ * @param value The field value.
+ */
+int onlp_regmap_field_set(onlp_regmap_t* map,
+                          const onlp_regmap_field_t* field, int value);
+
+/**
+ * @brief Capture a range of registers in a single access.
+ * @param map The register map.
+ * @param start The first register.
+ * @param count The number of registers.
+ * @param [out] snapshot Receives the snapshot.
+ */
+int onlp_regmap_snapshot(onlp_regmap_t* map, uint16_t start, int count,
+                         onlp_regmap_snapshot_t* snapshot);
+
+/**
+ * @brief Get a field value from a snapshot.
+ * @param snapshot The snapshot.
+ * @param field The field.
+ * @param [out] value Receives the field value.
+ */
+int onlp_regmap_snapshot_field_get(const onlp_regmap_snapshot_t* snapshot,
+                                   const onlp_regmap_field_t* field,
+                                   int* value);
+
+/**
+ * @brief Decode a port bitmap from a snapshot.
+ * @param snapshot The snapshot.
+ * @param bitmap The bitmap description.
+ * @param [out] dst Receives the port values.
+ * @note Only the ports described by the bitmap are modified.
+ */
+int onlp_regmap_snapshot_bitmap_get(const onlp_regmap_snapshot_t* snapshot,
+                                    const onlp_regmap_bitmap_t* bitmap,
+                                    onlp_sfp_bitmap_t* dst);
+
+/**
+ * @brief Read and decode a port bitmap from the device.
+ * @param map The register map.
+ * @param bitmap The bitmap description.
+ * @param [out] dst Receives the port values.
+ */
+int onlp_regmap_bitmap_get(onlp_regmap_t* map,
+                           const onlp_regmap_bitmap_t* bitmap,
+                           onlp_sfp_bitmap_t* dst);
+
+/**
+ * @brief Get a single port's bit from a bitmap on the device.
+ * @param map The register map.
+ * @param bitmap The bitmap description.
+ * @param port The port number.
+ * @returns The bit value or a negative error code.
+ */
+int onlp_regmap_bitmap_port_get(onlp_regmap_t* map,
+                                const onlp_regmap_bitmap_t* bitmap,
+                                int port);
+
+/**
+ * @brief Set a single port's bit in a bitmap on the device.
+ * @param map The register map.
+ * @param bitmap The bitmap description.
+ * @param port The port number.
+ * @param value The bit value.
+ */
+int onlp_regmap_bitmap_port_set(onlp_regmap_t* map,
+                                const onlp_regmap_bitmap_t* bitmap,
+                                int port, int value);
+
+#endif /* __ONLPLIB_REGMAP_H__ */
@@ -0,0 +1,632 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ *
+ *           Copyright 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+#include <onlplib/bmc.h>
+#include <onlp/onlp.h>
+#include "onlplib_log.h"
+#include <AIM/aim_time.h>
+#include <termios.h>
+#include <sys/file.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <ctype.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+
+/*
+ * Every command is wrapped as
+ *
+ *     echo @@ON""LPB<seq>@@;<command>;echo @@ON""LPE<seq> $?@@;
+ *
+ * The shell prints the markers without the quotes, so the echo of
+ * the command line itself never matches them.
+ */
+#define MARKER_BEGIN        "@@ONLPB"
+#define MARKER_END          "@@ONLPE"
+#define MARKER_BEGIN_CMD    "@@ON\"\"LPB"
+#define MARKER_END_CMD      "@@ON\"\"LPE"
+#define MARKER_WRAP_FMT     "echo " MARKER_BEGIN_CMD "%u@@;%.*s;echo " MARKER_END_CMD "%u $?@@;"
+
+/* Wrapping overhead with the widest sequence numbers. */
+#define MARKER_WRAP_SIZE    (sizeof(MARKER_WRAP_FMT) + 20)
+
+/* Longest command line sent in one round trip. */
+#define LINE_MAX__          1024
+
+#define LOGIN_RETRY         3
+
+typedef struct cache_entry_s {
+    char* cmd;
+    char* out;
+    int len;
+    int status;
+    uint64_t expires;
+} cache_entry_t;
+
+typedef struct console_s {
+    pthread_mutex_t lock;
+    const onlp_bmc_console_config_t* config;
+    int fd;
+    int logged_in;
+    uint32_t seq;
+
+    /* Response data from the current round trip */
+    char buf[ONLPLIB_CONFIG_BMC_CONSOLE_BUFFER_SIZE];
+    int len;
+
+    cache_entry_t cache[ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_SIZE];
+} console_t;
+
+static console_t console__ = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .fd = -1,
+};
+
+static uint32_t
+timeout__(void)
+{
+    return console__.config->timeout_ms ?
+        console__.config->timeout_ms : ONLPLIB_CONFIG_BMC_CONSOLE_TIMEOUT_MS;
+}
+
+static uint32_t
+ttl__(void)
+{
+    return console__.config->cache_ttl_ms ?
+        console__.config->cache_ttl_ms : ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_TTL_MS;
+}
+
+static int
+open__(void)
+{
+    struct termios attr;
+    const char* device = getenv(ONLPLIB_CONFIG_BMC_CONSOLE_DEVICE_ENV);
+
+    if(device == NULL) {
+        device = console__.config->device;
+    }
+
+    console__.fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if(console__.fd < 0) {
+        AIM_LOG_ERROR("bmc console: open(%s): %{errno}", device, errno);
+        return ONLP_STATUS_E_INTERNAL;
+    }
+
+    if(tcgetattr(console__.fd, &attr) == 0) {
+        cfmakeraw(&attr);
+        attr.c_cflag = B57600 | CS8 | CLOCAL | CREAD;
+        attr.c_iflag = IGNPAR | IGNCR;
+        attr.c_cc[VMIN] = 0;
+        attr.c_cc[VTIME] = 0;
+        cfsetospeed(&attr, B57600);
+        cfsetispeed(&attr, B57600);
+        tcsetattr(console__.fd, TCSANOW, &attr);
+    }
+
+    console__.logged_in = 0;
+    return 0;
+}
+
+static void
+close__(void)
+{
+    if(console__.fd >= 0) {
+        close(console__.fd);
+        console__.fd = -1;
+    }
+    console__.logged_in = 0;
+}
+
+/**
+ * Discard all pending input and empty the response buffer.
+ */
+static void
+drain__(void)
+{
+    char tmp[256];
+    while(read(console__.fd, tmp, sizeof(tmp)) > 0);
+    console__.len = 0;
+    console__.buf[0] = 0;
+}
+
+static int
+write__(const char* data, int len)
+{
+    struct pollfd pfd = { console__.fd, POLLOUT, 0 };
+
+    while(len > 0) {
+        int rv = write(console__.fd, data, len);
+        if(rv < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            if(errno != EAGAIN || poll(&pfd, 1, timeout__()) <= 0) {
+                AIM_LOG_ERROR("bmc console: write failed: %{errno}", errno);
+                return ONLP_STATUS_E_INTERNAL;
+            }
+            continue;
+        }
+        data += rv;
+        len -= rv;
+    }
+    return 0;
+}
+
+static int
+write_str__(const char* s)
+{
+    return write__(s, strlen(s));
+}
+
+/**
+ * Append whatever arrives before the deadline to the response buffer.
+ */
+static int
+fill__(uint64_t deadline)
+{
+    struct pollfd pfd = { console__.fd, POLLIN, 0 };
+    char tmp[512];
+    uint64_t now = aim_time_monotonic();
+    int rv, i;
+
+    if(now >= deadline) {
+        return 0;
+    }
+
+    rv = poll(&pfd, 1, (deadline - now + 999) / 1000);
+    if(rv <= 0) {
+        return (rv < 0 && errno != EINTR) ? ONLP_STATUS_E_INTERNAL : 0;
+    }
+
+    rv = read(console__.fd, tmp, sizeof(tmp));
+    if(rv < 0) {
+        return (errno == EAGAIN || errno == EINTR) ? 0 : ONLP_STATUS_E_INTERNAL;
+    }
+    if(rv == 0) {
+        /* Hangup */
+        return ONLP_STATUS_E_INTERNAL;
+    }
+
+    for(i = 0; i < rv; i++) {
+        if(tmp[i] == '\r' || tmp[i] == '\0') {
+            continue;
+        }
+        if(console__.len >= sizeof(console__.buf) - 1) {
+            AIM_LOG_ERROR("bmc console: response exceeds %d bytes.",
+                          (int)sizeof(console__.buf));
+            return ONLP_STATUS_E_INTERNAL;
+        }
+        console__.buf[console__.len++] = tmp[i];
+    }
+    console__.buf[console__.len] = 0;
+    return rv;
+}
+
+/**
+ * Wait until one of the patterns appears in the response buffer
+ * at or after offset 'from'.
+ *
+ * Returns the index of the matching pattern.
+ */
+static int
+expect__(const char** patterns, int count, int from, uint32_t timeout_ms,
+         int* offset)
+{
+    uint64_t deadline = aim_time_monotonic() + timeout_ms * 1000ULL;
+    int i;
+
+    for(;;) {
+        for(i = 0; i < count; i++) {
+            char* p = strstr(console__.buf + from, patterns[i]);
+            if(p) {
+                if(offset) {
+                    *offset = p - console__.buf;
+                }
+                return i;
+            }
+        }
+        if(aim_time_monotonic() >= deadline) {
+            return ONLP_STATUS_E_INTERNAL;
+        }
+        ONLP_IF_ERROR_RETURN(fill__(deadline));
+    }
+}
+
+static int
+login__(void)
+{
+    const onlp_bmc_console_config_t* config = console__.config;
+    const char* patterns[] = { config->prompt, "login:", "assword:" };
+    int i, rv;
+
+    for(i = 0; i < LOGIN_RETRY; i++) {
+        drain__();
+        ONLP_IF_ERROR_RETURN(write_str__("\r"));
+        rv = expect__(patterns, AIM_ARRAYSIZE(patterns), 0, timeout__(), NULL);
+
+        if(rv == 1) {
+            drain__();
+            if(config->login) {
+                config->login();
+            }
+            else if(config->user) {
+                ONLP_IF_ERROR_RETURN(write_str__(config->user));
+                ONLP_IF_ERROR_RETURN(write_str__("\r"));
+                if(expect__(patterns + 2, 1, 0, timeout__(), NULL) == 0 &&
+                   config->password) {
+                    drain__();
+                    ONLP_IF_ERROR_RETURN(write_str__(config->password));
+                    ONLP_IF_ERROR_RETURN(write_str__("\r"));
+                }
+            }
+            rv = expect__(patterns, 1, 0, timeout__(), NULL);
+        }
+
+        if(rv == 0) {
+            console__.logged_in = 1;
+            return 0;
+        }
+        /* At the password prompt, or no answer. Start over. */
+    }
+
+    AIM_LOG_ERROR("bmc console: unable to log in.");
+    return ONLP_STATUS_E_INTERNAL;
+}
+
+static int
+cmdlen__(const char* cmd)
+{
+    int len = strlen(cmd);
+    while(len && strchr("\r\n ;", cmd[len-1])) {
+        len--;
+    }
+    return len;
+}
+
+static void
+result__(onlp_bmc_cmd_t* cmd, const char* out, int len, int status)
+{
+    if(cmd->out && cmd->size > 0) {
+        int n = (len < cmd->size - 1) ? len : cmd->size - 1;
+        memcpy(cmd->out, out, n);
+        cmd->out[n] = 0;
+    }
+    cmd->rv = len;
+    cmd->status = status;
+}
+
+/**
+ * Send the given commands on one command line and collect their results.
+ */
+static int
+transact__(onlp_bmc_cmd_t* cmds, int* idx, int count)
+{
+    char line[LINE_MAX__ + MARKER_WRAP_SIZE + 2];
+    char marker[32];
+    const char* patterns[1];
+    uint32_t seq = console__.seq;
+    int i, len = 0, offset;
+
+    console__.seq += count;
+
+    for(i = 0; i < count; i++) {
+        const char* cmd = cmds[idx[i]].cmd;
+        len += snprintf(line + len, sizeof(line) - len, MARKER_WRAP_FMT,
+                        seq + i, cmdlen__(cmd), cmd, seq + i);
+    }
+    len += snprintf(line + len, sizeof(line) - len, "\r");
+
+    drain__();
+    ONLP_IF_ERROR_RETURN(write__(line, len));
+
+    /* The last end marker, then the prompt. */
+    snprintf(marker, sizeof(marker), MARKER_END "%u ", seq + count - 1);
+    patterns[0] = marker;
+    if(expect__(patterns, 1, 0, timeout__() * count, &offset) < 0) {
+        AIM_LOG_ERROR("bmc console: timeout waiting for '%s'", cmds[idx[count-1]].cmd);
+        return ONLP_STATUS_E_INTERNAL;
+    }
+    patterns[0] = console__.config->prompt;
+    ONLP_IF_ERROR_RETURN(expect__(patterns, 1, offset, timeout__(), NULL));
+
+    for(i = 0; i < count; i++) {
+        char *begin, *end;
+        int blen;
+
+        blen = snprintf(marker, sizeof(marker), MARKER_BEGIN "%u@@\n", seq + i);
+        begin = strstr(console__.buf, marker);
+        snprintf(marker, sizeof(marker), MARKER_END "%u ", seq + i);
+        end = begin ? strstr(begin + blen, marker) : NULL;
+
+        if(end == NULL) {
+            cmds[idx[i]].rv = ONLP_STATUS_E_INTERNAL;
+            continue;
+        }
+        result__(cmds + idx[i], begin + blen, end - (begin + blen),
+                 atoi(end + strlen(marker)));
+    }
+    return 0;
+}
+
+static int
+run__(onlp_bmc_cmd_t* cmds, int* idx, int count)
+{
+    int attempt, rv = ONLP_STATUS_E_INTERNAL;
+
+    for(attempt = 0; attempt < 2; attempt++) {
+        if(console__.fd < 0) {
+            ONLP_IF_ERROR_RETURN(open__());
+        }
+
+        /* The console may be shared with other processes. */
+        flock(console__.fd, LOCK_EX);
+        rv = console__.logged_in ? 0 : login__();
+        if(rv >= 0) {
+            rv = transact__(cmds, idx, count);
+        }
+        flock(console__.fd, LOCK_UN);
+
+        if(rv >= 0) {
+            return rv;
+        }
+        /* Resynchronize with the console before retrying. */
+        console__.logged_in = 0;
+    }
+    return rv;
+}
+
+static void
+cache_flush__(void)
+{
+    int i;
+    for(i = 0; i < AIM_ARRAYSIZE(console__.cache); i++) {
+        aim_free(console__.cache[i].cmd);
+        aim_free(console__.cache[i].out);
+        memset(console__.cache + i, 0, sizeof(console__.cache[i]));
+    }
+}
+
+static int
+cache_get__(onlp_bmc_cmd_t* cmd, uint64_t now)
+{
+    int i;
+    for(i = 0; i < AIM_ARRAYSIZE(console__.cache); i++) {
+        cache_entry_t* e = console__.cache + i;
+        if(e->cmd && e->expires > now && !strcmp(e->cmd, cmd->cmd)) {
+            result__(cmd, e->out, e->len, e->status);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void
+cache_put__(onlp_bmc_cmd_t* cmd, uint64_t now)
+{
+    cache_entry_t* e = console__.cache;
+    int i;
+
+    if(cmd->out == NULL || cmd->rv >= cmd->size) {
+        /* The caller's buffer did not hold the full output. */
+        return;
+    }
+
+    /* Replace the same command, or the entry closest to expiry. */
+    for(i = 0; i < AIM_ARRAYSIZE(console__.cache); i++) {
+        cache_entry_t* c = console__.cache + i;
+        if(c->cmd && !strcmp(c->cmd, cmd->cmd)) {
+            e = c;
+            break;
+        }
+        if(c->expires < e->expires) {
+            e = c;
+        }
+    }
+
+    aim_free(e->cmd);
+    aim_free(e->out);
+    e->cmd = aim_strdup(cmd->cmd);
+    e->out = aim_zmalloc(cmd->rv + 1);
+    memcpy(e->out, cmd->out, cmd->rv);
+    e->len = cmd->rv;
+    e->status = cmd->status;
+    e->expires = now + ttl__() * 1000ULL;
+}
+
+int
+onlp_bmc_console_exec_batch(onlp_bmc_cmd_t* cmds, int count)
+{
+    int i, n = 0, size = 0, rv = 0, last_write = -1;
+    int* idx;
+    uint64_t now = aim_time_monotonic();
+
+    if(count <= 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&console__.lock);
+
+    if(console__.config == NULL) {
+        pthread_mutex_unlock(&console__.lock);
+        AIM_LOG_ERROR("bmc console: not initialized.");
+        return ONLP_STATUS_E_INTERNAL;
+    }
+
+    for(i = 0; i < count; i++) {
+        cmds[i].rv = ONLP_STATUS_E_INTERNAL;
+        cmds[i].status = -1;
+        if(!(cmds[i].flags & ONLP_BMC_CMD_F_CACHE)) {
+            last_write = i;
+        }
+    }
+
+    /*
+     * Any command which is not cacheable may change the results of
+     * the others, so nothing is served from the cache in that case.
+     */
+    if(last_write >= 0) {
+        cache_flush__();
+    }
+
+    idx = aim_zmalloc(sizeof(*idx) * count);
+    for(i = 0; i <= count; i++) {
+        if(i < count) {
+            int len = cmdlen__(cmds[i].cmd);
+
+            if(len == 0 || len > LINE_MAX__) {
+                AIM_LOG_ERROR("bmc console: invalid command '%s'", cmds[i].cmd);
+                cmds[i].rv = ONLP_STATUS_E_PARAM;
+                continue;
+            }
+            if(last_write < 0 && cache_get__(cmds + i, now)) {
+                continue;
+            }
+            if(n == 0 || size + len + MARKER_WRAP_SIZE <= LINE_MAX__) {
+                idx[n++] = i;
+                size += len + MARKER_WRAP_SIZE;
+                continue;
+            }
+        }
+
+        if(n) {
+            if((rv = run__(cmds, idx, n)) < 0) {
+                break;
+            }
+            n = size = 0;
+            if(i < count) {
+                /* Start the next line with this command. */
+                i--;
+            }
+        }
+    }
+    aim_free(idx);
+
+    now = aim_time_monotonic();
+    for(i = last_write + 1; i < count; i++) {
+        if(cmds[i].rv >= 0 && cmds[i].status == 0) {
+            cache_put__(cmds + i, now);
+        }
+    }
+
+    pthread_mutex_unlock(&console__.lock);
+    return rv;
+}
+
+int
+onlp_bmc_console_exec(const char* cmd, uint32_t flags, char* out, int size)
+{
+    onlp_bmc_cmd_t c;
+
+    memset(&c, 0, sizeof(c));
+    c.cmd = cmd;
+    c.flags = flags;
+    c.out = out;
+    c.size = size;
+
+    ONLP_IF_ERROR_RETURN(onlp_bmc_console_exec_batch(&c, 1));
+    if(c.rv < 0) {
+        return c.rv;
+    }
+    if(c.status != 0) {
+        AIM_LOG_ERROR("bmc console: '%s' exited with status %d", cmd, c.status);
+        return ONLP_STATUS_E_INTERNAL;
+    }
+    return c.rv;
+}
+
+int
+onlp_bmc_console_parse_int(const char* out, int base, int* value)
+{
+    char* end;
+    long v;
+
+    while(isspace((unsigned char)*out)) {
+        out++;
+    }
+    errno = 0;
+    v = strtol(out, &end, base);
+    if(end == out || errno) {
+        return ONLP_STATUS_E_INVALID;
+    }
+    while(isspace((unsigned char)*end)) {
+        end++;
+    }
+    if(*end) {
+        return ONLP_STATUS_E_INVALID;
+    }
+    *value = v;
+    return 0;
+}
+
+int
+onlp_bmc_console_read_int(const char* cmd, int base, int* value)
+{
+    char out[64];
+    ONLP_IF_ERROR_RETURN(onlp_bmc_console_exec(cmd, ONLP_BMC_CMD_F_CACHE,
+                                               out, sizeof(out)));
+    return onlp_bmc_console_parse_int(out, base, value);
+}
+
+void
+onlp_bmc_console_cache_flush(void)
+{
+    pthread_mutex_lock(&console__.lock);
+    cache_flush__();
+    pthread_mutex_unlock(&console__.lock);
+}
+
+int
+onlp_bmc_console_init(const onlp_bmc_console_config_t* config)
+{
+    int rv = 0;
+
+    pthread_mutex_lock(&console__.lock);
+    if(console__.fd < 0) {
+        console__.config = config;
+        if((rv = open__()) >= 0) {
+            flock(console__.fd, LOCK_EX);
+            rv = login__();
+            flock(console__.fd, LOCK_UN);
+            if(rv < 0) {
+                close__();
+            }
+        }
+    }
+    pthread_mutex_unlock(&console__.lock);
+    return rv;
+}
+
+int
+onlp_bmc_console_deinit(void)
+{
+    pthread_mutex_lock(&console__.lock);
+    close__();
+    cache_flush__();
+    pthread_mutex_unlock(&console__.lock);
+    return 0;
+}
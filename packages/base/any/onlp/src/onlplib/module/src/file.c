@@ -447,3 +447,68 @@ onlp_file_find(char* root, char* fname, char** rpath)
     fts_close(fs);
     return ONLP_STATUS_E_MISSING;
 }
+
+int
+onlp_file_hwmon_alarm_arm(onlp_file_hwmon_alarm_t* alarm, const char* input,
+                          int mcelsius, int hysteresis, int* fd)
+{
+    int rv;
+    int len;
+    const char* suffix = "_input";
+    char buf[16];
+
+    *fd = -1;
+
+    len = strlen(input) - strlen(suffix);
+    if(len <= 0 || strcmp(input + len, suffix)) {
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    if(mcelsius == 0) {
+        /* Restore the original limits. */
+        if(alarm->saved) {
+            if(alarm->has_hyst) {
+                onlp_file_write_int(alarm->max_hyst, "%.*s_max_hyst", len, input);
+            }
+            rv = onlp_file_write_int(alarm->max, "%.*s_max", len, input);
+            if(rv < 0) {
+                return rv;
+            }
+            alarm->saved = 0;
+        }
+        return ONLP_STATUS_OK;
+    }
+
+    if(!alarm->saved) {
+        rv = onlp_file_read_int(&alarm->max, "%.*s_max", len, input);
+        if(rv < 0) {
+            return rv;
+        }
+        /* Not all sensors support it. */
+        alarm->has_hyst =
+            (onlp_file_read_int(&alarm->max_hyst, "%.*s_max_hyst", len, input) >= 0);
+        alarm->saved = 1;
+    }
+
+    /* Lower the hysteresis first, the driver may clamp it to max. */
+    if(alarm->has_hyst) {
+        onlp_file_write_int(mcelsius - hysteresis, "%.*s_max_hyst", len, input);
+    }
+    rv = onlp_file_write_int(mcelsius, "%.*s_max", len, input);
+    if(rv < 0) {
+        return rv;
+    }
+    if(alarm->has_hyst) {
+        onlp_file_write_int(mcelsius - hysteresis, "%.*s_max_hyst", len, input);
+    }
+
+    *fd = onlp_file_open(O_RDONLY, 0, "%.*s_max_alarm", len, input);
+    if(*fd >= 0) {
+        /* sysfs_notify() is only delivered after the attribute has been read. */
+        if(read(*fd, buf, sizeof(buf)) < 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    return ONLP_STATUS_OK;
+}
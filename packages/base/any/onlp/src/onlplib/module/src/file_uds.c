@@ -25,6 +25,8 @@
 #include <onlplib/file_uds.h>
 #include "onlplib_log.h"
 
+#include <AIM/aim_time.h>
+
 #include <BigList/biglist.h>
 #include <BigList/biglist_locked.h>
 
@@ -81,13 +83,28 @@ typedef struct onlp_file_uds_service_s {
     /** service is active. */
     int active;
 
+    /**
+     * References held by the service list and by pending requests.
+     * Protected by the service manager lock.
+     */
+    int refcount;
+
+    /** Response cache lifetime. Responses are not cached if zero. */
+    uint32_t ttl_ms;
+
+    /** Cached response. */
+    pthread_mutex_t cache_lock;
+    uint8_t* cache;
+    int cache_size;
+    uint64_t cache_expires;
+
 } onlp_file_uds_service_t;
 
 /**
  * Destroy a file service.
  */
 static void
-onlp_file_uds_service_clear__(onlp_file_uds_service_t* p)
+onlp_file_uds_service_destroy__(onlp_file_uds_service_t* p)
 {
     if(p) {
         if(p->lfd > 0) {
@@ -96,14 +113,8 @@ onlp_file_uds_service_clear__(onlp_file_uds_service_t* p)
         if(p->path) {
             aim_free((char*)p->path);
         }
-        memset(p, 0, sizeof(*p));
-    }
-}
-static void
-onlp_file_uds_service_destroy__(onlp_file_uds_service_t* p)
-{
-    if(p) {
-        onlp_file_uds_service_clear__(p);
+        aim_free(p->cache);
+        pthread_mutex_destroy(&p->cache_lock);
         aim_free(p);
     }
 }
@@ -120,6 +131,8 @@ onlp_file_uds_service_create__(onlp_file_uds_service_t** rvp,
 
     onlp_file_uds_service_t* rv = aim_zmalloc(sizeof(*rv));
 
+    rv->lfd = -1;
+    pthread_mutex_init(&rv->cache_lock, NULL);
     rv->path = aim_strdup(path);
     char* cmd = aim_fstrdup("mkdir -p `dirname %s`", path);
     if(system(cmd) != 0) {
@@ -160,6 +173,15 @@ onlp_file_uds_service_create__(onlp_file_uds_service_t** rvp,
     return -1;
 }
 
+/**
+ * A pending client request.
+ */
+typedef struct onlp_file_uds_request_s {
+    onlp_file_uds_service_t* ufp;
+    int fd;
+    struct onlp_file_uds_request_s* next;
+} onlp_file_uds_request_t;
+
 /**
  * This is the control object for a UDS service group.
  */
@@ -168,22 +190,38 @@ struct onlp_file_uds_s {
     /** Thread signal. Used to wake up the service thread when required. */
     int eventfd;
 
-    /** Service worker thread */
+    /** Listening descriptors for all active services. */
+    int epollfd;
+
+    /** Service thread */
     pthread_t thread;
     volatile int running;
     volatile int terminate;
 
     /** Service client list */
     biglist_locked_t* list;
+
+    /** Protects the request queue and service reference counts. */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    /** Pending requests */
+    onlp_file_uds_request_t* head;
+    onlp_file_uds_request_t* tail;
+
+    /** Request worker threads */
+    pthread_t* workers;
+    int worker_count;
 };
 
+#define ONLP_FILE_UDS_EVENTS_MAX 64
 
 /**
  * Add a descriptor to an epoll set.
  */
 static int
 epoll_add__(int epoll_fd, int add_fd, uint32_t events, void* data,
-            int* counter, const char* name)
+            const char* name)
 {
     struct epoll_event ev = {0};
     ev.data.ptr = data;
@@ -194,144 +232,323 @@ epoll_add__(int epoll_fd, int add_fd, uint32_t events, void* data,
             return -1;
         }
     }
+    return 0;
+}
 
-    if(counter) {
-        (*counter)++;
-    }
+static void
+service_ref__(onlp_file_uds_t* control, onlp_file_uds_service_t* ufp)
+{
+    pthread_mutex_lock(&control->lock);
+    ufp->refcount++;
+    pthread_mutex_unlock(&control->lock);
+}
 
-    return 0;
+static void
+service_unref__(onlp_file_uds_t* control, onlp_file_uds_service_t* ufp)
+{
+    int refcount;
+    pthread_mutex_lock(&control->lock);
+    refcount = --ufp->refcount;
+    pthread_mutex_unlock(&control->lock);
+    if(refcount == 0) {
+        onlp_file_uds_service_destroy__(ufp);
+    }
 }
 
 /**
- * Service a connection.
+ * Write a complete response to the client.
  */
 static void
-accept__(onlp_file_uds_service_t* ufp)
+send__(int fd, const uint8_t* data, int size)
 {
-    int fd;
-
-    if((fd = accept(ufp->lfd, NULL, 0)) > 0) {
-        ufp->handler(fd, ufp->cookie);
+    while(size > 0) {
+        int rv = send(fd, data, size, MSG_NOSIGNAL);
+        if(rv < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += rv;
+        size -= rv;
     }
-    close(fd);
 }
 
 /**
- * This is the service list entry.
+ * Refresh a service's cached response.
+ *
+ * The handler writes its response to a temporary file
+ * which is then read back into the cache.
  */
+static void
+cache_fill__(onlp_file_uds_service_t* ufp)
+{
+    FILE* fp;
+    off_t size;
+
+    if((fp = tmpfile()) == NULL) {
+        AIM_LOG_ERROR("tmpfile() for %s: %{errno}", ufp->path, errno);
+        return;
+    }
+
+    aim_free(ufp->cache);
+    ufp->cache = NULL;
+    ufp->cache_size = 0;
+
+    if(ufp->handler(fileno(fp), ufp->cookie) >= 0 &&
+       (size = lseek(fileno(fp), 0, SEEK_END)) >= 0) {
+        ufp->cache = aim_zmalloc(size + 1);
+        if(pread(fileno(fp), ufp->cache, size, 0) == size) {
+            ufp->cache_size = size;
+            ufp->cache_expires = aim_time_monotonic() + ufp->ttl_ms * 1000ULL;
+        }
+        else {
+            aim_free(ufp->cache);
+            ufp->cache = NULL;
+        }
+    }
+
+    fclose(fp);
+}
 
 /**
- * The service worker thread.
- *
- * All registered services are polled for incoming connections
- * and handled in series.
+ * Service a connection from the cache.
  *
- * These are designed for simple transactions and not
- * long-lived connections.
+ * Concurrent requests for an expired entry are coalesced
+ * into a single handler call.
  */
-static void*
-uds_thread_worker__(void* p)
+static void
+cache_handle__(onlp_file_uds_service_t* ufp, int fd)
 {
-    volatile onlp_file_uds_t* control = (onlp_file_uds_t*)p;
+    uint8_t* data = NULL;
+    int size = 0;
 
-    int epollfd;
-    if((epollfd = epoll_create(256)) == -1) {
-        AIM_LOG_ERROR("epoll_create(): %{errno}", errno);
-        return NULL;
+    pthread_mutex_lock(&ufp->cache_lock);
+    if(ufp->cache == NULL || aim_time_monotonic() >= ufp->cache_expires) {
+        cache_fill__(ufp);
     }
+    if(ufp->cache) {
+        size = ufp->cache_size;
+        data = aim_zmalloc(size + 1);
+        memcpy(data, ufp->cache, size);
+    }
+    pthread_mutex_unlock(&ufp->cache_lock);
 
-    control->running = 1;
-    for(;;) {
+    if(data) {
+        send__(fd, data, size);
+        aim_free(data);
+    }
+}
 
-        biglist_t* ble;
-        onlp_file_uds_service_t* ufp;
-        int nfd = 0;
+/**
+ * Service a connection.
+ */
+static void
+handle__(onlp_file_uds_service_t* ufp, int fd)
+{
+    if(ufp->ttl_ms) {
+        cache_handle__(ufp, fd);
+    }
+    else {
+        ufp->handler(fd, ufp->cookie);
+    }
+    close(fd);
+}
 
-        if(control->terminate) {
-            /** Request for termination. */
-            break;
+/**
+ * Accept all pending connections on a service and
+ * queue them to the worker pool.
+ */
+static void
+accept__(onlp_file_uds_t* control, onlp_file_uds_service_t* ufp)
+{
+    int fd;
+
+    while((fd = accept4(ufp->lfd, NULL, NULL, SOCK_CLOEXEC)) >= 0) {
+        if(control->worker_count == 0) {
+            handle__(ufp, fd);
+            continue;
         }
 
-        /** control->eventfd wakes us up */
-        if(epoll_add__(epollfd, control->eventfd, EPOLLIN, NULL, &nfd, "eventfd") < 0) {
-            return NULL;
+        onlp_file_uds_request_t* req = aim_zmalloc(sizeof(*req));
+        req->ufp = ufp;
+        req->fd = fd;
+        service_ref__(control, ufp);
+
+        pthread_mutex_lock(&control->lock);
+        if(control->tail) {
+            control->tail->next = req;
         }
+        else {
+            control->head = req;
+        }
+        control->tail = req;
+        pthread_cond_signal(&control->cond);
+        pthread_mutex_unlock(&control->lock);
+    }
 
-        /** Add all active descriptors. */
-        biglist_lock(control->list);
-        BIGLIST_FOREACH_DATA(ble, control->list->list, onlp_file_uds_service_t*, ufp) {
-            switch(ufp->active)
-                {
-                case 1:
-                    /* Service is active. Wait on it. */
-                    epoll_add__(epollfd, ufp->lfd, EPOLLIN, ufp, &nfd, ufp->path);
-                    break;
-                case -1:
-                    /* Service deletion request. */
-                    AIM_LOG_MSG("Removing %s...", ufp->path);
-                    epoll_ctl(epollfd, EPOLL_CTL_DEL, ufp->lfd, NULL);
-                    onlp_file_uds_service_clear__(ufp);
-                    break;
-                case 0:
-                    /* Service is inactive. */
-                    break;
-                }
+    if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        AIM_LOG_ERROR("accept() for %s: %{errno}", ufp->path, errno);
+    }
+}
+
+/**
+ * Remove services for which deletion was requested.
+ *
+ * This is only called from the service thread between
+ * epoll_wait() calls so no stale events can reference
+ * the removed services. Pending requests hold their own
+ * references.
+ */
+static void
+reap__(onlp_file_uds_t* control)
+{
+    biglist_t* ble;
+    biglist_t* reaped = NULL;
+    onlp_file_uds_service_t* ufp;
+
+    biglist_lock(control->list);
+    BIGLIST_FOREACH_DATA(ble, control->list->list, onlp_file_uds_service_t*, ufp) {
+        if(ufp->active == -1) {
+            reaped = biglist_prepend(reaped, ufp);
         }
+    }
+    BIGLIST_FOREACH_DATA(ble, reaped, onlp_file_uds_service_t*, ufp) {
+        AIM_LOG_MSG("Removing %s...", ufp->path);
+        control->list->list = biglist_remove(control->list->list, ufp);
+        epoll_ctl(control->epollfd, EPOLL_CTL_DEL, ufp->lfd, NULL);
+        close(ufp->lfd);
+        ufp->lfd = -1;
+        service_unref__(control, ufp);
+    }
+    biglist_unlock(control->list);
+    biglist_free(reaped);
+}
 
-        biglist_unlock(control->list);
+/**
+ * The service thread.
+ *
+ * All registered services are in a persistent epoll set,
+ * updated only when services are added or removed. Incoming
+ * connections are accepted here and handled by the worker pool.
+ *
+ * These are designed for simple transactions and not
+ * long-lived connections.
+ */
+static void*
+uds_thread_worker__(void* p)
+{
+    onlp_file_uds_t* control = (onlp_file_uds_t*)p;
+    struct epoll_event events[ONLP_FILE_UDS_EVENTS_MAX];
+
+    while(!control->terminate) {
 
-        struct epoll_event* events = aim_zmalloc(sizeof(*events)*nfd);
-        int rv = epoll_wait(epollfd, events, nfd, -1);
+        int i;
+        int rv = epoll_wait(control->epollfd, events,
+                            ONLP_FILE_UDS_EVENTS_MAX, -1);
 
         if(rv < 0) {
             if(errno != EINTR) {
                 AIM_LOG_ERROR("epoll_wait() returned %{errno}", errno);
                 break;
             }
+            continue;
         }
-        else if(rv == 0) {
-            /** Shouldn't happen with infinite timeout */
-        }
-        else {
-            int i;
-            for(i = 0; i < rv; i++) {
-                if(events[i].events & EPOLLIN) {
-                    onlp_file_uds_service_t* ufp = (onlp_file_uds_service_t*)events[i].data.ptr;
-                    if(ufp == NULL) {
-                        eventfd_read__(control->eventfd);
-                    }
-                    else {
-                        if(ufp->active == 1) {
-                            accept__(ufp);
-                        }
-                    }
+
+        for(i = 0; i < rv; i++) {
+            if(events[i].events & EPOLLIN) {
+                onlp_file_uds_service_t* ufp = (onlp_file_uds_service_t*)events[i].data.ptr;
+                if(ufp == NULL) {
+                    /** control->eventfd wakes us up */
+                    eventfd_read__(control->eventfd);
+                }
+                else if(ufp->active == 1) {
+                    accept__(control, ufp);
                 }
             }
         }
-        aim_free(events);
+
+        reap__(control);
+    }
+    return NULL;
+}
+
+/**
+ * The request worker threads.
+ */
+static void*
+uds_request_worker__(void* p)
+{
+    onlp_file_uds_t* control = (onlp_file_uds_t*)p;
+
+    for(;;) {
+        onlp_file_uds_request_t* req;
+
+        pthread_mutex_lock(&control->lock);
+        while(control->head == NULL && !control->terminate) {
+            pthread_cond_wait(&control->cond, &control->lock);
+        }
+        if(control->terminate) {
+            pthread_mutex_unlock(&control->lock);
+            break;
+        }
+        req = control->head;
+        control->head = req->next;
+        if(control->head == NULL) {
+            control->tail = NULL;
+        }
+        pthread_mutex_unlock(&control->lock);
+
+        handle__(req->ufp, req->fd);
+        service_unref__(control, req->ufp);
+        aim_free(req);
     }
-    control->running = 0;
     return NULL;
 }
 
 int
 onlp_file_uds_create(onlp_file_uds_t** rvp)
 {
+    int i;
     onlp_file_uds_t* rv = aim_zmalloc(sizeof(*rv));
-    if((rv->eventfd = eventfd(0, 0)) == -1) {
+
+    rv->eventfd = -1;
+    rv->epollfd = -1;
+    pthread_mutex_init(&rv->lock, NULL);
+    pthread_cond_init(&rv->cond, NULL);
+
+    if((rv->eventfd = eventfd(0, EFD_CLOEXEC)) == -1) {
         AIM_LOG_ERROR("eventfd: %{errno}", errno);
         goto failed;
     }
+    if((rv->epollfd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        AIM_LOG_ERROR("epoll_create1(): %{errno}", errno);
+        goto failed;
+    }
+    if(epoll_add__(rv->epollfd, rv->eventfd, EPOLLIN, NULL, "eventfd") < 0) {
+        goto failed;
+    }
     if((rv->list = biglist_locked_create()) == NULL) {
         goto failed;
     }
 
-    rv->running = 0;
+    if(ONLPLIB_CONFIG_FILE_UDS_WORKER_COUNT > 0) {
+        rv->workers = aim_zmalloc(sizeof(*rv->workers) *
+                                  ONLPLIB_CONFIG_FILE_UDS_WORKER_COUNT);
+    }
+    for(i = 0; i < ONLPLIB_CONFIG_FILE_UDS_WORKER_COUNT; i++) {
+        if(pthread_create(rv->workers + i, NULL, uds_request_worker__, rv) != 0) {
+            AIM_LOG_ERROR("pthread_create failed: %{errno}", errno);
+            goto failed;
+        }
+        rv->worker_count++;
+    }
 
     if(pthread_create(&rv->thread, NULL, uds_thread_worker__, rv) != 0) {
         AIM_LOG_ERROR("pthread_create failed: %{errno}", errno);
         goto failed;
     }
+    rv->running = 1;
 
     *rvp = rv;
     return 0;
@@ -344,13 +561,43 @@ onlp_file_uds_create(onlp_file_uds_t** rvp)
 void
 onlp_file_uds_destroy(onlp_file_uds_t* p)
 {
+    int i;
+
     if(p) {
+        p->terminate = 1;
         if(p->running == 1) {
-            p->terminate = 1;
             eventfd_write__(p->eventfd);
             pthread_join(p->thread, NULL);
         }
-        biglist_locked_free_all(p->list, (biglist_free_f)onlp_file_uds_service_destroy__);
+
+        pthread_mutex_lock(&p->lock);
+        pthread_cond_broadcast(&p->cond);
+        pthread_mutex_unlock(&p->lock);
+        for(i = 0; i < p->worker_count; i++) {
+            pthread_join(p->workers[i], NULL);
+        }
+
+        /** Drop unhandled requests */
+        while(p->head) {
+            onlp_file_uds_request_t* req = p->head;
+            p->head = req->next;
+            close(req->fd);
+            service_unref__(p, req->ufp);
+            aim_free(req);
+        }
+
+        if(p->list) {
+            biglist_locked_free_all(p->list, (biglist_free_f)onlp_file_uds_service_destroy__);
+        }
+        if(p->epollfd >= 0) {
+            close(p->epollfd);
+        }
+        if(p->eventfd >= 0) {
+            close(p->eventfd);
+        }
+        pthread_cond_destroy(&p->cond);
+        pthread_mutex_destroy(&p->lock);
+        aim_free(p->workers);
         aim_free(p);
     }
 }
@@ -361,7 +608,7 @@ find_uds_locked__(biglist_t* list, const char* path)
     biglist_t* ble;
     onlp_file_uds_service_t* ufp;
     BIGLIST_FOREACH_DATA(ble, list, onlp_file_uds_service_t*, ufp) {
-        if(ufp->path) {
+        if(ufp->path && ufp->active != -1) {
             if(!strcmp(path, ufp->path)) {
                 return ufp;
             }
@@ -373,6 +620,14 @@ find_uds_locked__(biglist_t* list, const char* path)
 int
 onlp_file_uds_add(onlp_file_uds_t* fuds, const char* path,
                   onlp_file_uds_handler_t handler, void* cookie)
+{
+    return onlp_file_uds_add_cached(fuds, path, handler, cookie, 0);
+}
+
+int
+onlp_file_uds_add_cached(onlp_file_uds_t* fuds, const char* path,
+                         onlp_file_uds_handler_t handler, void* cookie,
+                         uint32_t ttl_ms)
 {
     int rv = 0;
     biglist_lock(fuds->list);
@@ -383,12 +638,22 @@ onlp_file_uds_add(onlp_file_uds_t* fuds, const char* path,
     else {
         onlp_file_uds_service_t* ufp;
         if(onlp_file_uds_service_create__(&ufp, path, handler, cookie) >= 0) {
+            ufp->ttl_ms = ttl_ms;
+            ufp->refcount = 1;
             ufp->active = 1;
-            fuds->list->list = biglist_append(fuds->list->list, ufp);
+            if(epoll_add__(fuds->epollfd, ufp->lfd, EPOLLIN, ufp, ufp->path) < 0) {
+                onlp_file_uds_service_destroy__(ufp);
+                rv = -1;
+            }
+            else {
+                fuds->list->list = biglist_append(fuds->list->list, ufp);
+            }
+        }
+        else {
+            rv = -1;
         }
     }
     biglist_unlock(fuds->list);
-    eventfd_write__(fuds->eventfd);
     return rv;
 }
 
@@ -402,4 +667,5 @@ onlp_file_uds_remove(onlp_file_uds_t* fuds, const char* path)
         ufp->active = -1;
     }
     biglist_unlock(fuds->list);
+    eventfd_write__(fuds->eventfd);
 }
@@ -33,6 +33,10 @@
 #include <sys/types.h>
 #include <sys/ioctl.h>
 #include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <AIM/aim_time.h>
 #include <onlp/onlp.h>
 #include "onlplib_log.h"
 
@@ -84,11 +88,421 @@ onlp_i2c_open(int bus, uint8_t addr, uint32_t flags)
     return ONLP_STATUS_E_I2C;
 }
 
+/**************************************************************************//**
+ *
+ * Device Health
+ *
+ *****************************************************************************/
+
+static onlp_i2c_recovery_t recovery__;
+static int recovery_valid__ = 0;
+
+void
+onlp_i2c_recovery_register(onlp_i2c_recovery_t* recovery)
+{
+    if(recovery) {
+        recovery__ = *recovery;
+        recovery_valid__ = 1;
+    }
+    else {
+        recovery_valid__ = 0;
+    }
+}
+
+/**
+ * Sleep before the given read retry. The first attempt is not delayed.
+ */
+static void
+retry_delay__(int attempt)
+{
+    if(attempt > 0 && ONLPLIB_CONFIG_I2C_RETRY_DELAY_US > 0) {
+        uint32_t us = ONLPLIB_CONFIG_I2C_RETRY_DELAY_US;
+        while(--attempt > 0 && us < ONLPLIB_CONFIG_I2C_RETRY_DELAY_MAX_US) {
+            us <<= 1;
+        }
+        usleep((us < ONLPLIB_CONFIG_I2C_RETRY_DELAY_MAX_US) ?
+               us : ONLPLIB_CONFIG_I2C_RETRY_DELAY_MAX_US);
+    }
+}
+
+#if ONLPLIB_CONFIG_INCLUDE_I2C_HEALTH == 1
+
+typedef struct health_entry_s {
+    int valid;
+    uint64_t until;
+    onlp_i2c_health_t h;
+} health_entry_t;
+
+static health_entry_t health__[ONLPLIB_CONFIG_I2C_HEALTH_TABLE_SIZE];
+static pthread_mutex_t health_lock__ = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Set while the recovery handlers run so their own operations
+ * cannot recurse into recovery.
+ */
+static __thread int in_recovery__ = 0;
+
+/**
+ * ONLPLIB_CONFIG_I2C_HEALTH_ENV, or -1 if it is not set.
+ */
+static int health_env__ = -1;
+static pthread_once_t health_env_once__ = PTHREAD_ONCE_INIT;
+
+static void
+health_env_init__(void)
+{
+    char* s = getenv(ONLPLIB_CONFIG_I2C_HEALTH_ENV);
+    if(s && *s) {
+        health_env__ = (atoi(s) != 0);
+    }
+}
+
+/**
+ * Returns non-zero if the health of the operation is tracked.
+ * Tracking is enabled by registering the recovery handlers unless
+ * the environment says otherwise.
+ */
+static int
+health_enabled__(uint32_t flags)
+{
+    if(flags & ONLP_I2C_F_NO_HEALTH) {
+        return 0;
+    }
+    pthread_once(&health_env_once__, health_env_init__);
+    return (health_env__ >= 0) ? health_env__ : recovery_valid__;
+}
+
+/**
+ * Find (or create) the entry for a device. Called with the lock held.
+ * Returns NULL if the device is not (and cannot be) tracked.
+ */
+static health_entry_t*
+health_find__(int bus, uint8_t addr, int create)
+{
+    int i;
+    uint32_t slot = ((uint32_t)bus * 131 + addr) % ONLPLIB_CONFIG_I2C_HEALTH_TABLE_SIZE;
+
+    for(i = 0; i < ONLPLIB_CONFIG_I2C_HEALTH_TABLE_SIZE; i++) {
+        health_entry_t* e = health__ + slot;
+        if(!e->valid) {
+            if(!create) {
+                return NULL;
+            }
+            memset(e, 0, sizeof(*e));
+            e->valid = 1;
+            e->h.bus = bus;
+            e->h.addr = addr;
+            e->h.score = 100;
+            return e;
+        }
+        if(e->h.bus == bus && e->h.addr == addr) {
+            return e;
+        }
+        slot = (slot + 1) % ONLPLIB_CONFIG_I2C_HEALTH_TABLE_SIZE;
+    }
+    return NULL;
+}
+
+static void
+health_snapshot__(health_entry_t* e, onlp_i2c_health_t* h, uint64_t now)
+{
+    *h = e->h;
+    h->backoff_ms = (e->until > now) ? (e->until - now) / 1000 : 0;
+}
+
+/**
+ * Called before an operation. Returns the number of read attempts
+ * the operation may make, or ONLP_STATUS_E_I2C if the device is
+ * backing off.
+ */
+static int
+health_begin__(int bus, uint8_t addr, uint32_t flags)
+{
+    int attempts = (flags & ONLP_I2C_F_DISABLE_READ_RETRIES) ?
+        1 : ONLPLIB_CONFIG_I2C_READ_RETRY_COUNT;
+
+    if(!health_enabled__(flags)) {
+        return attempts;
+    }
+
+    pthread_mutex_lock(&health_lock__);
+    health_entry_t* e = health_find__(bus, addr, 1);
+    if(e) {
+        if(e->until && aim_time_monotonic() < e->until) {
+            e->h.skipped++;
+            attempts = ONLP_STATUS_E_I2C;
+        }
+        else {
+            e->h.operations++;
+            if(e->h.consecutive) {
+                /* Probe a failing device instead of spending the full budget. */
+                attempts = 1;
+            }
+        }
+    }
+    pthread_mutex_unlock(&health_lock__);
+    return attempts;
+}
+
+/**
+ * Record the number of retries spent by an operation.
+ */
+static void
+health_retries__(int bus, uint8_t addr, uint32_t flags, int retries)
+{
+    if(retries <= 0 || !health_enabled__(flags)) {
+        return;
+    }
+    pthread_mutex_lock(&health_lock__);
+    health_entry_t* e = health_find__(bus, addr, 0);
+    if(e) {
+        e->h.retries += retries;
+    }
+    pthread_mutex_unlock(&health_lock__);
+}
+
+/**
+ * Called when an operation has failed. Runs the next recovery handler
+ * for the device. Returns 1 if the operation should be attempted again.
+ */
+static int
+health_recover__(int bus, uint8_t addr, uint32_t flags)
+{
+    int rv = -1;
+    uint32_t consecutive;
+    onlp_i2c_recovery_t r;
+
+    if(!recovery_valid__ || in_recovery__ || !health_enabled__(flags)) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&health_lock__);
+    health_entry_t* e = health_find__(bus, addr, 0);
+    consecutive = (e) ? e->h.consecutive : 0;
+    if(e && consecutive < 2) {
+        e->h.recoveries++;
+    }
+    r = recovery__;
+    pthread_mutex_unlock(&health_lock__);
+
+    if(e == NULL) {
+        return 0;
+    }
+
+    in_recovery__ = 1;
+    if(consecutive == 0 && r.mux_reset) {
+        AIM_LOG_VERBOSE("i2c-%d: resetting the muxes for device 0x%x", bus, addr);
+        rv = r.mux_reset(bus, addr, r.cookie);
+    }
+    else if(consecutive == 1 && r.bus_recover) {
+        AIM_LOG_VERBOSE("i2c-%d: recovering the bus for device 0x%x", bus, addr);
+        rv = r.bus_recover(bus, r.cookie);
+    }
+    in_recovery__ = 0;
+
+    return (rv >= 0) ? 1 : 0;
+}
+
+/**
+ * Called after an operation with its result.
+ */
+static void
+health_end__(int bus, uint8_t addr, uint32_t flags, int rv)
+{
+    if(!health_enabled__(flags)) {
+        return;
+    }
+
+    pthread_mutex_lock(&health_lock__);
+    health_entry_t* e = health_find__(bus, addr, 0);
+    if(e == NULL) {
+        pthread_mutex_unlock(&health_lock__);
+        return;
+    }
+
+    if(rv >= 0) {
+        if(e->h.quarantined) {
+            AIM_LOG_INFO("i2c-%d: device 0x%x has recovered.", bus, addr);
+        }
+        e->h.consecutive = 0;
+        e->h.quarantined = 0;
+        e->until = 0;
+        e->h.score = (e->h.score * 7 + 100 + 7) / 8;
+    }
+    else {
+        uint64_t ms = ONLPLIB_CONFIG_I2C_BACKOFF_MS;
+        e->h.failures++;
+        e->h.consecutive++;
+        e->h.score = (e->h.score * 7) / 8;
+
+        if(e->h.consecutive >= ONLPLIB_CONFIG_I2C_QUARANTINE_THRESHOLD) {
+            if(!e->h.quarantined) {
+                AIM_LOG_WARN("i2c-%d: device 0x%x quarantined after %d consecutive failures.",
+                             bus, addr, e->h.consecutive);
+            }
+            e->h.quarantined = 1;
+            ms = ONLPLIB_CONFIG_I2C_BACKOFF_MAX_MS;
+        }
+        else {
+            ms <<= (e->h.consecutive - 1);
+        }
+        if(ms > ONLPLIB_CONFIG_I2C_BACKOFF_MAX_MS) {
+            ms = ONLPLIB_CONFIG_I2C_BACKOFF_MAX_MS;
+        }
+        e->until = (ms) ? aim_time_monotonic() + ms * 1000 : 0;
+    }
+    pthread_mutex_unlock(&health_lock__);
+}
+
 int
-onlp_i2c_block_read(int bus, uint8_t addr, uint8_t offset, int size,
-                    uint8_t* rdata, uint32_t flags)
+onlp_i2c_health_get(int bus, uint8_t addr, onlp_i2c_health_t* health)
+{
+    int rv = ONLP_STATUS_E_MISSING;
+
+    pthread_mutex_lock(&health_lock__);
+    health_entry_t* e = health_find__(bus, addr, 0);
+    if(e) {
+        health_snapshot__(e, health, aim_time_monotonic());
+        rv = 0;
+    }
+    pthread_mutex_unlock(&health_lock__);
+    return rv;
+}
+
+int
+onlp_i2c_health_iterate(int (*cb)(onlp_i2c_health_t* health, void* cookie),
+                        void* cookie)
+{
+    int i, rv = 0;
+    uint64_t now = aim_time_monotonic();
+
+    for(i = 0; i < ONLPLIB_CONFIG_I2C_HEALTH_TABLE_SIZE && rv >= 0; i++) {
+        onlp_i2c_health_t h;
+        int valid;
+
+        /* The callback runs unlocked so it may perform i2c operations. */
+        pthread_mutex_lock(&health_lock__);
+        if((valid = health__[i].valid)) {
+            health_snapshot__(health__ + i, &h, now);
+        }
+        pthread_mutex_unlock(&health_lock__);
+
+        if(valid) {
+            rv = cb(&h, cookie);
+        }
+    }
+    return rv;
+}
+
+void
+onlp_i2c_health_clear(int bus, int addr)
+{
+    int i;
+
+    pthread_mutex_lock(&health_lock__);
+    if(bus < 0) {
+        memset(health__, 0, sizeof(health__));
+    }
+    else {
+        for(i = 0; i < ONLPLIB_CONFIG_I2C_HEALTH_TABLE_SIZE; i++) {
+            health_entry_t* e = health__ + i;
+            if(e->valid && e->h.bus == bus && (addr < 0 || e->h.addr == addr)) {
+                /* Keep the entry so the probe chain stays intact. */
+                uint8_t a = e->h.addr;
+                memset(&e->h, 0, sizeof(e->h));
+                e->until = 0;
+                e->h.bus = bus;
+                e->h.addr = a;
+                e->h.score = 100;
+            }
+        }
+    }
+    pthread_mutex_unlock(&health_lock__);
+}
+
+#else
+
+static int
+health_begin__(int bus, uint8_t addr, uint32_t flags)
+{
+    return (flags & ONLP_I2C_F_DISABLE_READ_RETRIES) ?
+        1 : ONLPLIB_CONFIG_I2C_READ_RETRY_COUNT;
+}
+
+#define health_retries__(_bus, _addr, _flags, _retries)
+#define health_recover__(_bus, _addr, _flags) 0
+#define health_end__(_bus, _addr, _flags, _rv)
+
+int
+onlp_i2c_health_get(int bus, uint8_t addr, onlp_i2c_health_t* health)
+{
+    return ONLP_STATUS_E_MISSING;
+}
+
+int
+onlp_i2c_health_iterate(int (*cb)(onlp_i2c_health_t* health, void* cookie),
+                        void* cookie)
+{
+    return 0;
+}
+
+void
+onlp_i2c_health_clear(int bus, int addr)
+{
+}
+
+#endif /* ONLPLIB_CONFIG_INCLUDE_I2C_HEALTH */
+
+typedef struct health_show_s {
+    aim_pvs_t* pvs;
+    int count;
+} health_show_t;
+
+static int
+health_show__(onlp_i2c_health_t* h, void* cookie)
+{
+    health_show_t* hs = (health_show_t*)cookie;
+
+    if(h->failures == 0 && h->skipped == 0) {
+        return 0;
+    }
+    if(hs->count++ == 0) {
+        aim_printf(hs->pvs, "Bus  Addr  Operations  Failures  Retries   Skipped   Recoveries  Consecutive  Backoff(ms)  Score  State\n");
+        aim_printf(hs->pvs, "---  ----  ----------  --------  --------  --------  ----------  -----------  -----------  -----  -----------\n");
+    }
+    aim_printf(hs->pvs, "%3d  0x%.2x  %10u  %8u  %8u  %8u  %10u  %11u  %11u  %5d  %s\n",
+               h->bus, h->addr, h->operations, h->failures, h->retries,
+               h->skipped, h->recoveries, h->consecutive, h->backoff_ms,
+               h->score,
+               (h->quarantined) ? "QUARANTINED" : (h->backoff_ms) ? "BACKOFF" : "OK");
+    return 0;
+}
+
+void
+onlp_i2c_health_show(aim_pvs_t* pvs)
+{
+    health_show_t hs = { pvs, 0 };
+    onlp_i2c_health_iterate(health_show__, &hs);
+    if(hs.count == 0) {
+        aim_printf(pvs, "No i2c device failures.\n");
+    }
+}
+
+/**************************************************************************//**
+ *
+ * Operations
+ *
+ * Each operation is wrapped by the health tracking. The read
+ * operations make up to 'attempts' attempts per transaction.
+ *
+ *****************************************************************************/
+
+static int
+block_read__(int bus, uint8_t addr, uint8_t offset, int size,
+             uint8_t* rdata, uint32_t flags, int attempts)
 {
     int fd;
+    int retries = 0;
 
     fd = onlp_i2c_open(bus, addr, flags);
 
@@ -100,10 +514,11 @@ onlp_i2c_block_read(int bus, uint8_t addr, uint8_t offset, int size,
     uint8_t* p = rdata;
     while(count > 0) {
         int rsize = (count >= ONLPLIB_CONFIG_I2C_BLOCK_SIZE) ? ONLPLIB_CONFIG_I2C_BLOCK_SIZE : count;
-        int retries = (flags & ONLP_I2C_F_DISABLE_READ_RETRIES) ? 1 : ONLPLIB_CONFIG_I2C_READ_RETRY_COUNT;
+        int attempt;
 
         int rv = -1;
-        while(retries-- && rv < 0) {
+        for(attempt = 0; attempt < attempts && rv < 0; attempt++) {
+            retry_delay__(attempt);
             if(flags & ONLP_I2C_F_USE_SMBUS_BLOCK_READ) {
                 rv = i2c_smbus_read_block_data(fd, offset, p);
             } else {
@@ -116,6 +531,7 @@ onlp_i2c_block_read(int bus, uint8_t addr, uint8_t offset, int size,
                 offset += rsize;
             }
         }
+        retries += attempt - 1;
 
         if(rv != rsize) {
             AIM_LOG_ERROR("i2c-%d: reading address 0x%x, offset %d, size=%d failed: %{errno}",
@@ -127,20 +543,40 @@ onlp_i2c_block_read(int bus, uint8_t addr, uint8_t offset, int size,
         count -= rsize;
     }
 
+    health_retries__(bus, addr, flags, retries);
     close(fd);
     return 0;
 
  error:
+    health_retries__(bus, addr, flags, retries);
     close(fd);
     return ONLP_STATUS_E_I2C;
 }
 
 int
-onlp_i2c_read(int bus, uint8_t addr, uint8_t offset, int size,
-              uint8_t* rdata, uint32_t flags)
+onlp_i2c_block_read(int bus, uint8_t addr, uint8_t offset, int size,
+                    uint8_t* rdata, uint32_t flags)
+{
+    int rv, attempts;
+
+    if((attempts = health_begin__(bus, addr, flags)) < 0) {
+        return attempts;
+    }
+    rv = block_read__(bus, addr, offset, size, rdata, flags, attempts);
+    if(rv < 0 && health_recover__(bus, addr, flags)) {
+        rv = block_read__(bus, addr, offset, size, rdata, flags, 1);
+    }
+    health_end__(bus, addr, flags, rv);
+    return rv;
+}
+
+static int
+read__(int bus, uint8_t addr, uint8_t offset, int size,
+       uint8_t* rdata, uint32_t flags, int attempts)
 {
     int i;
     int fd;
+    int retries = 0;
 
     fd = onlp_i2c_open(bus, addr, flags);
 
@@ -150,11 +586,13 @@ onlp_i2c_read(int bus, uint8_t addr, uint8_t offset, int size,
 
     for(i = 0; i < size; i++) {
         int rv = -1;
-        int retries = (flags & ONLP_I2C_F_DISABLE_READ_RETRIES) ? 1: ONLPLIB_CONFIG_I2C_READ_RETRY_COUNT;
+        int attempt;
 
-        while(retries-- && rv < 0) {
+        for(attempt = 0; attempt < attempts && rv < 0; attempt++) {
+            retry_delay__(attempt);
             rv = i2c_smbus_read_byte_data(fd, offset+i);
         }
+        retries += attempt - 1;
 
         if(rv < 0) {
             AIM_LOG_ERROR("i2c-%d: reading address 0x%x, offset %d failed: %{errno}",
@@ -165,18 +603,37 @@ onlp_i2c_read(int bus, uint8_t addr, uint8_t offset, int size,
             rdata[i] = rv;
         }
     }
+    health_retries__(bus, addr, flags, retries);
     close(fd);
     return 0;
 
  error:
+    health_retries__(bus, addr, flags, retries);
     close(fd);
     return ONLP_STATUS_E_I2C;
 }
 
-
 int
-onlp_i2c_write(int bus, uint8_t addr, uint8_t offset, int size,
-               uint8_t* data, uint32_t flags)
+onlp_i2c_read(int bus, uint8_t addr, uint8_t offset, int size,
+              uint8_t* rdata, uint32_t flags)
+{
+    int rv, attempts;
+
+    if((attempts = health_begin__(bus, addr, flags)) < 0) {
+        return attempts;
+    }
+    rv = read__(bus, addr, offset, size, rdata, flags, attempts);
+    if(rv < 0 && health_recover__(bus, addr, flags)) {
+        rv = read__(bus, addr, offset, size, rdata, flags, 1);
+    }
+    health_end__(bus, addr, flags, rv);
+    return rv;
+}
+
+
+static int
+write__(int bus, uint8_t addr, uint8_t offset, int size,
+        uint8_t* data, uint32_t flags)
 {
     int i;
     int fd;
@@ -203,6 +660,24 @@ onlp_i2c_write(int bus, uint8_t addr, uint8_t offset, int size,
     return ONLP_STATUS_E_I2C;
 }
 
+int
+onlp_i2c_write(int bus, uint8_t addr, uint8_t offset, int size,
+               uint8_t* data, uint32_t flags)
+{
+    int rv;
+
+    /* Writes are not retried, but a recovered device gets one more attempt. */
+    if((rv = health_begin__(bus, addr, flags)) < 0) {
+        return rv;
+    }
+    rv = write__(bus, addr, offset, size, data, flags);
+    if(rv < 0 && health_recover__(bus, addr, flags)) {
+        rv = write__(bus, addr, offset, size, data, flags);
+    }
+    health_end__(bus, addr, flags, rv);
+    return rv;
+}
+
 int
 onlp_i2c_readb(int bus, uint8_t addr, uint8_t offset, uint32_t flags)
 {
@@ -230,8 +705,8 @@ onlp_i2c_modifyb(int bus, uint8_t addr, uint8_t offset,
 }
 
 
-int
-onlp_i2c_readw(int bus, uint8_t addr, uint8_t offset, uint32_t flags)
+static int
+readw__(int bus, uint8_t addr, uint8_t offset, uint32_t flags)
 {
     int fd;
     int rv;
@@ -249,8 +724,24 @@ onlp_i2c_readw(int bus, uint8_t addr, uint8_t offset, uint32_t flags)
 }
 
 int
-onlp_i2c_writew(int bus, uint8_t addr, uint8_t offset, uint16_t word,
-                    uint32_t flags)
+onlp_i2c_readw(int bus, uint8_t addr, uint8_t offset, uint32_t flags)
+{
+    int rv;
+
+    if((rv = health_begin__(bus, addr, flags)) < 0) {
+        return rv;
+    }
+    rv = readw__(bus, addr, offset, flags);
+    if(rv < 0 && health_recover__(bus, addr, flags)) {
+        rv = readw__(bus, addr, offset, flags);
+    }
+    health_end__(bus, addr, flags, rv);
+    return rv;
+}
+
+static int
+writew__(int bus, uint8_t addr, uint8_t offset, uint16_t word,
+         uint32_t flags)
 {
     int fd;
     int rv;
@@ -268,6 +759,23 @@ onlp_i2c_writew(int bus, uint8_t addr, uint8_t offset, uint16_t word,
 
 }
 
+int
+onlp_i2c_writew(int bus, uint8_t addr, uint8_t offset, uint16_t word,
+                    uint32_t flags)
+{
+    int rv;
+
+    if((rv = health_begin__(bus, addr, flags)) < 0) {
+        return rv;
+    }
+    rv = writew__(bus, addr, offset, word, flags);
+    if(rv < 0 && health_recover__(bus, addr, flags)) {
+        rv = writew__(bus, addr, offset, word, flags);
+    }
+    health_end__(bus, addr, flags, rv);
+    return rv;
+}
+
 int
 onlp_i2c_mux_select(onlp_i2c_mux_device_t* dev, int channel)
 {
@@ -31,13 +31,17 @@
 #include <stdio.h>
 #include <errno.h>
 
-void*
-onlp_mmap(off_t pa, uint32_t size, const char* name)
+static int
+mmap_size__(uint32_t size)
 {
-    int msize = 0;
     int psize = getpagesize();
+    return (((size / psize) + 1) * psize);
+}
 
-    msize = (((size / psize) + 1) * psize);
+void*
+onlp_mmap(off_t pa, uint32_t size, const char* name)
+{
+    int msize = mmap_size__(size);
 
     int fd = open("/dev/mem", O_RDWR | O_SYNC);
 
@@ -63,3 +67,12 @@ onlp_mmap(off_t pa, uint32_t size, const char* name)
     return memory;
 }
 
+int
+onlp_munmap(void* va, uint32_t size)
+{
+    if(va && munmap(va, mmap_size__(size)) < 0) {
+        AIM_LOG_ERROR("munmap() va=%p size=%d failed: %{errno}", va, size, errno);
+        return -1;
+    }
+    return 0;
+}
@@ -317,6 +317,153 @@ checksum_validate__(const uint8_t *data)
     return 0;
 }
 
+/**
+ * Append a TLV. Returns the new offset or -1 if it does not fit.
+ */
+static int
+encode_tlv__(uint8_t* data, int size, int offset,
+             uint8_t type, const void* value, int length)
+{
+    if(length > 255 || offset + sizeof(tlvinfo_tlv_t) + length > size ||
+       offset + sizeof(tlvinfo_tlv_t) + length > TLV_INFO_MAX_LEN) {
+        AIM_LOG_ERROR("ONIE TLV 0x%.2x (%d bytes) does not fit.", type, length);
+        return -1;
+    }
+    data[offset++] = type;
+    data[offset++] = length;
+    memcpy(data + offset, value, length);
+    return offset + length;
+}
+
+int
+onlp_onie_encode(onlp_onie_info_t* info, uint8_t* data, int size)
+{
+    tlvinfo_header_t* data_hdr = (tlvinfo_header_t *) data;
+    int offset = sizeof(tlvinfo_header_t);
+    uint32_t crc;
+    uint8_t v[4];
+    list_links_t* cur;
+
+    if(info == NULL || data == NULL || size < sizeof(tlvinfo_header_t)) {
+        return -1;
+    }
+
+#define ENCODE__(_type, _value, _length)                                \
+    do {                                                                \
+        offset = encode_tlv__(data, size, offset, _type, _value, _length); \
+        if(offset < 0) {                                                \
+            return -1;                                                  \
+        }                                                               \
+    } while(0)
+
+#define ONIE_TLV_ENTRY_str(_member, _code)                              \
+    do {                                                                \
+        if(info->_member) {                                             \
+            ENCODE__(_code, info->_member, strlen(info->_member));      \
+        }                                                               \
+    } while(0)
+
+#define ONIE_TLV_ENTRY_mac(_member, _code)                              \
+    do {                                                                \
+        static const uint8_t zero__[6];                                 \
+        if(memcmp(info->_member, zero__, 6)) {                          \
+            ENCODE__(_code, info->_member, 6);                          \
+        }                                                               \
+    } while(0)
+
+#define ONIE_TLV_ENTRY_byte(_member, _code)                             \
+    do {                                                                \
+        if(info->_member) {                                             \
+            ENCODE__(_code, &info->_member, 1);                         \
+        }                                                               \
+    } while(0)
+
+#define ONIE_TLV_ENTRY_int16(_member, _code)                            \
+    do {                                                                \
+        if(info->_member) {                                             \
+            v[0] = info->_member >> 8;                                  \
+            v[1] = info->_member & 0xFF;                                \
+            ENCODE__(_code, v, 2);                                      \
+        }                                                               \
+    } while(0)
+
+#define ONIE_TLV_ENTRY(_member, _name, _code, _type)    \
+    ONIE_TLV_ENTRY_##_type(_member, _code);
+
+    #include <onlplib/onlplib.x>
+
+#undef ONIE_TLV_ENTRY_str
+#undef ONIE_TLV_ENTRY_mac
+#undef ONIE_TLV_ENTRY_byte
+#undef ONIE_TLV_ENTRY_int16
+
+    LIST_FOREACH(&info->vx_list, cur) {
+        onlp_onie_vx_t* vx = container_of(cur, links, onlp_onie_vx_t);
+        ENCODE__(TLV_CODE_VENDOR_EXT, vx->data, vx->size);
+    }
+#undef ENCODE__
+
+    /* The CRC covers everything up to and including the CRC TLV header. */
+    if(offset + sizeof(tlvinfo_tlv_t) + 4 > size ||
+       offset + sizeof(tlvinfo_tlv_t) + 4 > TLV_INFO_MAX_LEN) {
+        AIM_LOG_ERROR("ONIE CRC TLV does not fit.");
+        return -1;
+    }
+    memcpy(data_hdr->signature, TLV_INFO_ID_STRING, sizeof(data_hdr->signature));
+    data_hdr->version = TLV_INFO_VERSION;
+    data_hdr->totallen = htons(offset + sizeof(tlvinfo_tlv_t) + 4 -
+                               sizeof(tlvinfo_header_t));
+    data[offset++] = TLV_CODE_CRC_32;
+    data[offset++] = 4;
+    crc = onlp_crc32(0, data, offset);
+    data[offset++] = crc >> 24;
+    data[offset++] = crc >> 16;
+    data[offset++] = crc >> 8;
+    data[offset++] = crc;
+    return offset;
+}
+
+int
+onlp_onie_info_copy(onlp_onie_info_t* dst, const onlp_onie_info_t* src)
+{
+    list_links_t* cur;
+
+    if(dst == NULL || src == NULL) {
+        return -1;
+    }
+
+    *dst = *src;
+    list_init(&dst->vx_list);
+
+#define COPY_STRING__(_member)                          \
+    do {                                                \
+        if(src->_member) {                              \
+            dst->_member = aim_strdup(src->_member);    \
+        }                                               \
+    } while(0)
+
+    COPY_STRING__(product_name);
+    COPY_STRING__(part_number);
+    COPY_STRING__(serial_number);
+    COPY_STRING__(manufacture_date);
+    COPY_STRING__(label_revision);
+    COPY_STRING__(platform_name);
+    COPY_STRING__(onie_version);
+    COPY_STRING__(manufacturer);
+    COPY_STRING__(country_code);
+    COPY_STRING__(vendor);
+    COPY_STRING__(diag_version);
+    COPY_STRING__(service_tag);
+    COPY_STRING__(_hdr_id_string);
+
+    LIST_FOREACH(&src->vx_list, cur) {
+        onlp_onie_vx_t* vx = aim_zmalloc(sizeof(*vx));
+        memcpy(vx, container_of(cur, links, onlp_onie_vx_t), sizeof(*vx));
+        list_push(&dst->vx_list, &vx->links);
+    }
+    return 0;
+}
+
 void
 onlp_onie_info_free(onlp_onie_info_t* info)
 {
@@ -80,6 +80,46 @@ onlplib_config_settings_t onlplib_config_settings[] =
 #else
 { ONLPLIB_CONFIG_I2C_READ_RETRY_COUNT(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
 #endif
+#ifdef ONLPLIB_CONFIG_I2C_RETRY_DELAY_US
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_I2C_RETRY_DELAY_US), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_I2C_RETRY_DELAY_US) },
+#else
+{ ONLPLIB_CONFIG_I2C_RETRY_DELAY_US(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_I2C_RETRY_DELAY_MAX_US
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_I2C_RETRY_DELAY_MAX_US), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_I2C_RETRY_DELAY_MAX_US) },
+#else
+{ ONLPLIB_CONFIG_I2C_RETRY_DELAY_MAX_US(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_INCLUDE_I2C_HEALTH
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_INCLUDE_I2C_HEALTH), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_INCLUDE_I2C_HEALTH) },
+#else
+{ ONLPLIB_CONFIG_INCLUDE_I2C_HEALTH(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_I2C_HEALTH_ENV
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_I2C_HEALTH_ENV), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_I2C_HEALTH_ENV) },
+#else
+{ ONLPLIB_CONFIG_I2C_HEALTH_ENV(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_I2C_HEALTH_TABLE_SIZE
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_I2C_HEALTH_TABLE_SIZE), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_I2C_HEALTH_TABLE_SIZE) },
+#else
+{ ONLPLIB_CONFIG_I2C_HEALTH_TABLE_SIZE(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_I2C_BACKOFF_MS
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_I2C_BACKOFF_MS), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_I2C_BACKOFF_MS) },
+#else
+{ ONLPLIB_CONFIG_I2C_BACKOFF_MS(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_I2C_BACKOFF_MAX_MS
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_I2C_BACKOFF_MAX_MS), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_I2C_BACKOFF_MAX_MS) },
+#else
+{ ONLPLIB_CONFIG_I2C_BACKOFF_MAX_MS(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_I2C_QUARANTINE_THRESHOLD
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_I2C_QUARANTINE_THRESHOLD), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_I2C_QUARANTINE_THRESHOLD) },
+#else
+{ ONLPLIB_CONFIG_I2C_QUARANTINE_THRESHOLD(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
 #ifdef ONLPLIB_CONFIG_I2C_USE_CUSTOM_HEADER
     { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_I2C_USE_CUSTOM_HEADER), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_I2C_USE_CUSTOM_HEADER) },
 #else
@@ -89,6 +129,41 @@ onlplib_config_settings_t onlplib_config_settings[] =
     { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_INCLUDE_I2C_SMBUS), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_INCLUDE_I2C_SMBUS) },
 #else
 { ONLPLIB_CONFIG_INCLUDE_I2C_SMBUS(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_REGMAP_SNAPSHOT_SIZE
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_REGMAP_SNAPSHOT_SIZE), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_REGMAP_SNAPSHOT_SIZE) },
+#else
+{ ONLPLIB_CONFIG_REGMAP_SNAPSHOT_SIZE(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_FILE_UDS_WORKER_COUNT
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_FILE_UDS_WORKER_COUNT), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_FILE_UDS_WORKER_COUNT) },
+#else
+{ ONLPLIB_CONFIG_FILE_UDS_WORKER_COUNT(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_BMC_CONSOLE_DEVICE_ENV
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_BMC_CONSOLE_DEVICE_ENV), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_BMC_CONSOLE_DEVICE_ENV) },
+#else
+{ ONLPLIB_CONFIG_BMC_CONSOLE_DEVICE_ENV(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_BMC_CONSOLE_TIMEOUT_MS
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_BMC_CONSOLE_TIMEOUT_MS), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_BMC_CONSOLE_TIMEOUT_MS) },
+#else
+{ ONLPLIB_CONFIG_BMC_CONSOLE_TIMEOUT_MS(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_BMC_CONSOLE_BUFFER_SIZE
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_BMC_CONSOLE_BUFFER_SIZE), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_BMC_CONSOLE_BUFFER_SIZE) },
+#else
+{ ONLPLIB_CONFIG_BMC_CONSOLE_BUFFER_SIZE(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_SIZE
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_SIZE), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_SIZE) },
+#else
+{ ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_SIZE(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_TTL_MS
+    { __onlplib_config_STRINGIFY_NAME(ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_TTL_MS), __onlplib_config_STRINGIFY_VALUE(ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_TTL_MS) },
+#else
+{ ONLPLIB_CONFIG_BMC_CONSOLE_CACHE_TTL_MS(__onlplib_config_STRINGIFY_NAME), "__undefined__" },
 #endif
     { NULL, NULL }
 };
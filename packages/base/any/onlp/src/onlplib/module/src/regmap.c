@@ -0,0 +1,337 @@
+/************************************************************
+ * <bsn.cl v=2014 v=onl>
+ *
+ *           Copyright 2015 Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+#include <onlplib/regmap.h>
+#include <onlplib/mmap.h>
+#include <onlplib/i2c.h>
+#include <onlplib/file.h>
+#include <onlp/onlp.h>
+#include "onlplib_log.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
+static int
+range_check__(onlp_regmap_t* map, uint16_t reg, int count)
+{
+    if(count <= 0 || reg + count > (int)map->size) {
+        AIM_LOG_ERROR("regmap %s: register range 0x%x-0x%x is out of bounds (size=0x%x)",
+                      map->name, reg, reg + count - 1, map->size);
+        return ONLP_STATUS_E_PARAM;
+    }
+    return 0;
+}
+
+static int
+sysfs_is_text__(onlp_regmap_t* map)
+{
+    return strchr(map->path, '%') != NULL;
+}
+
+int
+onlp_regmap_open(onlp_regmap_t* map)
+{
+    if(map->access == ONLP_REGMAP_ACCESS_MMAP && map->base == NULL) {
+        map->base = onlp_mmap(map->pa, map->size, map->name);
+        if(map->base == NULL) {
+            return ONLP_STATUS_E_INTERNAL;
+        }
+    }
+    return 0;
+}
+
+int
+onlp_regmap_read(onlp_regmap_t* map, uint16_t reg, int count, uint8_t* data)
+{
+    int i, fd, rv;
+
+    ONLP_IF_ERROR_RETURN(range_check__(map, reg, count));
+
+    switch(map->access)
+        {
+        case ONLP_REGMAP_ACCESS_MMAP:
+            ONLP_IF_ERROR_RETURN(onlp_regmap_open(map));
+            for(i = 0; i < count; i++) {
+                data[i] = map->base[reg + i];
+            }
+            return 0;
+
+#if ONLPLIB_CONFIG_INCLUDE_I2C == 1
+        case ONLP_REGMAP_ACCESS_I2C:
+            if(reg + count > 256) {
+                return ONLP_STATUS_E_PARAM;
+            }
+            if(count == 1) {
+                return onlp_i2c_read(map->bus, map->addr, reg, 1, data,
+                                     map->flags);
+            }
+            return onlp_i2c_block_read(map->bus, map->addr, reg, count, data,
+                                       map->flags);
+#endif
+
+        case ONLP_REGMAP_ACCESS_SYSFS:
+            if(sysfs_is_text__(map)) {
+                for(i = 0; i < count; i++) {
+                    int v;
+                    ONLP_IF_ERROR_RETURN(onlp_file_read_int(&v, map->path, reg + i));
+                    data[i] = v;
+                }
+                return 0;
+            }
+            if((fd = onlp_file_open(O_RDONLY, 1, "%s", map->path)) < 0) {
+                return fd;
+            }
+            rv = pread(fd, data, count, reg);
+            close(fd);
+            if(rv != count) {
+                AIM_LOG_ERROR("regmap %s: reading %d registers at 0x%x from %s failed: %{errno}",
+                              map->name, count, reg, map->path, errno);
+                return ONLP_STATUS_E_INTERNAL;
+            }
+            return 0;
+
+        default:
+            break;
+        }
+
+    return ONLP_STATUS_E_UNSUPPORTED;
+}
+
+int
+onlp_regmap_readb(onlp_regmap_t* map, uint16_t reg)
+{
+    uint8_t byte;
+    int rv = onlp_regmap_read(map, reg, 1, &byte);
+    return (rv < 0) ? rv : byte;
+}
+
+int
+onlp_regmap_writeb(onlp_regmap_t* map, uint16_t reg, uint8_t value)
+{
+    int fd, rv;
+
+    ONLP_IF_ERROR_RETURN(range_check__(map, reg, 1));
+
+    switch(map->access)
+        {
+        case ONLP_REGMAP_ACCESS_MMAP:
+            ONLP_IF_ERROR_RETURN(onlp_regmap_open(map));
+            map->base[reg] = value;
+            return 0;
+
+#if ONLPLIB_CONFIG_INCLUDE_I2C == 1
+        case ONLP_REGMAP_ACCESS_I2C:
+            if(reg > 255) {
+                return ONLP_STATUS_E_PARAM;
+            }
+            return onlp_i2c_writeb(map->bus, map->addr, reg, value, map->flags);
+#endif
+
+        case ONLP_REGMAP_ACCESS_SYSFS:
+            if(sysfs_is_text__(map)) {
+                return onlp_file_write_int(value, map->path, reg);
+            }
+            if((fd = onlp_file_open(O_WRONLY, 1, "%s", map->path)) < 0) {
+                return fd;
+            }
+            rv = pwrite(fd, &value, 1, reg);
+            close(fd);
+            if(rv != 1) {
+                AIM_LOG_ERROR("regmap %s: writing register 0x%x to %s failed: %{errno}",
+                              map->name, reg, map->path, errno);
+                return ONLP_STATUS_E_INTERNAL;
+            }
+            return 0;
+
+        default:
+            break;
+        }
+
+    return ONLP_STATUS_E_UNSUPPORTED;
+}
+
+int
+onlp_regmap_modifyb(onlp_regmap_t* map, uint16_t reg,
+                    uint8_t andmask, uint8_t ormask)
+{
+    int v;
+    ONLP_IF_ERROR_RETURN(v=onlp_regmap_readb(map, reg));
+    v &= andmask;
+    v |= ormask;
+    return onlp_regmap_writeb(map, reg, v);
+}
+
+static int
+field_shift__(uint8_t mask)
+{
+    int shift = 0;
+    while(mask && !(mask & 1)) {
+        mask >>= 1;
+        shift++;
+    }
+    return shift;
+}
+
+static int
+field_decode__(const onlp_regmap_field_t* field, uint8_t regval)
+{
+    int v = (regval & field->mask) >> field_shift__(field->mask);
+    if(field->flags & ONLP_REGMAP_F_ACTIVE_LOW) {
+        v = !v;
+    }
+    return v;
+}
+
+int
+onlp_regmap_field_get(onlp_regmap_t* map,
+                      const onlp_regmap_field_t* field, int* value)
+{
+    int v;
+    ONLP_IF_ERROR_RETURN(v=onlp_regmap_readb(map, field->reg));
+    *value = field_decode__(field, v);
+    return 0;
+}
+
+int
+onlp_regmap_field_set(onlp_regmap_t* map,
+                      const onlp_regmap_field_t* field, int value)
+{
+    if(field->flags & ONLP_REGMAP_F_ACTIVE_LOW) {
+        value = !value;
+    }
+    value = (value << field_shift__(field->mask)) & field->mask;
+    return onlp_regmap_modifyb(map, field->reg, ~field->mask, value);
+}
+
+int
+onlp_regmap_snapshot(onlp_regmap_t* map, uint16_t start, int count,
+                     onlp_regmap_snapshot_t* snapshot)
+{
+    if(count > ONLPLIB_CONFIG_REGMAP_SNAPSHOT_SIZE) {
+        AIM_LOG_ERROR("regmap %s: snapshot of %d registers exceeds the maximum (%d)",
+                      map->name, count, ONLPLIB_CONFIG_REGMAP_SNAPSHOT_SIZE);
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    snapshot->start = start;
+    snapshot->count = 0;
+    ONLP_IF_ERROR_RETURN(onlp_regmap_read(map, start, count, snapshot->data));
+    snapshot->count = count;
+    return 0;
+}
+
+static int
+snapshot_reg__(const onlp_regmap_snapshot_t* snapshot, uint16_t reg)
+{
+    if(reg < snapshot->start || reg >= snapshot->start + snapshot->count) {
+        return ONLP_STATUS_E_PARAM;
+    }
+    return snapshot->data[reg - snapshot->start];
+}
+
+int
+onlp_regmap_snapshot_field_get(const onlp_regmap_snapshot_t* snapshot,
+                               const onlp_regmap_field_t* field, int* value)
+{
+    int v;
+    ONLP_IF_ERROR_RETURN(v=snapshot_reg__(snapshot, field->reg));
+    *value = field_decode__(field, v);
+    return 0;
+}
+
+static uint8_t
+bitmap_mask__(const onlp_regmap_bitmap_t* bitmap, int n)
+{
+    int bit = n % 8;
+    return (bitmap->flags & ONLP_REGMAP_F_MSB_FIRST) ? (0x80 >> bit) : (1 << bit);
+}
+
+int
+onlp_regmap_snapshot_bitmap_get(const onlp_regmap_snapshot_t* snapshot,
+                                const onlp_regmap_bitmap_t* bitmap,
+                                onlp_sfp_bitmap_t* dst)
+{
+    int n, v = 0;
+
+    for(n = 0; n < bitmap->count; n++) {
+        if((n % 8) == 0) {
+            ONLP_IF_ERROR_RETURN(v=snapshot_reg__(snapshot, bitmap->reg + n/8));
+        }
+        int set = (v & bitmap_mask__(bitmap, n)) ? 1 : 0;
+        if(bitmap->flags & ONLP_REGMAP_F_ACTIVE_LOW) {
+            set = !set;
+        }
+        AIM_BITMAP_MOD(dst, bitmap->first + n, set);
+    }
+    return 0;
+}
+
+int
+onlp_regmap_bitmap_get(onlp_regmap_t* map,
+                       const onlp_regmap_bitmap_t* bitmap,
+                       onlp_sfp_bitmap_t* dst)
+{
+    onlp_regmap_snapshot_t snapshot;
+    ONLP_IF_ERROR_RETURN(onlp_regmap_snapshot(map, bitmap->reg,
+                                              (bitmap->count + 7) / 8,
+                                              &snapshot));
+    return onlp_regmap_snapshot_bitmap_get(&snapshot, bitmap, dst);
+}
+
+static int
+bitmap_port_field__(const onlp_regmap_bitmap_t* bitmap, int port,
+                    onlp_regmap_field_t* field)
+{
+    int n = port - bitmap->first;
+    if(n < 0 || n >= bitmap->count) {
+        return ONLP_STATUS_E_PARAM;
+    }
+    field->name = bitmap->name;
+    field->reg = bitmap->reg + n/8;
+    field->mask = bitmap_mask__(bitmap, n);
+    field->flags = bitmap->flags;
+    return 0;
+}
+
+int
+onlp_regmap_bitmap_port_get(onlp_regmap_t* map,
+                            const onlp_regmap_bitmap_t* bitmap, int port)
+{
+    int v;
+    onlp_regmap_field_t field;
+    ONLP_IF_ERROR_RETURN(bitmap_port_field__(bitmap, port, &field));
+    ONLP_IF_ERROR_RETURN(onlp_regmap_field_get(map, &field, &v));
+    return v;
+}
+
+int
+onlp_regmap_bitmap_port_set(onlp_regmap_t* map,
+                            const onlp_regmap_bitmap_t* bitmap,
+                            int port, int value)
+{
+    onlp_regmap_field_t field;
+    ONLP_IF_ERROR_RETURN(bitmap_port_field__(bitmap, port, &field));
+    return onlp_regmap_field_set(map, &field, value);
+}
@@ -0,0 +1,51 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ * 
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.       
+ * 
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ * 
+ *        http://www.eclipse.org/legal/epl-v10.html
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ * 
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+
+/********************************************************//**
+ *
+ * onlpsim Doxygen Header
+ *
+ ***********************************************************/
+#ifndef __ONLPSIM_DOX_H__
+#define __ONLPSIM_DOX_H__
+
+/**
+ * @defgroup onlpsim onlpsim - Simulated ONLP platform
+ *
+
+A latency and failure modelled ONLP platform. See the README.
+
+ *
+ * @{
+ *
+ * @defgroup onlpsim-onlpsim Public Interface
+ * @defgroup onlpsim-config Compile Time Configuration
+ * @defgroup onlpsim-porting Porting Macros
+ *
+ * @}
+ *
+ */
+
+#endif /* __ONLPSIM_DOX_H__ */
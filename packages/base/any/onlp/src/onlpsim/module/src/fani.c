@@ -0,0 +1,86 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ * 
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.       
+ * 
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ * 
+ *        http://www.eclipse.org/legal/epl-v10.html
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ * 
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+#include <onlp/platformi/fani.h>
+#include "onlpsim_int.h"
+#include "onlpsim_log.h"
+
+/*
+ * All fans share the speed set by the last percentage or mode request.
+ */
+
+int
+onlp_fani_init(void)
+{
+    return onlpsim_model_load();
+}
+
+int
+onlp_fani_info_get(onlp_oid_t id, onlp_fan_info_t* info)
+{
+    onlpsim_model_t* m = &onlpsim_model;
+    int fid = ONLP_OID_ID_GET(id);
+
+    if(!ONLPSIM_ID_VALID(fid, m->fans)) {
+        return ONLP_STATUS_E_INVALID;
+    }
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_FAN_INFO));
+
+    memset(info, 0, sizeof(*info));
+    info->hdr.id = id;
+    ONLPSIM_SNPRINTF(info->hdr.description, sizeof(info->hdr.description),
+                     "Chassis Fan %d", fid);
+    info->status = ONLP_FAN_STATUS_PRESENT | ONLP_FAN_STATUS_F2B;
+    info->caps = ONLP_FAN_CAPS_F2B | ONLP_FAN_CAPS_SET_PERCENTAGE |
+        ONLP_FAN_CAPS_GET_RPM | ONLP_FAN_CAPS_GET_PERCENTAGE;
+    info->percentage = m->fan_percentage;
+    info->rpm = m->fan_rpm_max * m->fan_percentage / 100;
+    info->mode = ONLP_FAN_MODE_NORMAL;
+    ONLPSIM_SNPRINTF(info->model, sizeof(info->model), "ONLPSIM-FAN");
+    ONLPSIM_SNPRINTF(info->serial, sizeof(info->serial), "SIMFAN%04d", fid);
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_fani_percentage_set(onlp_oid_t id, int p)
+{
+    if(!ONLPSIM_ID_VALID(ONLP_OID_ID_GET(id), onlpsim_model.fans) ||
+       p < 0 || p > 100) {
+        return ONLP_STATUS_E_INVALID;
+    }
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_FAN_SET));
+    onlpsim_model.fan_percentage = p;
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_fani_mode_set(onlp_oid_t id, onlp_fan_mode_t mode)
+{
+    static const int percentage[] = { 0, 25, 50, 75, 100 };
+
+    if(mode < 0 || mode >= AIM_ARRAYSIZE(percentage)) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+    return onlp_fani_percentage_set(id, percentage[mode]);
+}
@@ -0,0 +1,77 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ * 
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.       
+ * 
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ * 
+ *        http://www.eclipse.org/legal/epl-v10.html
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ * 
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+#include <onlp/platformi/ledi.h>
+#include "onlpsim_int.h"
+#include "onlpsim_log.h"
+
+int
+onlp_ledi_init(void)
+{
+    return onlpsim_model_load();
+}
+
+int
+onlp_ledi_info_get(onlp_oid_t id, onlp_led_info_t* info)
+{
+    onlpsim_model_t* m = &onlpsim_model;
+    int lid = ONLP_OID_ID_GET(id);
+
+    if(!ONLPSIM_ID_VALID(lid, m->leds)) {
+        return ONLP_STATUS_E_INVALID;
+    }
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_LED_INFO));
+
+    memset(info, 0, sizeof(*info));
+    info->hdr.id = id;
+    ONLPSIM_SNPRINTF(info->hdr.description, sizeof(info->hdr.description),
+                     "Chassis LED %d", lid);
+    info->status = ONLP_LED_STATUS_PRESENT;
+    info->caps = ONLP_LED_CAPS_ON_OFF | ONLP_LED_CAPS_GREEN |
+        ONLP_LED_CAPS_GREEN_BLINKING | ONLP_LED_CAPS_ORANGE;
+    info->mode = m->led_mode[lid];
+    if(info->mode != ONLP_LED_MODE_OFF) {
+        info->status |= ONLP_LED_STATUS_ON;
+    }
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_ledi_mode_set(onlp_oid_t id, onlp_led_mode_t mode)
+{
+    int lid = ONLP_OID_ID_GET(id);
+
+    if(!ONLPSIM_ID_VALID(lid, onlpsim_model.leds)) {
+        return ONLP_STATUS_E_INVALID;
+    }
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_LED_SET));
+    onlpsim_model.led_mode[lid] = mode;
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_ledi_set(onlp_oid_t id, int on_or_off)
+{
+    return onlp_ledi_mode_set(id, on_or_off ? ONLP_LED_MODE_GREEN : ONLP_LED_MODE_OFF);
+}
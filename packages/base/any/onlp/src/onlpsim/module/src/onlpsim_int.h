@@ -0,0 +1,137 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ * 
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.       
+ * 
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ * 
+ *        http://www.eclipse.org/legal/epl-v10.html
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ * 
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+
+#ifndef __ONLPSIM_INT_H__
+#define __ONLPSIM_INT_H__
+
+#include <onlpsim/onlpsim_config.h>
+#include <onlp/onlp.h>
+#include <onlp/sfp.h>
+#include <onlp/led.h>
+
+/**
+ * Simulated operations.
+ *
+ * Each operation has its own latency and failure model.
+ * The JSON key of each operation is given in onlpsim_op_names[].
+ */
+typedef enum onlpsim_op_e {
+    ONLPSIM_OP_SFP_PRESENCE,
+    ONLPSIM_OP_SFP_BITMAP,
+    ONLPSIM_OP_SFP_EEPROM,
+    ONLPSIM_OP_SFP_DOM,
+    ONLPSIM_OP_SFP_DEV,
+    ONLPSIM_OP_SFP_CONTROL,
+    ONLPSIM_OP_FAN_INFO,
+    ONLPSIM_OP_FAN_SET,
+    ONLPSIM_OP_THERMAL_INFO,
+    ONLPSIM_OP_PSU_INFO,
+    ONLPSIM_OP_LED_INFO,
+    ONLPSIM_OP_LED_SET,
+    ONLPSIM_OP_SYS_INFO,
+    ONLPSIM_OP_COUNT,
+} onlpsim_op_t;
+
+extern const char* onlpsim_op_names[ONLPSIM_OP_COUNT];
+
+/**
+ * Latency and failure model of an operation.
+ */
+typedef struct onlpsim_latency_s {
+    /** Fixed cost of every call. */
+    uint32_t us;
+    /** Uniformly distributed extra cost, 0..jitter_us. */
+    uint32_t jitter_us;
+    /** Extra cost of the slow calls, e.g. clock stretching or a bus reset. */
+    uint32_t tail_us;
+    /** How many calls per million are slow. */
+    uint32_t tail_ppm;
+    /** How many calls per million fail. */
+    uint32_t fail_ppm;
+} onlpsim_latency_t;
+
+/**
+ * The platform model.
+ */
+typedef struct onlpsim_model_s {
+    /** The model file, or NULL for the built-in model. */
+    char* file;
+
+    /** SFP ports are numbered 0..ports-1 */
+    int ports;
+    onlp_sfp_bitmap_t present;
+    onlp_sfp_bitmap_t rx_los;
+    onlp_sfp_bitmap_t tx_disable;
+    onlp_sfp_bitmap_t lp_mode;
+
+    /**
+     * If i2c_bus >= 0 the SFP EEPROM and device accesses are
+     * routed to this bus (e.g. one created by the i2c-stub driver).
+     * With i2c_per_port the bus of port N is i2c_bus + N.
+     */
+    int i2c_bus;
+    int i2c_per_port;
+    int i2c_addr;
+
+    int fans;
+    int fan_rpm_max;
+    int fan_percentage;
+
+    int thermals;
+    int thermal_mcelsius;
+
+    int psus;
+
+    int leds;
+    /** Indexed by LED id. */
+    onlp_led_mode_t led_mode[ONLP_OID_TABLE_SIZE + 1];
+
+    onlpsim_latency_t latency[ONLPSIM_OP_COUNT];
+
+} onlpsim_model_t;
+
+extern onlpsim_model_t onlpsim_model;
+
+/**
+ * @brief Load the platform model.
+ * @note The model is loaded once. It is read from the file named
+ * by ONLPSIM_CONFIG_MODEL_ENV or ONLPSIM_CONFIG_MODEL_FILE_DEFAULT,
+ * or the built-in model is used if neither exists.
+ */
+int onlpsim_model_load(void);
+
+/**
+ * @brief Account for a simulated operation.
+ * @param op The operation.
+ * @returns ONLP_STATUS_OK, or the injected error after the
+ * operation's modelled latency has passed.
+ */
+int onlpsim_op(onlpsim_op_t op);
+
+/** OID ids of each object type are 1..count */
+#define ONLPSIM_ID_VALID(_id, _count) ((_id) >= 1 && (_id) <= (_count))
+
+
+#endif /* __ONLPSIM_INT_H__ */
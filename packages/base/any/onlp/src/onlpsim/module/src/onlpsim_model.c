@@ -0,0 +1,304 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ * 
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.       
+ * 
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ * 
+ *        http://www.eclipse.org/legal/epl-v10.html
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ * 
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+#include <onlpsim/onlpsim_config.h>
+#include <cjson_util/cjson_util.h>
+#include <AIM/aim_memory.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <string.h>
+#include "onlpsim_int.h"
+#include "onlpsim_log.h"
+
+const char* onlpsim_op_names[ONLPSIM_OP_COUNT] = {
+    "sfp_presence",
+    "sfp_bitmap",
+    "sfp_eeprom",
+    "sfp_dom",
+    "sfp_dev",
+    "sfp_control",
+    "fan_info",
+    "fan_set",
+    "thermal_info",
+    "psu_info",
+    "led_info",
+    "led_set",
+    "sys_info",
+};
+
+onlpsim_model_t onlpsim_model;
+
+static pthread_once_t model_once__ = PTHREAD_ONCE_INIT;
+static int model_rv__;
+static unsigned int model_seed__ = 1;
+
+static __thread unsigned int op_seed__;
+static __thread int op_seeded__;
+
+static void
+model_defaults__(onlpsim_model_t* m)
+{
+    int p;
+
+    memset(m, 0, sizeof(*m));
+    AIM_BITMAP_INIT(&m->present, 255);
+    AIM_BITMAP_INIT(&m->rx_los, 255);
+    AIM_BITMAP_INIT(&m->tx_disable, 255);
+    AIM_BITMAP_INIT(&m->lp_mode, 255);
+
+    m->ports = 32;
+    for(p = 0; p < m->ports; p++) {
+        AIM_BITMAP_SET(&m->present, p);
+    }
+    m->i2c_bus = -1;
+    m->i2c_addr = 0x50;
+
+    m->fans = 4;
+    m->fan_rpm_max = 20000;
+    m->fan_percentage = 50;
+
+    m->thermals = 4;
+    m->thermal_mcelsius = 40000;
+
+    m->psus = 2;
+
+    m->leds = 2;
+    for(p = 0; p < AIM_ARRAYSIZE(m->led_mode); p++) {
+        m->led_mode[p] = ONLP_LED_MODE_GREEN;
+    }
+}
+
+static void
+lookup_int__(cJSON* cj, int* dst, const char* key)
+{
+    int v;
+    if(cjson_util_lookup_int(cj, &v, key) >= 0) {
+        *dst = v;
+    }
+}
+
+static void
+lookup_uint__(cJSON* cj, uint32_t* dst, const char* key)
+{
+    int v;
+    if(cjson_util_lookup_int(cj, &v, key) >= 0 && v >= 0) {
+        *dst = v;
+    }
+}
+
+/*
+ * A port set is either a port count (the first N ports)
+ * or an array of port numbers.
+ */
+static void
+ports_load__(cJSON* cj, const char* key, int ports, onlp_sfp_bitmap_t* dst)
+{
+    cJSON* entry = NULL;
+    int i, p;
+
+    if(cjson_util_lookup(cj, &entry, key) < 0 || entry == NULL) {
+        return;
+    }
+
+    AIM_BITMAP_CLR_ALL(dst);
+    if(entry->type == cJSON_Number) {
+        for(p = 0; p < entry->valueint && p < ports; p++) {
+            AIM_BITMAP_SET(dst, p);
+        }
+    }
+    else if(entry->type == cJSON_Array) {
+        for(i = 0; i < cJSON_GetArraySize(entry); i++) {
+            p = cJSON_GetArrayItem(entry, i)->valueint;
+            if(p >= 0 && p < ports) {
+                AIM_BITMAP_SET(dst, p);
+            }
+        }
+    }
+    else {
+        AIM_LOG_ERROR("%s: expected a port count or a list of ports.", key);
+    }
+}
+
+static void
+latency_load__(cJSON* cj, onlpsim_latency_t* l)
+{
+    lookup_uint__(cj, &l->us, "us");
+    lookup_uint__(cj, &l->jitter_us, "jitter_us");
+    lookup_uint__(cj, &l->tail_us, "tail_us");
+    lookup_uint__(cj, &l->tail_ppm, "tail_ppm");
+    lookup_uint__(cj, &l->fail_ppm, "fail_ppm");
+}
+
+static int
+model_parse__(onlpsim_model_t* m, cJSON* root)
+{
+    cJSON* entry;
+    int seed = model_seed__;
+    int i;
+
+    lookup_int__(root, &seed, "seed");
+    model_seed__ = seed;
+
+    lookup_int__(root, &m->ports, "sfp.ports");
+    if(m->ports < 0 || m->ports > ONLPSIM_CONFIG_PORTS_MAX) {
+        AIM_LOG_ERROR("sfp.ports: %d is out of range (0..%d).",
+                      m->ports, ONLPSIM_CONFIG_PORTS_MAX);
+        return ONLP_STATUS_E_PARAM;
+    }
+    /* All ports are populated unless the model says otherwise. */
+    AIM_BITMAP_CLR_ALL(&m->present);
+    for(i = 0; i < m->ports; i++) {
+        AIM_BITMAP_SET(&m->present, i);
+    }
+    ports_load__(root, "sfp.present", m->ports, &m->present);
+    ports_load__(root, "sfp.rx_los", m->ports, &m->rx_los);
+    lookup_int__(root, &m->i2c_bus, "sfp.i2c.bus");
+    lookup_int__(root, &m->i2c_addr, "sfp.i2c.addr");
+    lookup_int__(root, &m->i2c_per_port, "sfp.i2c.per_port");
+
+    lookup_int__(root, &m->fans, "fan.count");
+    lookup_int__(root, &m->fan_rpm_max, "fan.rpm_max");
+    lookup_int__(root, &m->fan_percentage, "fan.percentage");
+    lookup_int__(root, &m->thermals, "thermal.count");
+    lookup_int__(root, &m->thermal_mcelsius, "thermal.mcelsius");
+    lookup_int__(root, &m->psus, "psu.count");
+    lookup_int__(root, &m->leds, "led.count");
+
+    if(m->fans < 0 || m->thermals < 0 || m->psus < 0 || m->leds < 0 ||
+       m->fans + m->thermals + m->psus + m->leds > ONLP_OID_TABLE_SIZE) {
+        AIM_LOG_ERROR("The model has more than %d fans, thermals, psus and leds.",
+                      ONLP_OID_TABLE_SIZE);
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    /* The default latency applies to all operations which are not listed. */
+    if(cjson_util_lookup(root, &entry, "latency.default") >= 0 && entry) {
+        for(i = 0; i < ONLPSIM_OP_COUNT; i++) {
+            latency_load__(entry, m->latency + i);
+        }
+    }
+    for(i = 0; i < ONLPSIM_OP_COUNT; i++) {
+        if(cjson_util_lookup(root, &entry, "latency.%s", onlpsim_op_names[i]) >= 0 && entry) {
+            latency_load__(entry, m->latency + i);
+        }
+    }
+    return ONLP_STATUS_OK;
+}
+
+static void
+model_load__(void)
+{
+    onlpsim_model_t* m = &onlpsim_model;
+    const char* fname = getenv(ONLPSIM_CONFIG_MODEL_ENV);
+    cJSON* root = NULL;
+
+    model_defaults__(m);
+
+    if(fname == NULL) {
+        fname = ONLPSIM_CONFIG_MODEL_FILE_DEFAULT;
+        if(access(fname, R_OK) < 0) {
+            AIM_LOG_VERBOSE("No model file, using the built-in model.");
+            return;
+        }
+    }
+
+    if(cjson_util_parse_file(fname, &root) < 0 || root == NULL) {
+        AIM_LOG_ERROR("Could not parse the model file %s", fname);
+        model_rv__ = ONLP_STATUS_E_PARAM;
+        return;
+    }
+
+    model_rv__ = model_parse__(m, root);
+    if(model_rv__ >= 0) {
+        m->file = aim_strdup(fname);
+        AIM_LOG_VERBOSE("Loaded model %s: %d ports, %d fans, %d thermals, %d psus, %d leds",
+                        fname, m->ports, m->fans, m->thermals, m->psus, m->leds);
+    }
+    cJSON_Delete(root);
+}
+
+int
+onlpsim_model_load(void)
+{
+    pthread_once(&model_once__, model_load__);
+    return model_rv__;
+}
+
+/*
+ * Each thread draws from its own sequence so that concurrent callers
+ * do not contend on (or corrupt) a shared random state.
+ */
+static uint32_t
+rand__(void)
+{
+    if(!op_seeded__) {
+        op_seed__ = model_seed__ ^ (unsigned int)(uintptr_t)pthread_self();
+        op_seeded__ = 1;
+    }
+    return rand_r(&op_seed__);
+}
+
+static uint32_t
+ppm__(void)
+{
+    return rand__() % 1000000;
+}
+
+static void
+delay__(uint64_t us)
+{
+    struct timespec ts;
+
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000;
+    while(nanosleep(&ts, &ts) < 0 && errno == EINTR);
+}
+
+int
+onlpsim_op(onlpsim_op_t op)
+{
+    onlpsim_latency_t* l = onlpsim_model.latency + op;
+    uint64_t us = l->us;
+
+    if(l->jitter_us) {
+        us += rand__() % (l->jitter_us + 1);
+    }
+    if(l->tail_ppm && ppm__() < l->tail_ppm) {
+        us += l->tail_us;
+    }
+    if(us) {
+        delay__(us);
+    }
+
+    if(l->fail_ppm && ppm__() < l->fail_ppm) {
+        AIM_LOG_VERBOSE("%s: injected failure", onlpsim_op_names[op]);
+        return (op <= ONLPSIM_OP_SFP_CONTROL) ?
+            ONLP_STATUS_E_I2C : ONLP_STATUS_E_INTERNAL;
+    }
+    return ONLP_STATUS_OK;
+}
@@ -0,0 +1,61 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ * 
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.       
+ * 
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ * 
+ *        http://www.eclipse.org/legal/epl-v10.html
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ * 
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+#include <onlp/platformi/psui.h>
+#include "onlpsim_int.h"
+#include "onlpsim_log.h"
+
+int
+onlp_psui_init(void)
+{
+    return onlpsim_model_load();
+}
+
+int
+onlp_psui_info_get(onlp_oid_t id, onlp_psu_info_t* info)
+{
+    int pid = ONLP_OID_ID_GET(id);
+
+    if(!ONLPSIM_ID_VALID(pid, onlpsim_model.psus)) {
+        return ONLP_STATUS_E_INVALID;
+    }
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_PSU_INFO));
+
+    memset(info, 0, sizeof(*info));
+    info->hdr.id = id;
+    ONLPSIM_SNPRINTF(info->hdr.description, sizeof(info->hdr.description),
+                     "PSU-%d", pid);
+    ONLPSIM_SNPRINTF(info->model, sizeof(info->model), "ONLPSIM-PSU-AC");
+    ONLPSIM_SNPRINTF(info->serial, sizeof(info->serial), "SIMPSU%04d", pid);
+    info->status = ONLP_PSU_STATUS_PRESENT;
+    info->caps = ONLP_PSU_CAPS_AC | ONLP_PSU_CAPS_VIN | ONLP_PSU_CAPS_VOUT |
+        ONLP_PSU_CAPS_IIN | ONLP_PSU_CAPS_IOUT | ONLP_PSU_CAPS_PIN | ONLP_PSU_CAPS_POUT;
+    info->mvin = 230000;
+    info->mvout = 12000;
+    info->miin = 1000;
+    info->miout = 16000;
+    info->mpin = 230000;
+    info->mpout = 192000;
+    return ONLP_STATUS_OK;
+}
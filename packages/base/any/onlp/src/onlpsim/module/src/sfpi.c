@@ -0,0 +1,293 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ * 
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.       
+ * 
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ * 
+ *        http://www.eclipse.org/legal/epl-v10.html
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ * 
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+#include <onlp/platformi/sfpi.h>
+#include <onlplib/i2c.h>
+#include "onlpsim_int.h"
+#include "onlpsim_log.h"
+
+/*
+ * SFP ports are simulated as populated by 10GBASE-SR modules.
+ * If the model names an i2c bus the EEPROM and device accesses go
+ * through it instead, so that the cost of the kernel i2c path
+ * (e.g. an i2c-stub device) is included in the measurements.
+ */
+
+static int
+i2c_bus__(int port)
+{
+    onlpsim_model_t* m = &onlpsim_model;
+    return m->i2c_per_port ? m->i2c_bus + port : m->i2c_bus;
+}
+
+static int
+present__(int port)
+{
+    return AIM_BITMAP_GET(&onlpsim_model.present, port) ? 1 : 0;
+}
+
+static void
+sff_string__(uint8_t* dst, int size, const char* src)
+{
+    int i;
+    for(i = 0; i < size; i++) {
+        dst[i] = *src ? *src++ : ' ';
+    }
+}
+
+static uint8_t
+sff_cc__(uint8_t* data, int start, int end)
+{
+    int i;
+    uint8_t cc = 0;
+    for(i = start; i < end; i++) {
+        cc += data[i];
+    }
+    return cc;
+}
+
+/* SFF-8472 A0h contents of a 10GBASE-SR module. */
+static void
+sff_eeprom__(int port, uint8_t data[256])
+{
+    char serial[17];
+
+    memset(data, 0, 256);
+    data[0] = 0x03;     /* SFP */
+    data[1] = 0x04;
+    data[2] = 0x07;     /* LC */
+    data[3] = 0x10;     /* 10GBASE-SR */
+    data[11] = 0x06;    /* 64B/66B */
+    data[12] = 0x67;    /* 10.3 GBd */
+    data[16] = 0x08;    /* 80m OM2 */
+    data[17] = 0x03;
+    sff_string__(data + 20, 16, "ONLPSIM");
+    sff_string__(data + 40, 16, "SIM-10G-SR");
+    sff_string__(data + 56, 4, "A");
+    data[60] = 0x03;    /* 850nm */
+    data[61] = 0x52;
+    data[63] = sff_cc__(data, 0, 63);
+
+    ONLPSIM_SNPRINTF(serial, sizeof(serial), "SIM%04d", port);
+    sff_string__(data + 68, 16, serial);
+    sff_string__(data + 84, 8, "200101");
+    data[92] = 0x68;    /* DDM implemented, internally calibrated */
+    data[95] = sff_cc__(data, 64, 95);
+}
+
+int
+onlp_sfpi_init(void)
+{
+    return onlpsim_model_load();
+}
+
+int
+onlp_sfpi_bitmap_get(onlp_sfp_bitmap_t* bmap)
+{
+    int p;
+    for(p = 0; p < onlpsim_model.ports; p++) {
+        AIM_BITMAP_SET(bmap, p);
+    }
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sfpi_is_present(int port)
+{
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_SFP_PRESENCE));
+    return present__(port);
+}
+
+int
+onlp_sfpi_presence_bitmap_get(onlp_sfp_bitmap_t* dst)
+{
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_SFP_BITMAP));
+    AIM_BITMAP_ASSIGN(dst, &onlpsim_model.present);
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sfpi_rx_los_bitmap_get(onlp_sfp_bitmap_t* dst)
+{
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_SFP_BITMAP));
+    AIM_BITMAP_ASSIGN(dst, &onlpsim_model.rx_los);
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sfpi_eeprom_read(int port, uint8_t data[256])
+{
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_SFP_EEPROM));
+    if(!present__(port)) {
+        return ONLP_STATUS_E_MISSING;
+    }
+    if(onlpsim_model.i2c_bus >= 0) {
+        return onlp_i2c_block_read(i2c_bus__(port), onlpsim_model.i2c_addr,
+                                   0, 256, data, ONLP_I2C_F_FORCE);
+    }
+    sff_eeprom__(port, data);
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sfpi_dom_read(int port, uint8_t data[256])
+{
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_SFP_DOM));
+    if(!present__(port)) {
+        return ONLP_STATUS_E_MISSING;
+    }
+    if(onlpsim_model.i2c_bus >= 0) {
+        return onlp_i2c_block_read(i2c_bus__(port), onlpsim_model.i2c_addr + 1,
+                                   0, 256, data, ONLP_I2C_F_FORCE);
+    }
+    memset(data, 0, 256);
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sfpi_dev_readb(int port, uint8_t devaddr, uint8_t addr)
+{
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_SFP_DEV));
+    if(onlpsim_model.i2c_bus >= 0) {
+        return onlp_i2c_readb(i2c_bus__(port), devaddr, addr, ONLP_I2C_F_FORCE);
+    }
+    return 0;
+}
+
+int
+onlp_sfpi_dev_writeb(int port, uint8_t devaddr, uint8_t addr, uint8_t value)
+{
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_SFP_DEV));
+    if(onlpsim_model.i2c_bus >= 0) {
+        return onlp_i2c_writeb(i2c_bus__(port), devaddr, addr, value, ONLP_I2C_F_FORCE);
+    }
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sfpi_dev_readw(int port, uint8_t devaddr, uint8_t addr)
+{
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_SFP_DEV));
+    if(onlpsim_model.i2c_bus >= 0) {
+        return onlp_i2c_readw(i2c_bus__(port), devaddr, addr, ONLP_I2C_F_FORCE);
+    }
+    return 0;
+}
+
+int
+onlp_sfpi_dev_writew(int port, uint8_t devaddr, uint8_t addr, uint16_t value)
+{
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_SFP_DEV));
+    if(onlpsim_model.i2c_bus >= 0) {
+        return onlp_i2c_writew(i2c_bus__(port), devaddr, addr, value, ONLP_I2C_F_FORCE);
+    }
+    return ONLP_STATUS_OK;
+}
+
+static onlp_sfp_bitmap_t*
+control_bitmap__(onlp_sfp_control_t control)
+{
+    switch(control)
+        {
+        case ONLP_SFP_CONTROL_RX_LOS: return &onlpsim_model.rx_los;
+        case ONLP_SFP_CONTROL_TX_DISABLE: return &onlpsim_model.tx_disable;
+        case ONLP_SFP_CONTROL_LP_MODE: return &onlpsim_model.lp_mode;
+        default: return NULL;
+        }
+}
+
+int
+onlp_sfpi_control_supported(int port, onlp_sfp_control_t control, int* rv)
+{
+    *rv = control_bitmap__(control) ? 1 : 0;
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sfpi_control_set(int port, onlp_sfp_control_t control, int value)
+{
+    onlp_sfp_bitmap_t* bmap = control_bitmap__(control);
+
+    if(bmap == NULL || control == ONLP_SFP_CONTROL_RX_LOS) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_SFP_CONTROL));
+    AIM_BITMAP_MOD(bmap, port, value ? 1 : 0);
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sfpi_control_get(int port, onlp_sfp_control_t control, int* value)
+{
+    onlp_sfp_bitmap_t* bmap = control_bitmap__(control);
+
+    if(bmap == NULL) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_SFP_CONTROL));
+    *value = AIM_BITMAP_GET(bmap, port) ? 1 : 0;
+    return ONLP_STATUS_OK;
+}
+
+/*
+ * The simulated controls are kept in one bitmap per control, the way
+ * a CPLD keeps them in a block of registers, so all ports are read with
+ * a single operation.
+ */
+int
+onlp_sfpi_control_bitmap_get(onlp_sfp_control_t control, onlp_sfp_bitmap_t* dst)
+{
+    onlp_sfp_bitmap_t* bmap = control_bitmap__(control);
+
+    if(bmap == NULL) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_SFP_BITMAP));
+    AIM_BITMAP_ASSIGN(dst, bmap);
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sfpi_control_bitmap_set(onlp_sfp_control_t control,
+                             onlp_sfp_bitmap_t* ports,
+                             onlp_sfp_bitmap_t* values)
+{
+    onlp_sfp_bitmap_t* bmap = control_bitmap__(control);
+    int p;
+
+    if(bmap == NULL || control == ONLP_SFP_CONTROL_RX_LOS) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_SFP_CONTROL));
+    AIM_BITMAP_ITER(ports, p) {
+        AIM_BITMAP_MOD(bmap, p, AIM_BITMAP_GET(values, p) ? 1 : 0);
+    }
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sfpi_denit(void)
+{
+    return ONLP_STATUS_OK;
+}
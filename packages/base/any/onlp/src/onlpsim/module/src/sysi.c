@@ -0,0 +1,195 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ * 
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.       
+ * 
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ * 
+ *        http://www.eclipse.org/legal/epl-v10.html
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ * 
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+#include <onlp/platformi/sysi.h>
+#include <onlp/platformi/fani.h>
+#include <onlp/platformi/ledi.h>
+#include <onlp/platformi/psui.h>
+#include <onlp/platformi/thermali.h>
+#include <onlplib/crc32.h>
+#include "onlpsim_int.h"
+#include "onlpsim_log.h"
+
+const char*
+onlp_sysi_platform_get(void)
+{
+    return "onlpsim";
+}
+
+/*
+ * The simulated platform can stand in for any platform.
+ */
+int
+onlp_sysi_platform_set(const char* name)
+{
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sysi_init(void)
+{
+    return onlpsim_model_load();
+}
+
+static int
+tlv_add__(uint8_t* data, int len, uint8_t code, const char* value)
+{
+    int size = strlen(value);
+    data[len++] = code;
+    data[len++] = size;
+    memcpy(data + len, value, size);
+    return len + size;
+}
+
+int
+onlp_sysi_onie_data_get(uint8_t** data, int* size)
+{
+    static uint8_t onie_data[128];
+    int len = 11;
+    uint32_t crc;
+
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_SYS_INFO));
+
+    memset(onie_data, 0, sizeof(onie_data));
+    memcpy(onie_data, "TlvInfo", 8);
+    onie_data[8] = 0x1;
+    len = tlv_add__(onie_data, len, 0x21, "ONLPSIM");
+    len = tlv_add__(onie_data, len, 0x23, "SIM0001");
+    len = tlv_add__(onie_data, len, 0x28, "x86-64-onlpsim-r0");
+    onie_data[len++] = 0xFE;
+    onie_data[len++] = 0x4;
+    onie_data[9] = ((len + 4 - 11) & 0xFF00) >> 8;
+    onie_data[10] = ((len + 4 - 11) & 0xFF);
+
+    crc = onlp_crc32(0, onie_data, len);
+    onie_data[len++] = (crc >> 24) & 0xFF;
+    onie_data[len++] = (crc >> 16) & 0xFF;
+    onie_data[len++] = (crc >> 8) & 0xFF;
+    onie_data[len++] = crc & 0xFF;
+
+    *data = onie_data;
+    *size = len;
+    return ONLP_STATUS_OK;
+}
+
+void
+onlp_sysi_onie_data_free(uint8_t* data)
+{
+    /* Static data. */
+}
+
+int
+onlp_sysi_oids_get(onlp_oid_t* table, int max)
+{
+    onlpsim_model_t* m = &onlpsim_model;
+    onlp_oid_t* e = table;
+    int i;
+
+    memset(table, 0, max*sizeof(onlp_oid_t));
+
+    for(i = 1; i <= m->thermals && e < table + max; i++) {
+        *e++ = ONLP_THERMAL_ID_CREATE(i);
+    }
+    for(i = 1; i <= m->psus && e < table + max; i++) {
+        *e++ = ONLP_PSU_ID_CREATE(i);
+    }
+    for(i = 1; i <= m->fans && e < table + max; i++) {
+        *e++ = ONLP_FAN_ID_CREATE(i);
+    }
+    for(i = 1; i <= m->leds && e < table + max; i++) {
+        *e++ = ONLP_LED_ID_CREATE(i);
+    }
+    return ONLP_STATUS_OK;
+}
+
+/*
+ * Fan control follows the hottest sensor, the way most platform
+ * drivers do, so that the platform manager exercises the fan, thermal
+ * and led paths of the model on every pass.
+ */
+int
+onlp_sysi_platform_manage_fans(void)
+{
+    onlpsim_model_t* m = &onlpsim_model;
+    onlp_thermal_info_t ti;
+    int i, hottest = 0;
+    int p;
+
+    for(i = 1; i <= m->thermals; i++) {
+        ONLP_IF_ERROR_RETURN(onlp_thermali_info_get(ONLP_THERMAL_ID_CREATE(i), &ti));
+        if(ti.mcelsius > hottest) {
+            hottest = ti.mcelsius;
+        }
+    }
+
+    p = (hottest >= ONLP_THERMAL_THRESHOLD_WARNING_DEFAULT) ? 100 : 50;
+    for(i = 1; i <= m->fans; i++) {
+        ONLP_IF_ERROR_RETURN(onlp_fani_percentage_set(ONLP_FAN_ID_CREATE(i), p));
+    }
+    return ONLP_STATUS_OK;
+}
+
+int
+onlp_sysi_platform_manage_leds(void)
+{
+    onlpsim_model_t* m = &onlpsim_model;
+    onlp_psu_info_t pi;
+    onlp_led_mode_t mode = ONLP_LED_MODE_GREEN;
+    int i;
+
+    if(m->leds < 1) {
+        return ONLP_STATUS_OK;
+    }
+    for(i = 1; i <= m->psus; i++) {
+        if(onlp_psui_info_get(ONLP_PSU_ID_CREATE(i), &pi) < 0 ||
+           !(pi.status & ONLP_PSU_STATUS_PRESENT)) {
+            mode = ONLP_LED_MODE_ORANGE;
+        }
+    }
+    /* The first LED is the system status LED. */
+    return onlp_ledi_mode_set(ONLP_LED_ID_CREATE(1), mode);
+}
+
+int
+onlp_sysi_debug(aim_pvs_t* pvs, int argc, char** argv)
+{
+    onlpsim_model_t* m = &onlpsim_model;
+    onlpsim_latency_t* l;
+    int i;
+
+    aim_printf(pvs, "model: %s\n", m->file ? m->file : "built-in");
+    aim_printf(pvs, "ports: %d fans: %d thermals: %d psus: %d leds: %d\n",
+               m->ports, m->fans, m->thermals, m->psus, m->leds);
+    if(m->i2c_bus >= 0) {
+        aim_printf(pvs, "sfp i2c: bus %d%s addr 0x%x\n", m->i2c_bus,
+                   m->i2c_per_port ? "+port" : "", m->i2c_addr);
+    }
+    for(i = 0; i < ONLPSIM_OP_COUNT; i++) {
+        l = m->latency + i;
+        aim_printf(pvs, "%-14s us=%u jitter_us=%u tail_us=%u tail_ppm=%u fail_ppm=%u\n",
+                   onlpsim_op_names[i], l->us, l->jitter_us, l->tail_us,
+                   l->tail_ppm, l->fail_ppm);
+    }
+    return ONLP_STATUS_OK;
+}
@@ -0,0 +1,58 @@
+/************************************************************
+ * <bsn.cl fy=2014 v=onl>
+ * 
+ *        Copyright 2014, 2015 Big Switch Networks, Inc.       
+ * 
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ * 
+ *        http://www.eclipse.org/legal/epl-v10.html
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ * 
+ * </bsn.cl>
+ ************************************************************
+ *
+ *
+ *
+ ***********************************************************/
+#include <onlp/platformi/thermali.h>
+#include "onlpsim_int.h"
+#include "onlpsim_log.h"
+
+int
+onlp_thermali_init(void)
+{
+    return onlpsim_model_load();
+}
+
+int
+onlp_thermali_info_get(onlp_oid_t id, onlp_thermal_info_t* info)
+{
+    onlpsim_model_t* m = &onlpsim_model;
+    int tid = ONLP_OID_ID_GET(id);
+
+    if(!ONLPSIM_ID_VALID(tid, m->thermals)) {
+        return ONLP_STATUS_E_INVALID;
+    }
+    ONLP_IF_ERROR_RETURN(onlpsim_op(ONLPSIM_OP_THERMAL_INFO));
+
+    memset(info, 0, sizeof(*info));
+    info->hdr.id = id;
+    ONLPSIM_SNPRINTF(info->hdr.description, sizeof(info->hdr.description),
+                     "Chassis Thermal Sensor %d", tid);
+    info->status = ONLP_THERMAL_STATUS_PRESENT;
+    info->caps = ONLP_THERMAL_CAPS_ALL;
+    /* Each sensor reads a little warmer than the previous one. */
+    info->mcelsius = m->thermal_mcelsius + (tid - 1) * 1000;
+    info->thresholds.warning = ONLP_THERMAL_THRESHOLD_WARNING_DEFAULT;
+    info->thresholds.error = ONLP_THERMAL_THRESHOLD_ERROR_DEFAULT;
+    info->thresholds.shutdown = ONLP_THERMAL_THRESHOLD_SHUTDOWN_DEFAULT;
+    return ONLP_STATUS_OK;
+}
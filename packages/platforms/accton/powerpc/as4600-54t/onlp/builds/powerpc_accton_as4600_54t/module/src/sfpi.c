@@ -24,6 +24,7 @@
  *
  ***********************************************************/
 #include <onlp/platformi/sfpi.h>
+#include <onlplib/regmap.h>
 #include <onlplib/mmap.h>
 
 #include <errno.h>
@@ -42,10 +43,10 @@
 #define CPLD_REG_SFP_RX_LOSS    0x0B
 #define CPLD_REG_SFP_TX_FAIL    0x0C
 #define CPLD_REG_SFP_TX_DISABLE 0x0D
-#define CPLD_SFP_1_BIT_MASK  0x80
-#define CPLD_SFP_2_BIT_MASK  0x40
-#define CPLD_SFP_3_BIT_MASK  0x20
-#define CPLD_SFP_4_BIT_MASK  0x10
+#define CPLD_REG_SIZE        0x100
+
+#define SFP_PORT_FIRST 48
+#define SFP_PORT_COUNT 4
 
 #define I2C_SLAVE_ADDRESS_SFP_EEPROM_50 0x50
 #define I2C_SLAVE_ADDRESS_SFP_EEPROM_51 0x51
@@ -60,7 +61,35 @@
 #define MAX_I2C_BUSSES     2
 #define I2C_BUFFER_MAXSIZE 16
 
-static volatile uint8_t* cpld_base__ = NULL;
+static onlp_regmap_t cpld__ = {
+    .name = "as4600-54t-cpld",
+    .access = ONLP_REGMAP_ACCESS_MMAP,
+    .pa = CPLD_BASE_ADDRESS,
+    .size = CPLD_REG_SIZE,
+};
+
+/*
+ * SFP 1-4 (ports 48-51) occupy bits 7-4 of each status register.
+ */
+static const onlp_regmap_bitmap_t sfp_present__ = {
+    "present", CPLD_REG_SFP_PRESENT, SFP_PORT_FIRST, SFP_PORT_COUNT,
+    ONLP_REGMAP_F_MSB_FIRST | ONLP_REGMAP_F_ACTIVE_LOW
+};
+
+static const onlp_regmap_bitmap_t sfp_rx_los__ = {
+    "rx_los", CPLD_REG_SFP_RX_LOSS, SFP_PORT_FIRST, SFP_PORT_COUNT,
+    ONLP_REGMAP_F_MSB_FIRST
+};
+
+static const onlp_regmap_bitmap_t sfp_tx_fault__ = {
+    "tx_fault", CPLD_REG_SFP_TX_FAIL, SFP_PORT_FIRST, SFP_PORT_COUNT,
+    ONLP_REGMAP_F_MSB_FIRST
+};
+
+static const onlp_regmap_bitmap_t sfp_tx_disable__ = {
+    "tx_disable", CPLD_REG_SFP_TX_DISABLE, SFP_PORT_FIRST, SFP_PORT_COUNT,
+    ONLP_REGMAP_F_MSB_FIRST
+};
 
 int
 onlp_sfpi_init(void)
@@ -68,11 +97,7 @@ onlp_sfpi_init(void)
     /*
      * Map the CPLD address
      */
-    cpld_base__ = onlp_mmap(CPLD_BASE_ADDRESS, getpagesize(), __FILE__);
-    if(cpld_base__ == NULL || cpld_base__ == MAP_FAILED) {
-        return ONLP_STATUS_E_INTERNAL;
-    }
-    return ONLP_STATUS_OK;
+    return onlp_regmap_open(&cpld__);
 }
 
 int
@@ -93,67 +118,25 @@ onlp_sfpi_bitmap_get(onlp_sfp_bitmap_t* bmap)
 int
 onlp_sfpi_presence_bitmap_get(onlp_sfp_bitmap_t* dst)
 {
-    unsigned char val;
-    val = cpld_base__[CPLD_REG_SFP_PRESENT];
-    
-    AIM_BITMAP_MOD(dst, 48, (val & CPLD_SFP_1_BIT_MASK) ? 0 : 1);
-    AIM_BITMAP_MOD(dst, 49, (val & CPLD_SFP_2_BIT_MASK) ? 0 : 1);
-    AIM_BITMAP_MOD(dst, 50, (val & CPLD_SFP_3_BIT_MASK) ? 0 : 1);
-    AIM_BITMAP_MOD(dst, 51, (val & CPLD_SFP_4_BIT_MASK) ? 0 : 1);
-
-    return ONLP_STATUS_OK;
+    return onlp_regmap_bitmap_get(&cpld__, &sfp_present__, dst);
 }
 
 int
 onlp_sfpi_rx_los_bitmap_get(onlp_sfp_bitmap_t* dst)
 {
-    unsigned char val;
-    val = cpld_base__[CPLD_REG_SFP_RX_LOSS];
-    
-    AIM_BITMAP_MOD(dst, 48, (val & CPLD_SFP_1_BIT_MASK) ? 1 : 0);
-    AIM_BITMAP_MOD(dst, 49, (val & CPLD_SFP_2_BIT_MASK) ? 1 : 0);
-    AIM_BITMAP_MOD(dst, 50, (val & CPLD_SFP_3_BIT_MASK) ? 1 : 0);
-    AIM_BITMAP_MOD(dst, 51, (val & CPLD_SFP_4_BIT_MASK) ? 1 : 0);
-
-    return ONLP_STATUS_OK;
+    return onlp_regmap_bitmap_get(&cpld__, &sfp_rx_los__, dst);
 }
 
 int
 onlp_sfpi_is_present(int port)
 {
-    unsigned int regOffset;
-    unsigned char val, mask;
-    int rc = 0;
-
-    regOffset = CPLD_REG_SFP_PRESENT;
-
-    switch(port)
-        {
-        case 48:
-            mask = CPLD_SFP_1_BIT_MASK;
-            break;
-        case 49:
-            mask = CPLD_SFP_2_BIT_MASK;
-            break;
-        case 50:
-            mask = CPLD_SFP_3_BIT_MASK;
-            break;
-        case 51:
-            mask = CPLD_SFP_4_BIT_MASK;
-            break;
-        default:
-            return ONLP_STATUS_E_INTERNAL;
-        }
-
     /*
      * Return 1 if present.
      * Return 0 if not present.
      * Return < 0 if error.
      */
-    val = cpld_base__[regOffset];
-    rc = (val & mask) ? 0 : 1;
-
-    return rc;
+    int rv = onlp_regmap_bitmap_port_get(&cpld__, &sfp_present__, port);
+    return (rv == ONLP_STATUS_E_PARAM) ? ONLP_STATUS_E_INTERNAL : rv;
 }
 
 static int
@@ -221,140 +204,33 @@ onlp_sfpi_dom_read(int port, unsigned char* data)
 
 
 /*
- * Manually enable or disable the given SFP.
- *
- */
-static int
-tx_enable_set__(int port, int enable)
-{
-    /* If enable is 1, enable the SFP */
-    /* If enable is 0, disable the SFP */
-    unsigned int regOffset;
-    unsigned char val, mask;
-
-    regOffset = CPLD_REG_SFP_TX_DISABLE;
-
-    switch(port)
-    {
-    case 48:
-        mask = CPLD_SFP_1_BIT_MASK;
-        break;
-    case 49:
-        mask = CPLD_SFP_2_BIT_MASK;
-        break;
-    case 50:
-        mask = CPLD_SFP_3_BIT_MASK;
-        break;
-    case 51:
-        mask = CPLD_SFP_4_BIT_MASK;
-        break;
-    default:
-        return ONLP_STATUS_E_INVALID;
-    }
-
-    /* read the current status.
-     */
-    val = cpld_base__[regOffset];
-
-    /* CPLD value:
-     * 0: transmit Enable
-     * 1: transmit Disable
-     */
-    if ( enable == 1)
-    {
-        val &= ~mask;
-    }
-    else
-    {
-        val |= mask;
-    }
-
-    cpld_base__[regOffset] = val;
-
-    return ONLP_STATUS_OK;
-}
-
-/*
- * Returns whether the SFP is currently enabled or disabled.
+ * Read the RX_LOS and TX_FAULT status registers in one access.
  */
 static int
-tx_enable_get__(int port, int* enable)
+control_flags_get__(int port, uint32_t* status)
 {
-    unsigned int regOffset;
-    unsigned char val, mask;
+    onlp_regmap_snapshot_t snapshot;
+    onlp_sfp_bitmap_t bmap;
 
-    regOffset = CPLD_REG_SFP_TX_DISABLE;
-
-    switch(port)
-    {
-    case 48:
-        mask = CPLD_SFP_1_BIT_MASK;
-        break;
-    case 49:
-        mask = CPLD_SFP_2_BIT_MASK;
-        break;
-    case 50:
-        mask = CPLD_SFP_3_BIT_MASK;
-        break;
-    case 51:
-        mask = CPLD_SFP_4_BIT_MASK;
-        break;
-    default:
+    if(port < SFP_PORT_FIRST || port >= SFP_PORT_FIRST + SFP_PORT_COUNT) {
         return ONLP_STATUS_E_INTERNAL;
     }
 
-    val = cpld_base__[regOffset];
-
-    /* Return whether the SFP is currently enabled
-     * =0, if disable
-     * =1, if enalbe
-     */
-    *enable = (val & mask) ? 0 : 1;
-
-    return ONLP_STATUS_OK;
-}
-
-
-static int
-control_flags_get__(int port, uint32_t* status)
-{
-    unsigned int regOffset1, regOffset2;
-    unsigned char val1, val2, mask;
-
-    regOffset1 = CPLD_REG_SFP_RX_LOSS;
-    regOffset2 = CPLD_REG_SFP_TX_FAIL;
-
     *status = 0;
+    onlp_sfp_bitmap_t_init(&bmap);
 
-    switch(port)
-    {
-    case 48:
-        mask = CPLD_SFP_1_BIT_MASK;
-        break;
-    case 49:
-        mask = CPLD_SFP_2_BIT_MASK;
-        break;
-    case 50:
-        mask = CPLD_SFP_3_BIT_MASK;
-        break;
-    case 51:
-        mask = CPLD_SFP_4_BIT_MASK;
-        break;
-    default:
-        return ONLP_STATUS_E_INTERNAL;
-    }
-
-    val1 = cpld_base__[regOffset1];
-    val2 = cpld_base__[regOffset2];
+    ONLP_IF_ERROR_RETURN(onlp_regmap_snapshot(&cpld__, CPLD_REG_SFP_RX_LOSS,
+                                              CPLD_REG_SFP_TX_FAIL - CPLD_REG_SFP_RX_LOSS + 1,
+                                              &snapshot));
 
     /* Report any current status flags for the SFP */
-    if ((val1 & mask) == mask)
-    {
+    ONLP_IF_ERROR_RETURN(onlp_regmap_snapshot_bitmap_get(&snapshot, &sfp_rx_los__, &bmap));
+    if(AIM_BITMAP_GET(&bmap, port)) {
         *status |= ONLP_SFP_CONTROL_FLAG_RX_LOS;
     }
 
-    if ((val2 & mask) == mask)
-    {
+    ONLP_IF_ERROR_RETURN(onlp_regmap_snapshot_bitmap_get(&snapshot, &sfp_tx_fault__, &bmap));
+    if(AIM_BITMAP_GET(&bmap, port)) {
         *status |= ONLP_SFP_CONTROL_FLAG_TX_FAULT;
     }
 
@@ -368,7 +244,9 @@ onlp_sfpi_control_set(int port, onlp_sfp_control_t control, int value)
     switch(control)
         {
         case ONLP_SFP_CONTROL_TX_DISABLE:
-            return tx_enable_set__(port, !value);
+            /* CPLD value: 0 = transmit enable, 1 = transmit disable */
+            return onlp_regmap_bitmap_port_set(&cpld__, &sfp_tx_disable__,
+                                               port, value);
         default:
             return ONLP_STATUS_E_UNSUPPORTED;
         }
@@ -381,8 +259,8 @@ onlp_sfpi_control_get(int port, onlp_sfp_control_t control, int* value)
         case ONLP_SFP_CONTROL_TX_DISABLE:
             {
                 int rv;
-                ONLP_IF_ERROR_RETURN(rv = tx_enable_get__(port, value));
-                *value = ! *value;
+                ONLP_IF_ERROR_RETURN(rv = onlp_regmap_bitmap_port_get(&cpld__, &sfp_tx_disable__, port));
+                *value = rv;
                 return ONLP_STATUS_OK;
             }
 
@@ -410,7 +288,10 @@ onlp_sfpi_control_get(int port, onlp_sfp_control_t control, int* value)
 int
 onlp_sfpi_denit(void)
 {
-    munmap((void*)cpld_base__, getpagesize());
+    if(cpld__.base) {
+        onlp_munmap((void*)cpld__.base, cpld__.size);
+        cpld__.base = NULL;
+    }
     return 0;
 }
 
@@ -125,3 +125,26 @@ onlp_thermali_info_get(onlp_oid_t id, onlp_thermal_info_t* info)
     return onlp_file_read_int(&info->mcelsius, devfiles__[tid]);							
 }
 
+/*
+ * Original limits of the LM75 sensors, restored when the
+ * thermal watchdog disarms their alarms.
+ */
+static onlp_file_hwmon_alarm_t alarms__[AIM_ARRAYSIZE(devfiles__)];
+
+int
+onlp_thermali_alarm_arm(onlp_oid_t id, int mcelsius, int* fd)
+{
+    int tid;
+    VALIDATE(id);
+
+    tid = ONLP_OID_ID_GET(id);
+    *fd = -1;
+
+    /* Only the LM75 sensors on the main board have programmable limits. */
+    if(tid < THERMAL_1_ON_MAIN_BROAD || tid > THERMAL_4_ON_MAIN_BROAD) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+
+    return onlp_file_hwmon_alarm_arm(alarms__ + tid, devfiles__[tid], mcelsius,
+                                     ONLP_CONFIG_THERMAL_WATCHDOG_HYSTERESIS, fd);
+}
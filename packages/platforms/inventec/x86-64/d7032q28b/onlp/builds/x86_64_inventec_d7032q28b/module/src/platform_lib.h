@@ -21,6 +21,10 @@
 #define INV_CTMP_PREFIX		"/sys/devices/platform/coretemp.0/hwmon/hwmon0/"
 
 #define INV_SFP_EEPROM_UPDATE	"/sys/class/swps/module/eeprom_update"
+#define INV_SFP_RESET_I2C	"/sys/class/swps/module/reset_i2c"
+#define INV_SFP_RESET_PWD	"inventec"
+/* The swps driver resets the i2c topology from its 300ms polling worker. */
+#define INV_SFP_POLLING_US	(300*1000)
 #define CHASSIS_SFP_COUNT	(32)
 
 /*
@@ -29,6 +29,19 @@ static const int sfp_mux_index[NUM_OF_SFP_PORT] = {
 
 #define FRONT_PORT_TO_MUX_INDEX(port) (sfp_mux_index[port])
 
+static int
+sfp_mux_index_to_port(int bus)
+{
+    int port;
+
+    for (port = 0; port < NUM_OF_SFP_PORT; port++) {
+        if (sfp_mux_index[port] == bus) {
+            return port;
+        }
+    }
+    return -1;
+}
+
 static int
 sfp_node_read_int(char *node_path, int *value, int data_len)
 {
@@ -53,6 +66,46 @@ sfp_get_port_path(int port, char *node_name)
     return sfp_node_path;
 }
 
+/*
+ * i2c recovery handlers. A module which fails an i2c operation first
+ * gets the muxes reset, then has its own reset pulsed in case it is
+ * holding the bus.
+ */
+static int
+sfp_i2c_mux_reset(int bus, uint8_t addr, void* cookie)
+{
+    if (sfp_mux_index_to_port(bus) < 0) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+    if (onlp_file_write_str(INV_SFP_RESET_PWD, INV_SFP_RESET_I2C) < 0) {
+        AIM_LOG_ERROR("Unable to reset the i2c muxes for bus %d\r\n", bus);
+        return ONLP_STATUS_E_INTERNAL;
+    }
+    /* Give the polling worker a chance to run the reset. */
+    usleep(INV_SFP_POLLING_US);
+    return ONLP_STATUS_OK;
+}
+
+static int
+sfp_i2c_bus_recover(int bus, void* cookie)
+{
+    int port = sfp_mux_index_to_port(bus);
+
+    if (port < 0) {
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+    if (onlp_file_write_int(0, sfp_get_port_path(port, "reset")) < 0) {
+        AIM_LOG_ERROR("Unable to reset port(%d)\r\n", port);
+        return ONLP_STATUS_E_INTERNAL;
+    }
+    usleep(10*1000);
+    if (onlp_file_write_int(1, sfp_get_port_path(port, "reset")) < 0) {
+        AIM_LOG_ERROR("Unable to release the reset of port(%d)\r\n", port);
+        return ONLP_STATUS_E_INTERNAL;
+    }
+    return ONLP_STATUS_OK;
+}
+
 /************************************************************
  *
  * SFPI Entry Points
@@ -61,7 +114,12 @@ sfp_get_port_path(int port, char *node_name)
 int
 onlp_sfpi_init(void)
 {
-    /* Called at initialization time */
+    onlp_i2c_recovery_t recovery = {
+        sfp_i2c_mux_reset, sfp_i2c_bus_recover, NULL
+    };
+
+    /* Enables i2c health tracking for the ports. */
+    onlp_i2c_recovery_register(&recovery);
     return ONLP_STATUS_OK;
 }
 
@@ -163,6 +221,15 @@ onlp_sfpi_dom_read(int port, uint8_t data[256])
     return onlp_sfpi_eeprom_read( port, data);
 }
 
+int
+onlp_sfpi_i2c_get(int port, int* bus, int* addr)
+{
+    /* Each port has its own mux channel. */
+    *bus = FRONT_PORT_TO_MUX_INDEX(port);
+    *addr = -1;
+    return ONLP_STATUS_OK;
+}
+
 int
 onlp_sfpi_dev_readb(int port, uint8_t devaddr, uint8_t addr)
 {
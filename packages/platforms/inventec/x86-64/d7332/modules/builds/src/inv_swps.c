@@ -28,6 +28,9 @@
 
 int io_no_init = 0;
 module_param(io_no_init, int, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+/*intr_driven: ports in a steady fsm state are only serviced when their IntL is asserted*/
+int intr_driven = 1;
+module_param(intr_driven, int, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
 u32 logLevel = SWPS_ERR_LEV | SWPS_INFO_LEV;
 //u32 logLevel = ERR_ALL_LEV | INFO_ALL_LEV | DBG_ALL_LEV;
 bool int_flag_monitor_en = false;
@@ -1836,6 +1839,12 @@ static ssize_t fsm_st_show(struct swps_kobj_t *swps_kobj, struct swps_attribute
     st = sff_fsm_st_get(sff_obj);
     return scnprintf(buf, BUF_SIZE, "%s\n", sff_fsm_st_str[st]);
 }
+static ssize_t st_latency_show(struct swps_kobj_t *swps_kobj, struct swps_attribute *attr,
+                               char *buf)
+{
+    struct sff_obj_t *sff_obj = swps_kobj->sff_obj;
+    return scnprintf(buf, BUF_SIZE, "%u\n", sff_obj->st_latency_ms);
+}
 static ssize_t lc_fsm_st_show(struct swps_kobj_t *swps_kobj, struct swps_attribute *attr,
                            char *buf)
 {
@@ -2439,6 +2448,8 @@ static struct swps_attribute sff_transvr_type_attr =
 
 static struct swps_attribute sff_fsm_st_attr =
     __ATTR(fsm_st, S_IRUGO, fsm_st_show, NULL);
+static struct swps_attribute sff_st_latency_attr =
+    __ATTR(st_latency, S_IRUGO, st_latency_show, NULL);
 
 static struct swps_attribute sff_prs_all_attr =
     __ATTR(prs, S_IRUGO, sff_prs_all_show, NULL);
@@ -2585,6 +2596,7 @@ static struct attribute *sfp_attributes[] = {
     /*transceiver identified info attribute*/
     &sff_transvr_type_attr.attr,
     &sff_fsm_st_attr.attr,
+    &sff_st_latency_attr.attr,
     //&sff_eeprom_dump_attr.attr,
     NULL
 
@@ -2623,6 +2635,7 @@ static struct attribute *qsfp_attributes[] = {
     /*transceiver identified info attribute*/
     &sff_transvr_type_attr.attr,
     &sff_fsm_st_attr.attr,
+    &sff_st_latency_attr.attr,
     &sff_eeprom_dump_attr.attr,
     &sff_page_attr.attr,
     NULL
@@ -2656,6 +2669,7 @@ static struct attribute *qsfp_dd_attributes[] = {
     /*transceiver identified info attribute*/
     //&sff_transvr_type_attr.attr,
     &sff_fsm_st_attr.attr,
+    &sff_st_latency_attr.attr,
     &sff_eeprom_dump_attr.attr,
     &sff_page_attr.attr,
     &sff_page_sel_lock_attr.attr,
@@ -3063,6 +3077,28 @@ int sff_fsm_kobj_change_event(struct sff_obj_t *sff_obj)
     kobject_uevent_env(&sff_kobj->kobj, KOBJ_CHANGE, uevent_envp);
     return 0;
 }
+/*notify user space that an insert/remove transition has settled*/
+int sff_fsm_st_chg_event(struct sff_obj_t *sff_obj, sff_fsm_state_t st)
+{
+    struct swps_kobj_t *sff_kobj = sff_obj->kobj;
+    char *uevent_envp[4];
+    char port_str[32];
+    char st_str[48];
+    char latency_str[32];
+
+    if (!p_valid(sff_kobj) || !p_valid(sff_obj->name)) {
+        return -EINVAL;
+    }
+    snprintf(port_str, sizeof(port_str), "%s=%s", "PORT", sff_obj->name);
+    snprintf(st_str, sizeof(st_str), "%s=%s", "STATE", sff_fsm_st_str[st]);
+    snprintf(latency_str, sizeof(latency_str), "%s=%u", "LATENCY_MS", sff_obj->st_latency_ms);
+    uevent_envp[0] = port_str;
+    uevent_envp[1] = st_str;
+    uevent_envp[2] = latency_str;
+    uevent_envp[3] = NULL;
+
+    return kobject_uevent_env(&sff_kobj->kobj, KOBJ_CHANGE, uevent_envp);
+}
 static int sff_kobj_add(struct sff_obj_t *sff_obj)
 {
     struct attribute_group *attr_group = &sfp_group;
@@ -3461,6 +3497,38 @@ int dummy_mode_sel_get(struct sff_obj_t *sff_obj, u8 *value)
     return -ENOSYS;
 
 }
+/*states in which the fsm only waits for a presence change or an interrupt*/
+static bool sff_fsm_st_is_steady(sff_fsm_state_t st)
+{
+    switch (st) {
+    case SFF_FSM_ST_IDLE:
+    case SFF_FSM_ST_READY:
+    case SFF_FSM_ST_SUSPEND:
+    case SFF_FSM_ST_FAULT:
+    case SFF_FSM_ST_ISOLATED:
+    case SFF_FSM_ST_UNKNOWN_TYPE:
+        return true;
+    default:
+        return false;
+    }
+}
+/*measure how long an insert/remove takes to settle in a steady state*/
+static void sff_fsm_st_latency_update(struct sff_obj_t *sff_obj, sff_fsm_state_t next_st)
+{
+    if (SFF_FSM_ST_INSERTED == next_st ||
+        SFF_FSM_ST_REMOVED == next_st) {
+        sff_obj->st_chg_ts = jiffies;
+        sff_obj->st_chg_pending = true;
+        return;
+    }
+    if (sff_obj->st_chg_pending && sff_fsm_st_is_steady(next_st)) {
+        sff_obj->st_chg_pending = false;
+        sff_obj->st_latency_ms = jiffies_to_msecs(jiffies - sff_obj->st_chg_ts);
+        SWPS_LOG_DBG("%s settled in %s after %u ms\n",
+                     sff_obj->name, sff_fsm_st_str[next_st], sff_obj->st_latency_ms);
+        sff_fsm_st_chg_event(sff_obj, next_st);
+    }
+}
 void sff_fsm_st_chg_process(struct sff_obj_t *sff_obj,
                                   sff_fsm_state_t cur_st,
                                   sff_fsm_state_t next_st)
@@ -3468,6 +3536,7 @@ void sff_fsm_st_chg_process(struct sff_obj_t *sff_obj,
     if (cur_st != next_st) {
 
         sff_fsm_delay_cnt_reset(sff_obj, next_st);
+        sff_fsm_st_latency_update(sff_obj, next_st);
         //SWPS_LOG_DBG("port:%d st change:%d -> %d\n",
         //            port, st,sff_fsm_st_get(sff_obj));
         if (p_valid(sff_obj->lc_name) && p_valid(sff_obj->name)) {
@@ -3557,15 +3626,52 @@ static void io_no_init_handler(struct lc_t *card)
     }
 
 }
+/*read the aggregated IntL status of all ports once per polling cycle*/
+static bool sff_intr_bitmap_get(struct sff_mgr_t *sff, unsigned long *bitmap)
+{
+    if (!intr_driven || sff->valid_port_num <= 0) {
+        return false;
+    }
+    if (!p_valid(sff->io_drv) || !p_valid(sff->io_drv->intr_all_get)) {
+        return false;
+    }
+    if (sff->io_drv->intr_all_get(sff->obj[0].lc_id, bitmap) < 0) {
+        return false;
+    }
+    return true;
+}
+/*a port in a steady state with IntL deasserted(high) has nothing to do*/
+static bool sff_fsm_is_quiet(struct sff_obj_t *sff_obj, unsigned long intr)
+{
+    if (SFP_TYPE == sff_obj->type) {
+        return false;
+    }
+    if (!sff_fsm_st_is_steady(sff_fsm_st_get(sff_obj))) {
+        return false;
+    }
+    return (test_bit(sff_obj->port, &intr) ? true : false);
+}
 static int sff_fsm_run(struct sff_mgr_t *sff)
 {
     int port = 0;
     int ret = 0;
     struct sff_obj_t *sff_obj = NULL;
     int port_num = sff->valid_port_num;
+    unsigned long intr = 0;
+    bool intr_valid = sff_intr_bitmap_get(sff, &intr);
 
     for(port = 0; port < port_num; port++) {
         sff_obj = &(sff->obj[port]);
+        if (intr_valid && sff_fsm_is_quiet(sff_obj, intr)) {
+            sff_fsm_cnt_run(sff_obj);
+            continue;
+        }
+        /* SFP ports have no IntL, they are never quiet. */
+        if (intr_valid && int_flag_monitor_en &&
+            SFP_TYPE != sff_obj->type &&
+            SFF_FSM_ST_READY == sff_fsm_st_get(sff_obj)) {
+            SWPS_LOG_DBG("%s IntL asserted\n", sff_obj->name);
+        }
         if (sff_fsm_delay_cnt_is_hit(sff_obj)) {
             ret = sff_obj->fsm.task(sff_obj);
             if (ret < 0) {
@@ -298,6 +298,9 @@ struct sff_obj_t {
     struct sff_mgr_t *mgr;
     struct func_tbl_t *func_tbl;
     bool page_sel_lock;
+    unsigned long st_chg_ts; /*jiffies when the pending insert/remove transition started*/
+    bool st_chg_pending;
+    unsigned int st_latency_ms; /*how long the last insert/remove transition took to settle*/
 };
 struct mux_ch_t {
     int i2c_ch;
@@ -574,6 +577,7 @@ void sff_fsm_st_set(struct sff_obj_t *sff_obj, sff_fsm_state_t st);
 void sff_fsm_state_change_process(struct sff_obj_t *sff_obj, sff_fsm_state_t cur_st, sff_fsm_state_t next_st);
 struct monitor_para_t *monitor_para_find(int type);
 int sff_fsm_kobj_change_event(struct sff_obj_t *sff_obj);
+int sff_fsm_st_chg_event(struct sff_obj_t *sff_obj, sff_fsm_state_t st);
 
 int i2c_smbus_write_byte_data_retry(struct i2c_client *client, u8 offset, u8 data);
 int i2c_smbus_read_byte_data_retry(struct i2c_client *client, u8 offset);
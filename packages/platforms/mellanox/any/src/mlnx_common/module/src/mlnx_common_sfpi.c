@@ -30,7 +30,12 @@
 #include <onlplib/file.h>
 #include <onlplib/i2c.h>
 #include <onlplib/sfp.h>
+#include <errno.h>
+#include <net/if.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
 #include "mlnx_common_log.h"
 #include "mlnx_common_int.h"
 
@@ -38,6 +43,39 @@
 #define SFP_SYSFS_VALUE_LEN    20
 static char sfp_node_path[MAX_SFP_PATH] = {0};
 
+#ifndef ETH_MODULE_SFF_8636_MAX_LEN
+#define ETH_MODULE_SFF_8636_MAX_LEN 640
+#endif
+
+#define SFP_EEPROM_SIZE        256
+#define SFP_EEPROM_PAGE_SIZE   128
+
+/*
+ * Vendor serial number location, used to detect module swaps
+ * without re-reading the whole EEPROM.
+ */
+#define SFP_SERIAL_OFFSET      68
+#define QSFP_SERIAL_OFFSET     196
+#define SFP_SERIAL_LEN         16
+
+/*
+ * Per-port module EEPROM cache.
+ *
+ * The identification EEPROM is cached after the first read and
+ * invalidated when the port's presence state changes or the vendor
+ * serial number no longer matches.
+ */
+typedef struct mc_sfp_cache_s {
+    int present;
+    int valid;
+    uint32_t type;
+    uint8_t eeprom[SFP_EEPROM_SIZE];
+} mc_sfp_cache_t;
+
+static mc_sfp_cache_t* sfp_cache__ = NULL;
+static int sfp_cache_size__ = 0;
+static int ethtool_fd__ = -1;
+
 int get_sfp_port_num(void);
 
 static int
@@ -89,25 +127,182 @@ mc_sfp_get_port_path(int port, char *node_name)
     return sfp_node_path;
 }
 
-static char*
-mc_sfp_convert_i2c_path(int port, int devaddr)
+static mc_sfp_cache_t*
+mc_sfp_cache_get(int port)
 {
-    sprintf(sfp_node_path, "%s/sfp%d", SFP_PATH, port);
-    return sfp_node_path;
+    if (sfp_cache__ == NULL) {
+        mlnx_platform_info_t* platform_info = get_platform_info();
+        sfp_cache_size__ = platform_info->sfp_num + 1;
+        sfp_cache__ = aim_zmalloc(sfp_cache_size__ * sizeof(*sfp_cache__));
+        int p;
+        for (p = 0; p < sfp_cache_size__; p++) {
+            sfp_cache__[p].present = -1;
+        }
+    }
+
+    if (port < 0 || port >= sfp_cache_size__) {
+        return NULL;
+    }
+    return sfp_cache__ + port;
+}
+
+static void
+mc_sfp_cache_presence_update(int port, int present)
+{
+    mc_sfp_cache_t* cache = mc_sfp_cache_get(port);
+
+    if (cache && cache->present != present) {
+        cache->present = present;
+        cache->valid = 0;
+    }
 }
 
 static int
-mc_sfp_prepare_eeprom_dump(int port, const char* path)
+mc_sfp_ethtool_ioctl(int port, void* data)
 {
-    char* cmd = aim_fstrdup("ethtool -m sfp%d raw on length 256 > %s", port, path);
+    struct ifreq ifr;
 
-    if(system(cmd) != 0) {
-        aim_free(cmd);
-        return ONLP_STATUS_E_INTERNAL;
+    if (ethtool_fd__ < 0) {
+        ethtool_fd__ = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (ethtool_fd__ < 0) {
+            AIM_LOG_ERROR("socket() failed: %{errno}", errno);
+            return ONLP_STATUS_E_INTERNAL;
+        }
+    }
+
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "sfp%d", port);
+    ifr.ifr_data = data;
+
+    if (ioctl(ethtool_fd__, SIOCETHTOOL, &ifr) < 0) {
+        return (errno == ENODEV) ? ONLP_STATUS_E_MISSING : ONLP_STATUS_E_INTERNAL;
+    }
+    return ONLP_STATUS_OK;
+}
+
+static int
+mc_sfp_module_type_get(int port, uint32_t* type, uint32_t* len)
+{
+    struct ethtool_modinfo modinfo;
+
+    memset(&modinfo, 0, sizeof(modinfo));
+    modinfo.cmd = ETHTOOL_GMODULEINFO;
+    ONLP_IF_ERROR_RETURN(mc_sfp_ethtool_ioctl(port, &modinfo));
+
+    *type = modinfo.type;
+    if (len) {
+        *len = modinfo.eeprom_len;
+    }
+    return ONLP_STATUS_OK;
+}
+
+/*
+ * Read from the module EEPROM through SIOCETHTOOL/ETHTOOL_GMODULEEEPROM.
+ *
+ * The driver exposes the module as a linear address space:
+ *   SFF-8472:        A0h at 0-255, A2h at 256-511.
+ *   SFF-8436/8636:   lower page at 0-127, upper page N at 128 + N*128.
+ */
+static int
+mc_sfp_module_read(int port, uint32_t offset, uint32_t len, uint8_t* data)
+{
+    int rv;
+    struct ethtool_eeprom* eeprom;
+
+    eeprom = aim_zmalloc(sizeof(*eeprom) + len);
+    eeprom->cmd = ETHTOOL_GMODULEEEPROM;
+    eeprom->offset = offset;
+    eeprom->len = len;
+
+    rv = mc_sfp_ethtool_ioctl(port, eeprom);
+    if (rv == ONLP_STATUS_OK) {
+        memcpy(data, eeprom->data, len);
+    }
+    aim_free(eeprom);
+    return rv;
+}
+
+/*
+ * Map an (i2c address, page, offset) triple onto the driver's
+ * linear module EEPROM address space.
+ */
+static int
+mc_sfp_module_page_read(int port, uint8_t devaddr, int page, int addr,
+                        int len, uint8_t* data)
+{
+    uint32_t type, offset;
+
+    ONLP_IF_ERROR_RETURN(mc_sfp_module_type_get(port, &type, NULL));
+
+    switch (type) {
+    case ETH_MODULE_SFF_8079:
+    case ETH_MODULE_SFF_8472:
+        if (page != 0) {
+            return ONLP_STATUS_E_PARAM;
+        }
+        if (devaddr == 0x51) {
+            if (type != ETH_MODULE_SFF_8472) {
+                return ONLP_STATUS_E_UNSUPPORTED;
+            }
+            offset = SFP_EEPROM_SIZE + addr;
+        } else {
+            offset = addr;
+        }
+        break;
+
+    case ETH_MODULE_SFF_8436:
+    case ETH_MODULE_SFF_8636:
+        if (devaddr != 0x50) {
+            return ONLP_STATUS_E_PARAM;
+        }
+        if (addr < SFP_EEPROM_PAGE_SIZE || page == 0) {
+            offset = addr;
+        } else {
+            offset = page * SFP_EEPROM_PAGE_SIZE + addr;
+        }
+        if (offset + len > ETH_MODULE_SFF_8636_MAX_LEN) {
+            return ONLP_STATUS_E_PARAM;
+        }
+        break;
+
+    default:
+        return ONLP_STATUS_E_UNSUPPORTED;
+    }
+
+    return mc_sfp_module_read(port, offset, len, data);
+}
+
+static int
+mc_sfp_serial_offset(uint32_t type)
+{
+    return (type == ETH_MODULE_SFF_8436 || type == ETH_MODULE_SFF_8636) ?
+        QSFP_SERIAL_OFFSET : SFP_SERIAL_OFFSET;
+}
+
+/*
+ * Returns true if the cached EEPROM still describes the inserted module.
+ */
+static int
+mc_sfp_cache_check(int port, mc_sfp_cache_t* cache)
+{
+    uint32_t type;
+    uint8_t serial[SFP_SERIAL_LEN];
+    int offset;
+
+    if (!cache->valid) {
+        return 0;
+    }
+
+    if (mc_sfp_module_type_get(port, &type, NULL) < 0 || type != cache->type) {
+        return 0;
     }
-    aim_free(cmd);
 
-	return ONLP_STATUS_OK;
+    offset = mc_sfp_serial_offset(type);
+    if (mc_sfp_module_read(port, offset, sizeof(serial), serial) < 0) {
+        return 0;
+    }
+
+    return memcmp(serial, cache->eeprom + offset, sizeof(serial)) == 0;
 }
 
 /************************************************************
@@ -153,6 +348,7 @@ onlp_sfpi_is_present(int port)
         return ONLP_STATUS_E_INTERNAL;
     }
 
+    mc_sfp_cache_presence_update(port, present);
     return present;
 }
 
@@ -174,12 +370,10 @@ onlp_sfpi_presence_bitmap_get(onlp_sfp_bitmap_t* dst)
 int
 onlp_sfpi_eeprom_read(int port, uint8_t data[256])
 {
-    char* path = mc_sfp_get_port_path(port, NULL);
+    int rv;
+    uint32_t type;
+    mc_sfp_cache_t* cache = mc_sfp_cache_get(port);
 
-	if (mc_sfp_prepare_eeprom_dump(port, path) != ONLP_STATUS_OK) {
-            AIM_LOG_ERROR("Unable to prepare sfp%d eeprom dump\r\n", port);
-            return ONLP_STATUS_E_INTERNAL;
-	}
     /*
      * Read the SFP eeprom into data[]
      *
@@ -188,70 +382,85 @@ onlp_sfpi_eeprom_read(int port, uint8_t data[256])
      */
     memset(data, 0, 256);
 
-    if (onlplib_sfp_eeprom_read_file(path, data) != 0) {
+    if (cache == NULL) {
+        return ONLP_STATUS_E_PARAM;
+    }
+
+    if ((rv = onlp_sfpi_is_present(port)) < 0) {
+        return rv;
+    }
+    if (rv == 0) {
+        return ONLP_STATUS_E_MISSING;
+    }
+
+    if (mc_sfp_cache_check(port, cache)) {
+        memcpy(data, cache->eeprom, SFP_EEPROM_SIZE);
+        return ONLP_STATUS_OK;
+    }
+
+    cache->valid = 0;
+    if (mc_sfp_module_type_get(port, &type, NULL) < 0 ||
+        mc_sfp_module_read(port, 0, SFP_EEPROM_SIZE, cache->eeprom) < 0) {
         AIM_LOG_ERROR("Unable to read eeprom from port(%d)\r\n", port);
         return ONLP_STATUS_E_INTERNAL;
     }
+    cache->type = type;
+    cache->valid = 1;
 
+    memcpy(data, cache->eeprom, SFP_EEPROM_SIZE);
     return ONLP_STATUS_OK;
 }
 
 int
-onlp_sfpi_dev_readb(int port, uint8_t devaddr, uint8_t addr)
+onlp_sfpi_dom_read(int port, uint8_t data[256])
 {
-    char* path = mc_sfp_convert_i2c_path(port, devaddr);
-    uint8_t data;
-    int fd;
-    int nrd;
-
-    if (!path)
-		return ONLP_STATUS_E_MISSING;
+    memset(data, 0, 256);
+    return mc_sfp_module_page_read(port, 0x51, 0, 0, 256, data);
+}
 
-    fd = open(path, O_RDONLY);
-    if (fd < 0)
-		return ONLP_STATUS_E_MISSING;
+int
+onlp_sfpi_dev_read(int port, uint8_t devaddr, uint8_t addr,
+                   uint8_t* rdata, int size)
+{
+    if (size <= 0 || addr + size > SFP_EEPROM_SIZE) {
+        return ONLP_STATUS_E_PARAM;
+    }
+    return mc_sfp_module_page_read(port, devaddr, 0, addr, size, rdata);
+}
 
-    lseek(fd, addr, SEEK_SET);
-    nrd = read(fd, &data, 1);
-    close(fd);
+int
+onlp_sfpi_dev_readb(int port, uint8_t devaddr, uint8_t addr)
+{
+    uint8_t data;
 
-    if (nrd != 1) {
-		AIM_LOG_INTERNAL("Failed to read EEPROM file '%s'", path);
-		return ONLP_STATUS_E_INTERNAL;
-    }
+    ONLP_IF_ERROR_RETURN(mc_sfp_module_page_read(port, devaddr, 0, addr,
+                                                 1, &data));
     return data;
 }
 
 int
 onlp_sfpi_dev_readw(int port, uint8_t devaddr, uint8_t addr)
 {
-    char* path = mc_sfp_convert_i2c_path(port, devaddr);
     uint16_t data;
-    int fd;
-    int nrd;
 
-    if (!path){
-		return ONLP_STATUS_E_MISSING;
-    }
-
-    fd = open(path, O_RDONLY);
-    if (fd < 0) {
-		return ONLP_STATUS_E_MISSING;
-    }
-
-    lseek(fd, addr, SEEK_SET);
-    nrd = read(fd, &data, 2);
-    close(fd);
-
-    if (nrd != 2) {
-		AIM_LOG_INTERNAL("Failed to read EEPROM file '%s'", path);
-		return ONLP_STATUS_E_INTERNAL;
+    if (addr + sizeof(data) > SFP_EEPROM_SIZE) {
+        return ONLP_STATUS_E_PARAM;
     }
+    ONLP_IF_ERROR_RETURN(mc_sfp_module_page_read(port, devaddr, 0, addr,
+                                                 sizeof(data),
+                                                 (uint8_t*)&data));
     return data;
 }
 
 int
 onlp_sfpi_denit(void)
 {
+    if (ethtool_fd__ >= 0) {
+        close(ethtool_fd__);
+        ethtool_fd__ = -1;
+    }
+    aim_free(sfp_cache__);
+    sfp_cache__ = NULL;
+    sfp_cache_size__ = 0;
     return ONLP_STATUS_OK;
 }
@@ -0,0 +1,197 @@
+#!/usr/bin/python2
+############################################################
+#
+# Compression Benchmark
+#
+# Reports the image size and the cold read throughput of the
+# SWI squashfs and the initrd for a set of compression
+# specifications (see onlcompress.py). Run it on the target
+# platform to choose the compression settings for that
+# platform's architecture.
+#
+############################################################
+import argparse
+import os
+import sys
+import json
+import time
+import ctypes
+import shutil
+import tempfile
+import subprocess
+import onlcompress
+
+DEFAULT_SPECS = [
+    'gzip',
+    'lz4',
+    'lz4:hc=1',
+    'zstd:level=3',
+    'zstd:level=15',
+    'xz',
+    'xz:dict=1M,block=1M',
+    ]
+
+POSIX_FADV_DONTNEED = 4
+
+libc = ctypes.CDLL(None, use_errno=True)
+
+# The 64-bit offset variant has the same signature on every target,
+# with or without large file support.
+posix_fadvise64 = libc.posix_fadvise64
+posix_fadvise64.argtypes = [ ctypes.c_int, ctypes.c_int64, ctypes.c_int64, ctypes.c_int ]
+posix_fadvise64.restype = ctypes.c_int
+
+def drop_cache(fname):
+    """Evict fname from the page cache so the next read is cold."""
+    fd = os.open(fname, os.O_RDONLY)
+    try:
+        os.fsync(fd)
+        # Returns the error number rather than setting errno.
+        rv = posix_fadvise64(fd, 0, 0, POSIX_FADV_DONTNEED)
+    finally:
+        os.close(fd)
+
+    if rv != 0:
+        if os.geteuid() != 0:
+            raise OSError(rv, "posix_fadvise(%s): %s" % (fname, os.strerror(rv)))
+        # Drop the whole page cache instead.
+        subprocess.check_call([ 'sync' ])
+        with open('/proc/sys/vm/drop_caches', 'w') as f:
+            f.write('1\n')
+
+def timed(cmd):
+    start = time.time()
+    subprocess.check_call(cmd, shell=True)
+    return time.time() - start
+
+def tree_size(dir_):
+    return int(subprocess.check_output([ 'du', '-sb', dir_ ]).split()[0])
+
+
+class CompressionBench(object):
+
+    def __init__(self, workdir, repeat=1, mount=False):
+        self.workdir = workdir
+        self.repeat = repeat
+        self.mount = mount
+        self.results = []
+
+    def __best(self, f):
+        return min(f() for i in range(self.repeat))
+
+    def __report(self, kind, spec, raw, size, ctime, rtime, error=None):
+        r = dict(kind=kind, spec=spec, raw=raw, size=size,
+                 compress=ctime, read=rtime, error=error)
+        if error:
+            print "%-7s %-24s %s" % (kind, spec, error)
+        else:
+            print "%-7s %-24s %10.1f %6.1f%% %10.1f %9.2f %9.1f" % (
+                kind, spec, size / 1048576.0, 100.0 * size / max(raw, 1), ctime, rtime,
+                raw / 1048576.0 / max(rtime, 1e-6))
+        sys.stdout.flush()
+        self.results.append(r)
+
+    def __squash_read(self, image):
+        if self.mount:
+            # Reads through the kernel squashfs driver, as at boot.
+            mnt = os.path.join(self.workdir, 'mnt')
+            if not os.path.exists(mnt):
+                os.makedirs(mnt)
+            drop_cache(image)
+            subprocess.check_call("mount -t squashfs -o loop,ro %s %s" % (image, mnt), shell=True)
+            try:
+                return timed("tar -C %s -cf - . | cat >/dev/null" % mnt)
+            finally:
+                subprocess.check_call("umount %s" % mnt, shell=True)
+        else:
+            out = os.path.join(self.workdir, 'unsquashfs')
+            drop_cache(image)
+            try:
+                return timed("unsquashfs -f -n -d %s %s >/dev/null" % (out, image))
+            finally:
+                shutil.rmtree(out, ignore_errors=True)
+
+    def squashfs(self, rootfs, specs):
+        if os.path.isfile(rootfs):
+            src = os.path.join(self.workdir, 'rootfs')
+            subprocess.check_call("unsquashfs -f -n -d %s %s >/dev/null" % (src, rootfs), shell=True)
+            rootfs = src
+        raw = tree_size(rootfs)
+
+        for (i, spec) in enumerate(specs):
+            image = os.path.join(self.workdir, 'rootfs-%d.sqsh' % i)
+            try:
+                c = onlcompress.OnlCompression(spec)
+                ctime = timed("mksquashfs %s %s -noappend -no-progress %s >/dev/null" %
+                              (rootfs, image, c.squashfs_args()))
+                rtime = self.__best(lambda: self.__squash_read(image))
+                self.__report('squash', str(c), raw, os.path.getsize(image), ctime, rtime)
+            except (subprocess.CalledProcessError, onlcompress.OnlCompressionError), e:
+                self.__report('squash', spec, raw, 0, 0, 0, error="failed: %s" % e)
+            finally:
+                if os.path.exists(image):
+                    os.unlink(image)
+
+    def __stream_read(self, fname):
+        drop_cache(fname)
+        return timed("%s >/dev/null" % onlcompress.OnlCompression.decompress_command(fname))
+
+    def initrd(self, initrd, specs):
+        src = os.path.join(self.workdir, 'initrd.cpio')
+        subprocess.check_call("%s > %s" % (onlcompress.OnlCompression.decompress_command(initrd), src), shell=True)
+        raw = os.path.getsize(src)
+
+        for (i, spec) in enumerate(specs):
+            out = os.path.join(self.workdir, 'initrd-%d' % i)
+            try:
+                c = onlcompress.OnlCompression(spec)
+                ctime = timed("%s < %s > %s" % (c.stream_command(), src, out))
+                rtime = self.__best(lambda: self.__stream_read(out))
+                self.__report('initrd', str(c), raw, os.path.getsize(out), ctime, rtime)
+            except (subprocess.CalledProcessError, onlcompress.OnlCompressionError), e:
+                self.__report('initrd', spec, raw, 0, 0, 0, error="failed: %s" % e)
+            finally:
+                if os.path.exists(out):
+                    os.unlink(out)
+
+
+if __name__ == '__main__':
+
+    ap = argparse.ArgumentParser(description="ONL Compression Benchmark")
+    ap.add_argument("--rootfs", metavar='DIR|SQSH', help="Root filesystem directory or squashfs image.")
+    ap.add_argument("--initrd", metavar='CPIO', help="Initrd cpio, compressed or not.")
+    ap.add_argument("--specs", nargs='+', metavar='SPEC', default=DEFAULT_SPECS,
+                    help="The compression specifications to compare.")
+    ap.add_argument("--mount", action='store_true',
+                    help="Read the squashfs through a loop mount instead of unsquashfs (requires root).")
+    ap.add_argument("--repeat", type=int, default=1, help="Report the best of N reads.")
+    ap.add_argument("--workdir", help="Scratch directory. It should be on the target storage.")
+    ap.add_argument("--json", metavar='FILE', help="Also write the results to FILE.")
+    ops = ap.parse_args()
+
+    if not ops.rootfs and not ops.initrd:
+        ap.error("at least one of --rootfs or --initrd is required")
+
+    if ops.rootfs and os.geteuid() != 0:
+        sys.stderr.write("warning: not running as root, some rootfs files may not be readable.\n")
+
+    workdir = ops.workdir or tempfile.mkdtemp(prefix="compression-bench-")
+    if not os.path.exists(workdir):
+        os.makedirs(workdir)
+
+    bench = CompressionBench(workdir, repeat=max(1, ops.repeat), mount=ops.mount)
+
+    print "%-7s %-24s %10s %7s %10s %9s %9s" % ("image", "compression", "size(MB)", "ratio",
+                                               "compress(s)", "read(s)", "MB/s")
+    try:
+        if ops.rootfs:
+            bench.squashfs(ops.rootfs, ops.specs)
+        if ops.initrd:
+            bench.initrd(ops.initrd, ops.specs)
+    finally:
+        if not ops.workdir:
+            shutil.rmtree(workdir, ignore_errors=True)
+
+    if ops.json:
+        with open(ops.json, "w") as f:
+            json.dump(bench.results, f, indent=2)
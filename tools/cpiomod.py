@@ -5,14 +5,16 @@ import argparse
 import subprocess
 import shutil
 import tempfile
+import onlcompress
 
 ap = argparse.ArgumentParser(description="CPIO Modify Tool.")
 
-ap.add_argument("--cpio", help="Input cpio gzip", required=True)
+ap.add_argument("--cpio", help="Input cpio (any supported compression)", required=True)
 ap.add_argument("--add-directory", nargs='+', help="Add the given directory to the root of the cpio.", default=[])
 ap.add_argument("--makedevs", nargs='+', help="Run makedevs", default=[])
 ap.add_argument("--ls", action='store_true', help="List files in CPIO and exit.")
 ap.add_argument("--out", help="New CPIO")
+ap.add_argument("--compression", help="New CPIO compression. See onlcompress.py.", default='gzip')
 
 ops = ap.parse_args()
 
@@ -29,8 +31,8 @@ class CpioManager(object):
 
     def open(self, cpio):
         self.dir = tempfile.mkdtemp()
-        if os.system("cd %s && gzip -dc %s | sudo cpio -id" % (
-                self.dir, os.path.abspath(cpio))) != 0:
+        if os.system("cd %s && %s | sudo cpio -id" % (
+                self.dir, onlcompress.OnlCompression.decompress_command(os.path.abspath(cpio)))) != 0:
             raise Exception("Could not unpack cpio %s" % cpio)
 
     def add_directory(self, directory):
@@ -44,15 +46,18 @@ class CpioManager(object):
         if os.system("sudo %s -d %s %s" % (os.path.join(os.getenv('SWITCHLIGHT'), "tools", "makedevs"), os.path.abspath(devfile), self.dir)) != 0:
             raise Exception("Could not run makedevs")
 
-    def close(self, ncpio):
+    def close(self, ncpio, compression='gzip'):
         if ncpio:
-            os.system("cd %s && find . | sudo cpio -H newc -o | gzip -f > %s" % (self.dir, os.path.abspath(ncpio)))
+            os.system("cd %s && find . | sudo cpio -H newc -o | %s > %s" % (self.dir, onlcompress.OnlCompression(compression).stream_command(), os.path.abspath(ncpio)))
         os.system("sudo rm -rf %s" % (self.dir))
         self.dir = None
         
     def list(self):
         os.system("cd %s && find . -exec ls -l {} \; " % (self.dir))
 
+# Check the compression before unpacking.
+onlcompress.OnlCompression(ops.compression)
+
 cm = CpioManager()
 cm.open(ops.cpio)
 
@@ -66,7 +71,7 @@ for d in ops.add_directory:
 for md in ops.makedevs:
     cm.makedevs(md)
 
-cm.close(ops.out)
+cm.close(ops.out, ops.compression)
 
         
         
@@ -14,6 +14,7 @@ onldir = os.path.dirname(toolsdir)
 pydir = os.path.join(onldir, "packages/base/all/vendor-config-onl/src/python")
 sys.path.append(pydir)
 import onl.YamlUtils
+import onlcompress
 
 from onlpm import *
 pm = defaultPm()
@@ -91,6 +92,20 @@ class KernelImage(Image):
         Image.__init__(self, "kernel", fdata, compression='gzip')
         self.os = '"linux"'
 
+        # Kernel payloads are packaged gzipped. U-Boot decompresses
+        # them, so other compressors require a new payload.
+        comp = onlcompress.OnlCompression(ops.kernel_compression)
+        if comp.name != 'gzip':
+            (self.compression, cmd) = comp.fit_command()
+            if self.data not in payloads:
+                # Written to the current directory for use by the its file.
+                payload = "%s.%s" % (os.path.splitext(self.name)[0], self.compression)
+                if os.system("%s | %s > %s" % (onlcompress.OnlCompression.decompress_command(self.data),
+                                               cmd, payload)) != 0:
+                    raise RuntimeError("Could not compress %s" % self.data)
+                payloads[self.data] = os.path.abspath(payload)
+            self.data = payloads[self.data]
+
         # Fixme -- thse should be parameterized
         if arch == 'powerpc':
             self.load = "<0x0>"
@@ -113,6 +128,11 @@ class InitrdImage(Image):
     def __init__(self, fdata, arch):
         Image.__init__(self, "ramdisk", fdata, compression='gzip')
 
+        # The kernel unpacks the ramdisk, and detects its compression.
+        # Only declare gzip, as U-Boot may try to unpack anything else.
+        if os.path.exists(self.data) and onlcompress.OnlCompression.detect(self.data) != 'gzip':
+            self.compression = 'none'
+
         # Fixme -- thse should be parameterized
         if arch == 'powerpc':
             self.load = "<0x1000000>"
@@ -307,8 +327,13 @@ if __name__ == '__main__':
     ap.add_argument("--itb", metavar='itb-file', help="Compile result to an image tree blob file.")
     ap.add_argument("--its", metavar='its-file', help="Write result to an image tree source file.")
     ap.add_argument("--arch", choices=['powerpc', 'armel', 'armhf', 'arm64'], required=True)
+    ap.add_argument("--kernel-compression", metavar='SPEC', default='gzip',
+                    help="The kernel image compression. See onlcompress.py.")
     ops=ap.parse_args()
 
+    # Recompressed kernel payloads
+    payloads = {}
+
     fit = FlatImageTree(ops.desc)
     initrd=None
 
@@ -0,0 +1,192 @@
+#!/usr/bin/python2
+############################################################
+#
+# ONL Compression Settings
+#
+# The SWI squashfs, the initrds and the FIT payloads are
+# compressed according to a compression specification:
+#
+#     <compressor>[:<setting>=<value>[,<setting>=<value>...]]
+#
+# For example:
+#
+#     gzip
+#     gzip:level=6
+#     xz:dict=1M,block=1M,bcj=arm
+#     lz4:hc=1
+#     zstd:level=19,block=256K
+#
+# The target kernel (and U-Boot, for FIT kernels) must support
+# the compressor. The default for all payloads is gzip.
+#
+############################################################
+import os
+import sys
+import argparse
+
+class OnlCompressionError(Exception):
+    """General Error Exception"""
+    def __init__(self, value):
+        self.value = value
+
+    def __str__(self):
+        return repr(self.value)
+
+
+class OnlCompression(object):
+
+    # The settings accepted by each compressor.
+    #   level : compression level
+    #   block : squashfs block size
+    #   dict  : xz dictionary size
+    #   bcj   : xz branch/call/jump filter (x86, powerpc, arm, armthumb, ...)
+    #   hc    : lz4 high compression mode
+    SETTINGS = {
+        'gzip' : [ 'level', 'block' ],
+        'xz'   : [ 'level', 'block', 'dict', 'bcj' ],
+        'lz4'  : [ 'hc', 'block' ],
+        'zstd' : [ 'level', 'block' ],
+        }
+
+    DEFAULT_LEVEL = {
+        'gzip' : 6,
+        'xz' : 6,
+        'zstd' : 15,
+        }
+
+    # Stream magic numbers, used to pick a decompressor.
+    MAGIC = [
+        ('\x1f\x8b', 'gzip'),
+        ('\xfd7zXZ\x00', 'xz'),
+        ('\x02\x21\x4c\x18', 'lz4'),
+        ('\x04\x22\x4d\x18', 'lz4'),
+        ('\x28\xb5\x2f\xfd', 'zstd'),
+        ('BZh', 'bzip2'),
+        ('\x5d\x00\x00', 'lzma'),
+        ]
+
+    DECOMPRESS = {
+        'gzip' : 'gzip -dc',
+        'xz' : 'xz -dc',
+        'lz4' : 'lz4 -dc',
+        'zstd' : 'zstd -dc',
+        'bzip2' : 'bzip2 -dc',
+        'lzma' : 'xz --format=lzma -dc',
+        }
+
+    def __init__(self, spec):
+        (name, _, settings) = spec.strip().partition(':')
+        if name not in self.SETTINGS:
+            raise OnlCompressionError("Unknown compressor '%s'. Supported compressors are %s." %
+                                      (name, ", ".join(sorted(self.SETTINGS))))
+        self.name = name
+        self.settings = {}
+        for s in settings.split(',') if settings else []:
+            (k, _, v) = s.partition('=')
+            if k not in self.SETTINGS[name]:
+                raise OnlCompressionError("Setting '%s' is not supported by %s." % (k, name))
+            self.settings[k] = v
+
+    def __str__(self):
+        s = ",".join("%s=%s" % (k, self.settings[k]) for k in sorted(self.settings))
+        return "%s:%s" % (self.name, s) if s else self.name
+
+    def level(self):
+        return int(self.settings.get('level', self.DEFAULT_LEVEL.get(self.name, 0)))
+
+    def hc(self):
+        return self.settings.get('hc', '0') not in [ '0', 'no', 'false' ]
+
+    def __dict(self):
+        # Percentages of the block size only apply to squashfs.
+        d = self.settings.get('dict', '')
+        if d and not d.endswith('%'):
+            return ",dict=%s%s" % (d, "iB" if d[-1] in "KMG" else "")
+        return ""
+
+    def squashfs_args(self):
+        """The mksquashfs options for this specification."""
+        args = [ '-comp', self.name ]
+        if 'block' in self.settings:
+            args += [ '-b', self.settings['block'] ]
+        if self.name in [ 'gzip', 'zstd' ] and 'level' in self.settings:
+            args += [ '-Xcompression-level', self.settings['level'] ]
+        if self.name == 'xz':
+            if 'dict' in self.settings:
+                args += [ '-Xdict-size', self.settings['dict'] ]
+            if 'bcj' in self.settings:
+                args += [ '-Xbcj', self.settings['bcj'] ]
+        if self.name == 'lz4' and self.hc():
+            args += [ '-Xhc' ]
+        return " ".join(args)
+
+    def stream_command(self):
+        """Compress stdin to stdout in a format the kernel can unpack as an initramfs."""
+        if self.name == 'gzip':
+            return "gzip -c -n -%d" % self.level()
+        if self.name == 'xz':
+            # The kernel xz decoder only supports crc32 checks.
+            bcj = "--%s " % self.settings['bcj'] if 'bcj' in self.settings else ""
+            return "xz -c --check=crc32 %s--lzma2=preset=%d%s" % (bcj, self.level(), self.__dict())
+        if self.name == 'lz4':
+            # The kernel only supports the legacy lz4 format.
+            return "lz4 -c -l %s" % ("-9" if self.hc() else "-1")
+        if self.name == 'zstd':
+            return "zstd -c -q %s-%d" % ("--ultra " if self.level() > 19 else "", self.level())
+
+    def fit_command(self):
+        """Returns (compression, command) for a FIT kernel image.
+
+        U-Boot decompresses FIT kernels itself. It does not support
+        xz, so xz settings produce a legacy lzma stream."""
+        if self.name == 'xz':
+            return ('lzma', "xz -c --format=lzma --lzma1=preset=%d%s" % (self.level(), self.__dict()))
+        if self.name == 'lz4':
+            return ('lz4', "lz4 -c %s" % ("-9" if self.hc() else "-1"))
+        return (self.name, self.stream_command())
+
+    @classmethod
+    def detect(klass, fname):
+        """Returns the compressor used for the given file, or None."""
+        with open(fname, 'rb') as f:
+            magic = f.read(8)
+        for (m, name) in klass.MAGIC:
+            if magic.startswith(m):
+                return name
+        return None
+
+    @classmethod
+    def decompress_command(klass, fname):
+        """Returns the command which decompresses the given file to stdout."""
+        name = klass.detect(fname)
+        if name is None:
+            return "cat %s" % fname
+        return "%s %s" % (klass.DECOMPRESS[name], fname)
+
+
+if __name__ == '__main__':
+
+    ap = argparse.ArgumentParser(description="ONL Compression Settings")
+    ap.add_argument("spec", nargs='?', default='gzip', help="The compression specification.")
+    ap.add_argument("--squashfs", action='store_true', help="Show the mksquashfs options.")
+    ap.add_argument("--stream", action='store_true', help="Show the initrd compression command.")
+    ap.add_argument("--fit", action='store_true', help="Show the FIT kernel compression and command.")
+    ap.add_argument("--detect", metavar='FILE', help="Show the compressor used for FILE.")
+    ops = ap.parse_args()
+
+    try:
+        if ops.detect:
+            print OnlCompression.detect(ops.detect) or "none"
+            sys.exit(0)
+
+        c = OnlCompression(ops.spec)
+        if ops.squashfs:
+            print c.squashfs_args()
+        if ops.stream:
+            print c.stream_command()
+        if ops.fit:
+            print "%s %s" % c.fit_command()
+
+    except OnlCompressionError, e:
+        sys.stderr.write("error: %s\n" % e.value)
+        sys.exit(1)
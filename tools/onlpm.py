@@ -22,6 +22,12 @@ import re
 import json
 import lsb_release
 import cPickle as pickle
+import hashlib
+import fnmatch
+import time
+import heapq
+import multiprocessing
+import signal
 
 g_dist_codename = lsb_release.get_distro_information().get('CODENAME')
 
@@ -944,15 +950,629 @@ class OnlPackageRepo(object):
         with self.lock:
             return self.r.contents(pkg)
 
+class OnlPackageBuildCache(object):
+    """Content-addressed Package Build Cache
+
+    The packages produced by a package group are stored under a key
+    computed from the build inputs of the group:
+
+      1. The package specifications, after templating.
+      2. The contents of the package group directory.
+      3. The contents of every package directory the group reads
+         through yaml '!include' directives and makefile 'include'
+         directives, followed recursively, and of the modules named
+         in its DEPENDMODULES.
+      4. The contents of every submodule under $ONL/sm, of the
+         prerequisite submodules, and of $ONL/make.
+      5. The contents of any additional 'cache-inputs' paths
+         declared by the package group.
+      6. The contents of the prerequisite packages.
+      7. The toolchain and the distribution.
+
+    Inputs are found by scanning the build files, not by asking make,
+    so a group which reads files some other way must declare them
+    in 'cache-inputs'.
+
+    When the key is found the packages are restored from the cache
+    instead of being rebuilt.
+
+    Package groups with 'release' files are not cached, since those files
+    come from the build tree rather than the packages. Package groups
+    can also opt out with 'cache: False'."""
+
+    TOOLCHAINS = {
+        'amd64' : 'x86_64-linux-gnu',
+        'arm64' : 'aarch64-linux-gnu',
+        'armel' : 'arm-linux-gnueabi',
+        'armhf' : 'arm-linux-gnueabihf',
+        'powerpc' : 'powerpc-linux-gnu',
+        }
+
+    # Build products which may be left in the package tree.
+    EXCLUDES = [ 'BUILD', '.lock', '*.deb', '.PKGs.cache*', '*.pyc' ]
+
+    YAML_INCLUDE = re.compile(r'!include\s+(\S+)((?:\s+\w+=\S*)*)')
+    MAKE_INCLUDE = re.compile(r'^\s*-?include\s+(.+?)\s*$', re.MULTILINE)
+    MAKE_DEPENDMODULES = re.compile(r'^\s*DEPENDMODULES\s*[:+?]?=(.*)$', re.MULTILINE)
+    VARIABLE = re.compile(r'\$(?:\((\w+)\)|\{(\w+)\}|(\w+))')
+
+    def __init__(self, root):
+        self.root = os.path.join(root, g_dist_codename)
+        if not os.path.exists(self.root):
+            os.makedirs(self.root)
+        self.lock = onlu.Lock(os.path.join(self.root, '.lock'))
+        self.trees = {}
+        self.toolchains = {}
+        self.modules = None
+
+    def cacheable(self, pg):
+        return 'release' not in pg._pkgs and pg._pkgs.get('cache', True)
+
+    @staticmethod
+    def __normalize(s):
+        # Keys do not depend on the location of the build tree.
+        onl = os.getenv('ONL')
+        return s.replace(onl, '$ONL') if onl else s
+
+    def __excluded(self, path):
+        for c in path.split(os.sep):
+            for e in self.EXCLUDES:
+                if fnmatch.fnmatch(c, e):
+                    return True
+        return False
+
+    @staticmethod
+    def __hash_file(h, path):
+        if os.path.islink(path):
+            h.update(os.readlink(path))
+            return
+        with open(path, 'rb') as f:
+            for data in iter(lambda: f.read(1024 * 1024), ''):
+                h.update(data)
+
+    def __tree_git(self, path):
+        with open(os.devnull, 'w') as null:
+            top = subprocess.check_output(['git', '-C', path, 'rev-parse', '--show-toplevel'],
+                                          stderr=null).strip()
+            # Index contents, by blob hash, for tracked files.
+            index = subprocess.check_output(['git', '-C', path, 'ls-files', '-s', '-z', '--', '.'],
+                                            stderr=null)
+            # Working tree contents for changed or untracked files.
+            status = subprocess.check_output(['git', '-C', path, 'status', '--porcelain', '-z',
+                                              '--untracked-files=all', '--', '.'],
+                                             stderr=null)
+        h = hashlib.sha256()
+        for e in index.split('\0'):
+            if e and not self.__excluded(e.split('\t', 1)[-1]):
+                h.update(e + '\0')
+        for e in status.split('\0'):
+            f = os.path.join(top, e[3:])
+            if len(e) < 4 or self.__excluded(os.path.relpath(f, path)):
+                continue
+            h.update(e + '\0')
+            if os.path.isfile(f):
+                self.__hash_file(h, f)
+        return h.hexdigest()
+
+    def __tree_walk(self, path):
+        h = hashlib.sha256()
+        for root, dirs, files in os.walk(path):
+            dirs[:] = sorted(d for d in dirs if d != '.git' and not self.__excluded(d))
+            for f in sorted(files):
+                if self.__excluded(f):
+                    continue
+                p = os.path.join(root, f)
+                h.update(os.path.relpath(p, path) + '\0')
+                if os.path.isfile(p):
+                    self.__hash_file(h, p)
+        return h.hexdigest()
+
+    def tree(self, path):
+        """Hash the contents of a file or directory."""
+        path = os.path.abspath(path)
+        if path not in self.trees:
+            if os.path.isfile(path):
+                h = hashlib.sha256()
+                self.__hash_file(h, path)
+                self.trees[path] = h.hexdigest()
+            elif not os.path.isdir(path):
+                raise OnlPackageError("Build cache input '%s' does not exist." % path)
+            else:
+                try:
+                    self.trees[path] = self.__tree_git(path)
+                except (subprocess.CalledProcessError, OSError):
+                    self.trees[path] = self.__tree_walk(path)
+        return self.trees[path]
+
+    @classmethod
+    def __expand(cls, s, variables):
+        """Expand variable references, or return None if one is unknown."""
+        unknown = []
+        def sub(m):
+            name = m.group(1) or m.group(2) or m.group(3)
+            if name not in variables:
+                unknown.append(name)
+                return ''
+            return variables[name]
+        s = cls.VARIABLE.sub(sub, s)
+        return None if unknown else s
+
+    @staticmethod
+    def __package_root(path):
+        """The package directory containing path, or the directory of path."""
+        onl = os.getenv('ONL')
+        d = os.path.dirname(os.path.abspath(path))
+        while d != onl and d != os.path.dirname(d):
+            for spec in [ 'PKG.yml', 'APKG.yml', 'pkg.yml' ]:
+                if os.path.exists(os.path.join(d, spec)):
+                    return d
+            d = os.path.dirname(d)
+        return os.path.dirname(os.path.abspath(path))
+
+    def __module_dirs(self):
+        """Map infra module names to their directories under $ONL/packages."""
+        if self.modules is None:
+            self.modules = {}
+            onl = os.getenv('ONL')
+            if onl:
+                try:
+                    with open(os.devnull, 'w') as null:
+                        files = subprocess.check_output(['git', '-C', onl, 'ls-files', '-z', '--',
+                                                         'packages/*/.module'], stderr=null)
+                    files = [ os.path.join(onl, f) for f in files.split('\0') if f ]
+                except (subprocess.CalledProcessError, OSError):
+                    files = []
+                for f in files:
+                    for line in open(f):
+                        if line.startswith('name:'):
+                            self.modules[line.split(':', 1)[1].strip()] = os.path.dirname(f)
+        return self.modules
+
+    def __sources(self, pg):
+        """Find the package and module directories a group's build reads."""
+        onl = os.getenv('ONL')
+        sm = os.path.join(onl, 'sm') if onl else None
+
+        variables = dict(os.environ)
+        if onl and 'BUILDER' not in variables:
+            variables['BUILDER'] = os.path.join(onl, 'sm', 'infra', 'builder', 'unix')
+
+        dirs = set()
+        modules = set()
+        seen = set()
+
+        def scan(path, yaml_vars=None):
+            path = os.path.abspath(path)
+            if path in seen or not os.path.isfile(path):
+                return
+            seen.add(path)
+            if sm and path.startswith(sm + os.sep):
+                # Hashed as a submodule.
+                return
+            dirs.add(self.__package_root(path))
+            data = open(path).read()
+
+            if yaml_vars is not None:
+                for (target, opts) in self.YAML_INCLUDE.findall(data):
+                    v = dict(yaml_vars)
+                    v['__DIR__'] = os.path.dirname(path)
+                    v.update(o.split('=', 1) for o in opts.split())
+                    f = self.__expand(target, v)
+                    if f is None:
+                        logger.debug("Build cache: cannot resolve '%s' in %s" % (target, path))
+                        continue
+                    if not os.path.isabs(f):
+                        f = os.path.join(os.path.dirname(path), f)
+                    scan(f, v)
+                return
+
+            for m in self.MAKE_INCLUDE.findall(data):
+                for target in m.split():
+                    f = self.__expand(target, variables)
+                    if f is None:
+                        logger.debug("Build cache: cannot resolve '%s' in %s" % (target, path))
+                        continue
+                    if not os.path.isabs(f):
+                        f = os.path.join(os.path.dirname(path), f)
+                    scan(f)
+            for m in self.MAKE_DEPENDMODULES.findall(data):
+                modules.update(m.split())
+
+        yaml_vars = dict(variables)
+        for (k, v) in OnlPackage.package_defaults_get(pg._pkgs['__source']).iteritems():
+            if isinstance(v, basestring):
+                yaml_vars[k] = v
+
+        d = pg._pkgs['__directory']
+        scan(pg._pkgs['__source'], yaml_vars)
+        for root, subdirs, files in os.walk(d):
+            subdirs[:] = sorted(x for x in subdirs if x != '.git' and not self.__excluded(x))
+            for f in sorted(files):
+                if f == 'Makefile' or f.endswith('.mk'):
+                    scan(os.path.join(root, f))
+
+        index = self.__module_dirs()
+        for m in modules:
+            if m in index:
+                dirs.add(index[m])
+
+        # Submodules, by checked out contents.
+        if sm and os.path.isdir(sm):
+            for e in os.listdir(sm):
+                if os.path.isdir(os.path.join(sm, e)) and os.listdir(os.path.join(sm, e)):
+                    dirs.add(os.path.join(sm, e))
+        for sub in pg.prerequisite_submodules():
+            if sub.get('root') and sub.get('path'):
+                p = os.path.join(sub['root'], sub['path'])
+                if os.path.isdir(p):
+                    dirs.add(os.path.abspath(p))
+
+        if onl:
+            dirs.add(os.path.join(onl, 'make'))
+
+        # Drop directories contained in others.
+        return [ x for x in sorted(dirs)
+                 if not any(x.startswith(y + os.sep) for y in dirs) ]
+
+    def toolchain(self, arch):
+        if arch not in self.toolchains:
+            cc = 'gcc'
+            if arch in self.TOOLCHAINS:
+                cc = "%s-gcc" % self.TOOLCHAINS[arch]
+            try:
+                with open(os.devnull, 'w') as null:
+                    self.toolchains[arch] = subprocess.check_output([cc, '--version'], stderr=null).splitlines()[0]
+            except (subprocess.CalledProcessError, OSError):
+                self.toolchains[arch] = 'none'
+        return self.toolchains[arch]
+
+    def key(self, pg, opr):
+        h = hashlib.sha256()
+        inputs = {}
+
+        inputs['dist'] = g_dist_codename
+        inputs['packages'] = [ self.__normalize(json.dumps(dict((k, v) for (k, v) in p.pkg.iteritems()
+                                                                if not k.startswith('__')),
+                                                           sort_keys=True, default=str))
+                               for p in pg.packages ]
+        inputs['toolchains'] = sorted(set(self.toolchain(p.arch()) for p in pg.packages))
+
+        trees = self.__sources(pg)
+        for i in onlu.sflatten(pg._pkgs.get('cache-inputs', [])):
+            trees.append(i if os.path.isabs(i) else os.path.join(pg._pkgs['__directory'], i))
+        inputs['trees'] = [ (self.__normalize(os.path.abspath(t)), self.tree(t)) for t in trees ]
+
+        inputs['prerequisites'] = []
+        for pr in sorted(pg.prerequisite_packages()):
+            path = opr.lookup(pr)
+            if path:
+                inputs['prerequisites'].append((pr, self.tree(path)))
+
+        h.update(json.dumps(inputs, sort_keys=True))
+        return h.hexdigest()
+
+    def __dir(self, key):
+        return os.path.join(self.root, key[:2], key)
+
+    def restore(self, pg, key, dir_=None):
+        """Restore the packages for this key, or return None."""
+        d = self.__dir(key)
+        manifest = os.path.join(d, 'manifest.json')
+        if not os.path.exists(manifest):
+            return None
+
+        if dir_ is None:
+            dir_ = pg._pkgs['__directory']
+
+        products = []
+        with self.lock:
+            for deb in json.load(open(manifest))['products']:
+                deb = str(deb)
+                src = os.path.join(d, deb)
+                if not os.path.exists(src):
+                    logger.warn("Build cache entry %s is incomplete." % key)
+                    return None
+                logger.debug("+ /bin/cp %s %s", src, dir_)
+                shutil.copy(src, dir_)
+                products.append(os.path.join(dir_, deb))
+            # Entries are expired by access time.
+            os.utime(manifest, None)
+        return products
+
+    def store(self, pg, key, products):
+        d = self.__dir(key)
+        with self.lock:
+            if os.path.exists(d):
+                shutil.rmtree(d)
+            os.makedirs(d)
+            for p in products:
+                shutil.copy(p, d)
+            with open(os.path.join(d, 'manifest.json'), 'w') as f:
+                json.dump(dict(source=self.__normalize(pg._pkgs['__source']),
+                               packages=[ p.id() for p in pg.packages ],
+                               products=[ os.path.basename(p) for p in products ],
+                               time=time.time()),
+                          f, indent=2)
+
+    def record(self, pg, key, result, seconds):
+        logger.info("Build cache %s for %s (%s) in %.1fs" % (result, ",".join(p.id() for p in pg.packages),
+                                                             key[:12], seconds))
+        with self.lock:
+            with open(os.path.join(self.root, 'stats'), 'a') as f:
+                f.write("%d %s %s %.1f %s\n" % (time.time(), result, key,
+                                                 seconds, ",".join(p.id() for p in pg.packages)))
+
+    def stats(self, handle=sys.stdout):
+        counts = {}
+        seconds = {}
+        path = os.path.join(self.root, 'stats')
+        if os.path.exists(path):
+            for line in open(path):
+                f = line.split()
+                if len(f) >= 4:
+                    counts[f[1]] = counts.get(f[1], 0) + 1
+                    seconds[f[1]] = seconds.get(f[1], 0.0) + float(f[3])
+        total = sum(counts.values())
+        for r in [ 'hit', 'miss', 'skip' ]:
+            handle.write("%-5s %6d %5.1f%% %10.1fs\n" % (r, counts.get(r, 0),
+                                                        100.0 * counts.get(r, 0) / total if total else 0,
+                                                        seconds.get(r, 0.0)))
+
+class OnlPackageScheduler(object):
+    """Parallel Package Group Scheduler
+
+    Builds a set of package groups in dependency order from a single
+    process. The dependency graph is built from the prerequisite
+    packages of each group, across all architectures. Each group is
+    built in a forked worker so the loaded package groups do not
+    have to be reloaded. At most 'jobs' workers run at once.
+
+    Ready groups are started in order of their critical path, which is
+    the longest chain of estimated build times from the group to the
+    end of the build. Estimates are the durations of the last successful
+    build of each group, kept in <dir>/durations.json.
+
+    Each group's build output is written to <dir>/building/<name>.
+    When the build ends it is moved to <dir>/finished or <dir>/failed.
+    A Chrome trace (chrome://tracing, Perfetto) of the run is written
+    to <dir>/trace.json."""
+
+    def __init__(self, pm, jobs, dir_, force=False, keep_going=False):
+        self.pm = pm
+        self.jobs = max(1, jobs)
+        self.dir = dir_
+        self.force = force
+        self.keep_going = keep_going
+        self.groups = {}
+        self.owners = {}
+        for pg in pm.package_groups:
+            for p in pg.packages:
+                self.owners[p.id()] = pg
+
+    @staticmethod
+    def name(pg):
+        onl = os.getenv('ONL')
+        d = pg._pkgs['__directory']
+        if onl and d.startswith(onl):
+            d = os.path.relpath(d, onl)
+        return d.strip('/').replace('/', '_')
+
+    @staticmethod
+    def stage(pg):
+        prereqs = pg.prerequisites()
+        if prereqs.get('broken', False):
+            return 20
+        if prereqs.get('stage', False):
+            return prereqs.get('stage')
+        return 1 if len(pg.prerequisite_packages()) else 0
+
+    def add(self, pg):
+        """Add a package group and its prerequisite groups."""
+        if pg in self.groups:
+            return
+        if self.stage(pg) == 20:
+            logger.warn("Skipping broken package group %s." % self.name(pg))
+            return
+        self.groups[pg] = []
+        for pr in pg.prerequisite_packages():
+            dep = self.owners.get(pr, None)
+            if dep is None:
+                # Not known here, required (or reported missing) by the build.
+                continue
+            self.add(dep)
+            if dep in self.groups and dep is not pg and dep not in self.groups[pg]:
+                self.groups[pg].append(dep)
+
+    def __built(self, pg):
+        for p in pg.packages:
+            if p.id() not in self.pm.opr:
+                return False
+        return True
+
+    def __estimates(self):
+        """Durations of the last successful build of each group."""
+        path = os.path.join(self.dir, 'durations.json')
+        if os.path.exists(path):
+            try:
+                return json.load(open(path))
+            except ValueError:
+                logger.warn("Ignoring malformed build durations %s." % path)
+        return {}
+
+    def __priorities(self, nodes, deps):
+        """Critical path length from each group to the end of the build."""
+        est = self.__estimates()
+        default = sorted(est.values())[len(est) / 2] if est else 1.0
+
+        dependents = dict((pg, []) for pg in nodes)
+        for pg in nodes:
+            for d in deps[pg]:
+                dependents[d].append(pg)
+
+        rv = {}
+        def visit(pg, path):
+            if pg in rv:
+                return rv[pg]
+            if pg in path:
+                raise OnlPackageError("Circular package dependency: %s" %
+                                      " -> ".join(self.name(x) for x in path + [ pg ]))
+            below = [ visit(x, path + [ pg ]) for x in dependents[pg] ]
+            rv[pg] = est.get(self.name(pg), default) + max(below or [ 0 ])
+            return rv[pg]
+
+        for pg in nodes:
+            visit(pg, [])
+        return rv
+
+    def __start(self, pg):
+        log = os.path.join(self.dir, 'building', self.name(pg))
+        pid = os.fork()
+        if pid == 0:
+            rc = 1
+            try:
+                fd = os.open(log, os.O_WRONLY | os.O_CREAT | os.O_TRUNC, 0644)
+                os.dup2(fd, 1)
+                os.dup2(fd, 2)
+                os.close(fd)
+                self.pm.reopen()
+                self.pm.build_group(pg)
+                rc = 0
+            except Exception, e:
+                logger.error("%s: %s" % (self.name(pg), e))
+            finally:
+                sys.stdout.flush()
+                sys.stderr.flush()
+                os._exit(rc)
+        return pid
+
+    def run(self):
+        for d in [ 'building', 'finished', 'failed' ]:
+            p = os.path.join(self.dir, d)
+            if not os.path.exists(p):
+                os.makedirs(p)
+
+        # Groups which are already in the repo are not rebuilt, as with --require.
+        nodes = [ pg for pg in self.groups if self.force or not self.__built(pg) ]
+        deps = dict((pg, [ d for d in self.groups[pg] if d in nodes ]) for pg in nodes)
+
+        # Explicit stages still wait for every group in a lower stage.
+        for pg in nodes:
+            if pg.prerequisites().get('stage', False):
+                deps[pg] += [ x for x in nodes if x not in deps[pg] and
+                              self.stage(x) < self.stage(pg) ]
+
+        prio = self.__priorities(nodes, deps)
+        waiting = dict((pg, len(deps[pg])) for pg in nodes)
+        dependents = dict((pg, []) for pg in nodes)
+        for pg in nodes:
+            for d in deps[pg]:
+                dependents[d].append(pg)
+
+        ready = []
+        seq = 0
+        for pg in nodes:
+            if waiting[pg] == 0:
+                heapq.heappush(ready, (-prio[pg], seq, pg))
+                seq += 1
+
+        logger.info("Building %d of %d package groups with %d jobs..." % (len(nodes), len(self.groups), self.jobs))
+
+        running = {}
+        slots = range(self.jobs)
+        events = []
+        failed = []
+        done = 0
+        t0 = time.time()
+
+        try:
+            while ready or running:
+                while ready and slots and not (failed and not self.keep_going):
+                    (p, _, pg) = heapq.heappop(ready)
+                    pid = self.__start(pg)
+                    running[pid] = (pg, time.time(), slots.pop(0))
+                    logger.info("Building %s (critical path %.1fs)..." % (self.name(pg), -p))
+
+                if not running:
+                    break
+
+                (pid, status) = os.wait()
+                if pid not in running:
+                    continue
+                (pg, start, slot) = running.pop(pid)
+                slots.append(slot)
+                end = time.time()
+                done += 1
+
+                name = self.name(pg)
+                ok = os.WIFEXITED(status) and os.WEXITSTATUS(status) == 0
+                shutil.move(os.path.join(self.dir, 'building', name),
+                            os.path.join(self.dir, 'finished' if ok else 'failed', name))
+                events.append(dict(name=name, cat='build', ph='X', pid=1, tid=slot + 1,
+                                   ts=int((start - t0) * 1000000), dur=int((end - start) * 1000000),
+                                   args=dict(status='ok' if ok else 'failed',
+                                             packages=[ x.id() for x in pg.packages ])))
+
+                if ok:
+                    logger.info("[%d/%d] Finished %s in %.1fs" % (done, len(nodes), name, end - start))
+                    for x in dependents[pg]:
+                        waiting[x] -= 1
+                        if waiting[x] == 0:
+                            heapq.heappush(ready, (-prio[x], seq, x))
+                            seq += 1
+                else:
+                    logger.error("[%d/%d] Failed %s, see %s" % (done, len(nodes), name,
+                                                              os.path.join(self.dir, 'failed', name)))
+                    failed.append(name)
+
+        except KeyboardInterrupt:
+            for pid in running:
+                os.kill(pid, signal.SIGTERM)
+            raise
+
+        finally:
+            if events:
+                with open(os.path.join(self.dir, 'trace.json'), 'w') as f:
+                    json.dump(dict(traceEvents=events, displayTimeUnit='ms'), f, indent=1)
+                logger.info("Wrote build trace %s (%.1fs)" % (os.path.join(self.dir, 'trace.json'), time.time() - t0))
+
+                durations = self.__estimates()
+                for e in events:
+                    if e['args']['status'] == 'ok':
+                        durations[e['name']] = e['dur'] / 1000000.0
+                with open(os.path.join(self.dir, 'durations.json'), 'w') as f:
+                    json.dump(durations, f, indent=2, sort_keys=True)
+
+        if failed:
+            blocked = [ self.name(pg) for pg in nodes if waiting[pg] ]
+            raise OnlPackageError("Failed to build: %s (%d package groups not started)" %
+                                  (" ".join(failed), len(blocked) + len(ready)))
+
+
 class OnlPackageManager(object):
 
     def __init__(self):
         # Stores all loaded package groups.
         self.package_groups = []
         self.opr = None
+        self.cache = None
 
     def set_repo(self, repodir, packagedir='packages'):
         self.opr = OnlPackageRepo(repodir, packagedir=packagedir)
+        self.opr_args = (repodir, packagedir)
+
+    def set_build_cache(self, cachedir):
+        self.cache = OnlPackageBuildCache(cachedir)
+        self.cache_dir = cachedir
+
+    def reopen(self):
+        """Reopen the repo and build cache locks after a fork.
+
+        File locks are shared with the parent through inherited handles,
+        so a forked builder needs its own."""
+        if self.opr:
+            self.set_repo(*self.opr_args)
+        if self.cache:
+            self.set_build_cache(self.cache_dir)
 
 
     def filter(self, subdir=None, arches=None, substr=None):
@@ -1053,46 +1673,72 @@ class OnlPackageManager(object):
                 if filtered and pg.filtered:
                     continue
 
-                if not prereqs_only:
-                    #
-                    # Process prerequisite submodules.
-                    # Only due this if we are building the actual package,
-                    # not processing the package dependencies.
-                    #
-                    for sub in pg.prerequisite_submodules():
-                        root = sub.get('root', None)
-                        path = sub.get('path', None)
-                        depth = sub.get('depth', None)
-                        recursive = sub.get('recursive', None)
+                self.build_group(pg, dir_=dir_, prereqs_only=prereqs_only)
+                built = True
 
-                        if not root:
-                            raise OnlPackageError("Submodule prerequisite in package %s does not have a root key." % pkg)
+        if not built:
+            raise OnlPackageMissingError(pkg)
 
-                        if not path:
-                            raise OnlPackageError("Submodule prerequisite in package %s does not have a path key." % pkg)
+    def build_group(self, pg, dir_=None, prereqs_only=False):
 
-                        try:
-                            manager = submodules.OnlSubmoduleManager(root)
-                            manager.require(path, depth=depth, recursive=recursive)
-                        except submodules.OnlSubmoduleError, e:
-                            raise OnlPackageError(e.value)
-
-                # Process prerequisite packages
-                for pr in pg.prerequisite_packages():
-                    logger.info("Requiring prerequisite package %s..." % pr)
-                    self.require(pr, build_missing=True)
-
-                if not prereqs_only:
-                    # Build package
-                    products = pg.build(dir_=dir_)
-                    if self.opr:
-                        # Add results to our repo
-                        self.opr.add_packages(products)
+        if not prereqs_only:
+            #
+            # Process prerequisite submodules.
+            # Only due this if we are building the actual package,
+            # not processing the package dependencies.
+            #
+            for sub in pg.prerequisite_submodules():
+                root = sub.get('root', None)
+                path = sub.get('path', None)
+                depth = sub.get('depth', None)
+                recursive = sub.get('recursive', None)
 
-                built = True
+                if not root:
+                    raise OnlPackageError("Submodule prerequisite in package %s does not have a root key." % pg._pkgs['__source'])
 
-        if not built:
-            raise OnlPackageMissingError(pkg)
+                if not path:
+                    raise OnlPackageError("Submodule prerequisite in package %s does not have a path key." % pg._pkgs['__source'])
+
+                try:
+                    manager = submodules.OnlSubmoduleManager(root)
+                    manager.require(path, depth=depth, recursive=recursive)
+                except submodules.OnlSubmoduleError, e:
+                    raise OnlPackageError(e.value)
+
+        # Process prerequisite packages
+        for pr in pg.prerequisite_packages():
+            logger.info("Requiring prerequisite package %s..." % pr)
+            self.require(pr, build_missing=True)
+
+        if not prereqs_only:
+            # Build package
+            products = self.__build_cached(pg, dir_)
+            if self.opr:
+                # Add results to our repo
+                self.opr.add_packages(products)
+
+    def __build_cached(self, pg, dir_):
+        """Build a package group, or restore it from the build cache."""
+
+        if self.cache is None or self.opr is None:
+            return pg.build(dir_=dir_)
+
+        start = time.time()
+        if not self.cache.cacheable(pg):
+            products = pg.build(dir_=dir_)
+            self.cache.record(pg, '-' * 64, 'skip', time.time() - start)
+            return products
+
+        key = self.cache.key(pg, self.opr)
+        products = self.cache.restore(pg, key, dir_)
+        if products is not None:
+            self.cache.record(pg, key, 'hit', time.time() - start)
+            return products
+
+        products = pg.build(dir_=dir_)
+        self.cache.store(pg, key, products)
+        self.cache.record(pg, key, 'miss', time.time() - start)
+        return products
 
     def clean(self, pkg=None, dir_=None):
         for pg in self.package_groups:
@@ -1212,6 +1858,13 @@ class OnlPackageManager(object):
 
 
 
+    def pbuild(self, jobs, dir_, force=False, keep_going=False):
+        """Build all filtered packages with the package scheduler."""
+        scheduler = OnlPackageScheduler(self, jobs, dir_, force=force, keep_going=keep_going)
+        for pg in self.filtered_package_groups():
+            scheduler.add(pg)
+        scheduler.run()
+
     def pkg_info(self):
         return "\n".join([ pg.pkg_info() for pg in self.package_groups if not pg.filtered ])
 
@@ -1270,6 +1923,14 @@ if __name__ == '__main__':
     ap.add_argument("--arch")
     ap.add_argument("--arches", nargs='+', default=['amd64', 'powerpc', 'armel', 'armhf', 'arm64', 'all']),
     ap.add_argument("--pmake", action='store_true')
+    ap.add_argument("--pbuild", action='store_true',
+                    help="Build all selected packages and their prerequisites in dependency order.")
+    ap.add_argument("--jobs", "-j", type=int, default=int(os.environ.get('ONLPM_OPTION_JOBS', 0)) or multiprocessing.cpu_count(),
+                    help="The number of package groups built at once by --pbuild.")
+    ap.add_argument("--pbuild-dir", metavar='DIR', default=os.environ.get('ONLPM_OPTION_PBUILD_DIR', None),
+                    help="Build logs and the build trace for --pbuild. The default is <repo>/<dist>/pbuild.")
+    ap.add_argument("--keep-going", action='store_true',
+                    help="Continue building unrelated package groups after a failure.")
     ap.add_argument("--prereq-packages", action='store_true')
     ap.add_argument("--lookup", metavar='PACKAGE')
     ap.add_argument("--find-file", nargs=2, metavar=('PACKAGE', 'FILE'))
@@ -1295,6 +1956,10 @@ if __name__ == '__main__':
     ap.add_argument("--in-repo", nargs='+', metavar='PACKAGE')
     ap.add_argument("--include-env-json", default=os.environ.get('ONLPM_OPTION_INCLUDE_ENV_JSON', None))
     ap.add_argument("--platform-manifest", metavar=('PACKAGE'))
+    ap.add_argument("--build-cache", metavar='DIR', default=os.environ.get('ONLPM_OPTION_BUILD_CACHE', None),
+                    help="Restore unchanged packages from a content-addressed build cache in DIR.")
+    ap.add_argument("--no-build-cache", action='store_true')
+    ap.add_argument("--build-cache-stats", action='store_true')
 
     ops = ap.parse_args()
 
@@ -1345,6 +2010,17 @@ if __name__ == '__main__':
             logger.debug("Setting repo as '%s'..." % ops.repo)
             pm.set_repo(ops.repo, packagedir=ops.repo_package_dir)
 
+        if ops.build_cache and not ops.no_build_cache:
+            logger.debug("Setting build cache as '%s'..." % ops.build_cache)
+            pm.set_build_cache(ops.build_cache)
+
+        if ops.build_cache_stats:
+            if pm.cache is None:
+                logger.error("No build cache specified. Please use the --build-cache option or set ONLPM_OPTION_BUILD_CACHE in the environment.")
+                sys.exit(1)
+            pm.cache.stats()
+            sys.exit(0)
+
         if ops.in_repo:
             for p in ops.in_repo:
                 print "%s: %s" % (p, p in pm.opr)
@@ -1392,6 +2068,11 @@ if __name__ == '__main__':
         if ops.pkg_info:
             print pm.pkg_info()
 
+        if ops.pbuild:
+            pm.pbuild(ops.jobs,
+                      ops.pbuild_dir or os.path.join(ops.repo, g_dist_codename, 'pbuild'),
+                      force=ops.force, keep_going=ops.keep_going)
+
 
         ############################################################
         #
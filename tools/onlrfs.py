@@ -20,12 +20,17 @@ import StringIO
 from collections import Iterable
 import onlyaml
 import onlu
+import onlcompress
 import fileinput
 import crypt
 import string
 import random
 import re
 import json
+import hashlib
+import copy
+import time
+import urllib2
 
 logger = onlu.init_logging('onlrfs')
 
@@ -298,6 +303,68 @@ class OnlRfsContext(object):
                 onlu.execute("sudo mv %s %s" % (self.resolvconfb, self.resolvconf),
                              ex=OnlRfsError("Could not restore resolv.conf"))
 
+class OnlRfsLayerCache(object):
+    """Root Filesystem Layer Cache
+
+    Stores root filesystem layers as complete directory trees under
+    <root>/<arch>/<layer>-<key>. A layer is restored by copying the
+    tree into the target directory, using reflinks where the
+    filesystem supports them.
+
+    Plain copies are used rather than an overlayfs mount because the
+    result must stay a normal directory for the cpio, squash and
+    manifest steps which follow."""
+
+    # The number of trees kept for each layer.
+    KEEP = 2
+
+    def __init__(self, root, arch):
+        self.root = os.path.join(root, arch)
+        if not os.path.exists(self.root):
+            os.makedirs(self.root)
+
+    def path(self, layer, key):
+        return os.path.join(self.root, "%s-%s" % (layer, key))
+
+    @staticmethod
+    def copy(src, dst):
+        if os.path.exists(dst):
+            onlu.execute("sudo rm -rf %s" % dst,
+                         ex=OnlRfsError("Could not remove %s." % dst))
+        onlu.execute("sudo cp -a --reflink=auto %s %s" % (src, dst),
+                     ex=OnlRfsError("Could not copy %s to %s." % (src, dst)))
+
+    def restore(self, layer, key, dir_):
+        src = self.path(layer, key)
+        if not os.path.exists(src + ".key"):
+            logger.info("Layer %s (%s) is not cached." % (layer, key[:12]))
+            return False
+        logger.info("Restoring layer %s (%s)..." % (layer, key[:12]))
+        self.copy(src, dir_)
+        # Mark the entry as recently used.
+        os.utime(src + ".key", None)
+        return True
+
+    def store(self, layer, key, dir_, inputs):
+        dst = self.path(layer, key)
+        logger.info("Caching layer %s (%s)..." % (layer, key[:12]))
+        self.copy(dir_, dst + ".tmp")
+        if os.path.exists(dst):
+            onlu.execute("sudo rm -rf %s" % dst)
+        onlu.execute("sudo mv %s.tmp %s" % (dst, dst),
+                     ex=OnlRfsError("Could not store layer %s." % layer))
+        with open(dst + ".key", "w") as f:
+            json.dump(inputs, f, indent=2, sort_keys=True)
+        self.prune(layer)
+
+    def prune(self, layer):
+        entries = sorted(glob.glob(os.path.join(self.root, "%s-*.key" % layer)),
+                         key=os.path.getmtime, reverse=True)
+        for k in entries[self.KEEP:]:
+            logger.info("Removing cached layer %s" % os.path.basename(k)[:-4])
+            onlu.execute("sudo rm -rf %s %s" % (k[:-4], k))
+
+
 class OnlRfsBuilder(object):
 
     DEFAULTS = dict(
@@ -312,6 +379,9 @@ class OnlRfsBuilder(object):
     QEMU_ARM64='/usr/bin/qemu-aarch64-static'
     BINFMT_PPC='/proc/sys/fs/binfmt_misc/qemu-ppc'
 
+    # Change this when the layer build steps change.
+    LAYER_VERSION=1
+
     def __init__(self, config, arch, **kwargs):
         self.kwargs = kwargs
         self.arch = arch
@@ -360,16 +430,21 @@ class OnlRfsBuilder(object):
     def msconfig(self, fname):
         return self.ms.generate_file(fname)
 
-    def multistrap(self, dir_):
-        msconfig = self.ms.generate_file()
-
+    def scan_local_repos(self, ms):
         # Optional local package updates
         if os.getenv("ONLRFS_NO_PACKAGE_SCAN") is None:
-            for r in self.ms.localrepos:
+            for r in ms.localrepos:
                 logger.info("Updating %s" % r)
                 if os.path.exists(os.path.join(r, 'Makefile')):
                     onlu.execute("make -C %s" % r)
 
+    def multistrap(self, dir_, ms=None):
+        if ms is None:
+            ms = self.ms
+
+        msconfig = ms.generate_file()
+        self.scan_local_repos(ms)
+
         if os.path.exists(dir_):
             onlu.execute("sudo rm -rf %s" % dir_,
                          ex=OnlRfsError("Could not remove target directory."))
@@ -381,7 +456,7 @@ class OnlRfsBuilder(object):
             raise OnlRfsError("Multistrap debug.")
 
 
-    def dpkg_configure(self, dir_):
+    def dpkg_configure(self, dir_, unpack=[]):
         if self.arch == 'powerpc':
             onlu.execute('sudo cp %s %s' % (self.QEMU_PPC, os.path.join(dir_, 'usr/bin')))
         if self.arch in [ 'armel', 'armhf' ]:
@@ -400,6 +475,7 @@ class OnlRfsBuilder(object):
 chmod +x /usr/sbin/policy-rc.d
 export DEBIAN_FRONTEND=noninteractive
 export DEBCONF_NONINTERACTIVE_SEEN=true
+%(unpack)s
 echo "127.0.0.1 localhost" >/etc/hosts
 touch /etc/fstab
 echo "localhost" >/etc/hostname
@@ -416,7 +492,7 @@ dpkg --configure -a || true
 dpkg --configure -a # configure any packages that failed the first time and abort on failure.
 
 rm -f /usr/sbin/policy-rc.d
-    """)
+    """ % dict(unpack="dpkg --force-depends --unpack %s" % " ".join(unpack) if unpack else ""))
 
         logger.info("dpkg-configure filesystem...")
 
@@ -426,9 +502,156 @@ rm -f /usr/sbin/policy-rc.d
 
 
 
-    def configure(self, dir_):
+    def __local_sources(self):
+        return [ f['source'] for f in self.ms.config.values()
+                 if os.path.isdir(str(f.get('source', ''))) ]
+
+    def __local_deb(self, name):
+        for src in self.__local_sources():
+            debs = sorted(glob.glob(os.path.join(src, "%s_*.deb" % name)))
+            if debs:
+                return debs[-1]
+        return None
 
-        if not os.getenv('NO_DPKG_CONFIGURE'):
+    @staticmethod
+    def __deb_depends(deb):
+        rv = []
+        for field in [ 'Pre-Depends', 'Depends' ]:
+            for dep in subprocess.check_output([ 'dpkg-deb', '-f', deb, field ]).split(','):
+                # Only the first alternative, without version or architecture.
+                dep = dep.split('|')[0].strip()
+                if dep:
+                    rv.append(re.split(r'[\s(:]', dep)[0])
+        return rv
+
+    @staticmethod
+    def __sha256(fname):
+        h = hashlib.sha256()
+        with open(fname, 'rb') as f:
+            for block in iter(lambda: f.read(1 << 20), b''):
+                h.update(block)
+        return h.hexdigest()
+
+    @staticmethod
+    def mirror_indexes(ms):
+        """Hash the Release file of each remote archive in ms.
+
+        The base layer depends on the package versions the mirrors
+        resolve, which change with point and security updates.
+        An archive whose Release file cannot be fetched hashes as None."""
+        indexes = {}
+        for (name, f) in ms.config.iteritems():
+            source = str(f.get('source', ''))
+            if 'suite' not in f or not re.match(r'(https?|ftp)://', source):
+                continue
+            indexes[name] = None
+            for index in [ 'InRelease', 'Release' ]:
+                url = "%s/dists/%s/%s" % (source.rstrip('/'), f['suite'], index)
+                try:
+                    indexes[name] = hashlib.sha256(urllib2.urlopen(url, timeout=60).read()).hexdigest()
+                    break
+                except (urllib2.URLError, IOError), e:
+                    logger.debug("%s: %s" % (url, e))
+            if indexes[name] is None:
+                logger.warn("Could not fetch the Release file for %s (%s)." % (name, source))
+        return indexes
+
+    def layer_packages(self):
+        """Split the package list into the base and ONL layers.
+
+        Returns (base, onl). base lists the packages installed from
+        the Debian and remote archives, including the dependencies of
+        local packages. onl maps the packages found in the local
+        repositories, including local dependencies, to their .deb files."""
+        base = []
+        onl = {}
+        pending = list(self.get_packages())
+        while pending:
+            name = pending.pop(0)
+            if name in onl or name in base:
+                continue
+            deb = self.__local_deb(name)
+            if deb:
+                onl[name] = deb
+                pending += self.__deb_depends(deb)
+            else:
+                base.append(name)
+        return (base, onl)
+
+    def __base_config(self, base):
+        """The multistrap configuration without the local repositories."""
+        config = copy.deepcopy(self.ms.config)
+        local = [ n for (n, f) in config.iteritems() if os.path.isdir(str(f.get('source', ''))) ]
+        for n in local:
+            del config[n]
+        for entry in [ 'debootstrap', 'aptsources' ]:
+            config['General'][entry] = " ".join(e for e in config['General'][entry].split() if e not in local)
+        for f in config.values():
+            if 'packages' in f:
+                f['packages'] = base
+        return OnlMultistrapConfig(config)
+
+    def build_layers(self, dir_, cache):
+        """Assemble the base and ONL package layers in dir_.
+
+        The base layer is the multistrap of all Debian packages,
+        configured. The ONL layer adds the local packages to the base
+        layer. Each layer is keyed by the hash of its inputs, so a
+        change to an ONL package only rebuilds the ONL layer.
+        The base layer inputs include the Release file of every remote
+        archive, so a mirror update rebuilds it."""
+
+        # Update the local repositories before their packages are hashed.
+        str(self.ms)
+        self.scan_local_repos(self.ms)
+
+        (base, onl) = self.layer_packages()
+        bms = self.__base_config(base)
+
+        postinst = os.path.join(os.getenv('ONL'), 'tools', 'scripts', 'base-files.postinst')
+        binputs = dict(version=self.LAYER_VERSION, arch=self.arch,
+                       multistrap=bms.config, postinst=self.__sha256(postinst),
+                       mirrors=self.mirror_indexes(bms))
+        bkey = hashlib.sha256(json.dumps(binputs, sort_keys=True)).hexdigest()
+
+        oinputs = dict(base=bkey,
+                       packages=dict((n, "%s %s" % (os.path.basename(d), self.__sha256(d)))
+                                     for (n, d) in onl.iteritems()))
+        okey = hashlib.sha256(json.dumps(oinputs, sort_keys=True)).hexdigest()
+
+        if cache.restore('onl', okey, dir_):
+            return
+
+        start = time.time()
+        if not cache.restore('base', bkey, dir_):
+            self.multistrap(dir_, bms)
+            with OnlRfsContext(dir_, resolvconf=False):
+                self.dpkg_configure(dir_)
+            cache.store('base', bkey, dir_, binputs)
+        logger.info("Base layer ready in %.1fs" % (time.time() - start))
+
+        start = time.time()
+        debs = os.path.join(dir_, 'tmp', 'onlrfs-debs')
+        onlu.execute("sudo mkdir -p %s" % debs)
+        onlu.execute("sudo cp %s %s" % (" ".join(sorted(onl.values())), debs),
+                     ex=OnlRfsError("Could not copy the ONL packages."))
+        with OnlRfsContext(dir_, resolvconf=False):
+            self.dpkg_configure(dir_, unpack=[ os.path.join('/tmp/onlrfs-debs', os.path.basename(d))
+                                               for d in sorted(onl.values()) ])
+        onlu.execute("sudo rm -rf %s" % debs)
+        cache.store('onl', okey, dir_, oinputs)
+        logger.info("ONL layer ready in %.1fs" % (time.time() - start))
+
+    @staticmethod
+    def normalize_mtimes(dir_, epoch):
+        """Clamp all timestamps in dir_ to epoch for reproducible images."""
+        logger.info("Clamping timestamps in %s to %s..." % (dir_, epoch))
+        onlu.execute("sudo find %s -xdev -newermt @%s -exec touch -h -d @%s {} +" % (dir_, epoch, epoch),
+                     ex=OnlRfsError("Could not normalize timestamps."))
+
+    def configure(self, dir_, dpkg=True):
+
+        if dpkg and not os.getenv('NO_DPKG_CONFIGURE'):
             with OnlRfsContext(dir_, resolvconf=False):
                 self.dpkg_configure(dir_)
 
@@ -681,9 +904,15 @@ if __name__ == '__main__':
     ap.add_argument("--no-multistrap", action='store_true')
     ap.add_argument("--cpio")
     ap.add_argument("--squash")
+    ap.add_argument("--squash-compression", metavar='SPEC', default=os.getenv('ONLRFS_SQUASH_COMPRESSION', 'gzip'),
+                    help="The squashfs compression. See onlcompress.py.")
+    ap.add_argument("--cpio-compression", metavar='SPEC', default=os.getenv('ONLRFS_CPIO_COMPRESSION', 'gzip'),
+                    help="The cpio compression. See onlcompress.py.")
     ap.add_argument("--enable-root")
 
     ap.add_argument("--no-configure", action='store_true')
+    ap.add_argument("--layer-cache", metavar='DIR', default=os.getenv('ONLRFS_LAYER_CACHE'),
+                    help="Cache the base and ONL package layers in DIR.")
     ap.add_argument("--update", action='append')
     ap.add_argument("--install", action='append')
 
@@ -711,6 +940,10 @@ if __name__ == '__main__':
         sys.exit(0)
 
     try:
+        # Check the compression settings before the build.
+        squash_comp = onlcompress.OnlCompression(ops.squash_compression)
+        cpio_comp = onlcompress.OnlCompression(ops.cpio_compression)
+
         x = OnlRfsBuilder(ops.config, ops.arch)
 
         if ops.msconfig:
@@ -736,11 +969,17 @@ if __name__ == '__main__':
             x.multistrap(ops.dir)
             sys.exit(0)
 
+        layered = False
         if not ops.no_multistrap and not os.getenv('NO_MULTISTRAP'):
-            x.multistrap(ops.dir)
+            if ops.layer_cache:
+                x.build_layers(ops.dir, OnlRfsLayerCache(ops.layer_cache, ops.arch))
+                layered = True
+            else:
+                x.multistrap(ops.dir)
 
         if not ops.no_configure and not os.getenv('NO_DPKG_CONFIGURE'):
-            x.configure(ops.dir)
+            # The package layers are already configured.
+            x.configure(ops.dir, dpkg=not layered)
 
         if ops.update:
             x.update(ops.dir, ops.update)
@@ -748,17 +987,22 @@ if __name__ == '__main__':
         if ops.install:
             x.install(ops.dir, ops.install)
 
+        epoch = os.getenv('SOURCE_DATE_EPOCH')
+        if epoch and (ops.cpio or ops.squash):
+            x.normalize_mtimes(ops.dir, epoch)
+
         if ops.cpio:
-            if onlu.execute("%s/tools/scripts/make-cpio.sh %s %s" % (os.getenv('ONL'), ops.dir, ops.cpio)) != 0:
+            if onlu.execute("%s/tools/scripts/make-cpio.sh %s %s '%s'" % (os.getenv('ONL'), ops.dir, ops.cpio, cpio_comp.stream_command())) != 0:
                 raise OnlRfsError("cpio creation failed.")
 
         if ops.squash:
             if os.path.exists(ops.squash):
                 os.unlink(ops.squash)
-            if onlu.execute("sudo mksquashfs %s %s -no-progress -noappend -comp gzip" % (ops.dir, ops.squash)) != 0:
+            env = "SOURCE_DATE_EPOCH=%s " % epoch if epoch else ""
+            if onlu.execute("sudo %smksquashfs %s %s -no-progress -noappend %s" % (env, ops.dir, ops.squash, squash_comp.squashfs_args())) != 0:
                 if os.path.exists(ops.squash):
                     os.unlink(ops.squash)
                 raise OnlRfsError("Squash creation failed.")
 
-    except (OnlRfsError, onlyaml.OnlYamlError), e:
+    except (OnlRfsError, onlyaml.OnlYamlError, onlcompress.OnlCompressionError), e:
         logger.error(e.value)
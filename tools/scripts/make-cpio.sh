@@ -6,10 +6,13 @@ if [ "${UID}" != 0 ]; then
 fi
 
 if [ -z "$1" ] || [ -z "$2" ]; then
-    echo "usage: $0 src-dir dst-cpio-gz-file"
+    echo "usage: $0 src-dir dst-cpio-gz-file [compress-command]"
     exit 1
 fi
 
+# The default is gzip. See tools/onlcompress.py --stream for others.
+COMPRESS=${3:-gzip -f}
+
 SRCDIR=`readlink -f $1`
 DSTCPIOGZ=`readlink -f $2`
 
@@ -22,4 +25,4 @@ if [ -e "$DSTCPIOGZ" ]; then
     echo "Removing existing $DSTCPIOGZ"
 fi
 
-cd "$SRCDIR" && find . | cpio -H newc -o | gzip -f > "$DSTCPIOGZ"
+cd "$SRCDIR" && find . | cpio -H newc -o | $COMPRESS > "$DSTCPIOGZ"
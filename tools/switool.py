@@ -19,10 +19,12 @@ class OnlSwitchImage(object):
         self.manifest = None
 
     def add(self, fname, arcname=None, compressed=True):
-        self.zipfile.write(fname, arcname=arcname, compress_type = zipfile.ZIP_DEFLATED if compressed else zipefile.ZIP_STORED)
+        self.zipfile.write(fname, arcname=arcname, compress_type = zipfile.ZIP_DEFLATED if compressed else zipfile.ZIP_STORED)
 
     def add_rootfs(self, rootfs_sqsh):
-        self.add(rootfs_sqsh)
+        # The squashfs is already compressed. Storing it keeps
+        # the extraction at install and boot time to a copy.
+        self.add(rootfs_sqsh, compressed=False)
 
     def add_manifest(self, manifest):
         self.add(manifest, arcname="manifest.json")